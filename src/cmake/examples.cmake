@@ -46,6 +46,12 @@ add_executable(${EXAMPLE_TLS_CLIENT} ${${EXAMPLE_TLS_CLIENT}_objects} )
 target_link_libraries( ${EXAMPLE_TLS_CLIENT} ${LIB_DODO} )
 install( TARGETS ${EXAMPLE_TLS_CLIENT} RUNTIME DESTINATION bin )
 
+set( EXAMPLE_TLS_BENCH  "tls-bench" )
+set( ${EXAMPLE_TLS_BENCH}_objects  src/examples/tls/${EXAMPLE_TLS_BENCH}/${EXAMPLE_TLS_BENCH}.cpp )
+add_executable(${EXAMPLE_TLS_BENCH} ${${EXAMPLE_TLS_BENCH}_objects} )
+target_link_libraries( ${EXAMPLE_TLS_BENCH} ${LIB_DODO} )
+install( TARGETS ${EXAMPLE_TLS_BENCH} RUNTIME DESTINATION bin )
+
 set( EXAMPLE_SQLITE  "sqlite" )
 set( ${EXAMPLE_SQLITE}_objects  src/examples/${EXAMPLE_SQLITE}/${EXAMPLE_SQLITE}.cpp )
 add_executable(${EXAMPLE_SQLITE} ${${EXAMPLE_SQLITE}_objects} )
@@ -69,3 +75,15 @@ set( ${EXAMPLE_HTTP_CLIENT}_objects  src/examples/${EXAMPLE_HTTP_CLIENT}/${EXAMP
 add_executable(${EXAMPLE_HTTP_CLIENT} ${${EXAMPLE_HTTP_CLIENT}_objects} )
 target_link_libraries( ${EXAMPLE_HTTP_CLIENT} ${LIB_DODO} )
 install( TARGETS ${EXAMPLE_HTTP_CLIENT} RUNTIME DESTINATION bin )
+
+set( EXAMPLE_HTTP_SCAN_BENCH  "http-scan-bench" )
+set( ${EXAMPLE_HTTP_SCAN_BENCH}_objects  src/examples/${EXAMPLE_HTTP_SCAN_BENCH}/${EXAMPLE_HTTP_SCAN_BENCH}.cpp )
+add_executable(${EXAMPLE_HTTP_SCAN_BENCH} ${${EXAMPLE_HTTP_SCAN_BENCH}_objects} )
+target_link_libraries( ${EXAMPLE_HTTP_SCAN_BENCH} ${LIB_DODO} )
+install( TARGETS ${EXAMPLE_HTTP_SCAN_BENCH} RUNTIME DESTINATION bin )
+
+set( EXAMPLE_TCP_BENCH  "tcp-bench" )
+set( ${EXAMPLE_TCP_BENCH}_objects  src/examples/${EXAMPLE_TCP_BENCH}/${EXAMPLE_TCP_BENCH}.cpp )
+add_executable(${EXAMPLE_TCP_BENCH} ${${EXAMPLE_TCP_BENCH}_objects} )
+target_link_libraries( ${EXAMPLE_TCP_BENCH} ${LIB_DODO} )
+install( TARGETS ${EXAMPLE_TCP_BENCH} RUNTIME DESTINATION bin )
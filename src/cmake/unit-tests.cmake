@@ -24,6 +24,12 @@ add_executable(${TEST_COMMON_BYTES} ${${TEST_COMMON_BYTES}_objects} )
 target_link_libraries( ${TEST_COMMON_BYTES} ${LIB_DODO} )
 add_test (NAME "common::Bytes=${TEST_COMMON_BYTES}" COMMAND ${TEST_COMMON_BYTES} )
 
+set( TEST_COMMON_HISTOGRAM  "test-common-histogram" )
+set( ${TEST_COMMON_HISTOGRAM}_objects  tests/common/${TEST_COMMON_HISTOGRAM}.cpp )
+add_executable(${TEST_COMMON_HISTOGRAM} ${${TEST_COMMON_HISTOGRAM}_objects} )
+target_link_libraries( ${TEST_COMMON_HISTOGRAM} ${LIB_DODO} )
+add_test (NAME "common::Histogram=${TEST_COMMON_HISTOGRAM}" COMMAND ${TEST_COMMON_HISTOGRAM} )
+
 set( TEST_COMMON_DATACRYPT  "test-common-datacrypt" )
 set( ${TEST_COMMON_DATACRYPT}_objects  tests/common/${TEST_COMMON_DATACRYPT}.cpp )
 add_executable(${TEST_COMMON_DATACRYPT} ${${TEST_COMMON_DATACRYPT}_objects} )
@@ -32,6 +38,18 @@ add_test (NAME "common::DataCrypt=${TEST_COMMON_DATACRYPT}" COMMAND ${TEST_COMMO
 
 add_test (NAME "common::DataCrypt::cryptstr" COMMAND test "$(echo $(echo 'secret' | bin/cryptstr -e -k val:password) | bin/cryptstr -d -k val:password ) == 'secret'" )
 
+set( TEST_THREADS_MPMCQUEUE  "test-threads-mpmcqueue" )
+set( ${TEST_THREADS_MPMCQUEUE}_objects  tests/threads/${TEST_THREADS_MPMCQUEUE}.cpp )
+add_executable(${TEST_THREADS_MPMCQUEUE} ${${TEST_THREADS_MPMCQUEUE}_objects} )
+target_link_libraries( ${TEST_THREADS_MPMCQUEUE} ${LIB_DODO} )
+add_test (NAME "threads::MPMCQueue=${TEST_THREADS_MPMCQUEUE}" COMMAND ${TEST_THREADS_MPMCQUEUE} )
+
+set( TEST_THREADS_SEMAPHORE  "test-threads-semaphore" )
+set( ${TEST_THREADS_SEMAPHORE}_objects  tests/threads/${TEST_THREADS_SEMAPHORE}.cpp )
+add_executable(${TEST_THREADS_SEMAPHORE} ${${TEST_THREADS_SEMAPHORE}_objects} )
+target_link_libraries( ${TEST_THREADS_SEMAPHORE} ${LIB_DODO} )
+add_test (NAME "threads::Semaphore=${TEST_THREADS_SEMAPHORE}" COMMAND ${TEST_THREADS_SEMAPHORE} )
+
 set( TEST_NETWORK_ADDRESS  "test-network-address" )
 set( ${TEST_NETWORK_ADDRESS}_objects  tests/network/${TEST_NETWORK_ADDRESS}.cpp )
 add_executable(${TEST_NETWORK_ADDRESS} ${${TEST_NETWORK_ADDRESS}_objects} )
@@ -56,6 +74,42 @@ add_executable(${TEST_NETWORK_URI} ${${TEST_NETWORK_URI}_objects} )
 target_link_libraries( ${TEST_NETWORK_URI} ${LIB_DODO} )
 add_test (NAME "network::URI=${TEST_NETWORK_URI}" COMMAND ${TEST_NETWORK_URI} )
 
+set( TEST_NETWORK_HANDOVER  "test-network-handover" )
+set( ${TEST_NETWORK_HANDOVER}_objects  tests/network/${TEST_NETWORK_HANDOVER}.cpp )
+add_executable(${TEST_NETWORK_HANDOVER} ${${TEST_NETWORK_HANDOVER}_objects} )
+target_link_libraries( ${TEST_NETWORK_HANDOVER} ${LIB_DODO} )
+add_test (NAME "network::Handover=${TEST_NETWORK_HANDOVER}" COMMAND ${TEST_NETWORK_HANDOVER} )
+
+set( TEST_NETWORK_RATELIMITER  "test-network-ratelimiter" )
+set( ${TEST_NETWORK_RATELIMITER}_objects  tests/network/${TEST_NETWORK_RATELIMITER}.cpp )
+add_executable(${TEST_NETWORK_RATELIMITER} ${${TEST_NETWORK_RATELIMITER}_objects} )
+target_link_libraries( ${TEST_NETWORK_RATELIMITER} ${LIB_DODO} )
+add_test (NAME "network::RateLimiter=${TEST_NETWORK_RATELIMITER}" COMMAND ${TEST_NETWORK_RATELIMITER} )
+
+set( TEST_NETWORK_SCALINGPOLICY  "test-network-scalingpolicy" )
+set( ${TEST_NETWORK_SCALINGPOLICY}_objects  tests/network/${TEST_NETWORK_SCALINGPOLICY}.cpp )
+add_executable(${TEST_NETWORK_SCALINGPOLICY} ${${TEST_NETWORK_SCALINGPOLICY}_objects} )
+target_link_libraries( ${TEST_NETWORK_SCALINGPOLICY} ${LIB_DODO} )
+add_test (NAME "network::LatencyScalingPolicy=${TEST_NETWORK_SCALINGPOLICY}" COMMAND ${TEST_NETWORK_SCALINGPOLICY} )
+
+set( TEST_NETWORK_TIMERWHEEL  "test-network-timerwheel" )
+set( ${TEST_NETWORK_TIMERWHEEL}_objects  tests/network/${TEST_NETWORK_TIMERWHEEL}.cpp )
+add_executable(${TEST_NETWORK_TIMERWHEEL} ${${TEST_NETWORK_TIMERWHEEL}_objects} )
+target_link_libraries( ${TEST_NETWORK_TIMERWHEEL} ${LIB_DODO} )
+add_test (NAME "network::TimerWheel=${TEST_NETWORK_TIMERWHEEL}" COMMAND ${TEST_NETWORK_TIMERWHEEL} )
+
+set( TEST_NETWORK_TLSSESSIONCACHE  "test-network-tlssessioncache" )
+set( ${TEST_NETWORK_TLSSESSIONCACHE}_objects  tests/network/${TEST_NETWORK_TLSSESSIONCACHE}.cpp )
+add_executable(${TEST_NETWORK_TLSSESSIONCACHE} ${${TEST_NETWORK_TLSSESSIONCACHE}_objects} )
+target_link_libraries( ${TEST_NETWORK_TLSSESSIONCACHE} ${LIB_DODO} )
+add_test (NAME "network::TLSSessionCache=${TEST_NETWORK_TLSSESSIONCACHE}" COMMAND ${TEST_NETWORK_TLSSESSIONCACHE} )
+
+set( TEST_NETWORK_TCPLISTENER  "test-network-tcplistener" )
+set( ${TEST_NETWORK_TCPLISTENER}_objects  tests/network/${TEST_NETWORK_TCPLISTENER}.cpp )
+add_executable(${TEST_NETWORK_TCPLISTENER} ${${TEST_NETWORK_TCPLISTENER}_objects} )
+target_link_libraries( ${TEST_NETWORK_TCPLISTENER} ${LIB_DODO} )
+add_test (NAME "network::TCPListener=${TEST_NETWORK_TCPLISTENER}" COMMAND ${TEST_NETWORK_TCPLISTENER} )
+
 set( TEST_NETWORK_PROTOCOL_HTTP  "test-network-protocol-http" )
 set( ${TEST_NETWORK_PROTOCOL_HTTP}_objects  tests/network/${TEST_NETWORK_PROTOCOL_HTTP}.cpp )
 add_executable(${TEST_NETWORK_PROTOCOL_HTTP} ${${TEST_NETWORK_PROTOCOL_HTTP}_objects} )
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <dodo.hpp>
+
+using namespace dodo;
+using namespace dodo::network;
+using namespace dodo::network::protocol::http;
+using namespace std;
+
+/**
+ * A HTTP message to scan.
+ */
+struct Sample {
+  string name;
+  string data;
+  bool response;
+};
+
+/**
+ * Read a file.
+ */
+string readFile( const string &filename ) {
+  ifstream file( filename, ios::binary );
+  stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+/**
+ * Walk the header section like the parser does: a token, then field values separated by whitespace, up to the end
+ * of each line. Returns the number of bytes scanned.
+ */
+size_t scanHeaders( const string &data ) {
+  const char* p = data.data();
+  const char* end = p + data.size();
+  size_t lines = 0;
+  while ( p < end ) {
+    size_t line = HTTPScan::lineSpan( p, static_cast<size_t>( end - p ) );
+    if ( line == 0 ) break;
+    const char* eol = p + line;
+    p += HTTPScan::tokenSpan( p, line );
+    while ( p < eol ) {
+      p++;
+      p += HTTPScan::fieldValueSpan( p, static_cast<size_t>( eol - p ) );
+    }
+    p = eol + 2;
+    lines++;
+  }
+  return lines ? static_cast<size_t>( std::min( p, end ) - data.data() ) : 0;
+}
+
+/**
+ * Parse the message with HTTPRequest or HTTPResponse. Returns the number of bytes parsed.
+ */
+size_t parseMessage( const Sample &sample ) {
+  StringReadBuffer buffer( sample.data );
+  HTTPFragment::ParseResult result;
+  if ( sample.response ) {
+    HTTPResponse response;
+    result = response.parse( buffer );
+  } else {
+    HTTPRequest request;
+    result = request.parse( buffer );
+  }
+  if ( !result.ok() && !result.eof() ) throw runtime_error( sample.name + " " + result.asString() );
+  return sample.data.size();
+}
+
+/**
+ * Run f over the sample for about 200ms and return the bytes/s.
+ */
+template <typename F> double measure( const Sample &sample, F f ) {
+  size_t bytes = 0;
+  auto start = chrono::steady_clock::now();
+  double seconds = 0.0;
+  do {
+    for ( size_t i = 0; i < 1000; i++ ) bytes += f( sample );
+    seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+  } while ( seconds < 0.2 );
+  return static_cast<double>( bytes ) / seconds;
+}
+
+/**
+ * Compares the HTTPScan implementations on the HTTP messages in tests/network/http (or the directory in argv[1]),
+ * and on a request with long header values, for the bare header scan and for a full parse.
+ */
+int main( int argc, char* argv[] ) {
+  int error = 0;
+  try {
+    dodo::initLibrary();
+    string dir = argc > 1 ? argv[1] : BuildEnv::getSourceDirectory() + "/../tests/network/http";
+    vector<Sample> samples;
+    for ( const auto &entry : filesystem::directory_iterator( dir ) ) {
+      if ( entry.path().extension() != ".http" ) continue;
+      string data = readFile( entry.path().string() );
+      samples.push_back( { entry.path().filename().string(), data, data.compare( 0, 5, "HTTP/" ) == 0 } );
+    }
+    sort( samples.begin(), samples.end(), []( const Sample &a, const Sample &b ) { return a.name < b.name; } );
+    samples.push_back( { "long-headers (generated)",
+                         "GET /index.html HTTP/1.1\r\n"
+                         "Host: www.example.com\r\n"
+                         "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+                         "Chrome/120.0.0.0 Safari/537.36\r\n"
+                         "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp\r\n"
+                         "X-Forwarded-For-Authorization-Token-Identifier: " + string( 200, 'x' ) + "\r\n"
+                         "Cookie: session=" + string( 512, 'c' ) + ";preferences=" + string( 256, 'p' ) + "\r\n"
+                         "\r\n", false } );
+
+    HTTPScan::Implementation best = HTTPScan::getBestImplementation();
+    cout << "best implementation: " << HTTPScan::implementationAsString( best ) << endl;
+    cout << left << setw( 26 ) << "message" << setw( 8 ) << "impl" << right << setw( 8 ) << "bytes"
+         << setw( 14 ) << "scan MB/s" << setw( 14 ) << "parse MB/s" << endl;
+    cout << fixed << setprecision( 1 );
+    for ( const auto &sample : samples ) {
+      for ( int im = HTTPScan::imScalar; im <= best; im++ ) {
+        HTTPScan::setImplementation( static_cast<HTTPScan::Implementation>( im ) );
+        double scan = measure( sample, []( const Sample &s ) { return scanHeaders( s.data ); } );
+        double parse = measure( sample, parseMessage );
+        cout << left << setw( 26 ) << sample.name << setw( 8 )
+             << HTTPScan::implementationAsString( HTTPScan::getImplementation() ) << right << setw( 8 )
+             << sample.data.size() << setw( 14 ) << scan / 1.0E6 << setw( 14 ) << parse / 1.0E6 << endl;
+      }
+    }
+    HTTPScan::setImplementation( best );
+  }
+  catch ( const std::exception &e ) {
+    cerr << e.what() << endl;
+    error = 1;
+  }
+  dodo::closeLibrary();
+  return error;
+}
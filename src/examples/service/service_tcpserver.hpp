@@ -13,6 +13,8 @@ class Server : public TCPServer {
 
     virtual TCPServer* addServer() { return new Server( listener_ ); }
 
+    virtual TCPServer* addShardServer( TCPListener &shard ) { return new Server( shard ); }
+
     virtual bool handShake( BaseSocket *socket, ssize_t &received, ssize_t &sent ) {
       return true;
     }
@@ -22,7 +24,7 @@ class Server : public TCPServer {
       const Bytes &buf = work.data->getReadBuffer();
       if ( buf.getSize() > 0 ) {
         if ( buf.getOctet(buf.getSize()-1) == '\n' ) {
-          error = work.socket->send( buf.getArray(), buf.getSize() );
+          error = work.data->send( work.socket, buf.getArray(), buf.getSize() );
           work.data->clearBuffer();
           return error;
         } else if ( buf.getOctet(0) == 0xff || buf.getOctet(0) == 0x04 ) {
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <iomanip>
+#include <dodo.hpp>
+
+using namespace dodo;
+using namespace dodo::common;
+using namespace dodo::network;
+using namespace std;
+
+/**
+ * Line echo TCPServer.
+ */
+class EchoServer : public TCPServer {
+  public:
+    explicit EchoServer( TCPListener &listener ) : TCPServer( listener ) {}
+
+    virtual TCPServer* addServer() { return new EchoServer( listener_ ); }
+
+    virtual TCPServer* addShardServer( TCPListener &shard ) { return new EchoServer( shard ); }
+
+    virtual bool handShake( BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual SystemError readSocket( TCPListener::SocketWork &work, ssize_t &sent ) {
+      const Bytes &buf = work.data->getReadBuffer();
+      if ( buf.getSize() > 0 && buf.getOctet( buf.getSize() - 1 ) == '\n' ) {
+        SystemError error = work.data->send( work.socket, buf.getArray(), buf.getSize() );
+        sent = buf.getSize();
+        work.data->clearBuffer();
+        return error;
+      }
+      return SystemError::ecEAGAIN;
+    }
+
+    virtual void shutDown( BaseSocket *socket ) {}
+};
+
+/**
+ * Runs a line echo request-response load against a TCPListener in one-shot, edge-triggered, worker-owned and
+ * io_uring mode, and reports the throughput, the mean request latency and the number of epoll_ctl and io_uring_enter
+ * calls per request.
+ */
+class TCPBench : public Application {
+  public:
+    explicit TCPBench( const StartParameters &param ) : Application( param ) {}
+
+    virtual int run() {
+      try {
+        YAML::Node server = Config::getConfig()->getValue<YAML::Node>( {"server"} );
+        size_t clients = Config::getConfig()->getValue<size_t>( {"bench","clients"} );
+        size_t requests = Config::getConfig()->getValue<size_t>( {"bench","requests"} );
+        cout << "mode            requests       req/s  latency-us  epoll_ctl/req  io_uring_enter/req" << endl;
+        for ( const string mode : { "one-shot", "edge-triggered", "worker-owned", "io_uring" } ) {
+          YAML::Node yaml = YAML::Clone( server );
+          yaml["edge-triggered"] = ( mode == "edge-triggered" );
+          yaml["worker-owned"] = ( mode == "worker-owned" );
+          yaml["io-engine"] = ( mode == "io_uring" ? "io_uring" : "epoll" );
+          bench( mode, yaml, clients, requests );
+        }
+        cout << "(re-arming with EPOLL_CTL_DEL + EPOLL_CTL_ADD costs 2 epoll_ctl/req)" << endl;
+      }
+      catch ( const std::exception &e ) {
+        cerr << e.what() << endl;
+        return 1;
+      }
+      return 0;
+    }
+
+  private:
+
+    void bench( const string &mode, const YAML::Node &yaml, size_t clients, size_t requests ) {
+      TCPListener listener( yaml );
+      listener.start( new EchoServer( listener ) );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+      Address address( yaml["listen-address"].as<string>(), yaml["listen-port"].as<uint16_t>() );
+      TCPListener::Stats before = listener.getStats();
+      std::atomic<size_t> ok = 0;
+      std::atomic<double> latency = 0;
+      auto start = std::chrono::steady_clock::now();
+      vector<std::thread> threads;
+      for ( size_t c = 0; c < clients; c++ ) {
+        threads.emplace_back( [&,c] {
+          Socket socket( true, SocketParams( address.getAddressFamily(), SocketParams::stSTREAM, SocketParams::pnHOPOPT ) );
+          if ( socket.connect( address ) != SystemError::ecOK ) return;
+          string line;
+          double elapsed = 0;
+          for ( size_t i = 0; i < requests; i++ ) {
+            string request = "request " + to_string( c ) + " " + to_string( i ) + "\n";
+            auto sent = std::chrono::steady_clock::now();
+            if ( socket.send( request.c_str(), request.size() ) != SystemError::ecOK ) break;
+            if ( socket.receiveLine( line ) != SystemError::ecOK || line + "\n" != request ) break;
+            elapsed += std::chrono::duration<double>( std::chrono::steady_clock::now() - sent ).count();
+            ok++;
+          }
+          double expected = latency;
+          while ( !latency.compare_exchange_weak( expected, expected + elapsed ) );
+          socket.close();
+        } );
+      }
+      for ( auto &t : threads ) t.join();
+      double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+      TCPListener::Stats after = listener.getStats();
+      listener.stop();
+      listener.wait();
+      cout << left << setw(15) << mode << right << setw(9) << ok <<
+              setw(12) << fixed << setprecision(0) << (double)ok / seconds <<
+              setw(12) << setprecision(1) << latency / (double)ok * 1.0E6 <<
+              setw(15) << setprecision(3) << (double)( after.epoll_ctls - before.epoll_ctls ) / (double)ok <<
+              setw(20) << setprecision(3) << (double)( after.uring_enters - before.uring_enters ) / (double)ok << endl;
+    }
+};
+
+int main( int argc, char* argv[], char** envp ) {
+  try {
+    TCPBench app( { argc > 1 ? argv[1] : "tcp-bench.yaml", argc, argv, envp } );
+    return app.run();
+  }
+  catch ( const std::exception &e ) {
+    cerr << "main::catch std::exception : " << e.what() << endl;
+    return 1;
+  }
+}
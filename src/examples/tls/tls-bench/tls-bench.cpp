@@ -0,0 +1,142 @@
+#include <iostream>
+#include <atomic>
+#include <vector>
+#include <iomanip>
+#include <dodo.hpp>
+
+using namespace dodo;
+using namespace dodo::common;
+using namespace dodo::network;
+using namespace std;
+
+/**
+ * Line echo TCPServer.
+ */
+class EchoServer : public TCPServer {
+  public:
+    explicit EchoServer( TCPListener &listener ) : TCPServer( listener ) {}
+
+    virtual TCPServer* addServer() { return new EchoServer( listener_ ); }
+
+    virtual TCPServer* addShardServer( TCPListener &shard ) { return new EchoServer( shard ); }
+
+    virtual bool handShake( BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual SystemError readSocket( TCPListener::SocketWork &work, ssize_t &sent ) {
+      const Bytes &buf = work.data->getReadBuffer();
+      if ( buf.getSize() > 0 && buf.getOctet( buf.getSize() - 1 ) == '\n' ) {
+        SystemError error = work.data->send( work.socket, buf.getArray(), buf.getSize() );
+        sent = buf.getSize();
+        work.data->clearBuffer();
+        return error;
+      }
+      return SystemError::ecEAGAIN;
+    }
+
+    virtual void shutDown( BaseSocket *socket ) {}
+};
+
+/**
+ * Makes short-lived TLS connections (handshake, one line echo, close) to a TLS TCPListener over loopback, and
+ * reports the handshakes per second without session resumption, with the session cache and with session tickets.
+ *
+ * The certificate and private key are taken from the bench section of the configuration, a self-signed pair is
+ * created with
+ * ```
+ * openssl req -x509 -newkey rsa:2048 -nodes -keyout tls-bench.key -out tls-bench.pem -days 365 -subj "/CN=localhost"
+ * ```
+ */
+class TLSBench : public Application {
+  public:
+    explicit TLSBench( const StartParameters &param ) : Application( param ) {}
+
+    virtual int run() {
+      try {
+        YAML::Node server = Config::getConfig()->getValue<YAML::Node>( {"server"} );
+        size_t clients = Config::getConfig()->getValue<size_t>( {"bench","clients"} );
+        size_t connections = Config::getConfig()->getValue<size_t>( {"bench","connections"} );
+        certificate_ = Config::getConfig()->getValue<string>( {"bench","certificate"} );
+        key_ = Config::getConfig()->getValue<string>( {"bench","key"} );
+        version_ = TLSContext::tlsVersionFromString( Config::getConfig()->getValue<string>( {"bench","tls-version"} ) );
+        cout << "mode            handshakes  handshakes/s  resumed%  server-full  server-resumed" << endl;
+        for ( const string mode : { "full", "session-cache", "session-tickets" } ) {
+          bench( mode, server, clients, connections );
+        }
+      }
+      catch ( const std::exception &e ) {
+        cerr << e.what() << endl;
+        return 1;
+      }
+      return 0;
+    }
+
+  private:
+
+    void bench( const string &mode, const YAML::Node &yaml, size_t clients, size_t connections ) {
+      TCPListener::Params params( yaml );
+      params.tls = std::make_shared<TLSContext>( TLSContext::PeerVerification::pvVerifyNone, version_, false, false );
+      params.tls->loadPEMIdentity( certificate_, key_, "" );
+      params.tls->setSessionCache( mode == "session-cache" ? 20480 : 0, 300 );
+      params.tls->setSessionTickets( mode == "session-tickets" );
+      // the client caches the session to offer on the next connection, unless measuring full handshakes
+      TLSContext client( TLSContext::PeerVerification::pvVerifyNone, version_, false, false );
+      client.setSessionCache( mode == "full" ? 0 : 1024, 300 );
+      client.setSessionTickets( mode == "session-tickets" );
+      Address address( yaml["listen-address"].as<string>(), yaml["listen-port"].as<uint16_t>() );
+      TCPListener listener( address, params );
+      listener.start( new EchoServer( listener ) );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+      std::atomic<size_t> ok = 0;
+      auto start = std::chrono::steady_clock::now();
+      vector<std::thread> threads;
+      for ( size_t c = 0; c < clients; c++ ) {
+        threads.emplace_back( [&] {
+          for ( size_t i = 0; i < connections; i++ ) {
+            TLSSocket socket( true,
+                              SocketParams( address.getAddressFamily(), SocketParams::stSTREAM, SocketParams::pnHOPOPT ),
+                              client,
+                              { X509Common::SANType::stDNS, "localhost" } );
+            if ( socket.connect( address ) != SystemError::ecOK ) break;
+            string line;
+            // the echo also reads the TLS 1.3 session ticket the server sends after the handshake
+            if ( socket.send( "ping\n", 5 ) != SystemError::ecOK ) break;
+            if ( socket.receiveLine( line ) != SystemError::ecOK || line != "ping" ) break;
+            socket.close();
+            ok++;
+          }
+        } );
+      }
+      for ( auto &t : threads ) t.join();
+      double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      listener.stop();
+      listener.wait();
+      TLSContext::SessionStats client_stats = client.getSessionStats();
+      TLSContext::SessionStats server_stats = params.tls->getSessionStats();
+      cout << left << setw(15) << mode << right << setw(11) << ok <<
+              setw(14) << fixed << setprecision(0) << (double)ok / seconds <<
+              setw(10) << setprecision(1) <<
+              100.0 * (double)client_stats.resumed / (double)std::max( (size_t)1, client_stats.resumed + client_stats.full ) <<
+              setw(13) << server_stats.full <<
+              setw(16) << server_stats.resumed << endl;
+    }
+
+    /** The certificate PEM file. */
+    string certificate_;
+
+    /** The private key PEM file. */
+    string key_;
+
+    /** The TLS version. */
+    TLSContext::TLSVersion version_;
+};
+
+int main( int argc, char* argv[], char** envp ) {
+  try {
+    TLSBench app( { argc > 1 ? argv[1] : "tls-bench.yaml", argc, argv, envp } );
+    return app.run();
+  }
+  catch ( const std::exception &e ) {
+    cerr << "main::catch std::exception : " << e.what() << endl;
+    return 1;
+  }
+}
@@ -112,6 +112,44 @@ namespace dodo::common {
        */
       void free();
 
+      /**
+       * Set the size to 0 but keep the allocated memory, so that the Bytes can be refilled without allocating.
+       */
+      void clear() { size_ = 0; }
+
+      /**
+       * Make sure at least capacity Octets are allocated, without changing the size. Grows the allocation
+       * at least twofold, so that repeated growth takes amortized constant time.
+       * @param capacity The minimum capacity.
+       */
+      void ensureCapacity( size_t capacity );
+
+      /**
+       * Return the number of allocated Octets, always >= getSize().
+       * @return The capacity.
+       */
+      size_t getCapacity() const { return allocated_size; }
+
+      /**
+       * Return the number of allocated Octets beyond the size, which can be written to through getTail() and then
+       * added with extend().
+       * @return The spare capacity.
+       */
+      size_t getSpare() const { return allocated_size - size_; }
+
+      /**
+       * Return a pointer to the first Octet beyond the size. Like getArray(), the pointer is invalidated by calls
+       * that grow the allocation.
+       * @return The tail of the array.
+       */
+      Octet* getTail() const { return array_ + size_; }
+
+      /**
+       * Add n Octets written to the spare capacity to the size.
+       * @param n The number of Octets written at getTail(), n <= getSpare().
+       */
+      void extend( size_t n ) { assert( n <= getSpare() ); size_ += n; }
+
       /**
        * The way in which two Bytes instances match.
        */
@@ -28,6 +28,7 @@
 #include <common/config.hpp>
 #include <common/datacrypt.hpp>
 #include <common/exception.hpp>
+#include <common/histogram.hpp>
 #include <common/bytes.hpp>
 #include <common/puts.hpp>
 #include <common/systemerror.hpp>
@@ -0,0 +1,179 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file histogram.hpp
+ * Defines the dodo::common::Histogram class.
+ */
+
+#ifndef common_histogram_hpp
+#define common_histogram_hpp
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dodo::common {
+
+  /**
+   * A log-linear (HDR style) Histogram of unsigned 64 bit values, such as latencies in nanoseconds. Values below
+   * 2 * sub_buckets are counted exactly, larger values fall in one of sub_buckets buckets per power of two, so the
+   * relative error of a reported value is below 1 / sub_buckets.
+   *
+   * record() is lock-free and meant for a single writer thread, other threads may read or merge the Histogram
+   * concurrently. Counts are cumulative, the distribution over an interval is obtained by subtracting the
+   * Histogram at the start of the interval from the Histogram at its end.
+   *
+   * @code
+   * common::Histogram latency, previous;
+   * latency.record( 1500 );
+   * ...
+   * common::Histogram interval = latency;
+   * interval -= previous;
+   * previous = latency;
+   * std::cout << interval.getPercentile( 99.0 ) << std::endl;
+   * @endcode
+   */
+  class Histogram {
+    public:
+
+      /**
+       * The number of bits of a value that select a sub bucket.
+       */
+      static constexpr unsigned sub_bucket_bits = 4;
+
+      /**
+       * The number of buckets per power of two.
+       */
+      static constexpr size_t sub_buckets = 1 << sub_bucket_bits;
+
+      /**
+       * The number of buckets, covering the full uint64_t range.
+       */
+      static constexpr size_t num_buckets = ( 64 - sub_bucket_bits + 1 ) * sub_buckets;
+
+      /**
+       * Construct an empty Histogram.
+       */
+      Histogram() { clear(); }
+
+      /**
+       * Copy constructor.
+       * @param other The Histogram to copy.
+       */
+      Histogram( const Histogram &other ) { *this = other; }
+
+      /**
+       * Assignment.
+       * @param other The Histogram to copy.
+       * @return This Histogram.
+       */
+      Histogram& operator=( const Histogram &other );
+
+      /**
+       * Record a value, lock-free for a single writer thread.
+       * @param value The value.
+       */
+      void record( uint64_t value ) {
+        std::atomic<uint64_t> &count = counts_[ bucketIndex( value ) ];
+        count.store( count.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      }
+
+      /**
+       * Add the counts of another Histogram.
+       * @param other The Histogram to add.
+       * @return This Histogram.
+       */
+      Histogram& operator+=( const Histogram &other );
+
+      /**
+       * Subtract the counts of another (earlier) Histogram, counts that would become negative become 0.
+       * @param other The Histogram to subtract.
+       * @return This Histogram.
+       */
+      Histogram& operator-=( const Histogram &other );
+
+      /**
+       * Reset all counts to 0.
+       */
+      void clear();
+
+      /**
+       * Return the number of recorded values.
+       * @return The number of recorded values.
+       */
+      uint64_t getCount() const;
+
+      /**
+       * Return the value below or at which the given percentage of the recorded values are. The value returned is
+       * the upper bound of the bucket holding the percentile.
+       * @param percentile The percentile, 0.0 - 100.0.
+       * @return The value, 0 if the Histogram is empty.
+       */
+      uint64_t getPercentile( double percentile ) const;
+
+      /**
+       * Return the (upper bound of the bucket of the) largest recorded value.
+       * @return The maximum value, 0 if the Histogram is empty.
+       */
+      uint64_t getMax() const;
+
+      /**
+       * Return the bucket index for a value.
+       * @param value The value.
+       * @return The bucket index.
+       */
+      static size_t bucketIndex( uint64_t value ) {
+        if ( value < 2 * sub_buckets ) return (size_t)value;
+        unsigned shift = 63 - __builtin_clzll( value ) - sub_bucket_bits;
+        return ( shift + 1 ) * sub_buckets + (size_t)( ( value >> shift ) - sub_buckets );
+      }
+
+      /**
+       * Return the lowest value of a bucket.
+       * @param index The bucket index.
+       * @return The lowest value in the bucket.
+       */
+      static uint64_t bucketLow( size_t index ) {
+        if ( index < 2 * sub_buckets ) return index;
+        unsigned shift = (unsigned)( index / sub_buckets - 1 );
+        return ( sub_buckets + index % sub_buckets ) << shift;
+      }
+
+      /**
+       * Return the highest value of a bucket.
+       * @param index The bucket index.
+       * @return The highest value in the bucket.
+       */
+      static uint64_t bucketHigh( size_t index ) {
+        if ( index < 2 * sub_buckets ) return index;
+        unsigned shift = (unsigned)( index / sub_buckets - 1 );
+        return bucketLow( index ) + ( ( uint64_t(1) << shift ) - 1 );
+      }
+
+    private:
+
+      /**
+       * The counts per bucket.
+       */
+      std::array<std::atomic<uint64_t>,num_buckets> counts_;
+  };
+
+}
+
+#endif
@@ -127,6 +127,15 @@ namespace dodo::common {
     return (double)t2.tv_sec - (double)t1.tv_sec + ( (double)t2.tv_usec - (double)t1.tv_usec ) / 1.0E6;
   }
 
+  /**
+   * Return the time of the monotonic (steady) clock in nanoseconds, for measuring intervals and deadlines.
+   * @return The time.
+   */
+  inline uint64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch() ).count();
+  }
+
   /**
    * Split a string into substrings.
    * @param src The string to split from.
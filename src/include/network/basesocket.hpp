@@ -24,12 +24,63 @@
 #define network_basesocket_hpp
 
 #include <fcntl.h>
+#include <string>
+#include <string_view>
 
+#include "common/bytes.hpp"
 #include "common/exception.hpp"
 #include "network/address.hpp"
 
 namespace dodo::network {
 
+  /**
+   * A read-only view on a contiguous range of bytes, one of the buffers passed to BaseSocket::sendv(). A
+   * ConstBuffer does not own or copy the data, which must remain valid during the sendv() call.
+   */
+  struct ConstBuffer {
+    /**
+     * Construct from a pointer and a size.
+     * @param data The first byte.
+     * @param size The number of bytes.
+     */
+    ConstBuffer( const void* data, size_t size ) : data(data), size(size) {}
+
+    /**
+     * Construct from a common::Bytes.
+     * @param bytes The Bytes.
+     */
+    ConstBuffer( const common::Bytes &bytes ) : data(bytes.getArray()), size(bytes.getSize()) {}
+
+    /**
+     * Construct from a std::string.
+     * @param str The string.
+     */
+    ConstBuffer( const std::string &str ) : data(str.data()), size(str.size()) {}
+
+    /**
+     * Construct from a std::string_view.
+     * @param str The string.
+     */
+    ConstBuffer( std::string_view str ) : data(str.data()), size(str.size()) {}
+
+    /** The first byte. */
+    const void* data;
+
+    /** The number of bytes. */
+    size_t size;
+  };
+
+  /**
+   * A writable range of bytes, one of the buffers passed to BaseSocket::receivev().
+   */
+  struct MutableBuffer {
+    /** The first byte. */
+    void* data;
+
+    /** The number of bytes. */
+    size_t size;
+  };
+
   /**
    * Interface to and common implementation of concrete sockets (Socket, TLSSocket).
    */
@@ -99,6 +150,46 @@ namespace dodo::network {
        */
       virtual common::SystemError send( const void* buf, ssize_t len, bool more = false ) = 0;
 
+      /**
+       * Send as many bytes as the socket accepts without blocking. Unlike send(), the caller learns how many bytes
+       * were sent when the socket cannot take all of them.
+       * @param buf Take bytes from here
+       * @param len The number of bytes.
+       * @param sent The number of bytes sent, also when not all bytes could be sent.
+       * @param more Set to true if more is to come (increases packet filling efficiency when accurate).
+       * @return SystemError::ecOK if all len bytes were sent, SystemError::ecEAGAIN if only sent bytes were sent,
+       * or the error.
+       */
+      virtual common::SystemError sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more = false ) = 0;
+
+      /**
+       * Send the concatenation of count buffers, with the same semantics as send() but without first copying them
+       * into a single buffer.
+       * @code
+       * ConstBuffer buffers[] = { header, body };
+       * socket->sendv( buffers, 2 );
+       * @endcode
+       * @param buffers The buffers to send, in order.
+       * @param count The number of buffers.
+       * @param more Set to true if more is to come.
+       * @return The SystemError.
+       */
+      virtual common::SystemError sendv( const ConstBuffer* buffers, size_t count, bool more = false ) = 0;
+
+      /**
+       * Send length bytes from file descriptor fd, starting at offset, as many as the socket accepts without
+       * blocking (like sendPartial()). This implementation reads the file into a buffer with pread and sends it
+       * with sendPartial(), fd must be seekable. Socket overrides it to transfer without copying through user
+       * space.
+       * @param fd The file descriptor to send from.
+       * @param offset The offset in fd to start at.
+       * @param length The number of bytes to send.
+       * @param sent The number of bytes sent, also when not all bytes could be sent.
+       * @return SystemError::ecOK if all length bytes were sent, SystemError::ecEAGAIN if only sent bytes were
+       * sent, SystemError::ecENODATA if fd ends before offset + length, or the error.
+       */
+      virtual common::SystemError sendFile( int fd, off_t offset, size_t length, size_t &sent );
+
       /**
        * Receive bytes from the socket.
        * @param buf Put bytes received here
@@ -108,6 +199,25 @@ namespace dodo::network {
        */
       virtual common::SystemError receive( void* buf, ssize_t request, ssize_t &received ) = 0;
 
+      /**
+       * Receive bytes into count buffers, filling each buffer before moving on to the next. This implementation
+       * calls receive() for each buffer until a buffer is not filled entirely. Socket overrides it with a single
+       * readv.
+       * @param buffers The buffers to receive into.
+       * @param count The number of buffers.
+       * @param received The total number of bytes received.
+       * @return The SystemError, as receive(). If bytes were received before receive() returns an error for a
+       * subsequent buffer, ecOK is returned.
+       */
+      virtual common::SystemError receivev( const MutableBuffer* buffers, size_t count, ssize_t &received );
+
+      /**
+       * Return the number of bytes that can be read from the socket without blocking (ioctl FIONREAD). For
+       * encrypted sockets, this is the number of encrypted bytes.
+       * @return The number of bytes readable.
+       */
+      size_t getReadable() const;
+
       /**
        * Rerurn true if the socket is operating in blocking mode.
        * @return The mode.
@@ -153,6 +263,14 @@ namespace dodo::network {
        */
       void setReUsePort();
 
+      /**
+       * Set SO_INCOMING_CPU. On a listening socket that shares its port with other sockets through SO_REUSEPORT,
+       * the kernel prefers the socket whose incoming cpu matches the cpu processing the connection request.
+       * @param cpu The cpu number.
+       * @see setReUsePort()
+       */
+      void setIncomingCPU( int cpu );
+
       /**
        * Get the maximum buffer length for send.
        * @return The send buffer size.
@@ -327,6 +445,11 @@ namespace dodo::network {
        */
       virtual BaseSocket* accept() = 0;
 
+      /**
+       * The size of the buffer used by the pread fallback of sendFile().
+       */
+      static constexpr size_t sendfile_buffer_size = 16384;
+
       /**
        * Send an uint8_t.
        * @param value The value to send.
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file handover.hpp
+ * Defines the dodo::network::Handover class.
+ */
+
+#ifndef network_handover_hpp
+#define network_handover_hpp
+
+#include <string>
+
+#include "common/exception.hpp"
+
+namespace dodo::network {
+
+  /**
+   * Passes file descriptors between processes over a Unix domain stream socket (SCM_RIGHTS), used by the
+   * TCPListener to hand its listening sockets and established connections over to a new instance of the process.
+   *
+   * Each message is a single Tag byte, optionally carrying one file descriptor. The receiving process gets a
+   * duplicate of the descriptor, the sender still has to close its own.
+   */
+  class Handover {
+    public:
+
+      /**
+       * The message types.
+       */
+      enum class Tag : char {
+        Listen     = 'L', /**< A listening socket, one per TCPListener shard in shard order. */
+        Ready      = 'R', /**< All listening sockets have been sent. */
+        Connection = 'C', /**< An established connection. */
+      };
+
+      /**
+       * Bind and listen on a Unix domain socket at path, replacing a socket file left at path. The socket is
+       * non-blocking.
+       * @param path The file system path.
+       * @return The socket descriptor.
+       */
+      static int listen( const std::string &path );
+
+      /**
+       * Connect to a Unix domain socket at path.
+       * @param path The file system path.
+       * @param timeout_ms The send and receive timeout in milliseconds.
+       * @return The socket descriptor, -1 if there is no process listening on path.
+       */
+      static int connect( const std::string &path, int timeout_ms );
+
+      /**
+       * Send a message.
+       * @param channel The Unix domain socket.
+       * @param tag The Tag.
+       * @param fd The file descriptor to pass, -1 for none.
+       * @return SystemError::ecOK, SystemError::ecEAGAIN if a non-blocking channel is full or the error.
+       */
+      static common::SystemError send( int channel, Tag tag, int fd = -1 );
+
+      /**
+       * Receive a message.
+       * @param channel The Unix domain socket.
+       * @param tag The Tag received.
+       * @param fd The file descriptor received, -1 if none.
+       * @return SystemError::ecOK, SystemError::ecEAGAIN if a non-blocking channel has no message,
+       * SystemError::ecECONNABORTED if the peer closed the channel, SystemError::ecEMSGSIZE if the message carried
+       * more than one descriptor (which are closed) or the error.
+       */
+      static common::SystemError receive( int channel, Tag &tag, int &fd );
+  };
+
+}
+
+#endif
@@ -25,13 +25,19 @@
 
 #include "network/address.hpp"
 #include "network/basesocket.hpp"
+#include "network/handover.hpp"
 #include "network/protocol/http/http.hpp"
 #include "network/protocol/stomp/stomp.hpp"
+#include "network/ratelimiter.hpp"
+#include "network/scalingpolicy.hpp"
 #include "network/socket.hpp"
 #include "network/tcplistener.hpp"
 #include "network/tcpserver.hpp"
+#include "network/timerwheel.hpp"
 #include "network/tlscontext.hpp"
+#include "network/tlssessioncache.hpp"
 #include "network/tlssocket.hpp"
+#include "network/uring.hpp"
 #include "network/uri.hpp"
 #include "network/x509cert.hpp"
 
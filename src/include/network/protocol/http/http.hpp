@@ -25,9 +25,13 @@
 #define dodo_network_protocol_http_hpp
 
 #include <network/protocol/http/httpfragment.hpp>
+#include <network/protocol/http/httpheader.hpp>
+#include <network/protocol/http/httpheaderview.hpp>
 #include <network/protocol/http/httpmessage.hpp>
 #include <network/protocol/http/httprequest.hpp>
+#include <network/protocol/http/httprequestparser.hpp>
 #include <network/protocol/http/httpresponse.hpp>
+#include <network/protocol/http/httpscan.hpp>
 #include <network/protocol/http/httpversion.hpp>
 
 #endif
@@ -66,6 +66,8 @@ namespace dodo {
           peInvalidChunkHex,              /**< The hex chunk size is invalid. */
           peInvalidLastChunk,             /**< The last chunk does not have size 0. */
           peExpectingUnsignedInt,         /**< An unsigned int was expected. */
+          peHeaderTooLarge,               /**< The request line and headers exceed the maximum size. */
+          peBodyTooLarge,                 /**< The message body exceeds the maximum size. */
         };
 
         /**
@@ -98,6 +100,12 @@ namespace dodo {
            */
           bool eof() const { return systemError == common::SystemError::ecEAGAIN; }
 
+          /**
+           * Test if `parseError == peIncomplete`
+           * @return true if the fragment is not complete yet, but valid so far.
+           */
+          bool incomplete() const { return parseError == peIncomplete; }
+
           /**
            * Set the systemError. Implictly sets parseError to peOK ig `se == common::SystemError::ecOK`
            * and to peSystemError if `se != common::SystemError::ecOK`
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpheader.hpp
+ * Defines the dodo::network::protocol::http::HTTPHeader class.
+ */
+
+#ifndef dodo_network_protocol_http_httpheader_hpp
+#define dodo_network_protocol_http_httpheader_hpp
+
+#include <cstdint>
+#include <string_view>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Identifies the well-known HTTP header field names. The names are looked up case-insensitive with a perfect
+     * hash that is generated at compile time, so identifying a name costs a hash over its chars, one table index and
+     * one compare, without allocating or lowercasing it.
+     *
+     * @code
+     * HTTPHeader::Id id = HTTPHeader::lookup( "Content-Length" );   // HTTPHeader::hiContentLength
+     * std::string_view name = HTTPHeader::getName( id );            // "content-length"
+     * @endcode
+     */
+    class HTTPHeader {
+      public:
+
+        /**
+         * The well-known header field names.
+         */
+        enum Id : uint8_t {
+          hiUnknown = 0,            /**< Not a well-known header. */
+          hiAccept,                 /**< accept */
+          hiAcceptCharset,          /**< accept-charset */
+          hiAcceptEncoding,         /**< accept-encoding */
+          hiAcceptLanguage,         /**< accept-language */
+          hiAcceptRanges,           /**< accept-ranges */
+          hiAge,                    /**< age */
+          hiAllow,                  /**< allow */
+          hiAuthorization,          /**< authorization */
+          hiCacheControl,           /**< cache-control */
+          hiConnection,             /**< connection */
+          hiContentDisposition,     /**< content-disposition */
+          hiContentEncoding,        /**< content-encoding */
+          hiContentLanguage,        /**< content-language */
+          hiContentLength,          /**< content-length */
+          hiContentLocation,        /**< content-location */
+          hiContentRange,           /**< content-range */
+          hiContentType,            /**< content-type */
+          hiCookie,                 /**< cookie */
+          hiDate,                   /**< date */
+          hiETag,                   /**< etag */
+          hiExpect,                 /**< expect */
+          hiExpires,                /**< expires */
+          hiForwarded,              /**< forwarded */
+          hiFrom,                   /**< from */
+          hiHost,                   /**< host */
+          hiIfMatch,                /**< if-match */
+          hiIfModifiedSince,        /**< if-modified-since */
+          hiIfNoneMatch,            /**< if-none-match */
+          hiIfRange,                /**< if-range */
+          hiIfUnmodifiedSince,      /**< if-unmodified-since */
+          hiKeepAlive,              /**< keep-alive */
+          hiLastModified,           /**< last-modified */
+          hiLocation,               /**< location */
+          hiOrigin,                 /**< origin */
+          hiPragma,                 /**< pragma */
+          hiProxyAuthenticate,      /**< proxy-authenticate */
+          hiProxyAuthorization,     /**< proxy-authorization */
+          hiRange,                  /**< range */
+          hiReferer,                /**< referer */
+          hiRetryAfter,             /**< retry-after */
+          hiServer,                 /**< server */
+          hiSetCookie,              /**< set-cookie */
+          hiTE,                     /**< te */
+          hiTrailer,                /**< trailer */
+          hiTransferEncoding,       /**< transfer-encoding */
+          hiUpgrade,                /**< upgrade */
+          hiUserAgent,              /**< user-agent */
+          hiVary,                   /**< vary */
+          hiVia,                    /**< via */
+          hiWWWAuthenticate,        /**< www-authenticate */
+          hiXForwardedFor,          /**< x-forwarded-for */
+          hiXForwardedHost,         /**< x-forwarded-host */
+          hiXForwardedProto,        /**< x-forwarded-proto */
+          hiXRequestId,             /**< x-request-id */
+          hiCount,                  /**< The number of Ids, not an Id. */
+        };
+
+        /**
+         * Return the case-insensitive hash of a header field name, as used by lookup().
+         * @param name The name.
+         * @return The hash.
+         */
+        static uint32_t hash( std::string_view name );
+
+        /**
+         * Return the Id of a header field name.
+         * @param name The name, in any case.
+         * @return The Id, hiUnknown if the name is not a well-known header.
+         */
+        static Id lookup( std::string_view name ) { return lookup( name, hash( name ) ); }
+
+        /**
+         * Return the Id of a header field name of which the hash() is known.
+         * @param name The name, in any case.
+         * @param hash The hash( name ).
+         * @return The Id, hiUnknown if the name is not a well-known header.
+         */
+        static Id lookup( std::string_view name, uint32_t hash );
+
+        /**
+         * Return the name of an Id, in lowercase.
+         * @param id The Id.
+         * @return The name, empty for hiUnknown.
+         */
+        static std::string_view getName( Id id );
+
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpheaderview.hpp
+ * Defines the dodo::network::protocol::http::HTTPHeaderView class.
+ */
+
+#ifndef dodo_network_protocol_http_httpheaderview_hpp
+#define dodo_network_protocol_http_httpheaderview_hpp
+
+#include <network/protocol/http/httpheader.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    class HTTPMessage;
+
+    /**
+     * The header fields of a HTTP message as offsets into the buffer the message was received in, so parsing the
+     * headers does not copy or allocate. The first inlineFields fields are held in the HTTPHeaderView itself, only
+     * further fields go to the heap.
+     *
+     * Field names keep their case as received and are looked up case-insensitive, comparing a hash of the name
+     * first. Well-known names are tagged with their HTTPHeader::Id when the field is added, and the first field of
+     * each Id is found by index. A field value is trimmed of leading and trailing whitespace, but otherwise as
+     * received, so a value continued on the next line (obsolete line folding) includes the line break.
+     *
+     * The string_views returned are only valid as long as the buffer is unchanged. Use materialize() to copy fields
+     * that must outlive it.
+     *
+     * @remark This class is not thread safe.
+     */
+    class HTTPHeaderView {
+      public:
+
+        /** The number of fields held without allocation. */
+        static const size_t inlineFields = 16;
+
+        /** Returned by find() if there is no such field. */
+        static const size_t npos = static_cast<size_t>( -1 );
+
+        /**
+         * A header field, the offsets are relative to the buffer.
+         */
+        struct Field {
+          /** The offset of the name. */
+          uint32_t name_offset;
+          /** The size of the name. */
+          uint32_t name_size;
+          /** The offset of the value. */
+          uint32_t value_offset;
+          /** The size of the value. */
+          uint32_t value_size;
+          /** The HTTPHeader::hash() of the name. */
+          uint32_t hash;
+          /** The HTTPHeader::Id of the name. */
+          HTTPHeader::Id id;
+          /** True if the value continues on a next line. */
+          bool folded;
+        };
+
+        /**
+         * Construct an empty HTTPHeaderView.
+         */
+        HTTPHeaderView() : buffer_( nullptr ), size_( 0 ), first_() {}
+
+        /**
+         * Remove all fields.
+         */
+        void clear();
+
+        /**
+         * Set the buffer the offsets refer to, call again when the buffer has moved (such as a common::Bytes that
+         * grew).
+         * @param buffer The buffer.
+         */
+        void setBuffer( const char* buffer ) { buffer_ = buffer; }
+
+        /**
+         * Add a field.
+         * @param name_offset The offset of the name.
+         * @param name_size The size of the name.
+         * @param value_offset The offset of the value.
+         * @param value_size The size of the value.
+         * @param folded True if the value continues on a next line.
+         */
+        void add( uint32_t name_offset, uint32_t name_size, uint32_t value_offset, uint32_t value_size, bool folded );
+
+        /**
+         * Return the number of fields.
+         * @return The number of fields.
+         */
+        size_t size() const { return size_; }
+
+        /**
+         * Return a field.
+         * @param index The index of the field, less than size().
+         * @return The Field.
+         */
+        const Field& getField( size_t index ) const {
+          return index < inlineFields ? inline_[index] : overflow_[index - inlineFields];
+        }
+
+        /**
+         * Return the name of a field, as received.
+         * @param index The index of the field, less than size().
+         * @return The name.
+         */
+        std::string_view getName( size_t index ) const {
+          const Field& field = getField( index );
+          return std::string_view( buffer_ + field.name_offset, field.name_size );
+        }
+
+        /**
+         * Return the value of a field, as received.
+         * @param index The index of the field, less than size().
+         * @return The value.
+         */
+        std::string_view getValue( size_t index ) const {
+          const Field& field = getField( index );
+          return std::string_view( buffer_ + field.value_offset, field.value_size );
+        }
+
+        /**
+         * Return the index of the first field with the name (case-insensitive), starting at from.
+         * @param name The field name.
+         * @param from The index to start at.
+         * @return The index, or npos if there is no such field.
+         */
+        size_t find( std::string_view name, size_t from = 0 ) const;
+
+        /**
+         * Return the index of the first field with the Id, starting at from. Without from, this is a single index.
+         * @param id The HTTPHeader::Id, not HTTPHeader::hiUnknown.
+         * @param from The index to start at.
+         * @return The index, or npos if there is no such field.
+         */
+        size_t find( HTTPHeader::Id id, size_t from = 0 ) const;
+
+        /**
+         * Get the value of the first field with the name (case-insensitive).
+         * @param name The field name.
+         * @param value Receives the value.
+         * @return True if the field was found, false otherwise, in which case value is undefined.
+         */
+        bool getValue( std::string_view name, std::string_view &value ) const;
+
+        /**
+         * Get the value of the first field with the Id.
+         * @param id The HTTPHeader::Id, not HTTPHeader::hiUnknown.
+         * @param value Receives the value.
+         * @return True if the field was found, false otherwise, in which case value is undefined.
+         */
+        bool getValue( HTTPHeader::Id id, std::string_view &value ) const;
+
+        /**
+         * Return a copy of a field value, with folded lines and other whitespace inside the value replaced by a
+         * single space.
+         * @param index The index of the field, less than size().
+         * @return The value.
+         */
+        std::string materialize( size_t index ) const;
+
+        /**
+         * Copy all fields to the message headers, the names in lowercase and the values as materialize( size_t ).
+         * @param message The HTTPMessage to add the headers to.
+         */
+        void materialize( HTTPMessage &message ) const;
+
+      private:
+
+        /** The buffer. */
+        const char* buffer_;
+
+        /** The number of fields. */
+        size_t size_;
+
+        /** The first inlineFields fields. */
+        std::array<Field,inlineFields> inline_;
+
+        /** The fields after the first inlineFields. */
+        std::vector<Field> overflow_;
+
+        /** The index + 1 of the first field of each HTTPHeader::Id, 0 if there is none. */
+        std::array<uint16_t,HTTPHeader::hiCount> first_;
+
+    };
+
+  }
+
+}
+
+#endif
@@ -26,6 +26,9 @@
 
 #include <common/bytes.hpp>
 #include <network/protocol/http/httpfragment.hpp>
+#include <network/protocol/http/httpheader.hpp>
+#include <array>
+#include <map>
 #include <string>
 
 namespace dodo {
@@ -64,7 +67,13 @@ namespace dodo {
         /**
          * Default constructor.
          */
-        HTTPMessage() : body_("") {};
+        HTTPMessage() : body_(""), known_() {};
+
+        /**
+         * Copy constructor, copies the body and points known_ into the copied headers_.
+         * @param other The HTTPMessage to copy.
+         */
+        HTTPMessage( const HTTPMessage &other );
 
         /**
          * Add a header to the HTTPMessage. Note that multtiple headers may be specified with the same key
@@ -84,6 +93,14 @@ namespace dodo {
          */
         void addHeader( const std::string &key, const std::string &value );
 
+        /**
+         * Add a header of which the HTTPHeader::Id is known, saves the lookup of the key.
+         * @param id The HTTPHeader::Id of key.
+         * @param key The header key, in lowercase.
+         * @param value The header value.
+         */
+        void addHeader( HTTPHeader::Id id, const std::string &key, const std::string &value );
+
         /**
          * Replace the value of a header.
          * @param key the key to replace.
@@ -104,10 +121,24 @@ namespace dodo {
          */
         bool hasHeader( const std::string &header ) const { return headers_.find(header) != headers_.end(); }
 
+        /**
+         * Return true when the well-known header exists in this HTTPMessage's headers.
+         * @param id The HTTPHeader::Id to check for.
+         * @return True then the header exists in this HTTPMessage's headers.
+         */
+        bool hasHeader( HTTPHeader::Id id ) const { return known_[id]; }
+
+        /**
+         * Return the value of a well-known header, by index instead of a map lookup.
+         * @param id The HTTPHeader::Id.
+         * @return The value, or nullptr if the header does not exist.
+         */
+        const std::string* getHeader( HTTPHeader::Id id ) const { return known_[id]; }
+
         /**
          * Clear all headers.
          */
-        void clearHeaders() { headers_.clear(); };
+        void clearHeaders() { headers_.clear(); known_.fill( nullptr ); };
 
         /**
          * Get a header value as a string into value.
@@ -126,6 +157,62 @@ namespace dodo {
          */
         bool getHeaderValue( const std::string &key, unsigned long &value ) const;
 
+        /**
+         * Get a well-known header value as a string into value.
+         * @param id The HTTPHeader::Id.
+         * @param value Receives the header value.
+         * @return True if the header was found, false otherwise, in which case value is undefined.
+         */
+        bool getHeaderValue( HTTPHeader::Id id, std::string &value ) const;
+
+        /**
+         * Get a well-known header value as an unsigned long into value.
+         * @param id The HTTPHeader::Id.
+         * @param value Receives the header value.
+         * @return True if the header was found and the value an integer, false otherwise, in which case value is
+         * undefined.
+         */
+        bool getHeaderValue( HTTPHeader::Id id, unsigned long &value ) const;
+
+        /**
+         * Get the content-length header.
+         * @param length Receives the content length.
+         * @return True if the header was found and is an integer.
+         */
+        bool getContentLength( unsigned long &length ) const {
+          return getHeaderValue( HTTPHeader::hiContentLength, length );
+        }
+
+        /**
+         * Get the transfer-encoding header.
+         * @param value Receives the transfer encoding.
+         * @return True if the header was found.
+         */
+        bool getTransferEncoding( std::string &value ) const {
+          return getHeaderValue( HTTPHeader::hiTransferEncoding, value );
+        }
+
+        /**
+         * Get the connection header.
+         * @param value Receives the connection option.
+         * @return True if the header was found.
+         */
+        bool getConnection( std::string &value ) const { return getHeaderValue( HTTPHeader::hiConnection, value ); }
+
+        /**
+         * Get the host header.
+         * @param value Receives the host.
+         * @return True if the header was found.
+         */
+        bool getHost( std::string &value ) const { return getHeaderValue( HTTPHeader::hiHost, value ); }
+
+        /**
+         * Get the content-type header.
+         * @param value Receives the content type.
+         * @return True if the header was found.
+         */
+        bool getContentType( std::string &value ) const { return getHeaderValue( HTTPHeader::hiContentType, value ); }
+
         /**
          * Return the HTTTMessage body.
          * @return The HTTPMessage body.
@@ -148,6 +235,12 @@ namespace dodo {
 
       protected:
 
+        /**
+         * Return the headers as sent on the wire, including the empty line that ends the header section.
+         * @return The header section.
+         */
+        std::string headersAsString() const;
+
        /**
          * Parse a header section and update headers_.
          * @param data The VirtualReadBuffer to read from.
@@ -225,6 +318,15 @@ namespace dodo {
          */
         ParseResult parseChunkedBody(VirtualReadBuffer &data );
 
+        /**
+         * Read a body of length octets into body_. The VirtualReadBuffer is left on the last octet of the body, so
+         * that no data beyond the message is waited for.
+         * @param data The VirtualReadBuffer to read from.
+         * @param length The body length (content-length).
+         * @return The ParseError.
+         */
+        ParseResult parseContentBody( VirtualReadBuffer &data, size_t length );
+
         /**
          * Parse a body and resturn it as a single string. Note that the content-length header must be present
          * and specify the correct body length.
@@ -266,6 +368,18 @@ namespace dodo {
          */
         common::Bytes body_;
 
+      private:
+
+        /**
+         * Point known_ to the well-known headers in headers_.
+         */
+        void indexHeaders();
+
+        /**
+         * The value in headers_ of each well-known header, nullptr if the header does not exist.
+         */
+        std::array<const std::string*,HTTPHeader::hiCount> known_;
+
     };
 
   }
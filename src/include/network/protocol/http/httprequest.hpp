@@ -204,6 +204,9 @@ namespace dodo {
         static bool methodAllowsBody( Method method );
 
       protected:
+        /** The HTTPRequestParser fills the HTTPRequest as the data arrives. */
+        friend class HTTPRequestParser;
+
         /** The HTTPRequestLine of the HTTPRequest. */
         HTTPRequestLine request_line_;
 
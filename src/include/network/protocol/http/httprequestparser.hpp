@@ -0,0 +1,235 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httprequestparser.hpp
+ * Defines the dodo::network::protocol::http::HTTPRequestParser class.
+ */
+
+#ifndef dodo_network_protocol_http_httprequestparser_hpp
+#define dodo_network_protocol_http_httprequestparser_hpp
+
+#include <common/bytes.hpp>
+#include <network/protocol/http/httpheaderview.hpp>
+#include <network/protocol/http/httprequest.hpp>
+#include <string>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Incremental HTTP/1.1 request parser for non-blocking connections. Unlike HTTPRequest::parse(), which pulls
+     * data from a blocking VirtualReadBuffer, the HTTPRequestParser is pushed the data as it arrives, in fragments of
+     * any size. It keeps its position in the request between calls, so each byte is inspected once, and reports
+     * HTTPFragment::peIncomplete when it needs more data.
+     *
+     * In a TCPServer, the received data accumulates in the TCPConnectionData read buffer, and each readSocket() call
+     * only parses the bytes received since the previous call:
+     *
+     * @code
+     * HTTPFragment::ParseResult result = parser.parse( work.data->getReadBuffer() );
+     * if ( result.incomplete() ) return common::SystemError::ecEAGAIN;
+     * if ( !result.ok() ) return common::SystemError::ecECONNABORTED;
+     * // handle parser.getRequest(), bytes after parser.getConsumed() belong to the next request
+     * @endcode
+     *
+     * The header fields are not copied while parsing, but kept as a HTTPHeaderView of offsets into the buffer that
+     * holds the request, so the data passed to parse() must be the next bytes of one buffer that still holds the
+     * request from its start, like the TCPConnectionData read buffer. The buffer may move between calls. getRequest()
+     * copies the headers into the HTTPRequest, so call it before the buffer is cleared.
+     *
+     * A request without content-length or transfer-encoding header has no body. The trailer fields of a chunked body
+     * are skipped. The request line, the headers and the trailers together may not exceed the maximum header size.
+     * The body may not exceed the maximum body size, which is checked against the content-length or the chunk sizes
+     * before the body data arrives.
+     *
+     * @remark This class is not thread safe.
+     */
+    class HTTPRequestParser {
+      public:
+
+        /** The result type of parse(). */
+        typedef HTTPFragment::ParseResult ParseResult;
+
+        /**
+         * Construct a HTTPRequestParser.
+         * @param max_header_size The maximum size in bytes of the request line and headers.
+         * @param max_body_size The maximum size in bytes of the body, the sum of the chunk sizes of a chunked body.
+         */
+        explicit HTTPRequestParser( size_t max_header_size = 65536, size_t max_body_size = 1048576 );
+
+        /**
+         * Parse the next fragment of the request. Parsing stops at the end of the request, so consumed is less than
+         * size if the data also contains (part of) the next request. Once the request is complete or an error was
+         * found, parse() returns the same result and consumes nothing until reset().
+         * @param data The data received after the data passed to the previous parse() call, the getConsumed() bytes
+         * before data must hold the request parsed so far.
+         * @param size The number of bytes in data.
+         * @param consumed The number of bytes of data that belong to the request.
+         * @return HTTPFragment::peOk when the request is complete, HTTPFragment::peIncomplete if it needs more data,
+         * or the parse error.
+         */
+        ParseResult parse( const char* data, size_t size, size_t &consumed );
+
+        /**
+         * Parse the bytes of buffer after the first getConsumed() bytes, which were parsed by previous calls. Use
+         * when buffer accumulates the request, like the TCPConnectionData read buffer.
+         * @param buffer The buffer holding the request from its start.
+         * @return As parse( const char*, size_t, size_t& ).
+         */
+        ParseResult parse( const common::Bytes &buffer );
+
+        /**
+         * Prepare for the next request, clears the HTTPRequest.
+         */
+        void reset();
+
+        /**
+         * Return the number of bytes consumed since reset().
+         * @return The number of bytes.
+         */
+        size_t getConsumed() const { return consumed_; }
+
+        /**
+         * Return true if a complete request was parsed.
+         * @return True if complete.
+         */
+        bool isComplete() const { return state_ == psDone; }
+
+        /**
+         * Return the request, which is only complete once parse() returns HTTPFragment::peOk. Copies the headers
+         * parsed since the previous call from the buffer into the HTTPRequest.
+         * @return The HTTPRequest.
+         */
+        HTTPRequest& getRequest();
+
+        /**
+         * Return the headers without copying them, valid as long as the buffer holding the request is unchanged.
+         * @return The HTTPHeaderView.
+         */
+        const HTTPHeaderView& getHeaders() const { return headers_; }
+
+      private:
+
+        /**
+         * The parser states, each is the position at the start of the next byte.
+         */
+        enum ParseState {
+          psMethod,             /**< In the request method. */
+          psURI,                /**< In the request uri. */
+          psVersion,            /**< In the HTTP version. */
+          psRequestLineLF,      /**< Expecting the LF ending the request line. */
+          psHeaderLineStart,    /**< At the start of a header line. */
+          psHeaderName,         /**< In a header field name. */
+          psHeaderColon,        /**< After a header field name, expecting the colon. */
+          psHeaderValue,        /**< In a header field value. */
+          psHeaderValueLF,      /**< Expecting the LF ending a header line. */
+          psHeadersLF,          /**< Expecting the LF ending the header section. */
+          psBody,               /**< In a content-length body. */
+          psChunkSize,          /**< In a chunk size. */
+          psChunkExtension,     /**< In a chunk extension. */
+          psChunkSizeLF,        /**< Expecting the LF ending the chunk size line. */
+          psChunkData,          /**< In the chunk data. */
+          psChunkDataCR,        /**< Expecting the CR after the chunk data. */
+          psChunkDataLF,        /**< Expecting the LF after the chunk data. */
+          psTrailerLineStart,   /**< At the start of a trailer line. */
+          psTrailer,            /**< In a trailer line. */
+          psTrailerLF,          /**< Expecting the LF ending a trailer line. */
+          psTrailersLF,         /**< Expecting the LF ending the trailers. */
+          psDone,               /**< The request is complete. */
+          psError,              /**< A parse error was found. */
+        };
+
+        /**
+         * Enter the error state.
+         * @param error The ParseError.
+         */
+        void fail( HTTPFragment::ParseError error );
+
+        /**
+         * Add the header field parsed last to the headers.
+         */
+        void addHeader();
+
+        /**
+         * Enter the body state that follows from the headers, at the end of the header section.
+         */
+        void startBody();
+
+        /** The request being parsed. */
+        HTTPRequest request_;
+
+        /** The parse state. */
+        ParseState state_;
+
+        /** The parse error in state psError. */
+        HTTPFragment::ParseError error_;
+
+        /** The maximum size of the request line and headers. */
+        size_t max_header_size_;
+
+        /** The number of bytes of request line, headers and trailers parsed. */
+        size_t header_size_;
+
+        /** The maximum size of the body. */
+        size_t max_body_size_;
+
+        /** The size of the body, including the chunk being received. */
+        size_t body_size_;
+
+        /** The number of bytes consumed since reset(). */
+        size_t consumed_;
+
+        /** The method, uri or version being parsed. */
+        std::string token_;
+
+        /** The headers parsed so far. */
+        HTTPHeaderView headers_;
+
+        /** The number of headers copied into request_. */
+        size_t materialized_;
+
+        /** The offset of the header field name being parsed. */
+        size_t header_name_offset_;
+
+        /** The size of the header field name being parsed, 0 if there is none. */
+        size_t header_name_size_;
+
+        /** The offset of the header field value being parsed. */
+        size_t header_value_offset_;
+
+        /** The offset after the last non-whitespace char of the header field value, 0 if none was seen yet. */
+        size_t header_value_end_;
+
+        /** True if the header field value continues on a next line. */
+        bool header_folded_;
+
+        /** The remaining bytes of the body or the chunk. */
+        size_t remaining_;
+
+        /** The number of hex digits of the chunk size. */
+        size_t chunk_digits_;
+
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpscan.hpp
+ * Defines the dodo::network::protocol::http::HTTPScan class.
+ */
+
+#ifndef dodo_network_protocol_http_httpscan_hpp
+#define dodo_network_protocol_http_httpscan_hpp
+
+#include <cstddef>
+#include <string>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Scans HTTP data for the end of tokens, field values and lines, 16 (SSE4.2) or 32 (AVX2) bytes at a time. The
+     * implementation is chosen at runtime from what the CPU supports, with a scalar table lookup as fallback on CPUs
+     * without either, and on other architectures.
+     *
+     * Each function returns the length of the leading span of data that does not contain a stop char, which is size
+     * if there is none.
+     */
+    class HTTPScan {
+      public:
+
+        /**
+         * The scan implementations.
+         */
+        enum Implementation {
+          imScalar = 0,   /**< Table lookup per byte. */
+          imSSE42 = 1,    /**< SSE4.2 PCMPESTRI, 16 bytes at a time. */
+          imAVX2 = 2,     /**< AVX2, 32 bytes at a time. */
+        };
+
+        /**
+         * Return the length of the leading token chars, so the span stops at separators, whitespace, control
+         * chars and chars above 126.
+         * @param data The data to scan.
+         * @param size The number of bytes in data.
+         * @return The length of the span.
+         * @see https://tools.ietf.org/html/rfc7230#section-3.2.6
+         */
+        static size_t tokenSpan( const char* data, size_t size ) { return scanner_.token( data, size ); }
+
+        /**
+         * Return the length of the leading field value chars, so the span stops at CR, SP and HT.
+         * @param data The data to scan.
+         * @param size The number of bytes in data.
+         * @return The length of the span.
+         */
+        static size_t fieldValueSpan( const char* data, size_t size ) { return scanner_.field_value( data, size ); }
+
+        /**
+         * Return the length of the leading span without CR or LF.
+         * @param data The data to scan.
+         * @param size The number of bytes in data.
+         * @return The length of the span.
+         */
+        static size_t lineSpan( const char* data, size_t size ) { return scanner_.line( data, size ); }
+
+        /**
+         * Return true if c is a token char.
+         * @param c The char to check.
+         * @return True if c is a token char.
+         */
+        static bool isTokenChar( char c );
+
+        /**
+         * Return the implementation in use.
+         * @return The Implementation.
+         */
+        static Implementation getImplementation() { return scanner_.implementation; }
+
+        /**
+         * Return the best implementation the CPU supports, which is used by default.
+         * @return The Implementation.
+         */
+        static Implementation getBestImplementation();
+
+        /**
+         * Use another implementation, for example to compare them. Not thread safe, call before scanning.
+         * @param implementation The Implementation, at most getBestImplementation().
+         * @return False if the CPU does not support the implementation.
+         */
+        static bool setImplementation( Implementation implementation );
+
+        /**
+         * Return the name of an implementation.
+         * @param implementation The Implementation.
+         * @return The name.
+         */
+        static std::string implementationAsString( Implementation implementation );
+
+      private:
+
+        /** A scan function. */
+        typedef size_t (*ScanFunction)( const char* data, size_t size );
+
+        /**
+         * The scan functions of an implementation.
+         */
+        struct Scanner {
+          /** The implementation. */
+          Implementation implementation;
+          /** Scans a token. */
+          ScanFunction token;
+          /** Scans a field value. */
+          ScanFunction field_value;
+          /** Scans a line. */
+          ScanFunction line;
+        };
+
+        /**
+         * Return the Scanner of an implementation.
+         * @param implementation The Implementation.
+         * @return The Scanner.
+         */
+        static Scanner getScanner( Implementation implementation );
+
+        /** The Scanner in use. */
+        static Scanner scanner_;
+
+    };
+
+  }
+
+}
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ratelimiter.hpp
+ * Defines the dodo::network::RateLimiter class.
+ */
+
+#ifndef network_ratelimiter_hpp
+#define network_ratelimiter_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "network/address.hpp"
+
+namespace dodo::network {
+
+  /**
+   * Limits the connection rate, request rate and number of connections per peer host. Each host has a connection
+   * and a request token bucket, implemented as a generic cell rate algorithm so that a bucket is a single atomic
+   * theoretical arrival time that is updated with a compare-and-swap.
+   *
+   * The hosts are kept in a fixed-size, lock-free, open-addressing table with a bounded probe sequence. A slot is
+   * pinned whilst its host has connections, and reused by another host once it has no connections and both buckets
+   * are full again, as it then holds no state. If all slots in the probe sequence are taken, the host is not limited
+   * rather than rejected. Limiting is approximate under races, it never blocks.
+   */
+  class RateLimiter {
+    public:
+
+      /**
+       * RateLimiter parameters. A rate or maximum of 0 disables that limit.
+       */
+      struct Params {
+        /** The sustained number of new connections per second per host. */
+        double connection_rate = 0;
+        /** The number of new connections per host that may be made at once, the size of the bucket. */
+        size_t connection_burst = 0;
+        /** The sustained number of requests per second per host. */
+        double request_rate = 0;
+        /** The number of requests per host that may be made at once, the size of the bucket. */
+        size_t request_burst = 0;
+        /** The maximum number of concurrent connections per host. */
+        size_t max_connections = 0;
+      };
+
+      /**
+       * The slot of a host that is not tracked.
+       */
+      static constexpr uint32_t no_slot = UINT32_MAX;
+
+      /**
+       * The maximum number of slots probed for a host.
+       */
+      static constexpr size_t max_probes = 8;
+
+      /**
+       * Construct a RateLimiter.
+       * @param params The Params.
+       * @param capacity The minimum number of slots, rounded up to a power of 2.
+       */
+      RateLimiter( const Params &params, size_t capacity );
+
+      /**
+       * True if any of the limits in the Params is enabled.
+       * @param params The Params.
+       * @return True if a RateLimiter with these Params limits anything.
+       */
+      static bool isEnabled( const Params &params ) {
+        return params.connection_rate > 0 || params.request_rate > 0 || params.max_connections > 0;
+      }
+
+      /**
+       * Return the key of the host of an Address, the port is ignored.
+       * @param address The Address.
+       * @return The key, never 0.
+       */
+      static uint64_t key( const Address &address );
+
+      /**
+       * Admit a new connection from the host. If admitted, the connection is counted to the host until
+       * releaseConnection().
+       * @param key The key() of the host.
+       * @param slot Set to the slot of the host, or no_slot if the host is not tracked.
+       * @return False if the connection exceeds the connection rate or maximum connections of the host.
+       */
+      bool admitConnection( uint64_t key, uint32_t &slot );
+
+      /**
+       * Admit a request on a connection.
+       * @param slot The slot returned by admitConnection().
+       * @return False if the request exceeds the request rate of the host.
+       */
+      bool admitRequest( uint32_t slot );
+
+      /**
+       * Release a connection admitted by admitConnection().
+       * @param slot The slot returned by admitConnection().
+       */
+      void releaseConnection( uint32_t slot );
+
+    private:
+
+      /**
+       * A host in the table.
+       */
+      struct Entry {
+        /** The key of the host, 0 if the slot has never been used. */
+        std::atomic<uint64_t> key = 0;
+        /** The theoretical arrival time of the next connection in steady nanoseconds. */
+        std::atomic<uint64_t> connection_tat = 0;
+        /** The theoretical arrival time of the next request in steady nanoseconds. */
+        std::atomic<uint64_t> request_tat = 0;
+        /** The number of connections of the host. */
+        std::atomic<uint32_t> connections = 0;
+      };
+
+      /**
+       * Take a token from a bucket.
+       * @param tat The theoretical arrival time of the bucket.
+       * @param interval The nanoseconds per token, the inverse of the rate.
+       * @param tolerance The nanoseconds the theoretical arrival time may be ahead of now, the bucket size.
+       * @param now The current steady time in nanoseconds.
+       * @return False if the bucket is empty.
+       */
+      static bool take( std::atomic<uint64_t> &tat, uint64_t interval, uint64_t tolerance, uint64_t now );
+
+      /** The Params. */
+      Params params_;
+
+      /** The nanoseconds per connection token, 0 if not limited. */
+      uint64_t connection_interval_;
+
+      /** The connection burst tolerance in nanoseconds. */
+      uint64_t connection_tolerance_;
+
+      /** The nanoseconds per request token, 0 if not limited. */
+      uint64_t request_interval_;
+
+      /** The request burst tolerance in nanoseconds. */
+      uint64_t request_tolerance_;
+
+      /** The number of slots minus 1. */
+      size_t mask_;
+
+      /** The table. */
+      std::vector<Entry> table_;
+  };
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file scalingpolicy.hpp
+ * Defines the dodo::network::ScalingPolicy and dodo::network::LatencyScalingPolicy classes.
+ */
+
+#ifndef network_scalingpolicy_hpp
+#define network_scalingpolicy_hpp
+
+#include <cstddef>
+#include <string>
+
+namespace dodo::network {
+
+  /**
+   * Decides the number of active TCPServers in a TCPListener pool. Every scaling interval, the TCPListener
+   * measures the load into a Sample and calls decide(). TCPServers beyond the decided number are parked (their
+   * threads sleep and take no work), parked TCPServers are resumed before new TCPServer threads are started, so
+   * that scaling does not create and destroy threads.
+   *
+   * A custom policy is installed by overriding TCPServer::newScalingPolicy().
+   */
+  class ScalingPolicy {
+    public:
+
+      /**
+       * The load measured by the TCPListener over one scaling interval.
+       */
+      struct Sample {
+        /** The length of the interval in seconds. */
+        double interval_s = 0;
+        /** The number of active (not parked) TCPServers. */
+        size_t active = 0;
+        /** The minimum number of active TCPServers. */
+        size_t minservers = 0;
+        /** The maximum number of active TCPServers. */
+        size_t maxservers = 0;
+        /** The number of queued work items at the end of the interval. */
+        size_t queued = 0;
+        /** The average time in microseconds a work item waited in the queue before a TCPServer took it. */
+        double queue_wait_us = 0;
+        /** The fraction of the interval the active TCPServers were busy, 0.0 - 1.0. */
+        double utilisation = 0;
+        /** The number of work items taken from the queue per second. */
+        double throughput = 0;
+      };
+
+      virtual ~ScalingPolicy() {}
+
+      /**
+       * Decide the number of TCPServers that should be active. The TCPListener clamps the result to
+       * [minservers, maxservers].
+       * @param sample The load over the last interval.
+       * @return The number of TCPServers that should be active.
+       */
+      virtual size_t decide( const Sample &sample ) = 0;
+
+      /**
+       * Return the reason for the last decision, logged with the scaling decision.
+       * @return The reason.
+       */
+      const std::string& getReason() const { return reason_; }
+
+    protected:
+
+      /** The reason for the last decision. */
+      std::string reason_;
+  };
+
+  /**
+   * The default ScalingPolicy. Scales up when work waits in the queue longer than up_wait_us or when the
+   * TCPServers are busy more than up_utilisation of the time, for up_intervals consecutive intervals. Scales down by
+   * one TCPServer when work does not wait and utilisation is below down_utilisation for down_intervals consecutive
+   * intervals. The gap between the thresholds and the interval counts provide hysteresis so that bursty traffic does
+   * not make the pool flap.
+   *
+   * A scale up is proportional to the utilisation but at most doubles the pool. If a scale up did not raise the
+   * throughput whilst the pressure persists, the pool is saturated (typically on cpu or a resource shared by the
+   * TCPServers) and no further TCPServers are added until the pressure has gone.
+   */
+  class LatencyScalingPolicy : public ScalingPolicy {
+    public:
+
+      /**
+       * LatencyScalingPolicy parameters.
+       */
+      struct Params {
+        /** The queue wait in microseconds above which to scale up. */
+        double up_wait_us = 2000;
+        /** The utilisation above which to scale up. */
+        double up_utilisation = 0.85;
+        /** The utilisation below which to scale down. */
+        double down_utilisation = 0.4;
+        /** The number of consecutive intervals under pressure before scaling up. */
+        size_t up_intervals = 2;
+        /** The number of consecutive idle intervals before scaling down. */
+        size_t down_intervals = 10;
+      };
+
+      /**
+       * Construct a LatencyScalingPolicy.
+       * @param params The Params.
+       */
+      explicit LatencyScalingPolicy( const Params &params );
+
+      /**
+       * Decide the number of active TCPServers.
+       * @param sample The load over the last interval.
+       * @return The number of TCPServers that should be active.
+       */
+      virtual size_t decide( const Sample &sample );
+
+    private:
+
+      /**
+       * The relative throughput increase a scale up must yield, below it the pool is considered saturated.
+       */
+      static constexpr double saturation_gain = 1.05;
+
+      /** The Params. */
+      Params params_;
+
+      /** The number of consecutive intervals under pressure. */
+      size_t up_count_;
+
+      /** The number of consecutive idle intervals. */
+      size_t down_count_;
+
+      /** The throughput before the last scale up. */
+      double up_throughput_;
+
+      /** The number of active TCPServers after the last scale up, 0 if the last decision was not a scale up. */
+      size_t up_active_;
+  };
+
+}
+
+#endif
@@ -93,6 +93,47 @@ namespace dodo::network {
        */
       virtual common::SystemError send( const void* buf, ssize_t len, bool more = false );
 
+      /**
+       * Send as many of len bytes as the socket accepts without blocking.
+       * @param buf The bytes to send.
+       * @param len The number of bytes to send from buf.
+       * @param sent The number of bytes sent.
+       * @param more If true, do no force a network send right away.
+       * @return SystemError::ecOK if all bytes were sent or
+       *   - SystemError::ecEAGAIN: Not all bytes were sent, the socket send buffer is full.
+       *   - SystemError::ecECONNRESET, SystemError::ecEPIPE : The peer has disconnected.
+       */
+      virtual common::SystemError sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more = false );
+
+      /**
+       * Send the concatenation of count buffers with sendmsg, passing up to sendv_max_iov buffers per call in an
+       * iovec array, resuming after partial writes.
+       * @param buffers The buffers to send.
+       * @param count The number of buffers.
+       * @param more If true, do no force a network send right away.
+       * @return SystemError::ecOK or
+       *   - SystemError::ecEAGAIN: For non-blocking sockets, not all bytes were sent.
+       *   - SystemError::ecECONNRESET, SystemError::ecEPIPE : The peer has disconnected during the send.
+       */
+      virtual common::SystemError sendv( const ConstBuffer* buffers, size_t count, bool more = false );
+
+      /**
+       * Send length bytes from fd without copying them through user space. Regular files are sent with
+       * sendfile(2). A pipe is duplicated into an intermediate pipe with tee(2) and spliced to the socket, only the
+       * bytes the socket accepted are consumed from the source pipe, offset is ignored for pipes. Neither the pipes
+       * nor the socket are waited for, an empty source pipe returns SystemError::ecEAGAIN. The intermediate pipe is
+       * kept per thread. Other file types are sent with BaseSocket::sendFile().
+       * @param fd The file descriptor to send from.
+       * @param offset The offset in fd to start at.
+       * @param length The number of bytes to send.
+       * @param sent The number of bytes sent.
+       * @return SystemError::ecOK if all bytes were sent or
+       *   - SystemError::ecEAGAIN: Not all bytes were sent, the socket send buffer is full.
+       *   - SystemError::ecECONNRESET, SystemError::ecEPIPE : The peer has disconnected.
+       *   - SystemError::ecENODATA : fd ended before all bytes were sent.
+       */
+      virtual common::SystemError sendFile( int fd, off_t offset, size_t length, size_t &sent );
+
       /**
        * Send raw packets to the given Address.
        * @param address The destination Address
@@ -116,6 +157,15 @@ namespace dodo::network {
        */
       virtual common::SystemError receive( void* buf, ssize_t request, ssize_t &received );
 
+      /**
+       * Receive bytes into count buffers with a single readv.
+       * @param buffers The buffers to receive into.
+       * @param count The number of buffers, at most sendv_max_iov.
+       * @param received The number of bytes received.
+       * @return The error code, as receive().
+       */
+      virtual common::SystemError receivev( const MutableBuffer* buffers, size_t count, ssize_t &received );
+
       /**
        * Accepts a connection request and return a pointer to a new Socket for the new connection, the caller will
        * own the new Socket object.
@@ -130,6 +180,24 @@ namespace dodo::network {
 
     protected:
 
+      /**
+       * The maximum number of buffers passed to a single sendmsg or readv by sendv() and receivev().
+       */
+      static constexpr size_t sendv_max_iov = 64;
+
+      /**
+       * The maximum number of bytes passed to a single sendfile call.
+       */
+      static constexpr size_t sendfile_max_chunk = 0x7ffff000;
+
+      /**
+       * Send length bytes from pipe fd, see sendFile().
+       * @param fd The pipe to send from.
+       * @param length The number of bytes to send.
+       * @param sent The number of bytes sent.
+       * @return The SystemError, as sendFile().
+       */
+      common::SystemError sendPipe( int fd, size_t length, size_t &sent );
 
   };
 
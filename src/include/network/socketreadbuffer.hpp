@@ -39,6 +39,11 @@ namespace dodo {
      * will advance the current byte, but this in turn will call underflow, which in turn might do
      * a read if it reached the end of available bytes.
      *
+     * Besides get() and next(), which cost two virtual calls per byte, the buffered bytes can be accessed in bulk.
+     * peek() returns the contiguous window of buffered bytes starting at the current byte, and consume() advances
+     * over a number of them, so that a parser scans the window directly. find() and read() build on these to locate a
+     * delimiter with memchr and to copy data with memcpy.
+     *
      * @see SocketReadBuffer and FileReadBuffer - both concrete implementations.
      */
     class VirtualReadBuffer {
@@ -66,6 +71,39 @@ namespace dodo {
          */
         virtual common::SystemError underflow() = 0;
 
+        /**
+         * Return the contiguous window of buffered bytes, starting at the current char get() returns. Does not
+         * underflow, so the window is empty only if the source is exhausted.
+         * @param data Receives the start of the window.
+         * @return The number of bytes in the window.
+         */
+        virtual size_t peek( const char* &data ) const = 0;
+
+        /**
+         * Move n chars forward, as n calls to next().
+         * @param n The number of chars to move, at most the size of the peek() window.
+         * @return SystemError::ecOK and get() is valid, or a SystemError.
+         */
+        virtual common::SystemError consume( size_t n ) = 0;
+
+        /**
+         * Find a char in the peek() window.
+         * @param c The char to find.
+         * @param offset Receives the offset of c from the current char.
+         * @return True if c was found in the window, false if not (which does not mean it does not follow).
+         */
+        bool find( char c, size_t &offset ) const;
+
+        /**
+         * Copy n chars, starting at the current char, and move past them, as n calls to get() and next(), refilling
+         * the buffer as often as required.
+         * @param dest The destination, of at least n bytes.
+         * @param n The number of chars to copy.
+         * @return SystemError::ecOK and get() is valid, or a SystemError, in which case less than n chars may have
+         * been copied.
+         */
+        common::SystemError read( void* dest, size_t n );
+
         /**
          * Return the number of times underflow() was invoked.
          * @return The number of times underflow() was invoked.
@@ -122,6 +160,10 @@ namespace dodo {
          */
         virtual common::SystemError underflow();
 
+        virtual size_t peek( const char* &data ) const;
+
+        virtual common::SystemError consume( size_t n );
+
       protected:
 
         /**
@@ -163,6 +205,10 @@ namespace dodo {
 
         virtual common::SystemError underflow();
 
+        virtual size_t peek( const char* &data ) const;
+
+        virtual common::SystemError consume( size_t n );
+
       protected:
 
         /** The file handle. */
@@ -197,6 +243,22 @@ namespace dodo {
 
         virtual common::SystemError next() { if ( idx_ >= data_.length() -1  ) return common::SystemError::ecEAGAIN; else { idx_++; return common::SystemError::ecOK; } };
 
+        virtual size_t peek( const char* &data ) const { data = data_.data() + idx_; return data_.length() - idx_; }
+
+        /**
+         * Move n chars forward, but like next(), not beyond the last char.
+         * @param n The number of chars to move.
+         * @return SystemError::ecOK or SystemError::ecEAGAIN if the last char was reached.
+         */
+        virtual common::SystemError consume( size_t n ) {
+          if ( idx_ + n >= data_.length() ) {
+            idx_ = data_.length() ? data_.length() - 1 : 0;
+            return common::SystemError::ecEAGAIN;
+          }
+          idx_ += n;
+          return common::SystemError::ecOK;
+        }
+
       protected:
 
         virtual common::SystemError underflow() { return common::SystemError::ecOK; };
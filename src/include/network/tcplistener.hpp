@@ -24,21 +24,34 @@
 #define network_tcplistener_hpp
 
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <map>
+#include <memory>
 #include <queue>
 #include <set>
 #include <stdint.h>
 #include <sys/epoll.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 
 #include "common/exception.hpp"
 #include "common/bytes.hpp"
+#include "common/histogram.hpp"
+#include "common/util.hpp"
+#include "network/handover.hpp"
+#include "network/ratelimiter.hpp"
+#include "network/scalingpolicy.hpp"
+#include "network/timerwheel.hpp"
 #include "network/socket.hpp"
+#include "network/tlscontext.hpp"
+#include "threads/mpmcqueue.hpp"
 #include "threads/mutex.hpp"
+#include "threads/semaphore.hpp"
 #include "threads/thread.hpp"
 
 
@@ -48,6 +61,7 @@ namespace dodo {
 
     class TCPServer;
     class TCPListenerTimer;
+    class URing;
 
     /**
      * Class to track a connection.
@@ -61,12 +75,15 @@ namespace dodo {
         TCPConnectionData() {};
 
         /**
-         * Destruct.
+         * Destruct, closes the file descriptors of queued sendFile() transfers.
          */
-        virtual ~TCPConnectionData() {};
+        virtual ~TCPConnectionData();
 
         /**
-         * Reads and appends data to read_buffer
+         * Reads and appends data to read_buffer. Data is received directly into the spare capacity of read_buffer,
+         * which is sized after the previous read, and into a stack buffer as second readv segment, so that a burst
+         * larger than the spare capacity is drained in a single system call. When both segments are filled,
+         * read_buffer is grown to the number of bytes readable (FIONREAD) and reading continues.
          * @param socket The socket to read from.
          * @param received The number of bytes received.
          * @return The number of bytes read.
@@ -74,7 +91,15 @@ namespace dodo {
         common::SystemError readBuffer( BaseSocket* socket, ssize_t &received );
 
         /**
-         * Clears the read_buffer.
+         * Appends data that has already been received to read_buffer.
+         * @param data The data.
+         * @param size The number of bytes in data.
+         */
+        void appendBuffer( const common::Octet* data, size_t size ) { read_buffer.append( data, size ); }
+
+        /**
+         * Clears the read_buffer. The allocated memory is kept for the next request, unless it exceeds
+         * read_buffer_keep.
          */
         void clearBuffer();
 
@@ -84,9 +109,100 @@ namespace dodo {
          */
         const common::Bytes& getReadBuffer() const { return read_buffer; }
 
+        /**
+         * Send data on the connection without blocking. Data that the socket does not accept right away is queued
+         * and sent by the TCPServer when the TCPListener detects the socket is writable again (SockState::Write).
+         * Data is always sent in order, if data is already queued, all data is queued.
+         * @param socket The socket of the connection.
+         * @param buf The data to send.
+         * @param len The number of bytes in buf.
+         * @param more If true, more data will follow.
+         * @return SystemError::ecOK if the data was sent or queued, or the error if the connection failed.
+         */
+        common::SystemError send( BaseSocket* socket, const void* buf, ssize_t len, bool more = false );
+
+        /**
+         * Send length bytes from file descriptor fd, starting at offset, without blocking and without copying
+         * them through user space (BaseSocket::sendFile). What the socket does not accept right away is queued
+         * like send() output, and data sent after the file is queued behind it. The TCPServer transfers at most
+         * output_file_chunk bytes each time the socket is writable, so a large transfer does not occupy the
+         * TCPServer.
+         *
+         * The TCPConnectionData takes ownership of fd and closes it once the transfer has completed or the
+         * connection is closed, pass a dup() of fd to keep using it.
+         * @param socket The socket of the connection.
+         * @param fd The file descriptor to send from.
+         * @param offset The offset in fd to start at.
+         * @param length The number of bytes to send.
+         * @return SystemError::ecOK if the data was sent or queued, or the error if the connection failed.
+         */
+        common::SystemError sendFile( BaseSocket* socket, int fd, off_t offset, size_t length );
+
+        /**
+         * Send queued output.
+         * @param socket The socket of the connection.
+         * @param sent The number of bytes sent.
+         * @return SystemError::ecOK if the output queue was emptied, SystemError::ecEAGAIN if output remains queued
+         * or the error if the connection failed.
+         */
+        common::SystemError flushOutput( BaseSocket* socket, ssize_t &sent );
+
+        /**
+         * Return the number of queued output bytes.
+         * @return The number of bytes queued.
+         */
+        size_t getOutputSize() const;
+
+        /**
+         * The maximum number of file bytes flushOutput() sends in one call.
+         */
+        static constexpr size_t output_file_chunk = 1048576;
+
+        /**
+         * The minimum spare read_buffer capacity to receive into.
+         */
+        static constexpr size_t read_buffer_min_spare = 4096;
+
+        /**
+         * The size of the stack buffer that receives what does not fit the spare read_buffer capacity.
+         */
+        static constexpr size_t read_overflow_size = 65536;
+
+        /**
+         * The maximum read_buffer capacity kept by clearBuffer().
+         */
+        static constexpr size_t read_buffer_keep = 1048576;
+
       protected:
+
+        /**
+         * A file transfer queued by sendFile().
+         */
+        struct OutputFile {
+          /** The file descriptor, owned. */
+          int fd;
+          /** The offset of the next byte to send. */
+          off_t offset;
+          /** The number of bytes left to send. */
+          size_t length;
+          /** Output queued after the file. */
+          std::vector<common::Octet> trailer;
+        };
+
         /** Buffer for (incomplete) request data. */
         common::Bytes read_buffer;
+
+        /** The number of bytes received by the previous readBuffer() call, sizes the spare capacity. */
+        size_t read_hint = 0;
+
+        /** Queued output, the bytes from output_offset onwards are not sent yet. */
+        std::vector<common::Octet> output_buffer;
+
+        /** The number of output_buffer bytes already sent. */
+        size_t output_offset = 0;
+
+        /** File transfers queued behind output_buffer. */
+        std::deque<OutputFile> output_files;
     };
 
     /**
@@ -101,12 +217,14 @@ namespace dodo {
      *
      * The developer sub-classes TCPServer to implement a request-response protocol.
      *
-     * TCPListener uses the Linux epoll_wait interface to pick up socket events and distribute the work to TCPServers.
+     * TCPListener uses the Linux epoll_wait interface to pick up socket events and distribute the work to TCPServers,
+     * or io_uring completions if Params.io_engine is IOEngine::URing.
      *
      * The TCPListener is started start( TCPServer *server ) with an initial TCPServer object. The
      * TCPServer::addServer() method is used to spawn additional TCPServer objects up to Params.minservers when
-     * TCPListener::run() is invoked. The TCPListener will spawn TCPServer worker threads if the amount of pending
-     * work exceeds the number of existing TCPServer objects, up to Params.maxservers.
+     * TCPListener::run() is invoked. A ScalingPolicy decides the number of active TCPServers from the measured queue
+     * wait, TCPServer utilisation and throughput, between Params.minservers and Params.maxservers. TCPServers are
+     * parked rather than stopped when they are not needed.
      *
      * The TCPServer descendant class implements the details of handShake, readSocket and shutDown, and are each
      * passed a SocketWork that needs to be serviced -a SocketWork specifies the socket and the event state it is in.
@@ -126,6 +244,22 @@ namespace dodo {
     class TCPListener : public threads::Thread {
       public:
 
+        /**
+         * How new connections are assigned to TCPServers if Params.worker_owned is true.
+         */
+        enum class WorkerAssignment {
+          RoundRobin,     /**< Assign to the TCPServers in turn. */
+          LeastLoaded     /**< Assign to the TCPServer with the least connections. */
+        };
+
+        /**
+         * The I/O engine driving the connections.
+         */
+        enum class IOEngine {
+          Epoll,          /**< Readiness notification with epoll, the TCPServers read and send with system calls. */
+          URing           /**< Completion based io_uring, see Params.io_engine. */
+        };
+
         /**
          * Parameters affecting TCPListener behavior.
          */
@@ -141,15 +275,41 @@ namespace dodo {
             maxqdepth(128),
             sendbufsz(16384),
             recvbufsz(32768),
-            server_idle_ttl_s(300),
             pollbatch(128),
+            pop_batch(8),
+            spin_max(2000),
             listener_sleep_ms(1000),
-            throttle_sleep_us(4000),
-            cycle_max_throttles(40),
+            admission_resume_ratio(0.5),
+            shed_connections(false),
+            ip_connection_rate(0),
+            ip_connection_burst(20),
+            ip_request_rate(0),
+            ip_request_burst(100),
+            ip_max_connections(0),
             stat_trc_interval_s(300),
             send_timeout_seconds(10),
             receive_timeout_seconds(10),
-            tcp_keep_alive(false)
+            tcp_keep_alive(false),
+            edge_triggered(false),
+            worker_owned(false),
+            worker_assignment(WorkerAssignment::RoundRobin),
+            listener_shards(1),
+            shard_incoming_cpu(false),
+            io_engine(IOEngine::Epoll),
+            output_high_water(262144),
+            idle_timeout_ms(0),
+            handshake_timeout_ms(10000),
+            request_timeout_ms(60000),
+            handover_path(""),
+            handover_connections(false),
+            handover_drain_s(30),
+            tls(),
+            scale_interval_ms(500),
+            scale_up_wait_us(2000),
+            scale_up_utilisation(0.85),
+            scale_down_utilisation(0.4),
+            scale_up_intervals(2),
+            scale_down_intervals(10)
             {};
 
           /**
@@ -189,14 +349,21 @@ namespace dodo {
           socklen_t recvbufsz;
 
           /**
-           * The maximum TCPServer idle time in seconds before stopping the server, honoring minservers.
+           * The number of epoll_wait events read in one epol__wait wake-up
            */
-          double server_idle_ttl_s;
+          int pollbatch;
 
           /**
-           * The number of epoll_wait events read in one epol__wait wake-up
+           * The maximum number of SocketWork items a TCPServer takes from the work queue in one go. A TCPServer only
+           * takes more than one item when there are more queued items than TCPServers.
            */
-          int pollbatch;
+          size_t pop_batch;
+
+          /**
+           * The maximum number of times an idle TCPServer polls the work queue before it goes to sleep. The actual
+           * number adapts to how often spinning finds work. Ignored (0) on a single cpu.
+           */
+          size_t spin_max;
 
           /**
            * The TCPListener epoll_wait timeout in ms
@@ -204,16 +371,45 @@ namespace dodo {
           int listener_sleep_ms;
 
           /**
-           * The time to sleep when the queue gets too big (letting workers clear from the queue without
-           * accepting new work.
+           * When the work queue exceeds maxqdepth, the TCPListener stops accepting new connections so that the
+           * TCPServers can catch up on the established connections. New connections are admitted again once the
+           * queue has drained to admission_resume_ratio * maxqdepth.
+           */
+          double admission_resume_ratio;
+
+          /**
+           * If false, the listening socket is taken out of the epoll set whilst new connections are not admitted,
+           * so that the kernel backlog absorbs the burst. If true, new connections are accepted and closed right
+           * away, so that clients fail fast rather than wait in the backlog.
+           */
+          bool shed_connections;
+
+          /**
+           * The sustained number of new connections per second accepted from a single peer host, 0 disables.
+           * Connections over the limit are closed right away.
+           */
+          double ip_connection_rate;
+
+          /**
+           * The number of new connections a single peer host may make at once within ip_connection_rate.
+           */
+          size_t ip_connection_burst;
+
+          /**
+           * The sustained number of requests (read events) per second accepted from a single peer host, 0 disables.
+           * Connections that exceed the limit are shut down.
            */
-          size_t throttle_sleep_us;
+          double ip_request_rate;
 
           /**
-           * Maximum number of throttles per epoll_wait cycle. The listener thread is blocked no longer than
-           * cycle_max_throttles * throttle_sleep_us per epoll_wait cycle.
+           * The number of requests a single peer host may make at once within ip_request_rate.
            */
-          size_t cycle_max_throttles;
+          size_t ip_request_burst;
+
+          /**
+           * The maximum number of concurrent connections from a single peer host, 0 disables.
+           */
+          size_t ip_max_connections;
 
           /**
            * The epol__wait timeout in ms
@@ -234,6 +430,139 @@ namespace dodo {
            * Toggle TCP keep-alive.
            */
           bool tcp_keep_alive;
+
+          /**
+           * If true, register connections edge-triggered (EPOLLET) once, instead of re-arming a one-shot
+           * (EPOLLONESHOT) registration with EPOLL_CTL_MOD after each request. Events arriving whilst the connection's
+           * work is queued or in progress are accumulated and handled by the TCPServer when it releases the work.
+           * TCPConnectionData::readBuffer drains the socket, so edge-triggered mode requires no epoll_ctl calls
+           * per request.
+           */
+          bool edge_triggered;
+
+          /**
+           * If true, each accepted connection is assigned to a single TCPServer that owns it for the lifetime of the
+           * connection. The TCPServer polls its connections in its own epoll set and calls handShake, readSocket
+           * and shutDown inline, so there is no work queue and no cross-thread handoff per request. The number of
+           * TCPServers is fixed at minservers, maxservers does not apply.
+           */
+          bool worker_owned;
+
+          /**
+           * How connections are assigned to TCPServers if worker_owned is true.
+           */
+          WorkerAssignment worker_assignment;
+
+          /**
+           * The number of listener shards. Each shard binds the listen address with SO_REUSEPORT and runs its own
+           * epoll loop, connection map and TCPServer pool, the kernel distributes new connections over the shards.
+           * The minservers, maxservers, maxconnections and maxqdepth limits are totals, divided over the shards.
+           */
+          size_t listener_shards;
+
+          /**
+           * If true and listener_shards > 1, pin shard n to cpu n (modulo the number of cpus) and set SO_INCOMING_CPU
+           * on its listening socket, so that the kernel prefers the shard running on the cpu that processed the
+           * incoming packets.
+           */
+          bool shard_incoming_cpu;
+
+          /**
+           * The I/O engine. IOEngine::URing runs the connections worker-owned (worker_owned is implied), with a
+           * multishot accept on the listening socket and, per TCPServer, a ring with a multishot receive per
+           * connection into a provided buffer ring. The responses sent by TCPServer::readSocket are queued (see
+           * URingSocket) and submitted in one batch together with the next wait for completions, so that under load
+           * there are only a few io_uring_enter calls for many requests. If io_uring is not available at runtime
+           * the TCPListener falls back to IOEngine::Epoll.
+           */
+          IOEngine io_engine;
+
+          /**
+           * If a connection has at least output_high_water bytes of queued output (see TCPConnectionData::send and
+           * TCPConnectionData::sendFile, and the URingSocket output with IOEngine::URing), the TCPListener stops
+           * reading from the connection until the output has been drained below the mark.
+           */
+          size_t output_high_water;
+
+          /**
+           * Close connections that are idle (no partial request buffered) for longer than idle_timeout_ms
+           * milliseconds, 0 disables. Not supported by the io_uring engine.
+           */
+          size_t idle_timeout_ms;
+
+          /**
+           * Close connections that have not completed the handshake within handshake_timeout_ms milliseconds,
+           * 0 disables.
+           */
+          size_t handshake_timeout_ms;
+
+          /**
+           * Close connections that do not complete a request within request_timeout_ms milliseconds of a partial
+           * request (data left in the read buffer by readSocket), 0 disables.
+           */
+          size_t request_timeout_ms;
+
+          /**
+           * The path of a Unix domain socket for zero-downtime restarts, empty disables. A new instance of the
+           * process connects to it and receives the listening sockets of the running instance (SCM_RIGHTS), so that
+           * no connection is refused during the restart. The running instance then stops accepting, drains its work
+           * queue and stops, see hasHandedOver(). The new instance listens on the path for its own successor.
+           */
+          std::string handover_path;
+
+          /**
+           * If true, the running instance also hands its established connections over to the new instance, each
+           * once it waits for a request without buffered input or output. The TCPServer of the new instance does
+           * not call handShake() on them. Not supported with worker_owned or tls, as it requires connections without
+           * protocol state outside the socket.
+           */
+          bool handover_connections;
+
+          /**
+           * The maximum number of seconds the running instance waits for its connections to become idle and be
+           * handed over, connections left are closed.
+           */
+          int handover_drain_s;
+
+          /**
+           * If set, accepted connections are TLSSockets and the TCPServers perform the TLS handshake before calling
+           * handShake(). The handshake does not block the TCPServer, it is resumed on each socket event whilst the
+           * connection is SockState::New and waits for the socket to become readable or writable as the handshake
+           * requires. Not supported by the io_uring engine, which falls back to epoll.
+           */
+          std::shared_ptr<TLSContext> tls;
+
+          /**
+           * The interval in milliseconds at which the load is sampled and the ScalingPolicy decides the number of
+           * active TCPServers.
+           */
+          int scale_interval_ms;
+
+          /**
+           * Scale up when work waits longer than scale_up_wait_us microseconds in the queue (LatencyScalingPolicy).
+           */
+          double scale_up_wait_us;
+
+          /**
+           * Scale up when the TCPServers are busy more than this fraction of the time (LatencyScalingPolicy).
+           */
+          double scale_up_utilisation;
+
+          /**
+           * Scale down when the TCPServers are busy less than this fraction of the time and work does not wait
+           * (LatencyScalingPolicy).
+           */
+          double scale_down_utilisation;
+
+          /**
+           * The number of consecutive scale intervals under pressure before scaling up (LatencyScalingPolicy).
+           */
+          size_t scale_up_intervals;
+
+          /**
+           * The number of consecutive idle scale intervals before parking a TCPServer (LatencyScalingPolicy).
+           */
+          size_t scale_down_intervals;
         };
 
 
@@ -241,17 +570,105 @@ namespace dodo {
          * Load statisics.
          */
         struct Stats {
-          Stats() : connections(0), requests(0), throttles(0),received(0),sent(0) {};
+          Stats() : connections(0), requests(0), admission_pauses(0), paused_us(0), shed(0),
+                    limited_connections(0), limited_requests(0), received(0), sent(0),
+                    epoll_ctls(0), uring_enters(0), scale_ups(0), scale_downs(0), timeouts(0),
+                    handshake_failures(0) {};
           /** The number of connections. */
           ssize_t connections;
           /** The number of requests. */
           ssize_t requests;
-          /** The number of throttles. */
-          ssize_t throttles;
+          /** The number of times new connections were no longer admitted. */
+          ssize_t admission_pauses;
+          /** The time in microseconds new connections were not admitted. */
+          ssize_t paused_us;
+          /** The number of new connections closed because they were not admitted. */
+          ssize_t shed;
+          /** The number of new connections closed by the per host limits. */
+          ssize_t limited_connections;
+          /** The number of connections shut down because their host exceeded the request rate. */
+          ssize_t limited_requests;
           /** The number of bytes received */
           ssize_t received;
           /** The number of bytes sent */
           ssize_t sent;
+          /** The number of epoll_ctl calls */
+          ssize_t epoll_ctls;
+          /** The number of io_uring_enter calls */
+          ssize_t uring_enters;
+          /** The number of ScalingPolicy decisions to add TCPServers */
+          ssize_t scale_ups;
+          /** The number of ScalingPolicy decisions to park TCPServers */
+          ssize_t scale_downs;
+          /** The number of connections closed on an idle, handshake or request timeout. */
+          ssize_t timeouts;
+          /** The number of connections closed on a failed TLS handshake or TCPServer::handShake. */
+          ssize_t handshake_failures;
+
+          /**
+           * Add the other Stats to this Stats.
+           * @param other The Stats to add.
+           * @return This Stats.
+           */
+          Stats& operator+=( const Stats& other ) {
+            connections += other.connections;
+            requests += other.requests;
+            admission_pauses += other.admission_pauses;
+            paused_us += other.paused_us;
+            shed += other.shed;
+            limited_connections += other.limited_connections;
+            limited_requests += other.limited_requests;
+            received += other.received;
+            sent += other.sent;
+            epoll_ctls += other.epoll_ctls;
+            uring_enters += other.uring_enters;
+            scale_ups += other.scale_ups;
+            scale_downs += other.scale_downs;
+            timeouts += other.timeouts;
+            handshake_failures += other.handshake_failures;
+            return *this;
+          }
+        };
+
+        /**
+         * Latency Histograms in nanoseconds, recorded by each TCPServer thread without locking and merged by
+         * the TCPListener when it logs statistics.
+         */
+        struct Latencies {
+          /** From the socket event (or the requeue of pending events) to a TCPServer taking the work. */
+          common::Histogram queue_wait;
+          /** The handshakes, from the first TLS handshake attempt to the completion of TCPServer::handShake. */
+          common::Histogram handshake;
+          /** Reading the socket and the TCPServer::readSocket calls. */
+          common::Histogram read_socket;
+          /** From the socket event to the work being released. */
+          common::Histogram total;
+
+          /**
+           * Add the other Latencies to this Latencies.
+           * @param other The Latencies to add.
+           * @return This Latencies.
+           */
+          Latencies& operator+=( const Latencies& other ) {
+            queue_wait += other.queue_wait;
+            handshake += other.handshake;
+            read_socket += other.read_socket;
+            total += other.total;
+            return *this;
+          }
+
+          /**
+           * Subtract earlier Latencies from this Latencies.
+           * @param other The Latencies to subtract.
+           * @return This Latencies.
+           */
+          Latencies& operator-=( const Latencies& other ) {
+            queue_wait -= other.queue_wait;
+            handshake -= other.handshake;
+            read_socket -= other.read_socket;
+            total -= other.total;
+            return *this;
+          }
         };
 
         /**
@@ -261,7 +678,8 @@ namespace dodo {
           None   = 0,     /**< Undefined / initial */
           New    = 1,     /**< New connection, TCPServer::handShake() will be called */
           Read   = 2,     /**< Data is ready to be read, TCPServer::readSocket() will be called */
-          Shut   = 4      /**< BaseSocket is hung up or in error, TCPServer::shutDown() will be called */
+          Shut   = 4,     /**< BaseSocket is hung up or in error, TCPServer::shutDown() will be called */
+          Write  = 8      /**< BaseSocket is writable, queued output will be sent */
         };
 
         /**
@@ -269,12 +687,46 @@ namespace dodo {
          * @see clients_
          */
         struct SocketWork {
-          /** Pointer to the socket */
+          /**
+           * Pointer to the socket. Only touched by the holder of the work: the TCPServer it is queued to, or the
+           * TCPListener whilst the work is armed or claimed. Others check the generation.
+           */
           BaseSocket* socket = nullptr;
           /** State of the socket */
           SockState state = SockState::New;
           /** Data context */
           TCPConnectionData* data = nullptr;
+          /**
+           * Generation of the connection slot, incremented when the slot's connection is closed, before the socket is
+           * torn down. Tells stale event and timer tokens apart without touching the socket.
+           */
+          std::atomic<uint32_t> generation = 0;
+          /** True if the socket has been added to epoll, re-arming is then an EPOLL_CTL_MOD. */
+          bool registered = false;
+          /** SockState bits of events not yet queued (edge-triggered mode only). */
+          std::atomic<int> pending = 0;
+          /** True whilst the work is queued or in progress (edge-triggered mode only). */
+          std::atomic<bool> busy = false;
+          /** The TCPServer owning the connection (worker-owned mode only). */
+          std::atomic<TCPServer*> owner = nullptr;
+          /** The epoll events the socket is registered for (worker-owned mode only). */
+          uint32_t events = 0;
+          /** The steadyNanos() time the work was queued. */
+          uint64_t queued_ns = 0;
+          /** The steadyNanos() time at which the waiting connection times out, 0 if it does not. */
+          std::atomic<uint64_t> deadline = 0;
+          /** True whilst the connection waits for events in the TCPListener's epoll set. */
+          std::atomic<bool> armed = false;
+          /** Non-zero whilst a TCPServer re-arms the socket in epoll, the TCPListener must then not close it. */
+          std::atomic<uint32_t> rearming = 0;
+          /** The steadyNanos() time the partial request or unsent response was first seen, 0 if there is none. */
+          uint64_t request_ns = 0;
+          /** The RateLimiter slot of the peer host. */
+          uint32_t limit_slot = RateLimiter::no_slot;
+          /** The epoll event (EPOLLIN or EPOLLOUT) the resumable TLS handshake waits for, 0 if it does not wait. */
+          uint32_t handshake_events = 0;
+          /** The steadyNanos() time of the first handshake attempt, 0 if there was none. */
+          uint64_t handshake_ns = 0;
         };
 
         /**
@@ -300,25 +752,81 @@ namespace dodo {
         void start( TCPServer *server );
 
         /**
-         * Request a stop on the TCPListener. Call wait() to wait for the thread to actually be stopped.
+         * Request a stop on the TCPListener (and its shards). Call wait() to wait for the thread to actually be stopped.
+         */
+        void stop();
+
+        /**
+         * Return the Stats of this TCPListener, excluding those of its shards.
+         * @return A copy of the Stats.
+         */
+        Stats getStats();
+
+        /**
+         * Return true if the TCPListener has handed its listening sockets over to a new instance of the process
+         * and has stopped (Params.handover_path). The process should then exit.
+         * @return True if handed over.
+         */
+        bool hasHandedOver() const { return handed_over_; }
+
+        /**
+         * Return the cumulative Latencies of the TCPServers of this TCPListener, excluding those of its shards, as
+         * merged at the last statistics interval.
+         * @return A copy of the Latencies.
          */
-        void stop() { stop_server_ = true; }
+        Latencies getLatencies();
 
       private:
 
         /**
-         * Add an epoll event for the BaseSocket.
-         * @param s The BaseSocket
+         * Construct a listener shard, called by the primary TCPListener when Params.listener_shards > 1.
+         * @param address The address to listen on.
+         * @param params The Params to use.
+         * @param primary The primary TCPListener.
+         * @param index The shard index (the primary has index 0).
+         */
+        TCPListener( const Address& address, const Params &params, TCPListener* primary, size_t index );
+
+        /**
+         * Create the listener shards, each a TCPListener listening on the same address.
+         */
+        void createShards();
+
+        /**
+         * Return true if this TCPListener is the primary (or only) listener.
+         * @return True if this is the primary listener.
+         */
+        bool isPrimary() const { return primary_ == nullptr; }
+
+        /**
+         * Return the number of connected clients.
+         * @return The number of connected clients.
+         */
+        size_t getClientCount();
+
+        /**
+         * Add an epoll event for the SocketWork's BaseSocket, the event data points to the SocketWork.
+         * @param work The SocketWork
          * @param events The events to set (see man epoll_ctl).
          */
-        void pollAdd( const BaseSocket* s, uint32_t events );
+        void pollAdd( SocketWork* work, uint32_t events );
 
         /**
-         * Modify an epoll event for the BaseSocket.
-         * @param s The BaseSocket
+         * Modify an epoll event for the SocketWork's BaseSocket, the event data points to the SocketWork.
+         * @param work The SocketWork
          * @param events The events to set (see man epoll_ctl).
          */
-        void pollMod( const BaseSocket* s, uint32_t events );
+        void pollMod( SocketWork* work, uint32_t events );
+
+        /**
+         * Return the epoll events to (re-)arm for the SocketWork, adding EPOLLOUT if it has queued output, and
+         * leaving out read events if the queued output exceeds Params.output_high_water. Whilst a TLS handshake
+         * waits, only the event it waits for is armed.
+         * @param work The SocketWork.
+         * @param base The events in absence of queued output.
+         * @return The epoll events.
+         */
+        uint32_t eventMask( const SocketWork* work, uint32_t base ) const;
 
         /**
          * Delete the epoll event for the BaseSocket.
@@ -332,14 +840,39 @@ namespace dodo {
         void logStats();
 
         /**
-         * Throttle the listener when work_q_sz_ exceeds params_.maxqdepth
+         * Stop admitting new connections when work_q_sz_ exceeds Params.maxqdepth, admit them again when the queue
+         * has drained to resume_qdepth_. Never blocks the TCPListener thread.
+         */
+        void admitConnections();
+
+        /**
+         * Called by a TCPServer that took work from the queue, wakes the TCPListener if it does not admit new
+         * connections and the queue has drained to resume_qdepth_.
          */
-        void throttle();
+        void signalResume() {
+          if ( admission_paused_ && work_q_sz_ <= resume_qdepth_ && !resume_signalled_.exchange( true ) ) {
+            uint64_t one = 1;
+            if ( ::write( resume_fd_, &one, sizeof(one) ) < 0 ) resume_signalled_ = false;
+          }
+        }
+
+        /**
+         * Every Params.scale_interval_ms, sample the load and set the number of active TCPServers as decided by
+         * the ScalingPolicy.
+         */
+        void scaleServers();
+
+        /**
+         * Resume parked TCPServers, start new TCPServers or park TCPServers so that target TCPServers are active.
+         * @param target The number of TCPServers that should be active.
+         */
+        void setActiveServers( size_t target );
 
         /**
-         * Add a server if work_q_sz_ exceeds servers.size() and servers_.size() < params_.maxservers
+         * Return a monotonic time in nanoseconds.
+         * @return The time.
          */
-        void addServers();
+        static uint64_t steadyNanos() { return common::steadyNanos(); }
 
         /**
          * Cleanup stopped TCPServers
@@ -347,10 +880,204 @@ namespace dodo {
         void cleanStoppedServers();
 
         /**
-         * Tell the listener to close the socket.
-         * @param socket The socket to close.
+         * Close the SocketWork's socket and release its slot.
+         * @param work The SocketWork to close.
+         */
+        void closeSocket( SocketWork *work );
+
+        /**
+         * Take a new connection into a connection slot and hand it to a TCPServer.
+         * @param client_sock The accepted socket, owned by the TCPListener from here on.
+         * @param adopted True for a connection handed over by the previous instance, which skips the handshake.
+         */
+        void newConnection( BaseSocket* client_sock, bool adopted = false );
+
+        /**
+         * Accept new connections from the listening socket.
          */
-        void closeSocket( BaseSocket *socket );
+        void acceptConnections();
+
+        /**
+         * Handle the multishot accept completions of listen_ring_ (io_uring engine).
+         */
+        void reapAccepts();
+
+        /**
+         * Assign a new connection to a TCPServer (worker-owned mode), skipping TCPServers that are stopping.
+         * @param work The SocketWork of the new connection.
+         * @return False if there is no running TCPServer to assign to.
+         */
+        bool assignWork( SocketWork* work );
+
+        /**
+         * Move the connections owned by a stopped TCPServer to the running TCPServers (worker-owned mode), so they
+         * do not refer to the TCPServer once it is deleted. Connections of the io_uring engine, of which the
+         * operations in flight were cancelled with the ring, and those that cannot be moved are closed.
+         * @param server The stopped TCPServer.
+         */
+        void releaseOwned( TCPServer* server );
+
+        /**
+         * Add to the number of requests.
+         * @param requests The number of requests to add.
+         */
+        void addRequests( ssize_t requests ) {
+          count( counters().requests, requests );
+        }
+
+        /**
+         * Return the epoll event token for the SocketWork, composed of the slot generation (high 32 bits)
+         * and the slot index (low 32 bits).
+         * @param work The SocketWork.
+         * @return The token.
+         */
+        uint64_t pollToken( const SocketWork* work ) const {
+          return ( (uint64_t)work->generation.load() << 32 ) | (uint64_t)( work - clients_.data() );
+        }
+
+        /**
+         * The epoll event token of the listening socket, or of listen_ring_ with the io_uring engine.
+         */
+        static const uint64_t listen_token_ = UINT64_MAX;
+
+        /**
+         * The resolution of the connection timeouts in milliseconds, the maximum epoll_wait timeout whilst
+         * timeouts are enabled.
+         */
+        static constexpr int timeout_tick_ms = 100;
+
+        /**
+         * Return the deadline for a connection that is about to wait for events: the handshake, request or idle
+         * timeout from now, depending on the state of the connection.
+         * @param work The SocketWork.
+         * @return The steadyNanos() deadline, 0 if the applicable timeout is disabled.
+         */
+        uint64_t connectionDeadline( SocketWork* work ) const;
+
+        /**
+         * Close the connections in the TCPListener's epoll set whose deadline has passed, through the Shut path
+         * of a TCPServer.
+         */
+        void expireTimeouts();
+
+        /**
+         * True if any of the connection timeouts is enabled.
+         */
+        bool timeouts_enabled_;
+
+        /**
+         * The shortest enabled timeout in nanoseconds. Connections without a deadline are re-checked at this
+         * interval, as a deadline may be set whilst they are busy.
+         */
+        uint64_t timeout_recheck_ns_;
+
+        /**
+         * The connection deadlines, by pollToken(), if timeouts_enabled_ and connections are not worker-owned.
+         */
+        TimerWheel* wheel_;
+
+        /**
+         * The epoll event token of resume_fd_.
+         */
+        static const uint64_t resume_token_ = UINT64_MAX - 1;
+
+        /**
+         * The epoll event token of handover_listen_fd_.
+         */
+        static const uint64_t handover_token_ = UINT64_MAX - 2;
+
+        /**
+         * The epoll event token of handover_in_.
+         */
+        static const uint64_t handover_in_token_ = UINT64_MAX - 3;
+
+        /**
+         * The maximum number of milliseconds a new instance waits for the listening sockets of the running
+         * instance.
+         */
+        static constexpr int handover_timeout_ms = 5000;
+
+        /**
+         * Connect to Params.handover_path and receive the listening sockets of the running instance into
+         * handover_fds_, leaving handover_in_ open to receive its connections. Primary only.
+         */
+        void receiveListeners();
+
+        /**
+         * Accept a new instance on handover_listen_fd_, send it the listening sockets of all shards and start the
+         * handover on all shards. Primary only.
+         */
+        void sendListeners();
+
+        /**
+         * Adopt the connections received on handover_in_. Primary only.
+         */
+        void receiveConnections();
+
+        /**
+         * Called each TCPListener iteration whilst handing over: stop listening, hand over the idle connections
+         * and stop once drained.
+         */
+        void drainHandover();
+
+        /**
+         * Send a message to the new instance, serialized over the shards.
+         * @param tag The Handover::Tag.
+         * @param fd The file descriptor to pass.
+         * @return The result of Handover::send.
+         */
+        common::SystemError sendHandover( Handover::Tag tag, int fd );
+
+        /**
+         * Listening sockets received from the running instance, by shard index, -1 once taken by the shard. Primary
+         * only.
+         */
+        std::vector<int> handover_fds_;
+
+        /**
+         * The Unix domain socket new instances connect to, -1 if none. Primary only.
+         */
+        int handover_listen_fd_;
+
+        /**
+         * The channel to the previous instance, receiving its connections, -1 if none. Primary only.
+         */
+        int handover_in_;
+
+        /**
+         * The channel to the new instance, -1 if none. Primary only.
+         */
+        int handover_out_;
+
+        /**
+         * Serializes sendHandover() calls of the shards.
+         */
+        threads::Mutex handover_mutex_;
+
+        /**
+         * Set when the listening sockets have been handed over to a new instance.
+         */
+        std::atomic<bool> handing_over_;
+
+        /**
+         * False once this TCPListener no longer accepts connections after a handover.
+         */
+        bool listening_;
+
+        /**
+         * The steadyNanos() time after which connections that were not handed over are closed.
+         */
+        uint64_t handover_deadline_ns_;
+
+        /**
+         * True once the TCPListener and its shards have handed over and stopped.
+         */
+        std::atomic<bool> handed_over_;
+
+        /**
+         * If a sleeping TCPServer is woken within this many nanoseconds, it would have found the work by spinning.
+         */
+        static constexpr uint64_t spin_window_ns = 50000;
 
         /**
          * Called by the TCPServer, enters wait state until woken up by either a timeout or a notify
@@ -360,6 +1087,18 @@ namespace dodo {
          */
         bool waitForActivity( TCPServer* server );
 
+        /**
+         * Wake up to n idle TCPServers, the most recently idle first so that their caches are still warm.
+         * @param n The number of TCPServers to wake, typically the number of work items just pushed.
+         */
+        void wakeServers( size_t n );
+
+        /**
+         * Wake a specific TCPServer, whether idle, parked or stopping.
+         * @param server The TCPServer to wake.
+         */
+        void wakeServer( TCPServer* server );
+
         /**
          * Common constructor code.
          * @param address The address to listen on.
@@ -368,32 +1107,34 @@ namespace dodo {
         void construct( const Address& address, const Params &params );
 
         /**
-         * Push work.
-         * @param work The SocketWork to handle.
-         * @see SocketWork.
-         */
-        //void pushWork( BaseSocket* socket, SockState state );
-        void pushWork( const SocketWork &work );
-
-        /**
-         * Push work.
-         * @param fd The BaseSocket fieldescriptor.
+         * Push work. Only called by the TCPListener thread. Event detection on the socket is suspended until the
+         * work is released.
+         * @param work The SocketWork (a slot in clients_) to handle.
          * @param state The state the BaseSocket is in.
          * @see SockState.
          */
-        void pushWork( int fd, SockState state );
+        void pushWork( SocketWork* work, SockState state );
 
         /**
-         * Pop work.
-         * @return A SocketWork* to handle, or NULL if there is no work to handle.
+         * Pop up to n SocketWork items, lock-free.
+         * @param work Array of at least n SocketWork* that receives the work.
+         * @param n The maximum number of items to pop.
+         * @return The number of SocketWork items popped, 0 if there is no work to handle.
          */
-        SocketWork* popWork();
+        size_t popWork( SocketWork** work, size_t n );
 
         /**
          * Called by a TCPServer to signal that the work has been handled and event detection on it can resume.
          * @param work The SocketWork.
+         * @param state The SockState bits that were handled.
          */
-        void releaseWork( const SocketWork &work );
+        void releaseWork( SocketWork* work, SockState state );
+
+        /**
+         * Give up a claim on waiting work (see expireTimeouts()), queueing any events that arrived meanwhile.
+         * @param work The SocketWork.
+         */
+        void releaseClaim( SocketWork* work );
 
         /**
          * Entrypoint, override of Thread::run()
@@ -406,9 +1147,9 @@ namespace dodo {
          * @param s The sent bytes to add
          */
         void addReceivedSentBytes( ssize_t r, ssize_t s ) {
-          threads::Mutexer lock( stats_mutex_ );
-          last_stats_.received += r;
-          last_stats_.sent += s;
+          Counters &c = counters();
+          count( c.received, r );
+          count( c.sent, s );
         }
 
         /**
@@ -444,53 +1185,231 @@ namespace dodo {
         bool stop_server_;
 
         /**
-         * Protects both client_ and workload_
+         * Protects idle_servers_.
          */
-        threads::Mutex clientmutex_;
+        threads::Mutex idle_mutex_;
 
         /**
-         * Mutex used to wakeup TCPServer threads with condition variable cv_signal_.
-         * @see cv_signal_.
+         * The TCPServers waiting for work on their Semaphore, the most recently idle last.
          */
-        std::mutex mt_signal_;
+        std::vector<TCPServer*> idle_servers_;
 
         /**
-         * Condition variable used to wakeup TCPServer threads with mutex mt_signal_.
-         * @see mt_signal_.
+         * Connection table, preallocated to maxconnections SocketWork slots. A slot in use has a non-null socket,
+         * its work is either in progress or last completed state. A SocketWork is either armed in epoll or
+         * queued / in progress by a TCPServer, never both, so its state is only modified by one thread at a time.
          */
-        std::condition_variable cv_signal_;
+        std::vector<SocketWork> clients_;
 
         /**
-         * Map of file descriptors to SocketWork for all connected clients. The work is either in progress or last
-         * completed state.
+         * Lock-free queue of free slot indexes in clients_.
          */
-        std::map<int,SocketWork> clients_;
+        threads::MPMCQueue<uint32_t>* free_slots_;
 
         /**
-         * List of TCPServers.
+         * The number of connected clients (slots in use).
+         */
+        std::atomic<size_t> num_clients_;
+
+        /**
+         * List of TCPServers, active and parked.
          */
         std::list<TCPServer*> servers_;
 
         /**
-         * Queue of sockets with work for TCPServer instances.
+         * Decides the number of active TCPServers, created by TCPServer::newScalingPolicy().
+         */
+        ScalingPolicy* scaling_policy_;
+
+        /**
+         * The last load sample passed to the ScalingPolicy.
+         */
+        ScalingPolicy::Sample scale_sample_;
+
+        /**
+         * Time of the last scaling decision.
+         */
+        uint64_t scale_time_ns_;
+
+        /**
+         * The sum of the queue wait times of the work taken from the queue since the last scaling decision.
+         */
+        std::atomic<uint64_t> queue_wait_ns_;
+
+        /**
+         * The number of work items taken from the queue since the last scaling decision.
          */
-        std::deque<SocketWork*> workload_;
+        std::atomic<uint64_t> queue_waits_;
+
+        /**
+         * Round-robin counter for worker-owned connection assignment.
+         */
+        size_t next_server_;
+
+        /**
+         * Lock-free queue of sockets with work for TCPServer instances. As a connection is not armed in epoll
+         * while its work is queued or in progress, the queue never holds more than maxconnections items.
+         */
+        threads::MPMCQueue<SocketWork*>* workload_;
 
         /**
          * The number of queued work items.
          */
         std::atomic<unsigned long long> work_q_sz_;
 
+        /**
+         * True whilst new connections are not admitted, see Params.admission_resume_ratio.
+         */
+        std::atomic<bool> admission_paused_;
+
+        /**
+         * The per host limits, shared by the shards and owned by the primary TCPListener, nullptr if no limit is
+         * enabled.
+         */
+        RateLimiter* limiter_;
+
+        /**
+         * Check a read event on a connection against the request rate of its host, and count the rejection.
+         * @param work The SocketWork.
+         * @return False if the connection must be shut down.
+         */
+        bool admitRequest( const SocketWork* work ) {
+          if ( !limiter_ || limiter_->admitRequest( work->limit_slot ) ) return true;
+          count( counters().limited_requests, 1 );
+          return false;
+        }
+
+        /**
+         * The work queue depth at which new connections are admitted again.
+         */
+        unsigned long long resume_qdepth_;
+
+        /**
+         * The steadyNanos() time new connections were no longer admitted.
+         */
+        uint64_t paused_ns_;
+
+        /**
+         * eventfd written by signalResume() to wake the TCPListener.
+         */
+        int resume_fd_;
+
+        /**
+         * True if resume_fd_ was written and not yet read by the TCPListener.
+         */
+        std::atomic<bool> resume_signalled_;
+
         /**
          * The epoll interface file descriptor.
          */
         int epoll_fd_;
 
         /**
-         * The event mask for read events. This is the one-shot event mask for incoming data.
+         * The event mask for read events. This is the one-shot event mask for incoming data, or the edge-triggered
+         * event mask if Params.edge_triggered is true.
          */
         uint32_t read_event_mask_;
 
+        /**
+         * Statistics counters written by a single thread, the TCPListener or a TCPServer, aligned to a cache line so
+         * that threads do not contend on counting. getStats() sums the Counters of all threads.
+         */
+        struct alignas(64) Counters {
+          Counters() : connections(0), requests(0), admission_pauses(0), paused_us(0), shed(0),
+                       limited_connections(0), limited_requests(0), received(0), sent(0),
+                       epoll_ctls(0), uring_enters(0), scale_ups(0), scale_downs(0), timeouts(0),
+                       handshake_failures(0) {};
+          /** @see Stats::connections */
+          std::atomic<ssize_t> connections;
+          /** @see Stats::requests */
+          std::atomic<ssize_t> requests;
+          /** @see Stats::admission_pauses */
+          std::atomic<ssize_t> admission_pauses;
+          /** @see Stats::paused_us */
+          std::atomic<ssize_t> paused_us;
+          /** @see Stats::shed */
+          std::atomic<ssize_t> shed;
+          /** @see Stats::limited_connections */
+          std::atomic<ssize_t> limited_connections;
+          /** @see Stats::limited_requests */
+          std::atomic<ssize_t> limited_requests;
+          /** @see Stats::received */
+          std::atomic<ssize_t> received;
+          /** @see Stats::sent */
+          std::atomic<ssize_t> sent;
+          /** @see Stats::epoll_ctls */
+          std::atomic<ssize_t> epoll_ctls;
+          /** @see Stats::uring_enters */
+          std::atomic<ssize_t> uring_enters;
+          /** @see Stats::scale_ups */
+          std::atomic<ssize_t> scale_ups;
+          /** @see Stats::scale_downs */
+          std::atomic<ssize_t> scale_downs;
+          /** @see Stats::timeouts */
+          std::atomic<ssize_t> timeouts;
+          /** @see Stats::handshake_failures */
+          std::atomic<ssize_t> handshake_failures;
+
+          /**
+           * Add the counters to the Stats.
+           * @param stats The Stats to add to.
+           */
+          void addTo( Stats &stats ) const;
+        };
+
+        /**
+         * Add to a counter of Counters.
+         * @param counter The counter.
+         * @param n The number to add.
+         */
+        static void count( std::atomic<ssize_t> &counter, ssize_t n ) {
+          counter.fetch_add( n, std::memory_order_relaxed );
+        }
+
+        /**
+         * Return the Counters of the calling thread. Threads that are not the TCPListener or one of its TCPServers
+         * share the last Counters.
+         * @return The Counters.
+         */
+        Counters& counters() {
+          if ( thread_counters_ >= counters_.data() && thread_counters_ < counters_.data() + counters_.size() )
+            return *thread_counters_;
+          return counters_.back();
+        }
+
+        /**
+         * Give the TCPServer its own Counters, before it is started.
+         * @param server The TCPServer.
+         */
+        void registerServer( TCPServer* server );
+
+        /**
+         * Release the Counters of a TCPServer that is about to be deleted. The counts remain, the Counters are reused
+         * by the next TCPServer.
+         * @param server The TCPServer.
+         */
+        void unregisterServer( TCPServer* server );
+
+        /**
+         * The Counters of the TCPListener thread (the first), its TCPServers and the shared Counters (the last).
+         */
+        std::vector<Counters> counters_;
+
+        /**
+         * Indexes of the unused TCPServer Counters in counters_.
+         */
+        std::vector<size_t> free_counters_;
+
+        /**
+         * The Counters of the calling thread, set when the TCPListener or TCPServer thread starts.
+         */
+        static thread_local Counters* thread_counters_;
+
+        /**
+         * The ring with the multishot accept on the listening socket (io_uring engine), polled by epoll_fd_.
+         */
+        URing* listen_ring_;
+
         /**
          * The event mask for hangup events. This is the event mask for all error and hangup events, an event mode
          * active whilst a read event for the socket is already queued for processing, so that errors may be caught
@@ -504,12 +1423,27 @@ namespace dodo {
         Stats prev_stats_;
 
         /**
-         * The last Stats.
+         * The Latencies of all TCPServers, merged at the last statistics interval, protected by stats_mutex_.
          */
-        Stats last_stats_;
+        Latencies latencies_;
 
         /**
-         * Protects prev_stats_, last_stats_.
+         * The Latencies of deleted TCPServers.
+         */
+        Latencies retired_latencies_;
+
+        /**
+         * The aggregated Latencies over all shards at the previous statistics interval (primary only).
+         */
+        Latencies prev_latencies_;
+
+        /**
+         * The TLSContext session statistics at the previous statistics interval (primary only, Params.tls).
+         */
+        TLSContext::SessionStats prev_tls_stats_;
+
+        /**
+         * Protects latencies_.
          */
         threads::Mutex stats_mutex_;
 
@@ -548,6 +1482,31 @@ namespace dodo {
          */
         size_t event_maxconnections_reached_;
 
+        /**
+         * The listener shards, owned by the primary TCPListener. Empty for shards and unsharded listeners.
+         */
+        std::vector<TCPListener*> shards_;
+
+        /**
+         * The primary TCPListener if this is a shard, nullptr if this is the primary.
+         */
+        TCPListener* primary_;
+
+        /**
+         * The shard index, 0 for the primary.
+         */
+        size_t shard_index_;
+
+        /**
+         * The number of active (not parked) TCPServers, readable from other (shard) threads.
+         */
+        std::atomic<size_t> num_servers_;
+
+        /**
+         * The number of parked TCPServers, readable from other (shard) threads.
+         */
+        std::atomic<size_t> num_parked_;
+
         /**
          * TCPListenerTimer needs access to now_ and now_mutex_
          */
@@ -608,6 +1567,7 @@ namespace dodo {
       if ( state & TCPListener::SockState::New ) os << "New|";
       if ( state & TCPListener::SockState::Read ) os << "Read|";
       if ( state & TCPListener::SockState::Shut ) os << "Shut|";
+      if ( state & TCPListener::SockState::Write ) os << "Write|";
       //switch ( state ) {
         //case TCPListener::SockState::None :
           //os << "none";
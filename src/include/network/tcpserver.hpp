@@ -24,6 +24,7 @@
 #define network_tcpserver_hpp
 
 #include "network/tcplistener.hpp"
+#include "network/uring.hpp"
 
 namespace dodo {
 
@@ -37,6 +38,7 @@ namespace dodo {
      *  - bool readSocket( TCPListener::SocketWork &work, ssize_t &sent )
      *  - void shutDown( BaseSocket* )
      *  - TCPServer* addServer()
+     *  - TCPServer* addShardServer( TCPListener& ) (only when listener shards are used)
      *
      * Each TCPServer is a thread that consumes work from the TCPListener. There
      * can be multiple TCPServer threads consuming work together, and the TCPListener auto-scales TCPServers
@@ -78,7 +80,7 @@ namespace dodo {
          * @param listener TCPListener.
          */
         TCPServer( TCPListener &listener );
-        virtual ~TCPServer() {};
+        virtual ~TCPServer();
 
         /**
          * Run the TCPServer thread.
@@ -86,8 +88,9 @@ namespace dodo {
         virtual void run();
 
         /**
-         * Override to perform a protocol handshake. Note that the TCP handshake has already taken place,
-         * and handShake() will only be called for new sockets.
+         * Override to perform a protocol handshake. Note that the TCP handshake, and the TLS handshake if
+         * TCPListener::Params.tls is set, have already taken place, and handShake() will only be called for new
+         * sockets.
          * @param socket A pointer to the socket to handshake. If this returns false,. the socket
          * will be closed.
          * @param received The number of bytes received by the call.
@@ -97,7 +100,8 @@ namespace dodo {
         virtual bool handShake( network::BaseSocket *socket, ssize_t &received, ssize_t &sent ) = 0;
 
         /**
-         * Override to perform a request-response cycle.
+         * Override to perform a request-response cycle. Send responses with work.data->send(), which queues what
+         * the socket cannot take without blocking (see TCPConnectionData::send), rather than with work.socket->send().
          * @param work The work to perform.
          * @param sent The number of bytes sent by the call.
          * @return
@@ -120,12 +124,28 @@ namespace dodo {
          */
         virtual TCPServer* addServer() = 0;
 
+        /**
+         * Spawn a new TCPServer for another TCPListener. Used to create the initial TCPServer of each
+         * listener shard if TCPListener::Params::listener_shards > 1, override to enable sharding.
+         * @param shard The TCPListener shard the new TCPServer will work for.
+         * @return a pointer to a new TCPServer
+         */
+        virtual TCPServer* addShardServer( TCPListener &shard );
+
         /**
          * Return a new TCPConnectionData pointer or override to return a descendant of TCPConnectionData.
          * @return the new TCPConnectionData*.
          */
         virtual TCPConnectionData* newConnectionData() const { return new TCPConnectionData(); }
 
+        /**
+         * Return a new ScalingPolicy for the TCPListener pool, or override to return a custom ScalingPolicy. Called
+         * once per TCPListener (shard) on the initial TCPServer. The default is a LatencyScalingPolicy configured
+         * from the TCPListener::Params.
+         * @return The new ScalingPolicy, owned by the TCPListener.
+         */
+        virtual ScalingPolicy* newScalingPolicy() const;
+
         /**
          * Return true if the TCPServer has stopped working.
          * @return True if the TCPServer has stopped on request.
@@ -138,6 +158,12 @@ namespace dodo {
          */
         bool isBusy() const { return busy_; };
 
+        /**
+         * Return true if the TCPServer is parked by the TCPListener's ScalingPolicy.
+         * @return True if parked.
+         */
+        bool isParked() const { return parked_; };
+
         /**
          * Get the number of secodns the TCPServer has been idle.
          * @return The idle seconds.
@@ -163,6 +189,66 @@ namespace dodo {
 
       protected:
 
+        /**
+         * Service a single SocketWork item by calling handShake, readSocket and/or shutDown.
+         * @param sockmap The SocketWork to service.
+         * @param buffered If true, the received data has already been appended to the TCPConnectionData
+         * (io_uring engine) and the socket is not read.
+         * @return The SockState bits that were handled.
+         */
+        TCPListener::SockState serviceWork( TCPListener::SocketWork* sockmap, bool buffered = false );
+
+        /**
+         * Run loop in worker-owned mode (TCPListener::Params::worker_owned), polls and services the connections
+         * owned by this TCPServer.
+         */
+        void runOwned();
+
+        /**
+         * Service a SocketWork owned by this TCPServer and (re-)register or close its socket.
+         * @param work The SocketWork.
+         */
+        void serviceOwned( TCPListener::SocketWork* work );
+
+        /**
+         * Close the owned connections whose deadline has passed (Params.worker_owned).
+         */
+        void expireOwned();
+
+        /**
+         * Run loop with the io_uring engine (TCPListener::Params::io_engine), services the completions of the
+         * connections owned by this TCPServer.
+         */
+        void runURing();
+
+        /**
+         * Handle an io_uring completion.
+         * @param cqe The completion.
+         * @param requests Incremented for each request (received data).
+         */
+        void uringComplete( const struct io_uring_cqe& cqe, ssize_t &requests );
+
+        /**
+         * Submit the pending output of the SocketWork, (re-)arm or cancel its receive depending on
+         * Params.output_high_water, and close it if it is closing and has no operations in flight.
+         * @param work The SocketWork.
+         */
+        void uringSettle( TCPListener::SocketWork* work );
+
+        /**
+         * Return the number of bytes of output queued for a connection, including the output of the URingSocket
+         * not yet sent (io_uring engine).
+         * @param work The SocketWork.
+         * @return The number of bytes queued.
+         */
+        size_t queuedOutput( const TCPListener::SocketWork* work ) const;
+
+        /**
+         * Called by the TCPListener to hand a new connection to this TCPServer (worker-owned mode).
+         * @param work The SocketWork of the new connection.
+         */
+        void assignWork( TCPListener::SocketWork* work );
+
         /**
          * The TCPListener the TCPServer is working for.
          */
@@ -188,10 +274,84 @@ namespace dodo {
          */
         struct timeval last_active_;
 
+        /**
+         * If true, the TCPServer is parked: it takes no work until the TCPListener resumes it.
+         */
+        std::atomic<bool> parked_;
+
+        /**
+         * Nanoseconds spent servicing work, collected and reset by the TCPListener each scaling interval.
+         */
+        std::atomic<uint64_t> busy_ns_;
+
+        /**
+         * Posted by the TCPListener to wake the TCPServer when work arrives, when it is parked or resumed and when
+         * it should stop.
+         */
+        threads::Semaphore wakeup_;
+
+        /**
+         * The latencies of the work serviced by this TCPServer.
+         */
+        TCPListener::Latencies latencies_;
+
+        /**
+         * The statistics Counters of this TCPServer, assigned by the TCPListener.
+         */
+        TCPListener::Counters* counters_;
+
+        /**
+         * The deadlines of the connections owned by this TCPServer (Params.worker_owned), if timeouts are enabled.
+         */
+        TimerWheel* wheel_;
+
+        /**
+         * The current number of spins on the work queue before the TCPServer waits on wakeup_, adapted to how often
+         * spinning finds work.
+         */
+        size_t spin_;
+
         /**
          * State of the TCPServer.
          */
         ServerState state_;
+
+        /**
+         * The epoll file descriptor of the owned connections (worker-owned mode).
+         */
+        int epoll_fd_;
+
+        /**
+         * The eventfd signaling new connections in inbox_ (worker-owned mode).
+         */
+        int event_fd_;
+
+        /**
+         * New connections assigned by the TCPListener (worker-owned mode).
+         */
+        threads::MPMCQueue<TCPListener::SocketWork*>* inbox_;
+
+        /**
+         * The number of connections owned by this TCPServer (worker-owned mode).
+         */
+        std::atomic<size_t> num_connections_;
+
+        /**
+         * The ring of this TCPServer (io_uring engine), created by and used in the TCPServer thread only.
+         */
+        URing* ring_;
+
+        /**
+         * The number of provided receive buffers per ring (io_uring engine).
+         */
+        static const uint16_t uring_buffer_count = 512;
+
+        /**
+         * The size of a provided receive buffer (io_uring engine).
+         */
+        static const uint32_t uring_buffer_size = 4096;
+
+        friend class TCPListener;
     };
 
   }
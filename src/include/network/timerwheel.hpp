@@ -0,0 +1,144 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file timerwheel.hpp
+ * Defines the dodo::network::TimerWheel class.
+ */
+
+#ifndef network_timerwheel_hpp
+#define network_timerwheel_hpp
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dodo::network {
+
+  /**
+   * A hierarchical timing wheel of (token, deadline) entries with tick resolution. The first level has a bucket
+   * per tick for the next wheel_size ticks, the second level a bucket per wheel_size ticks for the next
+   * wheel_size * wheel_size ticks, cascaded into the first level as time passes. Deadlines beyond are parked in the
+   * farthest bucket and rescheduled when it is reached.
+   *
+   * schedule() is O(1). There is no cancel, the owner of the tokens cancels lazily by ignoring (or rescheduling)
+   * a token that is no longer due when expire() hands it back, so a deadline can be moved by any thread by merely
+   * updating it where the owner looks it up.
+   *
+   * A TimerWheel is not thread-safe, it is used by a single thread.
+   */
+  class TimerWheel {
+    public:
+
+      /**
+       * The number of buckets per level.
+       */
+      static constexpr size_t wheel_size = 256;
+
+      /**
+       * Construct a TimerWheel.
+       * @param tick_ns The resolution in nanoseconds.
+       * @param now_ns The current time in nanoseconds.
+       */
+      TimerWheel( uint64_t tick_ns, uint64_t now_ns );
+
+      /**
+       * Schedule a token.
+       * @param token The token, handed back by expire() at or after the deadline.
+       * @param deadline_ns The deadline in nanoseconds.
+       */
+      void schedule( uint64_t token, uint64_t deadline_ns );
+
+      /**
+       * Advance the TimerWheel to now and hand the tokens whose deadline has passed to f. f may schedule tokens.
+       * @param now_ns The current time in nanoseconds.
+       * @param f Called as f( token ) for each expired token.
+       */
+      template <typename F> void expire( uint64_t now_ns, F f ) {
+        uint64_t target = now_ns / tick_ns_;
+        while ( current_tick_ < target ) {
+          current_tick_++;
+          if ( ( current_tick_ % wheel_size ) == 0 ) {
+            // cascade the second level bucket of the wheel_size ticks that start now, those due on this tick go to
+            // the bucket expired next, place() would defer them to the next tick
+            scratch_.swap( level1_[ ( current_tick_ / wheel_size ) % wheel_size ] );
+            for ( const auto &entry : scratch_ ) {
+              if ( entry.tick == current_tick_ ) level0_[ current_tick_ % wheel_size ].push_back( entry );
+              else place( entry );
+            }
+            scratch_.clear();
+          }
+          scratch_.swap( level0_[ current_tick_ % wheel_size ] );
+          for ( const auto &entry : scratch_ ) {
+            if ( entry.tick <= current_tick_ ) {
+              size_--;
+              f( entry.token );
+            } else {
+              place( entry );
+            }
+          }
+          scratch_.clear();
+        }
+      }
+
+      /**
+       * Return the number of scheduled tokens.
+       * @return The number of scheduled tokens.
+       */
+      size_t size() const { return size_; }
+
+    private:
+
+      /**
+       * A scheduled token.
+       */
+      struct Entry {
+        /** The token. */
+        uint64_t token;
+        /** The deadline in ticks, rounded up. */
+        uint64_t tick;
+      };
+
+      /**
+       * Put an Entry in its bucket.
+       * @param entry The Entry.
+       */
+      void place( const Entry &entry );
+
+      /** The resolution in nanoseconds. */
+      uint64_t tick_ns_;
+
+      /** The last tick expired. */
+      uint64_t current_tick_;
+
+      /** The number of scheduled tokens. */
+      size_t size_;
+
+      /** Buckets per tick. */
+      std::array<std::vector<Entry>,wheel_size> level0_;
+
+      /** Buckets per wheel_size ticks. */
+      std::array<std::vector<Entry>,wheel_size> level1_;
+
+      /** Bucket being expired or cascaded, swapped with the bucket to keep its capacity. */
+      std::vector<Entry> scratch_;
+  };
+
+}
+
+#endif
@@ -23,7 +23,10 @@
 #ifndef network_tlscontext_hpp
 #define network_tlscontext_hpp
 
+#include <atomic>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <openssl/bio.h>
 #include <openssl/err.h>
 #include <openssl/ossl_typ.h>
@@ -32,6 +35,8 @@
 
 #include "common/exception.hpp"
 #include "common/systemerror.hpp"
+#include "network/tlssessioncache.hpp"
+#include "threads/mutex.hpp"
 
 
 
@@ -124,6 +129,13 @@ namespace dodo::network {
        *   ciphers:                                           # mandatory
        *     - TLS_AES_256_GCM_SHA384                         # at least one entry
        *     - TLS_AES_128_GCM_SHA256
+       *   session-cache:                                     # optional, see setSessionCache()
+       *     size: 20480                                      # 0 disables the session cache
+       *     ttl-s: 300
+       *     shards: 16
+       *   session-tickets:                                   # optional, see setSessionTickets()
+       *     enabled: true
+       *     key-rotation-s: 3600
        * ```
        * If the PEM format is used to provide keys and passphrase:
        * ```YAML
@@ -147,6 +159,19 @@ namespace dodo::network {
 
       virtual ~TLSContext();
 
+      /**
+       * Session resumption statistics.
+       * @see getSessionStats()
+       */
+      struct SessionStats {
+        /** The number of handshakes that resumed a session. */
+        size_t resumed = 0;
+        /** The number of full handshakes. */
+        size_t full = 0;
+        /** The number of sessions in the session caches. */
+        size_t cached = 0;
+      };
+
       /**
        * Load a certificate and the corresponding private key for an identity.
        * @param certfile The certificate PEM file.
@@ -208,6 +233,62 @@ namespace dodo::network {
       void setTrustPaths(  const std::string& cafile,
                            const std::string& capath );
 
+      /**
+       * Enable the session cache, so that a reconnecting peer resumes its session with an abbreviated handshake
+       * instead of a full handshake. Server side, sessions are cached by session id, including TLS 1.3 sessions
+       * for which stateful tickets are issued if session tickets are disabled. Client side, TLSSocket::connect()
+       * offers the session of the previous connection to the same address and peer name. A TLS 1.3 client session
+       * is used once, as the server issues a new ticket on each connection.
+       *
+       * The cache is a TLSSessionCache, so that concurrent handshakes rarely contend on it. Call before the
+       * TLSContext is used by TLSSockets.
+       * @param size The maximum number of sessions in the server and in the client cache, 0 disables session
+       * caching entirely.
+       * @param ttl_s The number of seconds a session can be resumed.
+       * @param shards The number of shards of the caches.
+       */
+      void setSessionCache( size_t size, time_t ttl_s, size_t shards = 16 );
+
+      /**
+       * Enable or disable stateless session tickets. If enabled, the server encrypts the session into the ticket it
+       * sends to the client, so that it can resume sessions without a session cache. The ticket keys are generated
+       * randomly and rotated every key_rotation_s seconds. Tickets encrypted with the previous key are still
+       * accepted, and renewed with the current key, so that a ticket can be resumed for key_rotation_s to twice
+       * key_rotation_s seconds. If disabled, sessions can only be resumed from the session cache.
+       *
+       * Call before the TLSContext is used by TLSSockets.
+       * @param enabled If false, no tickets are issued.
+       * @param key_rotation_s The number of seconds a ticket key is used to encrypt tickets.
+       */
+      void setSessionTickets( bool enabled, time_t key_rotation_s = 3600 );
+
+      /**
+       * Count a completed handshake, called by the TLSSocket.
+       * @param resumed True if the handshake resumed a session.
+       */
+      void countHandshake( bool resumed ) {
+        ( resumed ? resumed_ : full_ ).fetch_add( 1, std::memory_order_relaxed );
+      }
+
+      /**
+       * Return the session resumption statistics.
+       * @return The SessionStats.
+       */
+      SessionStats getSessionStats() const;
+
+      /**
+       * Return the session to offer when connecting to a peer, if the session cache is enabled.
+       * @param peer The peer, as the address and peer name.
+       * @return The session with a reference for the caller, or nullptr if there is none.
+       */
+      SSL_SESSION* getClientSession( const std::string &peer );
+
+      /**
+       * Return true if the session cache is enabled.
+       * @return True if enabled.
+       */
+      bool hasSessionCache() const { return client_sessions_ != nullptr; }
+
       /**
        * Return a pointer to the SSL_CTX
        * @return a pointer to the SSL_CTX
@@ -284,6 +365,82 @@ namespace dodo::network {
        */
       static int pem_passwd_cb( char *buf, int size, int rwflag, void *userdata );
 
+      /**
+       * Return the TLSContext of an SSL connection.
+       * @param ssl The SSL connection.
+       * @return The TLSContext.
+       */
+      static TLSContext* fromSSL( SSL* ssl ) {
+        return static_cast<TLSContext*>( SSL_CTX_get_app_data( SSL_get_SSL_CTX( ssl ) ) );
+      }
+
+      /**
+       * New session callback, adds the session to the server or client session cache.
+       * @param ssl The SSL connection.
+       * @param session The new session.
+       * @return 1 if the session was cached, so that the reference is kept.
+       */
+      static int new_session_cb( SSL* ssl, SSL_SESSION* session );
+
+      /**
+       * Get session callback, looks up a session in the server session cache.
+       * @param ssl The SSL connection.
+       * @param id The session id.
+       * @param length The length of the session id.
+       * @param copy Set to 0 as the returned session has a reference for the caller.
+       * @return The session or nullptr.
+       */
+      static SSL_SESSION* get_session_cb( SSL* ssl, const unsigned char* id, int length, int* copy );
+
+      /**
+       * Remove session callback, removes a session from the server session cache.
+       * @param ctx The SSL_CTX.
+       * @param session The session.
+       */
+      static void remove_session_cb( SSL_CTX* ctx, SSL_SESSION* session );
+
+      /**
+       * A session ticket key.
+       */
+      struct TicketKey {
+        /** The key name, sent in the clear in the ticket. */
+        unsigned char name[16];
+        /** The AES-256 encryption key. */
+        unsigned char aes[32];
+        /** The HMAC-SHA256 key. */
+        unsigned char hmac[32];
+        /** The steady time in nanoseconds the key was created. */
+        uint64_t created_ns;
+      };
+
+      /**
+       * Find the ticket key to encrypt (enc != 0) or decrypt a ticket with, rotating the keys when due.
+       * @param name The key name, set if encrypting.
+       * @param enc Non-zero if encrypting.
+       * @param key Set to the key.
+       * @return 1 if the key is current, 2 if the ticket should be renewed with the current key, 0 if there is no
+       * key with the name.
+       */
+      int ticketKey( unsigned char* name, int enc, TicketKey &key );
+
+      /**
+       * Session ticket key callback, initializes the cipher and HMAC contexts for a ticket.
+       * @param ssl The SSL connection.
+       * @param name The key name.
+       * @param iv The initialization vector, generated if encrypting.
+       * @param ctx The cipher context.
+       * @param hctx The HMAC context.
+       * @param enc Non-zero if encrypting.
+       * @return As ticketKey(), -1 on error.
+       */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+      static int ticket_key_cb( SSL* ssl, unsigned char* name, unsigned char* iv,
+                                EVP_CIPHER_CTX* ctx, EVP_MAC_CTX* hctx, int enc );
+#else
+      static int ticket_key_cb( SSL* ssl, unsigned char* name, unsigned char* iv,
+                                EVP_CIPHER_CTX* ctx, HMAC_CTX* hctx, int enc );
+#endif
+
       /**
        * The openssl SSL_CTX
        */
@@ -319,6 +476,41 @@ namespace dodo::network {
        */
       bool enable_clr_;
 
+      /**
+       * The server session cache by session id, nullptr if disabled.
+       */
+      std::unique_ptr<TLSSessionCache> server_sessions_;
+
+      /**
+       * The client session cache by peer, nullptr if disabled.
+       */
+      std::unique_ptr<TLSSessionCache> client_sessions_;
+
+      /**
+       * The number of resumed handshakes.
+       */
+      std::atomic<size_t> resumed_;
+
+      /**
+       * The number of full handshakes.
+       */
+      std::atomic<size_t> full_;
+
+      /**
+       * The session ticket keys, the current key first.
+       */
+      std::deque<TicketKey> ticket_keys_;
+
+      /**
+       * Guards ticket_keys_.
+       */
+      threads::Mutex ticket_mutex_;
+
+      /**
+       * The ticket key rotation interval in nanoseconds.
+       */
+      uint64_t ticket_rotation_ns_;
+
 
   };
 
@@ -0,0 +1,145 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file tlssessioncache.hpp
+ * Defines the dodo::network::TLSSessionCache class.
+ */
+
+#ifndef network_tlssessioncache_hpp
+#define network_tlssessioncache_hpp
+
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <openssl/ssl.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "threads/mutex.hpp"
+
+namespace dodo::network {
+
+  /**
+   * An in-process cache of TLS sessions, used by the TLSContext to resume sessions on the server side (by session
+   * id) and on the client side (by peer). The cache is divided in shards by the hash of the key, each with its own
+   * Mutex, so that concurrent handshakes rarely contend.
+   *
+   * Each shard holds at most size / shards sessions, and evicts them in the order they were added, which is also the
+   * order in which they expire as all sessions have the same time to live.
+   */
+  class TLSSessionCache {
+    public:
+
+      /**
+       * Construct a TLSSessionCache.
+       * @param size The maximum number of sessions.
+       * @param ttl_s The number of seconds a session is kept.
+       * @param shards The number of shards.
+       */
+      TLSSessionCache( size_t size, time_t ttl_s, size_t shards );
+
+      /**
+       * Destruct, frees the cached sessions.
+       */
+      ~TLSSessionCache();
+
+      /**
+       * Add a session, replacing a session with the same key. The TLSSessionCache takes over the reference of the
+       * caller.
+       * @param key The key.
+       * @param session The session.
+       */
+      void add( const std::string &key, SSL_SESSION* session );
+
+      /**
+       * Get a session.
+       * @param key The key.
+       * @return The session with an additional reference for the caller, or nullptr if there is none or it has
+       * expired.
+       */
+      SSL_SESSION* get( const std::string &key );
+
+      /**
+       * Remove a session.
+       * @param key The key.
+       */
+      void remove( const std::string &key );
+
+      /**
+       * Return the number of cached sessions.
+       * @return The number of sessions.
+       */
+      size_t size();
+
+    private:
+
+      /**
+       * A cached session.
+       */
+      struct Entry {
+        /** The session. */
+        SSL_SESSION* session;
+        /** The steady time in nanoseconds at which the session expires. */
+        uint64_t expires_ns;
+        /** The sequence number of the add, to recognize stale keys in the order. */
+        uint64_t sequence;
+      };
+
+      /**
+       * A shard, aligned to a cache line.
+       */
+      struct alignas(64) Shard {
+        /** Guards the shard. */
+        threads::Mutex mutex;
+        /** The sessions by key. */
+        std::unordered_map<std::string,Entry> sessions;
+        /** The keys and sequence numbers in the order they were added. */
+        std::deque<std::pair<std::string,uint64_t>> order;
+        /** The sequence number of the next add. */
+        uint64_t sequence = 0;
+      };
+
+      /**
+       * Return the shard of a key.
+       * @param key The key.
+       * @return The Shard.
+       */
+      Shard& shard( const std::string &key ) { return shards_[ std::hash<std::string>()( key ) % shards_.size() ]; }
+
+      /**
+       * Evict expired sessions and sessions over the capacity of the shard, from the front of the order. The
+       * Shard must be locked.
+       * @param shard The Shard.
+       * @param now_ns The steady time in nanoseconds.
+       */
+      void evict( Shard &shard, uint64_t now_ns );
+
+      /** The shards. */
+      std::vector<Shard> shards_;
+
+      /** The maximum number of sessions per shard. */
+      size_t shard_capacity_;
+
+      /** The time to live in nanoseconds. */
+      uint64_t ttl_ns_;
+  };
+
+}
+
+#endif
@@ -67,6 +67,12 @@ namespace dodo::network {
        */
       virtual ~TLSSocket();
 
+      /**
+       * Send the TLS close_notify if the handshake completed, and close the socket. Does not wait for the close_notify
+       * of the peer.
+       */
+      virtual void close();
+
       /**
        * Send data
        * @param buf Data to send
@@ -76,6 +82,29 @@ namespace dodo::network {
        */
       virtual common::SystemError send( const void* buf, ssize_t len, bool more = false );
 
+      /**
+       * Send as much data as the socket accepts without blocking. Partial writes are enabled on the SSL object, so
+       * SSL_write returns after each record written. A retry after ecSSL_ERROR_WANT_WRITE must pass the same data,
+       * but it may be at a different address.
+       * @param buf Data to send
+       * @param len Size of data in buf
+       * @param sent The number of bytes sent.
+       * @param more Ignored.
+       * @return SystemError::ecOK if all bytes were sent, SystemError::ecEAGAIN if not all bytes could be sent or
+       * the SystemError code.
+       */
+      virtual common::SystemError sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more = false );
+
+      /**
+       * Send the concatenation of count buffers. The buffers are coalesced into a single SSL_write so that they
+       * are encrypted into as few TLS records as possible. A single buffer is written without copying.
+       * @param buffers The buffers to send.
+       * @param count The number of buffers.
+       * @param more If true, do not force a send buffer flush, more data will follow
+       * @return The SystemError code, as send().
+       */
+      virtual common::SystemError sendv( const ConstBuffer* buffers, size_t count, bool more = false );
+
       /**
        * Receive data
        * @param buf Buffer to receive in
@@ -85,15 +114,36 @@ namespace dodo::network {
        */
       virtual common::SystemError receive( void* buf, ssize_t request, ssize_t &received );
 
+      /**
+       * Receive data into multiple buffers, filling each buffer before the next. Reads until the buffers are full
+       * or the data decrypted so far has been returned, so a blocking socket waits for at most one TLS record, like
+       * readv. A non-blocking socket without data returns SystemError::ecEAGAIN.
+       * @param buffers The buffers to receive into.
+       * @param count The number of buffers.
+       * @param received The number of bytes received.
+       * @return The SystemError code.
+       */
+      virtual common::SystemError receivev( const MutableBuffer* buffers, size_t count, ssize_t &received );
+
       /**
        * Accept a connection.
        * @return The SystemError.
        */
       virtual TLSSocket* accept();
 
+      /**
+       * Perform the server side of the TLS handshake on an accepted socket. On a non-blocking socket, the handshake
+       * is resumable: call acceptTLS() again once the socket is readable after SystemError::ecSSL_ERROR_WANT_READ or
+       * writable after SystemError::ecSSL_ERROR_WANT_WRITE, until it returns SystemError::ecOK.
+       * @return SystemError::ecOK if the handshake completed, SystemError::ecSSL_ERROR_WANT_READ,
+       * SystemError::ecSSL_ERROR_WANT_WRITE or SystemError::ecECONNABORTED if the handshake failed.
+       */
+      common::SystemError acceptTLS();
+
 
       /**
-       * Connect to the Address.
+       * Connect to the Address. If the TLSContext has a session cache, the session of the previous connection to the
+       * same address and peer name is resumed.
        * @param address The address to connect to.
        * @return The SystemError code.
        */
@@ -163,6 +213,11 @@ namespace dodo::network {
        */
       X509Common::SAN peer_name_;
 
+      /**
+       * The address and peer name a client connects to, the key of the session in the TLSContext session cache.
+       */
+      std::string session_key_;
+
   };
 
 };
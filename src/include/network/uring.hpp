@@ -0,0 +1,353 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file uring.hpp
+ * Defines the dodo::network::URing and dodo::network::URingSocket classes.
+ */
+
+#ifndef network_uring_hpp
+#define network_uring_hpp
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <vector>
+
+#include "common/bytes.hpp"
+#include "network/socket.hpp"
+
+namespace dodo::network {
+
+  class TCPServer;
+
+  /**
+   * A minimal io_uring submission/completion ring, using the raw io_uring_setup, io_uring_enter and
+   * io_uring_register system calls (no liburing dependency).
+   *
+   * SQEs obtained with the prep* methods are queued in the submission ring and submitted in one go by the next
+   * enter() call, which also waits for completions. Completions are consumed with forEachCQE().
+   *
+   * Optionally, a provided buffer ring is registered with setupBufferRing(), so that (multishot) receive operations
+   * pick a buffer from the ring at completion time rather than reserving one per pending receive.
+   *
+   * A URing is not thread-safe, it is used by a single thread.
+   */
+  class URing {
+    public:
+
+      /**
+       * Construct a URing.
+       * @param entries The number of submission queue entries, the completion queue is 4 times as large.
+       * @param flags IORING_SETUP_* flags. If io_uring_setup rejects the flags, the ring is set up without them.
+       * @throw common::Exception when io_uring_setup or mmap fail.
+       */
+      URing( unsigned entries, unsigned flags = 0 );
+
+      /**
+       * Destruct the URing, closes the ring and unmaps its memory.
+       */
+      ~URing();
+
+      URing( const URing& ) = delete;
+      URing& operator=( const URing& ) = delete;
+
+      /**
+       * Return true if io_uring with multishot operations and provided buffer rings is available, which can
+       * be disabled by kernel configuration (kernel.io_uring_disabled), seccomp policy or kernel version.
+       * @return True if io_uring can be used.
+       */
+      static bool isSupported();
+
+      /**
+       * Return the ring file descriptor.
+       * @return The ring file descriptor.
+       */
+      int getFD() const { return fd_; }
+
+      /**
+       * Register a provided buffer ring of count buffers of size bytes each.
+       * @param group The buffer group id, passed to prepRecv().
+       * @param count The number of buffers, a power of 2.
+       * @param size The size of each buffer.
+       * @throw common::Exception when the registration fails.
+       */
+      void setupBufferRing( uint16_t group, uint16_t count, uint32_t size );
+
+      /**
+       * Return a pointer to a provided buffer.
+       * @param bid The buffer id, as passed in the completion flags.
+       * @return A pointer to the buffer.
+       */
+      const common::Octet* getBuffer( uint16_t bid ) const { return buffers_ + (size_t)bid * buf_size_; }
+
+      /**
+       * Return a buffer to the provided buffer ring after its data has been consumed.
+       * @param bid The buffer id.
+       */
+      void recycleBuffer( uint16_t bid );
+
+      /**
+       * Queue a multishot accept.
+       * @param fd The listening socket.
+       * @param user_data The user_data of the completions.
+       */
+      void prepAccept( int fd, uint64_t user_data );
+
+      /**
+       * Queue a multishot receive selecting buffers from a provided buffer ring.
+       * @param fd The socket to receive from.
+       * @param group The buffer group id.
+       * @param user_data The user_data of the completions.
+       */
+      void prepRecv( int fd, uint16_t group, uint64_t user_data );
+
+      /**
+       * Queue a send. The data must remain valid until the completion.
+       * @param fd The socket to send on.
+       * @param buf The data to send.
+       * @param len The number of bytes to send.
+       * @param user_data The user_data of the completion.
+       */
+      void prepSend( int fd, const void* buf, size_t len, uint64_t user_data );
+
+      /**
+       * Queue a multishot poll.
+       * @param fd The file descriptor to poll.
+       * @param events The poll events.
+       * @param user_data The user_data of the completions.
+       */
+      void prepPoll( int fd, uint32_t events, uint64_t user_data );
+
+      /**
+       * Queue the cancellation of a pending operation.
+       * @param target The user_data of the operation to cancel.
+       * @param user_data The user_data of the cancel completion.
+       */
+      void prepCancel( uint64_t target, uint64_t user_data );
+
+      /**
+       * Submit all queued SQEs and wait for completions, in a single io_uring_enter call. Does not enter the kernel
+       * if there is nothing to submit and there are completions pending or wait_nr is 0.
+       * @param wait_nr The number of completions to wait for.
+       * @param timeout_ms The maximum time to wait.
+       */
+      void enter( unsigned wait_nr, int timeout_ms );
+
+      /**
+       * Call f( const io_uring_cqe& ) for each available completion and consume them.
+       * @param f The function to call.
+       * @return The number of completions consumed.
+       */
+      template <typename F> unsigned forEachCQE( F f ) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n( cq_tail_, __ATOMIC_ACQUIRE );
+        unsigned count = 0;
+        while ( head != tail ) {
+          f( cqes_[ head & cq_mask_ ] );
+          head++;
+          count++;
+        }
+        __atomic_store_n( cq_head_, head, __ATOMIC_RELEASE );
+        return count;
+      }
+
+      /**
+       * Return the number of io_uring_enter calls made.
+       * @return The number of io_uring_enter calls.
+       */
+      size_t getEnters() const { return enters_; }
+
+    private:
+
+      /**
+       * Return a zeroed SQE, submitting the queued SQEs first if the submission ring is full.
+       * @return The SQE.
+       */
+      struct io_uring_sqe* getSQE();
+
+      /**
+       * Unmap the ring memory and close the ring.
+       */
+      void release();
+
+      /** The ring file descriptor. */
+      int fd_;
+
+      /** The setup flags in effect. */
+      unsigned flags_;
+
+      /** The SQ ring mapping. */
+      void* sq_ring_;
+
+      /** The SQ ring mapping size. */
+      size_t sq_ring_sz_;
+
+      /** The CQ ring mapping, equals sq_ring_ with IORING_FEAT_SINGLE_MMAP. */
+      void* cq_ring_;
+
+      /** The CQ ring mapping size. */
+      size_t cq_ring_sz_;
+
+      /** The SQE array. */
+      struct io_uring_sqe* sqes_;
+
+      /** The number of SQ entries. */
+      unsigned sq_entries_;
+
+      /** The kernel SQ head. */
+      unsigned* sq_head_;
+
+      /** The SQ tail as seen by the kernel. */
+      unsigned* sq_tail_;
+
+      /** The SQ index mask. */
+      unsigned sq_mask_;
+
+      /** The local SQ tail, published to sq_tail_ by enter(). */
+      unsigned sqe_tail_;
+
+      /** The CQ head. */
+      unsigned* cq_head_;
+
+      /** The kernel CQ tail. */
+      unsigned* cq_tail_;
+
+      /** The CQ index mask. */
+      unsigned cq_mask_;
+
+      /** The CQE array. */
+      struct io_uring_cqe* cqes_;
+
+      /** The provided buffer ring, nullptr if none was set up. */
+      struct io_uring_buf_ring* buf_ring_;
+
+      /** The provided buffer ring mapping size. */
+      size_t buf_ring_sz_;
+
+      /** The local provided buffer ring tail. */
+      uint16_t buf_tail_;
+
+      /** The number of provided buffers. */
+      uint16_t buf_count_;
+
+      /** The size of each provided buffer. */
+      uint32_t buf_size_;
+
+      /** The provided buffer memory. */
+      common::Octet* buffers_;
+
+      /** The number of io_uring_enter calls made. */
+      size_t enters_;
+  };
+
+  /**
+   * A connection Socket serviced by a TCPServer running the io_uring engine. send() does not send but appends
+   * to an output buffer, which the TCPServer submits as a single send operation, batched with the submissions
+   * of the other connections, once the request has been handled. send() hence returns ecOK immediately, send
+   * errors are seen as a shutdown of the connection.
+   */
+  class URingSocket : public Socket {
+    public:
+
+      /**
+       * Construct from a socket descriptor.
+       * @param socket The socket file descriptor.
+       */
+      URingSocket( int socket ) : Socket( socket ), send_offset_(0), sending_(false), receiving_(false),
+                                  closing_(false), cancelled_(false) {};
+
+      /**
+       * Destructs this URingSocket, but does not call close().
+       */
+      virtual ~URingSocket() {};
+
+      /**
+       * Append len bytes to the output buffer.
+       * @param buf The bytes to send.
+       * @param len The number of bytes to send from buf.
+       * @param more Ignored, output is always sent once the request has been handled.
+       * @return SystemError::ecOK
+       */
+      virtual common::SystemError send( const void* buf, ssize_t len, bool more = false );
+
+      /**
+       * Append len bytes to the output buffer.
+       * @param buf The bytes to send.
+       * @param len The number of bytes to send from buf.
+       * @param sent Set to len.
+       * @param more Ignored.
+       * @return SystemError::ecOK
+       */
+      virtual common::SystemError sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more = false );
+
+      /**
+       * Append count buffers to the output buffer.
+       * @param buffers The buffers to send.
+       * @param count The number of buffers.
+       * @param more Ignored.
+       * @return SystemError::ecOK
+       */
+      virtual common::SystemError sendv( const ConstBuffer* buffers, size_t count, bool more = false );
+
+      /**
+       * Read length bytes from fd and append them to the output buffer (BaseSocket::sendFile()), so that the
+       * file is sent in order with the other output.
+       * @param fd The file descriptor to send from.
+       * @param offset The offset in fd to start at.
+       * @param length The number of bytes to send.
+       * @param sent The number of bytes appended.
+       * @return The SystemError, as BaseSocket::sendFile().
+       */
+      virtual common::SystemError sendFile( int fd, off_t offset, size_t length, size_t &sent ) {
+        return BaseSocket::sendFile( fd, offset, length, sent );
+      }
+
+      /**
+       * Return the number of bytes appended and not yet sent.
+       * @return The number of bytes.
+       */
+      size_t getQueuedSize() const { return output_.size() + inflight_.size() - send_offset_; }
+
+    private:
+
+      /** Output appended by send(), not yet submitted. */
+      std::vector<common::Octet> output_;
+
+      /** Output submitted, in flight. */
+      std::vector<common::Octet> inflight_;
+
+      /** The number of inflight_ bytes sent. */
+      size_t send_offset_;
+
+      /** True if a send is in flight. */
+      bool sending_;
+
+      /** True if a multishot receive is armed. */
+      bool receiving_;
+
+      /** True if the connection is to be closed once the in flight operations complete. */
+      bool closing_;
+
+      /** True if the armed receive has been cancelled. */
+      bool cancelled_;
+
+      friend class TCPServer;
+  };
+
+}
+
+#endif
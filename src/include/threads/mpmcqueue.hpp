@@ -0,0 +1,195 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file mpmcqueue.hpp
+ * Defines the dodo::threads::MPMCQueue class.
+ */
+
+#ifndef threads_mpmcqueue_hpp
+#define threads_mpmcqueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dodo::threads {
+
+  /**
+   * A bounded, lock-free multi-producer multi-consumer queue (D. Vyukov's ring design). Each cell carries a
+   * sequence number that tells producers and consumers whether the cell is free or holds data for the current
+   * lap, so that push and pop only need a single CAS on the shared enqueue or dequeue position.
+   *
+   * The capacity is rounded up to a power of 2. push() fails (returns false) when the queue is full, pop()
+   * fails when the queue is empty, neither blocks.
+   *
+   * pop( T*, size_t ) claims up to n consecutive ready cells with a single CAS, so a consumer can drain a batch
+   * of items in one go.
+   *
+   * @code
+   * threads::MPMCQueue<int> queue( 1024 );
+   * queue.push( 42 );
+   * int items[8];
+   * size_t n = queue.pop( items, 8 );
+   * @endcode
+   * @tparam T The (trivially copyable) item type.
+   */
+  template <typename T> class MPMCQueue {
+    public:
+
+      /**
+       * Construct an MPMCQueue.
+       * @param capacity The minimum capacity, rounded up to a power of 2.
+       */
+      explicit MPMCQueue( size_t capacity ) {
+        size_t sz = 2;
+        while ( sz < capacity ) sz <<= 1;
+        mask_ = sz - 1;
+        cells_ = new Cell[sz];
+        for ( size_t i = 0; i < sz; i++ ) cells_[i].sequence.store( i, std::memory_order_relaxed );
+        enqueue_pos_.store( 0, std::memory_order_relaxed );
+        dequeue_pos_.store( 0, std::memory_order_relaxed );
+      }
+
+      /**
+       * Destruct the MPMCQueue.
+       */
+      ~MPMCQueue() { delete[] cells_; }
+
+      MPMCQueue( const MPMCQueue& ) = delete;
+      MPMCQueue& operator=( const MPMCQueue& ) = delete;
+
+      /**
+       * Return the capacity of the queue.
+       * @return The capacity.
+       */
+      size_t capacity() const { return mask_ + 1; }
+
+      /**
+       * Push an item.
+       * @param item The item to push.
+       * @return False if the queue is full.
+       */
+      bool push( const T& item ) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load( std::memory_order_relaxed );
+        for (;;) {
+          cell = &cells_[pos & mask_];
+          size_t seq = cell->sequence.load( std::memory_order_acquire );
+          intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+          if ( dif == 0 ) {
+            if ( enqueue_pos_.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+          } else if ( dif < 0 ) {
+            return false;
+          } else {
+            pos = enqueue_pos_.load( std::memory_order_relaxed );
+          }
+        }
+        cell->data = item;
+        cell->sequence.store( pos + 1, std::memory_order_release );
+        return true;
+      }
+
+      /**
+       * Pop a single item.
+       * @param item Receives the item.
+       * @return False if the queue is empty.
+       */
+      bool pop( T& item ) {
+        return pop( &item, 1 ) == 1;
+      }
+
+      /**
+       * Pop up to n items, claiming all of them with a single CAS.
+       * @param items Array of at least n items that receives the popped items.
+       * @param n The maximum number of items to pop.
+       * @return The number of items popped, 0 if the queue is empty.
+       */
+      size_t pop( T* items, size_t n ) {
+        if ( n == 0 ) return 0;
+        size_t pos = dequeue_pos_.load( std::memory_order_relaxed );
+        size_t count = 0;
+        for (;;) {
+          count = 0;
+          while ( count < n ) {
+            size_t seq = cells_[(pos + count) & mask_].sequence.load( std::memory_order_acquire );
+            if ( (intptr_t)seq - (intptr_t)(pos + count + 1) != 0 ) break;
+            count++;
+          }
+          if ( count == 0 ) {
+            size_t seq = cells_[pos & mask_].sequence.load( std::memory_order_acquire );
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if ( dif < 0 ) return 0;
+            pos = dequeue_pos_.load( std::memory_order_relaxed );
+          } else if ( dequeue_pos_.compare_exchange_weak( pos, pos + count, std::memory_order_relaxed ) ) {
+            break;
+          }
+        }
+        for ( size_t i = 0; i < count; i++ ) {
+          Cell& cell = cells_[(pos + i) & mask_];
+          items[i] = cell.data;
+          cell.sequence.store( pos + i + mask_ + 1, std::memory_order_release );
+        }
+        return count;
+      }
+
+      /**
+       * Return an approximation of the number of queued items.
+       * @return The approximate size.
+       */
+      size_t size() const {
+        size_t e = enqueue_pos_.load( std::memory_order_relaxed );
+        size_t d = dequeue_pos_.load( std::memory_order_relaxed );
+        return e > d ? e - d : 0;
+      }
+
+    private:
+
+      /**
+       * Cache line size, used to keep the producer and consumer positions apart.
+       */
+      static const size_t cacheline_size = 64;
+
+      /**
+       * A queue cell.
+       */
+      struct Cell {
+        /** The sequence number of the cell. */
+        std::atomic<size_t> sequence;
+        /** The item. */
+        T data;
+      };
+
+      /** The cell array. */
+      Cell* cells_;
+
+      /** capacity - 1. */
+      size_t mask_;
+
+      /** The enqueue position. */
+      alignas(cacheline_size) std::atomic<size_t> enqueue_pos_;
+
+      /** The dequeue position. */
+      alignas(cacheline_size) std::atomic<size_t> dequeue_pos_;
+
+      /** Padding to avoid false sharing with adjacent objects. */
+      char pad_[cacheline_size - sizeof(std::atomic<size_t>)];
+  };
+
+}
+
+#endif
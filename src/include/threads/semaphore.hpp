@@ -0,0 +1,85 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file semaphore.hpp
+ * Defines the dodo::threads::Semaphore class.
+ */
+
+#ifndef threads_semaphore_hpp
+#define threads_semaphore_hpp
+
+#include <atomic>
+#include <cstdint>
+
+namespace dodo::threads {
+
+  /**
+   * A counting Semaphore on a Linux futex. post() and a wait() that finds the count positive do not enter the
+   * kernel, post() only issues a wake system call if a thread is actually waiting.
+   *
+   * @code
+   * threads::Semaphore sem;
+   * // thread A
+   * if ( sem.wait( 1000 ) ) { // posted } else { // timeout }
+   * // thread B
+   * sem.post();
+   * @endcode
+   */
+  class Semaphore {
+    public:
+
+      /**
+       * Construct a Semaphore.
+       * @param count The initial count.
+       */
+      explicit Semaphore( int32_t count = 0 ) : count_(count), waiters_(0) {};
+
+      /**
+       * Increment the count, waking a waiting thread.
+       */
+      void post();
+
+      /**
+       * Wait for the count to become positive and decrement it.
+       * @param timeout_ms The maximum time to wait in milliseconds, -1 waits indefinitely.
+       * @return True if the count was decremented, false on timeout.
+       */
+      bool wait( int timeout_ms = -1 );
+
+      /**
+       * Decrement the count if it is positive, without waiting.
+       * @return True if the count was decremented.
+       */
+      bool tryWait();
+
+    private:
+
+      /**
+       * The count, the futex word.
+       */
+      std::atomic<int32_t> count_;
+
+      /**
+       * The number of threads waiting in the kernel.
+       */
+      std::atomic<int32_t> waiters_;
+  };
+
+}
+
+#endif
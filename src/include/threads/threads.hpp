@@ -23,7 +23,9 @@
 #ifndef threads_threads_hpp
 #define threads_threads_hpp
 
+#include <threads/mpmcqueue.hpp>
 #include <threads/mutex.hpp>
+#include <threads/semaphore.hpp>
 #include <threads/thread.hpp>
 
 namespace dodo {
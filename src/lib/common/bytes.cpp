@@ -35,6 +35,8 @@ namespace dodo::common {
     if ( sz == size_ ) return;
     if ( array_ ) {
       if ( sz > allocated_size ) {
+        // grow geometrically, so that appending in small steps does not realloc at every step
+        if ( chunkedsz < allocated_size * 2 ) chunkedsz = allocated_size * 2;
         array_ = static_cast< Octet*>( std::realloc( array_, chunkedsz ) );
         if ( array_ || sz == 0 ) {
           size_ = sz;
@@ -53,6 +55,16 @@ namespace dodo::common {
     }
   }
 
+  void Bytes::ensureCapacity( size_t capacity ) {
+    if ( capacity <= allocated_size ) return;
+    size_t chunkedsz = ( capacity / alloc_block + 1 ) * alloc_block;
+    if ( chunkedsz < allocated_size * 2 ) chunkedsz = allocated_size * 2;
+    Octet* array = static_cast< Octet*>( std::realloc( array_, chunkedsz ) );
+    if ( !array ) throw_SystemException( "realloc of " << chunkedsz << " bytes failed", errno );
+    array_ = array;
+    allocated_size = chunkedsz;
+  }
+
   void Bytes::free() {
     if ( array_ != nullptr ) {
       std::free( array_ );
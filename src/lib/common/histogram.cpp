@@ -0,0 +1,83 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file histogram.cpp
+ * Implements the dodo::common::Histogram class.
+ */
+
+#include <common/histogram.hpp>
+
+#include <cmath>
+
+namespace dodo::common {
+
+  Histogram& Histogram::operator=( const Histogram &other ) {
+    for ( size_t i = 0; i < num_buckets; i++ ) {
+      counts_[i].store( other.counts_[i].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    }
+    return *this;
+  }
+
+  Histogram& Histogram::operator+=( const Histogram &other ) {
+    for ( size_t i = 0; i < num_buckets; i++ ) {
+      counts_[i].store( counts_[i].load( std::memory_order_relaxed ) +
+                        other.counts_[i].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    }
+    return *this;
+  }
+
+  Histogram& Histogram::operator-=( const Histogram &other ) {
+    for ( size_t i = 0; i < num_buckets; i++ ) {
+      uint64_t count = counts_[i].load( std::memory_order_relaxed );
+      uint64_t sub = other.counts_[i].load( std::memory_order_relaxed );
+      counts_[i].store( count > sub ? count - sub : 0, std::memory_order_relaxed );
+    }
+    return *this;
+  }
+
+  void Histogram::clear() {
+    for ( auto &count : counts_ ) count.store( 0, std::memory_order_relaxed );
+  }
+
+  uint64_t Histogram::getCount() const {
+    uint64_t total = 0;
+    for ( const auto &count : counts_ ) total += count.load( std::memory_order_relaxed );
+    return total;
+  }
+
+  uint64_t Histogram::getPercentile( double percentile ) const {
+    uint64_t total = getCount();
+    if ( total == 0 ) return 0;
+    uint64_t rank = (uint64_t)std::ceil( percentile / 100.0 * (double)total );
+    if ( rank < 1 ) rank = 1;
+    uint64_t seen = 0;
+    for ( size_t i = 0; i < num_buckets; i++ ) {
+      seen += counts_[i].load( std::memory_order_relaxed );
+      if ( seen >= rank ) return bucketHigh( i );
+    }
+    return getMax();
+  }
+
+  uint64_t Histogram::getMax() const {
+    for ( size_t i = num_buckets; i > 0; i-- ) {
+      if ( counts_[i-1].load( std::memory_order_relaxed ) ) return bucketHigh( i - 1 );
+    }
+    return 0;
+  }
+
+}
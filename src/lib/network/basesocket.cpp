@@ -23,7 +23,9 @@
 #include <common/logger.hpp>
 #include "network/basesocket.hpp"
 #include <netinet/tcp.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cmath>
 
 namespace dodo::network {
@@ -68,6 +70,43 @@ namespace dodo::network {
     } else return common::SystemError::ecOK;
   }
 
+  common::SystemError BaseSocket::receivev( const MutableBuffer* buffers, size_t count, ssize_t &received ) {
+    received = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+      ssize_t got = 0;
+      common::SystemError error = receive( buffers[i].data, buffers[i].size, got );
+      if ( error != common::SystemError::ecOK ) return received > 0 ? common::SystemError::ecOK : error;
+      received += got;
+      if ( got < (ssize_t)buffers[i].size ) break;
+    }
+    return common::SystemError::ecOK;
+  }
+
+  size_t BaseSocket::getReadable() const {
+    int readable = 0;
+    if ( ioctl( socket_, FIONREAD, &readable ) != 0 )
+      throw_SystemExceptionObject( "BaseSocket::getReadable ioctl failed", errno, this );
+    return readable;
+  }
+
+  common::SystemError BaseSocket::sendFile( int fd, off_t offset, size_t length, size_t &sent ) {
+    char buf[sendfile_buffer_size];
+    sent = 0;
+    while ( sent < length ) {
+      ssize_t rc = ::pread( fd, buf, std::min( length - sent, sizeof(buf) ), offset + sent );
+      if ( rc < 0 ) {
+        if ( errno == common::SystemError::ecEINTR ) continue;
+        return errno;
+      }
+      if ( rc == 0 ) return common::SystemError::ecENODATA;
+      ssize_t written = 0;
+      common::SystemError error = sendPartial( buf, rc, written );
+      sent += written;
+      if ( error != common::SystemError::ecOK ) return error;
+    }
+    return common::SystemError::ecOK;
+  }
+
   void BaseSocket::close() {
     if ( socket_ != -1 ) {
       auto rc = ::close( socket_ );
@@ -166,6 +205,15 @@ namespace dodo::network {
     if ( rc < 0 ) throw_SystemExceptionObject( "setsockopt SO_REUSEPORT failed", rc, this );
   }
 
+  void BaseSocket::setIncomingCPU( int cpu ) {
+    auto rc = setsockopt( socket_,
+                          SOL_SOCKET,
+                          SO_INCOMING_CPU,
+                          (char *)&cpu,
+                          sizeof(cpu) );
+    if ( rc < 0 ) throw_SystemExceptionObject( "setsockopt SO_INCOMING_CPU failed", errno, this );
+  }
+
   socklen_t BaseSocket::getSendBufSize() const {
     socklen_t optvar  = 0;
     socklen_t optlen = sizeof(optvar);
@@ -0,0 +1,143 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file handover.cpp
+ * Implements the dodo::network::Handover class.
+ */
+
+#include <network/handover.hpp>
+
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dodo::network {
+
+  /**
+   * Fill a sockaddr_un.
+   * @param path The file system path.
+   * @param addr The sockaddr_un to fill.
+   */
+  static void unixAddress( const std::string &path, sockaddr_un &addr ) {
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    if ( path.size() >= sizeof(addr.sun_path) ) throw_Exception( "Handover path too long : " << path );
+    memcpy( addr.sun_path, path.c_str(), path.size() );
+  }
+
+  int Handover::listen( const std::string &path ) {
+    sockaddr_un addr;
+    unixAddress( path, addr );
+    int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+    if ( fd < 0 ) throw_SystemException( "Handover::listen socket failed", errno );
+    // a previous instance may still listen on the old file, it is only reached through its own path
+    ::unlink( path.c_str() );
+    if ( ::bind( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 || ::listen( fd, 4 ) < 0 ) {
+      int error = errno;
+      ::close( fd );
+      throw_SystemException( "Handover::listen failed on " << path, error );
+    }
+    return fd;
+  }
+
+  int Handover::connect( const std::string &path, int timeout_ms ) {
+    sockaddr_un addr;
+    unixAddress( path, addr );
+    int fd = ::socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+    if ( fd < 0 ) throw_SystemException( "Handover::connect socket failed", errno );
+    if ( ::connect( fd, (sockaddr*)&addr, sizeof(addr) ) < 0 ) {
+      ::close( fd );
+      return -1;
+    }
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = ( timeout_ms % 1000 ) * 1000;
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv) );
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv) );
+    return fd;
+  }
+
+  common::SystemError Handover::send( int channel, Tag tag, int fd ) {
+    char data = static_cast<char>( tag );
+    struct iovec iov = { &data, sizeof(data) };
+    union {
+      char buf[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset( &msg, 0, sizeof(msg) );
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if ( fd >= 0 ) {
+      memset( &control, 0, sizeof(control) );
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof(control.buf);
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+      memcpy( CMSG_DATA(cmsg), &fd, sizeof(int) );
+    }
+    while ( ::sendmsg( channel, &msg, MSG_NOSIGNAL ) < 0 ) {
+      if ( errno != EINTR ) return errno;
+    }
+    return common::SystemError::ecOK;
+  }
+
+  common::SystemError Handover::receive( int channel, Tag &tag, int &fd ) {
+    char data = 0;
+    struct iovec iov = { &data, sizeof(data) };
+    union {
+      char buf[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset( &msg, 0, sizeof(msg) );
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    fd = -1;
+    ssize_t rc = 0;
+    while ( ( rc = ::recvmsg( channel, &msg, MSG_CMSG_CLOEXEC ) ) < 0 ) {
+      if ( errno != EINTR ) return errno;
+    }
+    if ( rc == 0 ) return common::SystemError::ecECONNABORTED;
+    // a message carries at most one descriptor, any others that arrived are closed rather than leaked
+    size_t received = 0;
+    for ( struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg ); cmsg; cmsg = CMSG_NXTHDR( &msg, cmsg ) ) {
+      if ( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ) continue;
+      size_t count = ( cmsg->cmsg_len - CMSG_LEN(0) ) / sizeof(int);
+      for ( size_t i = 0; i < count; i++ ) {
+        int received_fd = -1;
+        memcpy( &received_fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int) );
+        if ( received++ == 0 ) fd = received_fd; else ::close( received_fd );
+      }
+    }
+    // the kernel closes the descriptors that did not fit the control buffer, the message is rejected
+    if ( ( msg.msg_flags & MSG_CTRUNC ) || received > 1 ) {
+      if ( fd >= 0 ) ::close( fd );
+      fd = -1;
+      return common::SystemError::ecEMSGSIZE;
+    }
+    tag = static_cast<Tag>( data );
+    return common::SystemError::ecOK;
+  }
+
+}
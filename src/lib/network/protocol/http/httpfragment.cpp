@@ -53,6 +53,8 @@ namespace dodo {
         case peInvalidChunkHex : return "invalid hex chunk length";
         case peInvalidLastChunk : return "last chunk must have size 0";
         case peExpectingUnsignedInt : return "expecting an unsigned int";
+        case peHeaderTooLarge : return "header section too large";
+        case peBodyTooLarge : return "message body too large";
         default : return common::Puts() << "unhandled error " << error;
       }
     }
@@ -0,0 +1,143 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpheader.cpp
+ * Implements the dodo::network::protocol::http::HTTPHeader class.
+ */
+
+#include <network/protocol/http/httpheader.hpp>
+
+#include <array>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /** The names of the HTTPHeader::Id, in lowercase. */
+    static constexpr std::array<std::string_view,HTTPHeader::hiCount> names = {
+      "", "accept", "accept-charset", "accept-encoding", "accept-language", "accept-ranges", "age", "allow",
+      "authorization", "cache-control", "connection", "content-disposition", "content-encoding", "content-language",
+      "content-length", "content-location", "content-range", "content-type", "cookie", "date", "etag", "expect",
+      "expires", "forwarded", "from", "host", "if-match", "if-modified-since", "if-none-match", "if-range",
+      "if-unmodified-since", "keep-alive", "last-modified", "location", "origin", "pragma", "proxy-authenticate",
+      "proxy-authorization", "range", "referer", "retry-after", "server", "set-cookie", "te", "trailer",
+      "transfer-encoding", "upgrade", "user-agent", "vary", "via", "www-authenticate", "x-forwarded-for",
+      "x-forwarded-host", "x-forwarded-proto", "x-request-id",
+    };
+
+    static_assert( !names.back().empty(), "a HTTPHeader::Id has no name" );
+
+    /** The number of slots in the hash table. */
+    static constexpr size_t slot_count = 512;
+
+    /**
+     * Return the ASCII lowercase of c.
+     * @param c The char.
+     * @return The lowercase char.
+     */
+    static constexpr char lower( char c ) {
+      return c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+    }
+
+    /**
+     * Case-insensitive hash of the length and the first, middle and last char of a name, so the hash does not depend
+     * on the length of the name. Setting bit 5 lowercases letters, other chars that collide with it are told apart
+     * by the name compare after the lookup.
+     * @param name The name to hash.
+     * @param seed The seed, an odd multiplier.
+     * @return The hash.
+     */
+    static constexpr uint32_t seededHash( std::string_view name, uint32_t seed ) {
+      size_t size = name.size();
+      if ( size == 0 ) return 0;
+      uint32_t h = static_cast<uint32_t>( size );
+      h = h * 31 + ( static_cast<unsigned char>( name[0] ) | 0x20u );
+      h = h * 31 + ( static_cast<unsigned char>( name[size / 2] ) | 0x20u );
+      h = h * 31 + ( static_cast<unsigned char>( name[size - 1] ) | 0x20u );
+      return h * seed;
+    }
+
+    /**
+     * Return the slot of a hash, from its best mixed (high) bits.
+     * @param hash The hash.
+     * @return The slot.
+     */
+    static constexpr size_t slot( uint32_t hash ) {
+      return hash >> 23;
+    }
+
+    /**
+     * Find the first seed for which the names hash to distinct slots.
+     * @return The seed, 0 if none was found.
+     */
+    static constexpr uint32_t findSeed() {
+      for ( uint32_t seed = 2654435761u; seed < 2654435761u + 20000; seed += 2 ) {
+        std::array<bool,slot_count> used = {};
+        bool perfect = true;
+        for ( size_t id = 1; id < names.size() && perfect; id++ ) {
+          size_t s = slot( seededHash( names[id], seed ) );
+          perfect = !used[s];
+          used[s] = true;
+        }
+        if ( perfect ) return seed;
+      }
+      return 0;
+    }
+
+    /** The seed of the perfect hash. */
+    static constexpr uint32_t seed = findSeed();
+
+    static_assert( seed != 0, "no perfect hash seed for the HTTPHeader names" );
+
+    /**
+     * Build the table from slot to HTTPHeader::Id.
+     * @return The table.
+     */
+    static constexpr std::array<uint8_t,slot_count> buildSlots() {
+      std::array<uint8_t,slot_count> slots = {};
+      for ( size_t id = 1; id < names.size(); id++ ) {
+        slots[slot( seededHash( names[id], seed ) )] = static_cast<uint8_t>( id );
+      }
+      return slots;
+    }
+
+    /** The Id of each slot, hiUnknown for empty slots. */
+    static constexpr std::array<uint8_t,slot_count> slots = buildSlots();
+
+    uint32_t HTTPHeader::hash( std::string_view name ) {
+      return seededHash( name, seed );
+    }
+
+    HTTPHeader::Id HTTPHeader::lookup( std::string_view name, uint32_t hash ) {
+      Id id = static_cast<Id>( slots[slot( hash )] );
+      std::string_view known = names[id];
+      if ( known.size() != name.size() ) return hiUnknown;
+      for ( size_t i = 0; i < name.size(); i++ ) {
+        if ( lower( name[i] ) != known[i] ) return hiUnknown;
+      }
+      return id;
+    }
+
+    std::string_view HTTPHeader::getName( Id id ) {
+      return id < hiCount ? names[id] : names[hiUnknown];
+    }
+
+  }
+
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpheaderview.cpp
+ * Implements the dodo::network::protocol::http::HTTPHeaderView class.
+ */
+
+#include <network/protocol/http/httpheaderview.hpp>
+#include <network/protocol/http/httpmessage.hpp>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Return the ASCII lowercase of c.
+     * @param c The char.
+     * @return The lowercase char.
+     */
+    static inline char lower( char c ) {
+      return c >= 'A' && c <= 'Z' ? static_cast<char>( c + ( 'a' - 'A' ) ) : c;
+    }
+
+    void HTTPHeaderView::clear() {
+      size_ = 0;
+      overflow_.clear();
+      first_.fill( 0 );
+    }
+
+    void HTTPHeaderView::add( uint32_t name_offset, uint32_t name_size, uint32_t value_offset, uint32_t value_size,
+                              bool folded ) {
+      std::string_view name( buffer_ + name_offset, name_size );
+      uint32_t hash = HTTPHeader::hash( name );
+      Field field = { name_offset, name_size, value_offset, value_size, hash, HTTPHeader::lookup( name, hash ),
+                      folded };
+      if ( size_ < inlineFields ) inline_[size_] = field; else overflow_.push_back( field );
+      size_++;
+      if ( field.id != HTTPHeader::hiUnknown && first_[field.id] == 0 && size_ <= UINT16_MAX ) {
+        first_[field.id] = static_cast<uint16_t>( size_ );
+      }
+    }
+
+    size_t HTTPHeaderView::find( HTTPHeader::Id id, size_t from ) const {
+      if ( from == 0 && size_ <= UINT16_MAX ) return first_[id] ? first_[id] - 1u : npos;
+      for ( size_t i = from; i < size_; i++ ) {
+        if ( getField( i ).id == id ) return i;
+      }
+      return npos;
+    }
+
+    size_t HTTPHeaderView::find( std::string_view name, size_t from ) const {
+      uint32_t h = HTTPHeader::hash( name );
+      HTTPHeader::Id id = HTTPHeader::lookup( name, h );
+      if ( id != HTTPHeader::hiUnknown ) return find( id, from );
+      for ( size_t i = from; i < size_; i++ ) {
+        const Field& field = getField( i );
+        if ( field.hash != h || field.name_size != name.size() ) continue;
+        const char* p = buffer_ + field.name_offset;
+        size_t c = 0;
+        while ( c < name.size() && lower( p[c] ) == lower( name[c] ) ) c++;
+        if ( c == name.size() ) return i;
+      }
+      return npos;
+    }
+
+    bool HTTPHeaderView::getValue( std::string_view name, std::string_view &value ) const {
+      size_t index = find( name );
+      if ( index == npos ) return false;
+      value = getValue( index );
+      return true;
+    }
+
+    bool HTTPHeaderView::getValue( HTTPHeader::Id id, std::string_view &value ) const {
+      size_t index = find( id );
+      if ( index == npos ) return false;
+      value = getValue( index );
+      return true;
+    }
+
+    std::string HTTPHeaderView::materialize( size_t index ) const {
+      std::string_view value = getValue( index );
+      if ( !getField( index ).folded && value.find( '\t' ) == std::string_view::npos &&
+           value.find( "  " ) == std::string_view::npos ) {
+        return std::string( value );
+      }
+      std::string result;
+      result.reserve( value.size() );
+      bool space = false;
+      for ( char c : value ) {
+        if ( c == ' ' || c == '\t' || c == '\r' || c == '\n' ) space = true;
+        else {
+          if ( space ) result += ' ';
+          space = false;
+          result += c;
+        }
+      }
+      return result;
+    }
+
+    void HTTPHeaderView::materialize( HTTPMessage &message ) const {
+      for ( size_t i = 0; i < size_; i++ ) {
+        HTTPHeader::Id id = getField( i ).id;
+        if ( id != HTTPHeader::hiUnknown ) {
+          message.addHeader( id, std::string( HTTPHeader::getName( id ) ), materialize( i ) );
+        } else {
+          std::string name( getName( i ) );
+          for ( auto &c : name ) c = lower( c );
+          message.addHeader( name, materialize( i ) );
+        }
+      }
+    }
+
+  }
+
+}
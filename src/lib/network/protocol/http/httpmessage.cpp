@@ -22,9 +22,12 @@
  */
 
 #include <network/protocol/http/httpmessage.hpp>
+#include <network/protocol/http/httpscan.hpp>
 
 #include <common/util.hpp>
 
+#include <sstream>
+
 namespace dodo {
 
   namespace network::protocol::http {
@@ -34,13 +37,52 @@ namespace dodo {
     const char HTTPMessage::charSP = char(32);
     const char HTTPMessage::charHT = char(9);
 
+    /**
+     * Return the HTTPHeader::Id of a header key, keys are case-sensitive in headers_ so only a lowercase key matches.
+     * @param key The header key.
+     * @return The HTTPHeader::Id or HTTPHeader::hiUnknown.
+     */
+    static HTTPHeader::Id keyId( const std::string &key ) {
+      HTTPHeader::Id id = HTTPHeader::lookup( key );
+      return HTTPHeader::getName( id ) == key ? id : HTTPHeader::hiUnknown;
+    }
+
+    HTTPMessage::HTTPMessage( const HTTPMessage &other ) : HTTPFragment( other ), headers_( other.headers_ ),
+                                                           body_() {
+      // common::Bytes does not copy its array, so the body is appended
+      body_.append( other.body_ );
+      indexHeaders();
+    }
+
+    void HTTPMessage::indexHeaders() {
+      known_.fill( nullptr );
+      for ( const auto &header : headers_ ) {
+        HTTPHeader::Id id = keyId( header.first );
+        if ( id != HTTPHeader::hiUnknown ) known_[id] = &header.second;
+      }
+    }
+
     void HTTPMessage::addHeader( const std::string &key, const std::string &value ) {
-      std::map<std::string,std::string>::const_iterator i = headers_.find( key );
+      addHeader( keyId( key ), key, value );
+    }
+
+    void HTTPMessage::addHeader( HTTPHeader::Id id, const std::string &key, const std::string &value ) {
+      std::map<std::string,std::string>::iterator i = headers_.find( key );
       if ( i == headers_.end() ) {
-        headers_[key] = value;
+        i = headers_.insert( { key, value } ).first;
+        if ( id != HTTPHeader::hiUnknown ) known_[id] = &i->second;
       } else {
-        headers_[key] += "," + value;
+        i->second += "," + value;
+      }
+    }
+
+    std::string HTTPMessage::headersAsString() const {
+      std::stringstream ss;
+      for ( auto header : headers_ ) {
+        ss << header.first << ": " << header.second << charCR << charLF;
       }
+      ss << charCR << charLF;
+      return ss.str();
     }
 
     HTTPMessage::ParseResult HTTPMessage::eatCRLF( VirtualReadBuffer& buffer ) {
@@ -71,6 +113,21 @@ namespace dodo {
       } else return false;
     }
 
+    bool HTTPMessage::getHeaderValue( HTTPHeader::Id id, unsigned long &value ) const {
+      value = 0;
+      if ( !known_[id] ) return false;
+      size_t pos = 0;
+      value = stoul( *known_[id], &pos );
+      return pos == known_[id]->size();
+    }
+
+    bool HTTPMessage::getHeaderValue( HTTPHeader::Id id, std::string &value ) const {
+      value = "";
+      if ( !known_[id] ) return false;
+      value = *known_[id];
+      return true;
+    }
+
     bool HTTPMessage::getHeaderValue( const std::string &key, std::string &value ) const {
       std::map<std::string,std::string>::const_iterator i = headers_.find( key );
       value = "";
@@ -88,7 +145,10 @@ namespace dodo {
       do {
         parseResult = parseToken( data, header_key );
         if ( parseResult.ok() ) {
-          std::for_each( header_key.begin(), header_key.end(), [](char & c) {
+          // well-known keys are replaced by their lowercase name, only other keys are lowercased char by char
+          HTTPHeader::Id header_id = HTTPHeader::lookup( header_key );
+          if ( header_id != HTTPHeader::hiUnknown ) header_key = HTTPHeader::getName( header_id );
+          else std::for_each( header_key.begin(), header_key.end(), [](char & c) {
             c = (char)std::tolower(c);
           });
           parseResult.setSystemError( eatSpace( data ) );
@@ -100,7 +160,7 @@ namespace dodo {
           if ( ! parseResult.ok() ) return parseResult;
           parseResult = parseFieldValue( data, header_value );
           if ( parseResult.ok() || parseResult.eof() ) {
-            addHeader( header_key, header_value );
+            addHeader( header_id, header_key, header_value );
             parseResult.setSystemError( eatSpace( data ) );
             if ( ! parseResult.ok() ) return parseResult;
           } else return parseResult;
@@ -162,8 +222,12 @@ namespace dodo {
               state = psSP;
               parseResult.setSystemError( data.next() );
             } else {
-              value += data.get();
-              parseResult.setSystemError( data.next() );
+              // append the run of value chars in the buffered window at once
+              const char* window = nullptr;
+              size_t size = data.peek( window );
+              size_t run = 1 + HTTPScan::fieldValueSpan( window + 1, size - 1 );
+              value.append( window, run );
+              parseResult.setSystemError( data.consume( run ) );
             }
             break;
           case psCR:
@@ -196,14 +260,16 @@ namespace dodo {
     HTTPMessage::ParseResult HTTPMessage::parseToken( VirtualReadBuffer& buffer, std::string &token ) {
       ParseResult parseResult;
       token = "";
-      std::stringstream stoken;
       while ( !isSeparator( buffer.get() ) && !isCTL( buffer.get() ) ) {
-        stoken << buffer.get();
-        parseResult.setSystemError( buffer.next() );
-        if ( ! parseResult.ok() ) return parseResult;
+        // append the run of token chars in the buffered window at once
+        const char* window = nullptr;
+        size_t size = buffer.peek( window );
+        size_t run = 1 + HTTPScan::tokenSpan( window + 1, size - 1 );
+        token.append( window, run );
+        parseResult.setSystemError( buffer.consume( run ) );
+        if ( ! parseResult.ok() ) { token = ""; return parseResult; }
       }
       if ( isSeparator( buffer.get() ) || isCTL( buffer.get() ) ) {
-        token = stoken.str();
         return { peOk, common::SystemError::ecOK };
       } else return { peUnFinishedToken, common::SystemError::ecOK };
     }
@@ -228,11 +294,10 @@ namespace dodo {
         parseResult = parseChunkHex( data, chunk_size );
         if ( parseResult.ok() ) {
           if ( chunk_size == 0 ) break;
-          for ( size_t i = 0; i < chunk_size; i++ ) {
-            body_.append( data.get() );
-            parseResult.setSystemError( data.next() );
-            if ( ! parseResult.ok() ) return parseResult;
-          }
+          body_.ensureCapacity( body_.getSize() + chunk_size );
+          parseResult.setSystemError( data.read( body_.getTail(), chunk_size ) );
+          if ( ! parseResult.ok() ) return parseResult;
+          body_.extend( chunk_size );
           parseResult = parseCRLF( data );
           if ( ! parseResult.ok() ) return parseResult;
         } else return parseResult;
@@ -241,8 +306,22 @@ namespace dodo {
       if ( parseResult.eof() ) return { peOk, common::SystemError::ecOK }; else return parseResult;
     }
 
+    HTTPMessage::ParseResult HTTPMessage::parseContentBody( VirtualReadBuffer &data, size_t length ) {
+      ParseResult parseResult;
+      if ( length == 0 ) return parseResult;
+      body_.ensureCapacity( body_.getSize() + length );
+      parseResult.setSystemError( data.read( body_.getTail(), length - 1 ) );
+      if ( ! parseResult.ok() ) return parseResult;
+      body_.extend( length - 1 );
+      body_.append( static_cast<common::Octet>( data.get() ) );
+      return parseResult;
+    }
+
     void HTTPMessage::replaceHeader( const std::string &key, const std::string &value ) {
-        headers_[key] = value;
+        std::string &stored = headers_[key];
+        stored = value;
+        HTTPHeader::Id id = keyId( key );
+        if ( id != HTTPHeader::hiUnknown ) known_[id] = &stored;
     }
 
     void HTTPMessage::setBody( const std::string& body ) {
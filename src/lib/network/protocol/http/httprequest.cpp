@@ -86,10 +86,7 @@ namespace dodo {
     std::string HTTPRequest::asString() const {
       std::stringstream ss;
       ss << request_line_.asString();
-      for ( auto header : headers_ ) {
-        ss << header.first << ": " << header.second << HTTPMessage::charCR << HTTPMessage::charLF;
-      }
-      ss << HTTPMessage::charCR << HTTPMessage::charLF;
+      ss << headersAsString();
       if ( methodAllowsBody(request_line_.getMethod()) && body_.getSize() > 0 ) {
         ss << body_.asString();
       }
@@ -97,18 +94,7 @@ namespace dodo {
     }
 
     common::SystemError HTTPRequest::send( BaseSocket* socket ) {
-      std::stringstream ss;
-      ss << request_line_.asString();
-      for ( auto header : headers_ ) {
-        ss << header.first << ": " << header.second << HTTPMessage::charCR << HTTPMessage::charLF;
-      }
-      ss << HTTPMessage::charCR << HTTPMessage::charLF;
-      common::SystemError rc = socket->send( ss.str().c_str(), ss.str().length() );
-      if ( !rc.ok() ) return rc;
-      if ( methodAllowsBody(request_line_.getMethod()) && body_.getSize() > 0 ) {
-        rc = socket->send( body_.getArray(), body_.getSize(), false );
-      }
-      return rc;
+      return write( socket );
     }
 
     HTTPMessage::ParseResult HTTPRequest::parse( VirtualReadBuffer &data ) {
@@ -139,17 +125,12 @@ namespace dodo {
     HTTPMessage::ParseResult HTTPRequest::parseBody( VirtualReadBuffer &data ) {
       ParseResult parseResult;
       size_t content_length;
-      if ( getHeaderValue( "content-length", content_length ) ) {
-        for ( size_t i = 0; i < content_length; i++ ) {
-          body_.append( data.get() );
-          if ( i < content_length -1 ) {
-            parseResult.setSystemError( data.next() );
-            if ( ! parseResult.ok() ) return parseResult;
-          }
-        }
+      if ( getContentLength( content_length ) ) {
+        parseResult = parseContentBody( data, content_length );
+        if ( ! parseResult.ok() ) return parseResult;
       } else {
         std::string transfer_encoding;
-        if ( getHeaderValue( "transfer-encoding", transfer_encoding ) ) {
+        if ( getTransferEncoding( transfer_encoding ) ) {
           if ( transfer_encoding == "chunked" ) {
             parseResult = parseChunkedBody( data );
             if ( ! parseResult.ok() ) return parseResult;
@@ -247,7 +228,10 @@ namespace dodo {
     }
 
     common::SystemError HTTPRequest::write( BaseSocket* socket ) const {
-      return socket->send( this->asString().c_str(), this->asString().length(), false );
+      std::string head = request_line_.asString() + headersAsString();
+      ConstBuffer buffers[] = { head, body_ };
+      size_t count = methodAllowsBody(request_line_.getMethod()) && body_.getSize() > 0 ? 2 : 1;
+      return socket->sendv( buffers, count );
     }
 
   }
@@ -0,0 +1,361 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httprequestparser.cpp
+ * Implements the dodo::network::protocol::http::HTTPRequestParser class.
+ */
+
+#include <network/protocol/http/httprequestparser.hpp>
+
+#include <climits>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Return true if c may appear in a token (such as a method or header field name).
+     * @param c The char to check.
+     * @return True if c is a token char.
+     * @see https://tools.ietf.org/html/rfc7230#section-3.2.6
+     */
+    static bool isTokenChar( unsigned char c ) {
+      return c > 32 && c < 127 && !strchr( "()<>@,;:\\\"/[]?={}", c );
+    }
+
+    /**
+     * Return true if c is a control character other than horizontal tab.
+     * @param c The char to check.
+     * @return True if c is a control character.
+     */
+    static bool isCTL( unsigned char c ) {
+      return ( c < 32 && c != '\t' ) || c == 127;
+    }
+
+    /**
+     * Return true if c is a space or horizontal tab.
+     * @param c The char to check.
+     * @return True if c is whitespace.
+     */
+    static bool isSP( unsigned char c ) {
+      return c == ' ' || c == '\t';
+    }
+
+    /**
+     * Return the value of a hexadecimal digit.
+     * @param c The char to convert.
+     * @return The value or -1 if c is not a hexadecimal digit.
+     */
+    static int hexValue( unsigned char c ) {
+      if ( c >= '0' && c <= '9' ) return c - '0';
+      if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+      if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+      return -1;
+    }
+
+    HTTPRequestParser::HTTPRequestParser( size_t max_header_size, size_t max_body_size ) :
+      max_header_size_( std::min( max_header_size, static_cast<size_t>( UINT32_MAX ) ) ),
+      max_body_size_( max_body_size ) {
+      reset();
+    }
+
+    void HTTPRequestParser::reset() {
+      request_.getRequestLine() = HTTPRequest::HTTPRequestLine();
+      request_.clearHeaders();
+      request_.body_.clear();
+      headers_.clear();
+      materialized_ = 0;
+      state_ = psMethod;
+      error_ = HTTPFragment::peOk;
+      header_size_ = 0;
+      body_size_ = 0;
+      consumed_ = 0;
+      token_.clear();
+      header_name_offset_ = 0;
+      header_name_size_ = 0;
+      header_value_offset_ = 0;
+      header_value_end_ = 0;
+      header_folded_ = false;
+      remaining_ = 0;
+      chunk_digits_ = 0;
+    }
+
+    void HTTPRequestParser::fail( HTTPFragment::ParseError error ) {
+      state_ = psError;
+      error_ = error;
+    }
+
+    void HTTPRequestParser::addHeader() {
+      if ( header_name_size_ == 0 ) return;
+      if ( header_value_end_ == 0 ) header_value_offset_ = header_value_end_ = header_name_offset_ + header_name_size_;
+      headers_.add( static_cast<uint32_t>( header_name_offset_ ), static_cast<uint32_t>( header_name_size_ ),
+                    static_cast<uint32_t>( header_value_offset_ ),
+                    static_cast<uint32_t>( header_value_end_ - header_value_offset_ ), header_folded_ );
+      header_name_size_ = 0;
+      header_value_offset_ = 0;
+      header_value_end_ = 0;
+      header_folded_ = false;
+    }
+
+    HTTPRequest& HTTPRequestParser::getRequest() {
+      if ( materialized_ < headers_.size() ) {
+        request_.clearHeaders();
+        headers_.materialize( request_ );
+        materialized_ = headers_.size();
+      }
+      return request_;
+    }
+
+    void HTTPRequestParser::startBody() {
+      size_t index = headers_.find( HTTPHeader::hiTransferEncoding );
+      if ( index != HTTPHeaderView::npos ) {
+        // transfer-encoding overrules content-length, and chunked must be the final encoding
+        size_t next = index;
+        while ( ( next = headers_.find( HTTPHeader::hiTransferEncoding, next + 1 ) ) != HTTPHeaderView::npos ) index = next;
+        std::string last = headers_.materialize( index );
+        size_t pos = last.find_last_of( ',' );
+        if ( pos != std::string::npos ) last.erase( 0, last.find_first_not_of( " \t", pos + 1 ) );
+        std::transform( last.begin(), last.end(), last.begin(), []( unsigned char c ) { return std::tolower(c); } );
+        if ( last != "chunked" ) return fail( HTTPFragment::peInvalidTransferEncoding );
+        remaining_ = 0;
+        chunk_digits_ = 0;
+        state_ = psChunkSize;
+      } else if ( ( index = headers_.find( HTTPHeader::hiContentLength ) ) != HTTPHeaderView::npos ) {
+        // repeated content-length fields are rejected
+        if ( headers_.find( HTTPHeader::hiContentLength, index + 1 ) != HTTPHeaderView::npos ) {
+          return fail( HTTPFragment::peInvalidContentLength );
+        }
+        std::string_view value = headers_.getValue( index );
+        if ( value.empty() || value.size() > 18 ) return fail( HTTPFragment::peInvalidContentLength );
+        remaining_ = 0;
+        for ( unsigned char c : value ) {
+          if ( c < '0' || c > '9' ) return fail( HTTPFragment::peInvalidContentLength );
+          remaining_ = remaining_ * 10 + ( c - '0' );
+        }
+        if ( remaining_ > max_body_size_ ) return fail( HTTPFragment::peBodyTooLarge );
+        body_size_ = remaining_;
+        state_ = remaining_ > 0 ? psBody : psDone;
+      } else state_ = psDone;
+    }
+
+    HTTPRequestParser::ParseResult HTTPRequestParser::parse( const common::Bytes &buffer ) {
+      size_t consumed = 0;
+      if ( buffer.getSize() <= consumed_ ) return parse( nullptr, 0, consumed );
+      return parse( reinterpret_cast<const char*>( buffer.getArray() ) + consumed_,
+                    buffer.getSize() - consumed_, consumed );
+    }
+
+    HTTPRequestParser::ParseResult HTTPRequestParser::parse( const char* data, size_t size, size_t &consumed ) {
+      consumed = 0;
+      if ( data ) headers_.setBuffer( data - consumed_ );
+      const char* p = data;
+      const char* end = data + size;
+      while ( p < end && state_ != psDone && state_ != psError ) {
+        if ( state_ == psBody || state_ == psChunkData ) {
+          // body data is appended as a whole instead of char by char
+          size_t n = std::min( remaining_, static_cast<size_t>( end - p ) );
+          request_.body_.append( reinterpret_cast<const common::Octet*>( p ), n );
+          p += n;
+          remaining_ -= n;
+          if ( remaining_ == 0 ) state_ = state_ == psBody ? psDone : psChunkDataCR;
+          continue;
+        }
+        // the offset of c relative to the start of the request
+        size_t offset = consumed_ + static_cast<size_t>( p - data );
+        unsigned char c = static_cast<unsigned char>( *p++ );
+        if ( state_ < psBody || state_ >= psTrailerLineStart ) {
+          if ( ++header_size_ > max_header_size_ ) {
+            fail( HTTPFragment::peHeaderTooLarge );
+            break;
+          }
+        }
+        switch ( state_ ) {
+
+          case psMethod:
+            if ( c == ' ' ) {
+              HTTPRequest::Method method = HTTPRequest::methodFromString( token_ );
+              if ( method == HTTPRequest::meINVALID ) fail( HTTPFragment::peInvalidMethod );
+              else {
+                request_.getRequestLine().setMethod( method );
+                token_.clear();
+                state_ = psURI;
+              }
+            } else if ( isTokenChar( c ) ) token_ += static_cast<char>( c );
+            // empty lines before the request line are ignored
+            else if ( !token_.empty() || ( c != '\r' && c != '\n' ) ) fail( HTTPFragment::peInvalidRequestLine );
+            break;
+
+          case psURI:
+            if ( c == ' ' ) {
+              if ( token_.empty() ) break;
+              request_.getRequestLine().setRequestURI( token_ );
+              token_.clear();
+              state_ = psVersion;
+            } else if ( isCTL( c ) || c == '\t' ) fail( HTTPFragment::peInvalidRequestLine );
+            else token_ += static_cast<char>( c );
+            break;
+
+          case psVersion:
+            if ( c == '\r' ) {
+              if ( token_.size() != 8 || token_.compare( 0, 5, "HTTP/" ) != 0 || token_[6] != '.' ||
+                   !std::isdigit( static_cast<unsigned char>( token_[5] ) ) ||
+                   !std::isdigit( static_cast<unsigned char>( token_[7] ) ) ) {
+                fail( HTTPFragment::peInvalidHTTPVersion );
+              } else {
+                request_.getRequestLine().setHTTPVersion( HTTPVersion( token_[5] - '0', token_[7] - '0' ) );
+                token_.clear();
+                state_ = psRequestLineLF;
+              }
+            } else if ( isSP( c ) ) break;
+            else if ( token_.size() >= 8 ) fail( HTTPFragment::peInvalidHTTPVersion );
+            else token_ += static_cast<char>( c );
+            break;
+
+          case psRequestLineLF:
+            if ( c == '\n' ) state_ = psHeaderLineStart; else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psHeaderLineStart:
+            if ( c == '\r' ) {
+              addHeader();
+              state_ = psHeadersLF;
+            } else if ( isSP( c ) ) {
+              // obsolete line folding continues the previous field value
+              if ( header_name_size_ == 0 ) fail( HTTPFragment::peInvalidHeaderFieldValue );
+              else {
+                header_folded_ = header_folded_ || header_value_end_ != 0;
+                state_ = psHeaderValue;
+              }
+            } else if ( isTokenChar( c ) ) {
+              addHeader();
+              header_name_offset_ = offset;
+              state_ = psHeaderName;
+            } else fail( HTTPFragment::peUnFinishedToken );
+            break;
+
+          case psHeaderName:
+            if ( c == ':' ) {
+              header_name_size_ = offset - header_name_offset_;
+              state_ = psHeaderValue;
+            } else if ( isTokenChar( c ) ) break;
+            else if ( isSP( c ) ) {
+              header_name_size_ = offset - header_name_offset_;
+              state_ = psHeaderColon;
+            } else fail( HTTPFragment::peExpectingHeaderColon );
+            break;
+
+          case psHeaderColon:
+            if ( c == ':' ) state_ = psHeaderValue;
+            else if ( !isSP( c ) ) fail( HTTPFragment::peExpectingHeaderColon );
+            break;
+
+          case psHeaderValue:
+            // the value runs from its first to its last non-whitespace char
+            if ( c == '\r' ) state_ = psHeaderValueLF;
+            else if ( isSP( c ) ) break;
+            else if ( isCTL( c ) ) fail( HTTPFragment::peInvalidHeaderFieldValue );
+            else {
+              if ( header_value_end_ == 0 ) header_value_offset_ = offset;
+              header_value_end_ = offset + 1;
+            }
+            break;
+
+          case psHeaderValueLF:
+            if ( c == '\n' ) state_ = psHeaderLineStart; else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psHeadersLF:
+            if ( c == '\n' ) startBody(); else fail( HTTPFragment::peInvalidHeaderListEnd );
+            break;
+
+          case psChunkSize: {
+            int digit = hexValue( c );
+            if ( digit >= 0 ) {
+              // at most 15 digits, so that the size cannot overflow
+              if ( ++chunk_digits_ > 15 ) fail( HTTPFragment::peInvalidChunkHex );
+              else {
+                remaining_ = remaining_ * 16 + static_cast<size_t>( digit );
+                // body_size_ does not exceed max_body_size_, so the difference cannot wrap
+                if ( remaining_ > max_body_size_ - body_size_ ) fail( HTTPFragment::peBodyTooLarge );
+              }
+            } else if ( chunk_digits_ == 0 ) fail( HTTPFragment::peInvalidChunkHex );
+            else if ( c == '\r' ) state_ = psChunkSizeLF;
+            else if ( c == ';' || isSP( c ) ) state_ = psChunkExtension;
+            else fail( HTTPFragment::peInvalidChunkHex );
+            break;
+          }
+
+          case psChunkExtension:
+            if ( c == '\r' ) state_ = psChunkSizeLF;
+            else if ( isCTL( c ) ) fail( HTTPFragment::peInvalidChunkHex );
+            break;
+
+          case psChunkSizeLF:
+            if ( c == '\n' ) {
+              body_size_ += remaining_;
+              state_ = remaining_ > 0 ? psChunkData : psTrailerLineStart;
+            } else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psChunkDataCR:
+            if ( c == '\r' ) state_ = psChunkDataLF; else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psChunkDataLF:
+            if ( c == '\n' ) {
+              remaining_ = 0;
+              chunk_digits_ = 0;
+              state_ = psChunkSize;
+            } else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psTrailerLineStart:
+            state_ = c == '\r' ? psTrailersLF : psTrailer;
+            break;
+
+          case psTrailer:
+            if ( c == '\r' ) state_ = psTrailerLF;
+            break;
+
+          case psTrailerLF:
+            if ( c == '\n' ) state_ = psTrailerLineStart; else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          case psTrailersLF:
+            if ( c == '\n' ) state_ = psDone; else fail( HTTPFragment::peExpectCRLF );
+            break;
+
+          default: throw_Exception( "HTTPRequestParser::parse unhandled state " << state_ );
+
+        }
+      }
+      consumed = static_cast<size_t>( p - data );
+      consumed_ += consumed;
+      if ( state_ == psError ) return { error_, common::SystemError::ecOK };
+      if ( state_ == psDone ) return { HTTPFragment::peOk, common::SystemError::ecOK };
+      return { HTTPFragment::peIncomplete, common::SystemError::ecOK };
+    }
+
+  }
+
+}
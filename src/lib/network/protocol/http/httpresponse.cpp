@@ -22,6 +22,7 @@
  */
 
 #include <network/protocol/http/httpresponse.hpp>
+#include <network/protocol/http/httpscan.hpp>
 
 #include <common/util.hpp>
 
@@ -58,23 +59,20 @@ namespace dodo {
     bool HTTPResponse::hasBody() const {
       bool result = false;
       unsigned long content_length = 0;
-      if ( getHeaderValue( "content-length", content_length ) ) {
+      if ( getContentLength( content_length ) ) {
         if ( content_length > 0 ) return true;
       }
       std::string transfer_encoding;
       std::string connection;
-      if ( getHeaderValue( "transfer-encoding", transfer_encoding ) ) if ( transfer_encoding == "chunked" ) return true;
-      if ( getHeaderValue( "connection", connection ) ) if ( connection == "close" ) return true;
+      if ( getTransferEncoding( transfer_encoding ) ) if ( transfer_encoding == "chunked" ) return true;
+      if ( getConnection( connection ) ) if ( connection == "close" ) return true;
       return result;
     }
 
     std::string HTTPResponse::asString() const {
       std::stringstream ss;
       ss << response_line_.asString();
-      for ( auto header : headers_ ) {
-        ss << header.first << ": " << header.second << HTTPMessage::charCR << HTTPMessage::charLF;
-      }
-      ss << HTTPMessage::charCR << HTTPMessage::charLF;
+      ss << headersAsString();
       if ( body_.getSize() > 0 ) {
         ss << body_.asString();
       }
@@ -82,18 +80,9 @@ namespace dodo {
     }
 
     common::SystemError HTTPResponse::send( BaseSocket* socket ) {
-      std::stringstream ss;
-      ss << response_line_.asString();
-      for ( auto header : headers_ ) {
-        ss << header.first << ": " << header.second << HTTPMessage::charCR << HTTPMessage::charLF;
-      }
-      ss << HTTPMessage::charCR << HTTPMessage::charLF;
-      common::SystemError rc = socket->send( ss.str().c_str(), ss.str().length() );
-      if ( !rc.ok() ) return rc;
-      if ( body_.getSize() > 0 ) {
-        rc = socket->send( body_.getArray(), body_.getSize(), false );
-      }
-      return rc;
+      std::string head = response_line_.asString() + headersAsString();
+      ConstBuffer buffers[] = { head, body_ };
+      return socket->sendv( buffers, body_.getSize() > 0 ? 2 : 1 );
     }
 
     std::string HTTPResponse::HTTPResponseLine::asString() const {
@@ -119,8 +108,10 @@ namespace dodo {
         if ( parseResult.ok() ) {
           http_code_ = static_cast<HTTPCode>(i);
           // ignore the error string (we already have the HTTP code) but we do expect CRLF.
-          while ( parseResult.ok() && data.get() != charCR ) {
-            parseResult.setSystemError( data.next() );
+          while ( parseResult.ok() && data.get() != charCR && data.get() != charLF ) {
+            const char* window = nullptr;
+            size_t size = data.peek( window );
+            parseResult.setSystemError( data.consume( 1 + HTTPScan::lineSpan( window + 1, size - 1 ) ) );
             if ( ! parseResult.ok() ) return parseResult;
           }
           if ( data.get() != charCR )
@@ -143,28 +134,26 @@ namespace dodo {
     HTTPMessage::ParseResult HTTPResponse::parseBody( VirtualReadBuffer &data ) {
       ParseResult parseResult;
       size_t content_length;
-      if ( getHeaderValue( "content-length", content_length ) ) {
-        for ( size_t i = 0; i < content_length; i++ ) {
-          body_.append( data.get() );
-          if ( i < content_length -1 ) {
-            parseResult.setSystemError( data.next() );
-            if ( ! parseResult.ok() ) return parseResult;
-          }
-        }
+      if ( getContentLength( content_length ) ) {
+        parseResult = parseContentBody( data, content_length );
+        if ( ! parseResult.ok() ) return parseResult;
       } else {
         std::string transfer_encoding;
         std::string connection_close;
-        if ( getHeaderValue( "transfer-encoding", transfer_encoding ) ) {
+        if ( getTransferEncoding( transfer_encoding ) ) {
           if ( transfer_encoding == "chunked" ) {
             parseResult = parseChunkedBody( data );
             if ( ! parseResult.ok() ) return parseResult;
           } else return { peInvalidTransferEncoding, common::SystemError::ecOK };
-        } else if ( getHeaderValue( "connection", connection_close ) ) {
+        } else if ( getConnection( connection_close ) ) {
           if ( connection_close == "close" ) {
             // read anything we can get and ignore all errors
             while ( parseResult.ok() ) {
-              body_.append( data.get() );
-              parseResult.setSystemError( data.next() );
+              const char* window = nullptr;
+              size_t size = data.peek( window );
+              if ( size == 0 ) break;
+              body_.append( reinterpret_cast<const common::Octet*>( window ), size );
+              parseResult.setSystemError( data.consume( size ) );
             }
             return { peOk, common::SystemError::ecOK };
           } else return { peUnexpectedBody, common::SystemError::ecOK };
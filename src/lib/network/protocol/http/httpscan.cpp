@@ -0,0 +1,303 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file httpscan.cpp
+ * Implements the dodo::network::protocol::http::HTTPScan class.
+ */
+
+#include <network/protocol/http/httpscan.hpp>
+
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DODO_HTTPSCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace dodo {
+
+  namespace network::protocol::http {
+
+    /**
+     * Return true if c is a token char.
+     * @param c The char to check.
+     * @return True if c is a token char.
+     */
+    static constexpr bool tokenChar( unsigned int c ) {
+      return c > 32 && c < 127 && c != '(' && c != ')' && c != '<' && c != '>' && c != '@' && c != ',' &&
+             c != ';' && c != ':' && c != '\\' && c != '"' && c != '/' && c != '[' && c != ']' && c != '?' &&
+             c != '=' && c != '{' && c != '}';
+    }
+
+    /**
+     * Build a table that is true for the token chars.
+     * @return The table.
+     */
+    static constexpr std::array<bool,256> tokenTable() {
+      std::array<bool,256> table = {};
+      for ( unsigned int c = 0; c < 256; c++ ) table[c] = tokenChar( c );
+      return table;
+    }
+
+    /** The token table as a constexpr. */
+    static constexpr std::array<bool,256> token_table = tokenTable();
+
+    /**
+     * Scalar token scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    static size_t tokenScalar( const char* data, size_t size ) {
+      size_t i = 0;
+      while ( i < size && token_table[static_cast<unsigned char>( data[i] )] ) i++;
+      return i;
+    }
+
+    /**
+     * Scalar field value scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    static size_t fieldValueScalar( const char* data, size_t size ) {
+      size_t i = 0;
+      while ( i < size && data[i] != '\r' && data[i] != ' ' && data[i] != '\t' ) i++;
+      return i;
+    }
+
+    /**
+     * Scalar line scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    static size_t lineScalar( const char* data, size_t size ) {
+      size_t i = 0;
+      while ( i < size && data[i] != '\r' && data[i] != '\n' ) i++;
+      return i;
+    }
+
+#ifdef DODO_HTTPSCAN_X86
+
+    /**
+     * SSE4.2 token scan. PCMPESTRI holds at most 8 ranges, so the last range also stops at '|' and '~', which are
+     * token chars and are skipped.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("sse4.2")))
+    static size_t tokenSSE42( const char* data, size_t size ) {
+      alignas(16) static const char ranges[16] = { '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@',
+                                                   '[', ']', '{', '\xff' };
+      const __m128i stops = _mm_load_si128( reinterpret_cast<const __m128i*>( ranges ) );
+      size_t i = 0;
+      while ( i + 16 <= size ) {
+        __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) );
+        int index = _mm_cmpestri( stops, 16, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT );
+        if ( index == 16 ) {
+          i += 16;
+          continue;
+        }
+        i += static_cast<size_t>( index );
+        if ( !token_table[static_cast<unsigned char>( data[i] )] ) return i;
+        i++;
+      }
+      return i + tokenScalar( data + i, size - i );
+    }
+
+    /**
+     * SSE4.2 scan for the first of a set of (at most 16) chars.
+     * @param set The chars.
+     * @param count The number of chars in set.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The offset of the first char in data that is in set, or the offset of the unscanned tail (less than
+     * 16 bytes).
+     */
+    __attribute__((target("sse4.2")))
+    static size_t findAnySSE42( __m128i set, int count, const char* data, size_t size ) {
+      size_t i = 0;
+      while ( i + 16 <= size ) {
+        __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data + i ) );
+        int index = _mm_cmpestri( set, count, block, 16,
+                                  _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT );
+        if ( index != 16 ) return i + static_cast<size_t>( index );
+        i += 16;
+      }
+      return i;
+    }
+
+    /**
+     * SSE4.2 field value scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("sse4.2")))
+    static size_t fieldValueSSE42( const char* data, size_t size ) {
+      size_t i = findAnySSE42( _mm_setr_epi8( '\r', ' ', '\t', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 ), 3, data, size );
+      return i + fieldValueScalar( data + i, size - i );
+    }
+
+    /**
+     * SSE4.2 line scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("sse4.2")))
+    static size_t lineSSE42( const char* data, size_t size ) {
+      size_t i = findAnySSE42( _mm_setr_epi8( '\r', '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 ), 2, data, size );
+      return i + lineScalar( data + i, size - i );
+    }
+
+    /**
+     * Build the AVX2 token lookup table on the low nibble: bit h of entry l is set if char h * 16 + l is a token
+     * char, for h < 8.
+     * @return The table, repeated for both 128 bit lanes.
+     */
+    static constexpr std::array<char,32> tokenLowNibbles() {
+      std::array<char,32> table = {};
+      for ( unsigned int l = 0; l < 16; l++ ) {
+        unsigned int bits = 0;
+        for ( unsigned int h = 0; h < 8; h++ ) if ( tokenChar( h * 16 + l ) ) bits |= 1u << h;
+        table[l] = table[l + 16] = static_cast<char>( bits );
+      }
+      return table;
+    }
+
+    /** The AVX2 token lookup table on the low nibble. */
+    alignas(32) static constexpr std::array<char,32> token_low_nibbles = tokenLowNibbles();
+
+    /**
+     * AVX2 token scan. Each char is classified with two table lookups (VPSHUFB) on its low and high nibble, the
+     * high nibble selects a bit of the low nibble entry, chars above 127 select none.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("avx2,bmi")))
+    static size_t tokenAVX2( const char* data, size_t size ) {
+      const __m256i low_table = _mm256_load_si256( reinterpret_cast<const __m256i*>( token_low_nibbles.data() ) );
+      const __m256i high_table = _mm256_setr_epi8( 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                   1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0 );
+      const __m256i nibble = _mm256_set1_epi8( 0x0f );
+      size_t i = 0;
+      while ( i + 32 <= size ) {
+        __m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i ) );
+        __m256i low = _mm256_shuffle_epi8( low_table, _mm256_and_si256( block, nibble ) );
+        __m256i high = _mm256_shuffle_epi8( high_table, _mm256_and_si256( _mm256_srli_epi16( block, 4 ), nibble ) );
+        __m256i invalid = _mm256_cmpeq_epi8( _mm256_and_si256( low, high ), _mm256_setzero_si256() );
+        unsigned int mask = static_cast<unsigned int>( _mm256_movemask_epi8( invalid ) );
+        if ( mask ) return i + _tzcnt_u32( mask );
+        i += 32;
+      }
+      return i + tokenScalar( data + i, size - i );
+    }
+
+    /**
+     * AVX2 field value scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("avx2,bmi")))
+    static size_t fieldValueAVX2( const char* data, size_t size ) {
+      const __m256i cr = _mm256_set1_epi8( '\r' );
+      const __m256i sp = _mm256_set1_epi8( ' ' );
+      const __m256i ht = _mm256_set1_epi8( '\t' );
+      size_t i = 0;
+      while ( i + 32 <= size ) {
+        __m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i ) );
+        __m256i stop = _mm256_or_si256( _mm256_cmpeq_epi8( block, cr ), _mm256_cmpeq_epi8( block, sp ) );
+        stop = _mm256_or_si256( stop, _mm256_cmpeq_epi8( block, ht ) );
+        unsigned int mask = static_cast<unsigned int>( _mm256_movemask_epi8( stop ) );
+        if ( mask ) return i + _tzcnt_u32( mask );
+        i += 32;
+      }
+      return i + fieldValueScalar( data + i, size - i );
+    }
+
+    /**
+     * AVX2 line scan.
+     * @param data The data.
+     * @param size The size of data.
+     * @return The span length.
+     */
+    __attribute__((target("avx2,bmi")))
+    static size_t lineAVX2( const char* data, size_t size ) {
+      const __m256i cr = _mm256_set1_epi8( '\r' );
+      const __m256i lf = _mm256_set1_epi8( '\n' );
+      size_t i = 0;
+      while ( i + 32 <= size ) {
+        __m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data + i ) );
+        __m256i stop = _mm256_or_si256( _mm256_cmpeq_epi8( block, cr ), _mm256_cmpeq_epi8( block, lf ) );
+        unsigned int mask = static_cast<unsigned int>( _mm256_movemask_epi8( stop ) );
+        if ( mask ) return i + _tzcnt_u32( mask );
+        i += 32;
+      }
+      return i + lineScalar( data + i, size - i );
+    }
+
+#endif
+
+    HTTPScan::Implementation HTTPScan::getBestImplementation() {
+#ifdef DODO_HTTPSCAN_X86
+      if ( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "bmi" ) ) return imAVX2;
+      if ( __builtin_cpu_supports( "sse4.2" ) ) return imSSE42;
+#endif
+      return imScalar;
+    }
+
+    HTTPScan::Scanner HTTPScan::getScanner( Implementation implementation ) {
+      switch ( implementation ) {
+#ifdef DODO_HTTPSCAN_X86
+        case imAVX2  : return { imAVX2, tokenAVX2, fieldValueAVX2, lineAVX2 };
+        case imSSE42 : return { imSSE42, tokenSSE42, fieldValueSSE42, lineSSE42 };
+#endif
+        default      : return { imScalar, tokenScalar, fieldValueScalar, lineScalar };
+      }
+    }
+
+    HTTPScan::Scanner HTTPScan::scanner_ = HTTPScan::getScanner( HTTPScan::getBestImplementation() );
+
+    bool HTTPScan::setImplementation( Implementation implementation ) {
+      if ( implementation > getBestImplementation() ) return false;
+      scanner_ = getScanner( implementation );
+      return true;
+    }
+
+    bool HTTPScan::isTokenChar( char c ) {
+      return token_table[static_cast<unsigned char>( c )];
+    }
+
+    std::string HTTPScan::implementationAsString( Implementation implementation ) {
+      switch ( implementation ) {
+        case imScalar : return "scalar";
+        case imSSE42  : return "sse4.2";
+        case imAVX2   : return "avx2";
+        default       : return "unknown";
+      }
+    }
+
+  }
+
+}
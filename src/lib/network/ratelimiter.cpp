@@ -0,0 +1,130 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file ratelimiter.cpp
+ * Implements the dodo::network::RateLimiter class.
+ */
+
+#include <network/ratelimiter.hpp>
+#include <common/util.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace dodo::network {
+
+  /**
+   * Mix a 64 bit value (the splitmix64 finalizer).
+   * @param x The value.
+   * @return The mixed value.
+   */
+  static uint64_t mix( uint64_t x ) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  RateLimiter::RateLimiter( const Params &params, size_t capacity ) : params_(params) {
+    connection_interval_ = params_.connection_rate > 0 ? (uint64_t)( 1.0E9 / params_.connection_rate ) : 0;
+    connection_tolerance_ = std::max( (size_t)1, params_.connection_burst ) * connection_interval_;
+    request_interval_ = params_.request_rate > 0 ? (uint64_t)( 1.0E9 / params_.request_rate ) : 0;
+    request_tolerance_ = std::max( (size_t)1, params_.request_burst ) * request_interval_;
+    size_t size = 1;
+    while ( size < capacity ) size <<= 1;
+    mask_ = size - 1;
+    table_ = std::vector<Entry>( size );
+  }
+
+  uint64_t RateLimiter::key( const Address &address ) {
+    uint64_t k = address.getAddressFamily();
+    if ( address.getAddressFamily() == SocketParams::afINET ) {
+      k = k << 32 | reinterpret_cast<const sockaddr_in*>( address.getAddress() )->sin_addr.s_addr;
+    } else if ( address.getAddressFamily() == SocketParams::afINET6 ) {
+      uint64_t words[2];
+      memcpy( words, reinterpret_cast<const sockaddr_in6*>( address.getAddress() )->sin6_addr.s6_addr, sizeof(words) );
+      k = mix( k ^ words[0] ) ^ words[1];
+    }
+    k = mix( k );
+    return k ? k : 1;
+  }
+
+  bool RateLimiter::take( std::atomic<uint64_t> &tat, uint64_t interval, uint64_t tolerance, uint64_t now ) {
+    uint64_t current = tat.load( std::memory_order_relaxed );
+    uint64_t next = 0;
+    do {
+      next = std::max( current, now ) + interval;
+      if ( next - now > tolerance ) return false;
+    } while ( !tat.compare_exchange_weak( current, next, std::memory_order_relaxed ) );
+    return true;
+  }
+
+  bool RateLimiter::admitConnection( uint64_t key, uint32_t &slot ) {
+    uint64_t now = common::steadyNanos();
+    slot = no_slot;
+    size_t free = no_slot;
+    for ( size_t i = 0; i < max_probes; i++ ) {
+      size_t index = ( key + i ) & mask_;
+      Entry &entry = table_[index];
+      uint64_t current = entry.key.load( std::memory_order_acquire );
+      if ( current == key ) {
+        slot = (uint32_t)index;
+        break;
+      }
+      // a slot without connections and with full buckets holds no state
+      if ( free == no_slot &&
+           ( current == 0 ||
+             ( entry.connections.load( std::memory_order_relaxed ) == 0 &&
+               entry.connection_tat.load( std::memory_order_relaxed ) <= now &&
+               entry.request_tat.load( std::memory_order_relaxed ) <= now ) ) ) free = index;
+    }
+    if ( slot == no_slot ) {
+      // not tracked if the probe sequence is full
+      if ( free == no_slot ) return true;
+      Entry &entry = table_[free];
+      uint64_t current = entry.key.load( std::memory_order_relaxed );
+      if ( !entry.key.compare_exchange_strong( current, key, std::memory_order_acq_rel ) ) return true;
+      entry.connection_tat.store( 0, std::memory_order_relaxed );
+      entry.request_tat.store( 0, std::memory_order_relaxed );
+      slot = (uint32_t)free;
+    }
+    Entry &entry = table_[slot];
+    if ( params_.max_connections &&
+         entry.connections.load( std::memory_order_relaxed ) >= params_.max_connections ) return false;
+    if ( connection_interval_ && !take( entry.connection_tat, connection_interval_, connection_tolerance_, now ) )
+      return false;
+    entry.connections.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+  }
+
+  bool RateLimiter::admitRequest( uint32_t slot ) {
+    if ( slot == no_slot || !request_interval_ ) return true;
+    return take( table_[slot].request_tat, request_interval_, request_tolerance_, common::steadyNanos() );
+  }
+
+  void RateLimiter::releaseConnection( uint32_t slot ) {
+    if ( slot == no_slot ) return;
+    std::atomic<uint32_t> &connections = table_[slot].connections;
+    uint32_t current = connections.load( std::memory_order_relaxed );
+    // a slot claimed by another host whilst counting may have lost a count, never wrap
+    while ( current && !connections.compare_exchange_weak( current, current - 1, std::memory_order_relaxed ) );
+  }
+
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file scalingpolicy.cpp
+ * Implements the dodo::network::LatencyScalingPolicy class.
+ */
+
+#include <network/scalingpolicy.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace dodo::network {
+
+  LatencyScalingPolicy::LatencyScalingPolicy( const Params &params ) :
+    params_(params), up_count_(0), down_count_(0), up_throughput_(0), up_active_(0) {
+  }
+
+  size_t LatencyScalingPolicy::decide( const Sample &sample ) {
+    bool waiting = sample.queue_wait_us > params_.up_wait_us;
+    bool busy = sample.utilisation > params_.up_utilisation;
+    bool idle = sample.queue_wait_us < params_.up_wait_us / 4 && sample.utilisation < params_.down_utilisation;
+    if ( waiting || busy ) {
+      up_count_++;
+      down_count_ = 0;
+    } else {
+      up_count_ = 0;
+      up_active_ = 0;
+      if ( idle ) down_count_++; else down_count_ = 0;
+    }
+    reason_ = "";
+
+    if ( up_count_ >= params_.up_intervals && sample.active < sample.maxservers ) {
+      up_count_ = 0;
+      if ( up_active_ && sample.active >= up_active_ && sample.throughput < up_throughput_ * saturation_gain ) {
+        reason_ = "saturated";
+        return sample.active;
+      }
+      double target_utilisation = ( params_.up_utilisation + params_.down_utilisation ) / 2;
+      size_t target = sample.active + 1;
+      if ( busy ) {
+        target = std::max( target, (size_t)std::ceil( (double)sample.active * sample.utilisation / target_utilisation ) );
+      }
+      target = std::min( target, std::max( (size_t)1, 2 * sample.active ) );
+      up_throughput_ = sample.throughput;
+      up_active_ = target;
+      reason_ = waiting ? "queue-wait" : "utilisation";
+      return target;
+    }
+
+    if ( down_count_ >= params_.down_intervals && sample.active > sample.minservers ) {
+      down_count_ = 0;
+      reason_ = "idle";
+      return sample.active - 1;
+    }
+
+    return sample.active;
+  }
+
+}
@@ -20,9 +20,14 @@
  * Implements the dodo::network::Socket class.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -56,6 +61,209 @@ namespace dodo::network {
     else return common::SystemError::ecOK;
   }
 
+  common::SystemError Socket::sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more ) {
+    int flags = MSG_NOSIGNAL;
+    if ( more ) flags = flags | MSG_MORE;
+    const char* cp = (const char*)buf;
+    sent = 0;
+    while ( sent < len ) {
+      ssize_t rc = ::send( socket_, cp + sent, len - sent, flags );
+      if ( rc < 0 ) {
+        switch ( errno ) {
+          case common::SystemError::ecEINTR :
+            continue;
+          case common::SystemError::ecEAGAIN :
+          case common::SystemError::ecECONNRESET :
+          case common::SystemError::ecEPIPE :
+            return errno;
+          default: throw_SystemExceptionObject( "Socket::sendPartial failed", errno, this );
+        };
+      }
+      sent += rc;
+    }
+    return common::SystemError::ecOK;
+  }
+
+  common::SystemError Socket::sendv( const ConstBuffer* buffers, size_t count, bool more ) {
+    struct iovec iov[sendv_max_iov];
+    struct msghdr msg;
+    memset( &msg, 0, sizeof(msg) );
+    size_t next = 0;
+    while ( next < count ) {
+      size_t n = 0;
+      while ( next < count && n < sendv_max_iov ) {
+        if ( buffers[next].size > 0 ) {
+          iov[n].iov_base = const_cast<void*>( buffers[next].data );
+          iov[n].iov_len = buffers[next].size;
+          n++;
+        }
+        next++;
+      }
+      int flags = MSG_NOSIGNAL;
+      if ( more || next < count ) flags = flags | MSG_MORE;
+      size_t first = 0;
+      while ( first < n ) {
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = n - first;
+        ssize_t rc = ::sendmsg( socket_, &msg, flags );
+        if ( rc < 0 ) {
+          switch ( errno ) {
+            case common::SystemError::ecEINTR :
+              continue;
+            case common::SystemError::ecEAGAIN :
+            case common::SystemError::ecECONNRESET :
+            case common::SystemError::ecEPIPE :
+              return errno;
+            default: throw_SystemExceptionObject( "Socket::sendv failed", errno, this );
+          };
+        }
+        size_t done = rc;
+        while ( first < n && done >= iov[first].iov_len ) {
+          done -= iov[first].iov_len;
+          first++;
+        }
+        if ( first < n ) {
+          iov[first].iov_base = static_cast<char*>( iov[first].iov_base ) + done;
+          iov[first].iov_len -= done;
+        }
+      }
+    }
+    return common::SystemError::ecOK;
+  }
+
+  common::SystemError Socket::sendFile( int fd, off_t offset, size_t length, size_t &sent ) {
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) throw_SystemExceptionObject( "Socket::sendFile fstat failed", errno, this );
+    if ( S_ISFIFO( st.st_mode ) ) return sendPipe( fd, length, sent );
+    if ( !S_ISREG( st.st_mode ) ) return BaseSocket::sendFile( fd, offset, length, sent );
+    sent = 0;
+    while ( sent < length ) {
+      off_t off = offset + sent;
+      ssize_t rc = ::sendfile( socket_, fd, &off, std::min( length - sent, sendfile_max_chunk ) );
+      if ( rc < 0 ) {
+        switch ( errno ) {
+          case common::SystemError::ecEINTR :
+            continue;
+          case common::SystemError::ecEAGAIN :
+          case common::SystemError::ecECONNRESET :
+          case common::SystemError::ecEPIPE :
+            return errno;
+          default: throw_SystemExceptionObject( "Socket::sendFile failed", errno, this );
+        };
+      }
+      if ( rc == 0 ) return common::SystemError::ecENODATA;
+      sent += rc;
+    }
+    return common::SystemError::ecOK;
+  }
+
+  /**
+   * The intermediate pipe and the /dev/null descriptor used by Socket::sendPipe(), opened on first use by each
+   * thread and closed when the thread exits, so that a send does not create and close a pipe.
+   */
+  struct SplicePipe {
+    /** The read and write end of the pipe, -1 if not open. */
+    int pipefd[2] = { -1, -1 };
+    /** /dev/null, -1 if not open. */
+    int devnull = -1;
+
+    ~SplicePipe() {
+      close();
+      if ( devnull >= 0 ) ::close( devnull );
+    }
+
+    /**
+     * Close the pipe.
+     */
+    void close() {
+      if ( pipefd[0] >= 0 ) ::close( pipefd[0] );
+      if ( pipefd[1] >= 0 ) ::close( pipefd[1] );
+      pipefd[0] = pipefd[1] = -1;
+    }
+
+    /**
+     * Open the descriptors that are not open yet, a failure is retried on the next call.
+     * @return 0 or the errno of the failure.
+     */
+    int open() {
+      if ( devnull < 0 && ( devnull = ::open( "/dev/null", O_WRONLY | O_CLOEXEC ) ) < 0 ) return errno;
+      if ( pipefd[0] < 0 && ::pipe2( pipefd, O_CLOEXEC | O_NONBLOCK ) != 0 ) {
+        pipefd[0] = pipefd[1] = -1;
+        return errno;
+      }
+      return 0;
+    }
+  };
+
+  static thread_local SplicePipe splice_pipe;
+
+  /**
+   * Splice length bytes that are available in from to to.
+   * @param from The descriptor to splice from.
+   * @param to The descriptor to splice to.
+   * @param length The number of bytes.
+   * @return 0 or the errno of the failure.
+   */
+  static int spliceAvailable( int from, int to, size_t length ) {
+    while ( length > 0 ) {
+      ssize_t rc = ::splice( from, nullptr, to, nullptr, length, SPLICE_F_NONBLOCK );
+      if ( rc < 0 ) {
+        if ( errno == common::SystemError::ecEINTR ) continue;
+        return errno;
+      }
+      if ( rc == 0 ) return common::SystemError::ecENODATA;
+      length -= rc;
+    }
+    return 0;
+  }
+
+  common::SystemError Socket::sendPipe( int fd, size_t length, size_t &sent ) {
+    int syserr = splice_pipe.open();
+    if ( syserr ) throw_SystemExceptionObject( "Socket::sendFile cannot open the splice pipe", syserr, this );
+    const int* pipefd = splice_pipe.pipefd;
+    common::SystemError error = common::SystemError::ecOK;
+    sent = 0;
+    while ( sent < length && error == common::SystemError::ecOK ) {
+      // an empty source returns EAGAIN rather than blocking the caller
+      ssize_t teed = ::tee( fd, pipefd[1], length - sent, SPLICE_F_NONBLOCK );
+      if ( teed < 0 ) {
+        if ( errno == common::SystemError::ecEINTR ) continue;
+        error = errno;
+        break;
+      }
+      if ( teed == 0 ) {
+        error = common::SystemError::ecENODATA;
+        break;
+      }
+      ssize_t moved = 0;
+      while ( moved < teed ) {
+        ssize_t rc = ::splice( pipefd[0], nullptr, socket_, nullptr, teed - moved, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+        if ( rc < 0 ) {
+          if ( errno == common::SystemError::ecEINTR ) continue;
+          if ( errno == common::SystemError::ecEAGAIN || errno == common::SystemError::ecECONNRESET ||
+               errno == common::SystemError::ecEPIPE ) error = errno; else syserr = errno;
+          break;
+        }
+        moved += rc;
+      }
+      // the bytes sent are consumed from the source, the bytes the socket did not accept are dropped from the
+      // pipe, so that it is empty for the next call
+      if ( !syserr ) {
+        syserr = spliceAvailable( fd, splice_pipe.devnull, moved );
+        if ( !syserr ) sent += moved;
+      }
+      int dropped = spliceAvailable( pipefd[0], splice_pipe.devnull, teed - moved );
+      if ( dropped ) {
+        // a pipe that could not be emptied is replaced on the next call
+        splice_pipe.close();
+        if ( !syserr ) syserr = dropped;
+      }
+      if ( syserr ) break;
+    }
+    if ( syserr ) throw_SystemExceptionObject( "Socket::sendFile splice failed", syserr, this );
+    return error;
+  }
+
   common::SystemError Socket::sendTo( const Address& address, const void* buf, ssize_t len ) {
     int flags = 0;
     ssize_t left = len;
@@ -95,6 +303,28 @@ namespace dodo::network {
     }
   }
 
+  common::SystemError Socket::receivev( const MutableBuffer* buffers, size_t count, ssize_t &received ) {
+    struct iovec iov[sendv_max_iov];
+    if ( count > sendv_max_iov ) count = sendv_max_iov;
+    for ( size_t i = 0; i < count; i++ ) {
+      iov[i].iov_base = buffers[i].data;
+      iov[i].iov_len = buffers[i].size;
+    }
+    received = 0;
+    ssize_t rc = ::readv( socket_, iov, (int)count );
+    if ( rc < 0 ) {
+      switch ( errno ) {
+        case common::SystemError::ecEAGAIN :
+        case common::SystemError::ecECONNREFUSED :
+        case common::SystemError::ecENOTCONN :
+          return errno;
+        default: throw_SystemExceptionObject( "Socket::receivev failed", errno, this );
+      };
+    }
+    received = rc;
+    return common::SystemError::ecOK;
+  }
+
   Socket* Socket::accept() {
     Socket* ret = new Socket();
     *ret = Socket::SocketInvalid;
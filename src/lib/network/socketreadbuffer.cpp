@@ -22,12 +22,43 @@
 
 #include <network/socketreadbuffer.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <stdio.h>
 
 namespace dodo {
 
   namespace network {
 
+    bool VirtualReadBuffer::find( char c, size_t &offset ) const {
+      const char* data = nullptr;
+      size_t size = peek( data );
+      const char* found = size ? static_cast<const char*>( memchr( data, c, size ) ) : nullptr;
+      if ( !found ) return false;
+      offset = static_cast<size_t>( found - data );
+      return true;
+    }
+
+    common::SystemError VirtualReadBuffer::read( void* dest, size_t n ) {
+      char* out = static_cast<char*>( dest );
+      while ( n > 0 ) {
+        const char* data = nullptr;
+        size_t size = peek( data );
+        if ( size == 0 ) {
+          common::SystemError error = underflow();
+          if ( error != common::SystemError::ecOK ) return error;
+          continue;
+        }
+        size_t count = std::min( size, n );
+        memcpy( out, data, count );
+        out += count;
+        n -= count;
+        common::SystemError error = consume( count );
+        if ( error != common::SystemError::ecOK ) return error;
+      }
+      return common::SystemError::ecOK;
+    }
+
     SocketReadBuffer::SocketReadBuffer( BaseSocket* socket, size_t bufsize ) {
       socket_ = socket;
       if ( !socket_->getBlocking() ) throw_Exception( "SocketReadBuffer requires a blocking socket" );
@@ -60,6 +91,16 @@ namespace dodo {
       return underflow();
     }
 
+    size_t SocketReadBuffer::peek( const char* &data ) const {
+      data = buffer_ + idx_;
+      return idx_ < received_ ? static_cast<size_t>( received_ - idx_ ) : 0;
+    }
+
+    common::SystemError SocketReadBuffer::consume( size_t n ) {
+      idx_ += n;
+      return underflow();
+    }
+
     FileReadBuffer::FileReadBuffer( std::string filename, size_t bufsize ) : VirtualReadBuffer() {
       bufsize_ = bufsize;
       read_ = 0;
@@ -97,6 +138,16 @@ namespace dodo {
       return underflow();
     }
 
+    size_t FileReadBuffer::peek( const char* &data ) const {
+      data = buffer_ + idx_;
+      return idx_ < read_ ? read_ - idx_ : 0;
+    }
+
+    common::SystemError FileReadBuffer::consume( size_t n ) {
+      idx_ += n;
+      return underflow();
+    }
+
   }
 
 }
@@ -22,11 +22,17 @@
 
 #include <network/tcplistener.hpp>
 #include <network/tcpserver.hpp>
+#include <network/tlssocket.hpp>
+#include <network/uring.hpp>
 #include <common/logger.hpp>
 #include <common/util.hpp>
 
 #include <algorithm>
+#include <fcntl.h>
 #include <map>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 
 namespace dodo {
@@ -36,31 +42,124 @@ namespace dodo {
     using namespace std::literals;
 
     common::SystemError TCPConnectionData::readBuffer( BaseSocket* socket, ssize_t &received ) {
-      common::Bytes tmp;
-      tmp.reserve( 4096 );
-      ssize_t recv = 0;
+      common::Octet overflow[read_overflow_size];
+      size_t want = std::max( read_hint, read_buffer_min_spare );
       received = 0;
       common::SystemError error;
-      do {
-        error = socket->receive( tmp.getArray(), tmp.getSize(), recv );
-        if ( ( error == common::SystemError::ecOK || error == common::SystemError::ecEAGAIN ) && recv > 0 ) {
-          log_Debug( "TCPConnectionData::readBuffer socket " << socket->getFD() <<
-                      " received " << recv << " bytes" );
-          log_Trace( "TCPConnectionData::readBuffer socket " << socket->getFD() <<
-                      " received '" << tmp.hexDump( recv ) << "'" );
-          read_buffer.append( tmp, recv );
-          received += recv;
-        } else if ( ! ( error == common::SystemError::ecOK || error == common::SystemError::ecEAGAIN ) ) {
+      for (;;) {
+        read_buffer.ensureCapacity( read_buffer.getSize() + want );
+        size_t spare = read_buffer.getSpare();
+        MutableBuffer buffers[2] = { { read_buffer.getTail(), spare }, { overflow, sizeof(overflow) } };
+        ssize_t recv = 0;
+        error = socket->receivev( buffers, 2, recv );
+        if ( error != common::SystemError::ecOK && error != common::SystemError::ecEAGAIN ) {
           log_Error( "TCPConnectionData::readBuffer receive error socket " <<
                       socket->getFD() << " error : '" << error.asString() << " bytes'" );
-          return false;
+          return error;
         }
-      } while ( recv == 4096 );
+        if ( recv <= 0 ) break;
+        log_Debug( "TCPConnectionData::readBuffer socket " << socket->getFD() << " received " << recv << " bytes" );
+        if ( (size_t)recv <= spare ) {
+          read_buffer.extend( recv );
+        } else {
+          read_buffer.extend( spare );
+          read_buffer.append( overflow, recv - spare );
+        }
+        received += recv;
+        if ( (size_t)recv < spare + sizeof(overflow) ) break;
+        // both segments filled, size the next read after what is pending
+        want = std::max( socket->getReadable(), read_buffer_min_spare );
+      }
+      log_Trace( "TCPConnectionData::readBuffer socket " << socket->getFD() <<
+                 " buffer '" << read_buffer.hexDump( read_buffer.getSize() ) << "'" );
+      if ( received > 0 ) read_hint = std::min( (size_t)received, read_overflow_size );
       return error;
     }
 
     void TCPConnectionData::clearBuffer() {
-      read_buffer.free();
+      if ( read_buffer.getCapacity() > read_buffer_keep ) read_buffer.free(); else read_buffer.clear();
+    }
+
+    TCPConnectionData::~TCPConnectionData() {
+      for ( auto &file : output_files ) ::close( file.fd );
+    }
+
+    common::SystemError TCPConnectionData::send( BaseSocket* socket, const void* buf, ssize_t len, bool more ) {
+      ssize_t sent = 0;
+      if ( getOutputSize() == 0 ) {
+        common::SystemError error = socket->sendPartial( buf, len, sent, more );
+        if ( error != common::SystemError::ecOK && error != common::SystemError::ecEAGAIN ) return error;
+        output_buffer.clear();
+        output_offset = 0;
+      }
+      if ( sent < len ) {
+        const common::Octet* octets = static_cast<const common::Octet*>( buf ) + sent;
+        std::vector<common::Octet> &queue = output_files.empty() ? output_buffer : output_files.back().trailer;
+        queue.insert( queue.end(), octets, octets + ( len - sent ) );
+        log_Debug( "TCPConnectionData::send socket " << socket->getFD() << " queued " << len - sent << " bytes" );
+      }
+      return common::SystemError::ecOK;
+    }
+
+    common::SystemError TCPConnectionData::sendFile( BaseSocket* socket, int fd, off_t offset, size_t length ) {
+      if ( length == 0 ) {
+        ::close( fd );
+        return common::SystemError::ecOK;
+      }
+      bool idle = getOutputSize() == 0;
+      output_files.push_back( { fd, offset, length, {} } );
+      if ( !idle ) return common::SystemError::ecOK;
+      ssize_t sent = 0;
+      common::SystemError error = flushOutput( socket, sent );
+      if ( error == common::SystemError::ecEAGAIN ) {
+        log_Debug( "TCPConnectionData::sendFile socket " << socket->getFD() << " queued " << length - sent <<
+                   " bytes" );
+        return common::SystemError::ecOK;
+      }
+      return error;
+    }
+
+    size_t TCPConnectionData::getOutputSize() const {
+      size_t size = output_buffer.size() - output_offset;
+      for ( const auto &file : output_files ) size += file.length + file.trailer.size();
+      return size;
+    }
+
+    common::SystemError TCPConnectionData::flushOutput( BaseSocket* socket, ssize_t &sent ) {
+      sent = 0;
+      for (;;) {
+        if ( output_offset < output_buffer.size() ) {
+          ssize_t written = 0;
+          common::SystemError error = socket->sendPartial( output_buffer.data() + output_offset,
+                                                           output_buffer.size() - output_offset, written );
+          sent += written;
+          output_offset += written;
+          if ( error != common::SystemError::ecOK ) {
+            // compact so that the queue does not grow unbounded whilst it is being drained and appended to
+            if ( error == common::SystemError::ecEAGAIN && output_offset > output_buffer.size() / 2 ) {
+              output_buffer.erase( output_buffer.begin(), output_buffer.begin() + output_offset );
+              output_offset = 0;
+            }
+            return error;
+          }
+        }
+        output_buffer.clear();
+        output_offset = 0;
+        if ( output_files.empty() ) return common::SystemError::ecOK;
+        OutputFile &file = output_files.front();
+        size_t written = 0;
+        common::SystemError error = socket->sendFile( file.fd, file.offset, std::min( file.length, output_file_chunk ),
+                                                      written );
+        sent += written;
+        file.offset += written;
+        file.length -= written;
+        if ( error != common::SystemError::ecOK ) return error;
+        // yield after a chunk, the socket is still writable so the TCPServer is called back for the next one
+        if ( file.length > 0 ) return common::SystemError::ecEAGAIN;
+        ::close( file.fd );
+        output_buffer.swap( file.trailer );
+        output_files.pop_front();
+      }
     }
 
     /**
@@ -115,16 +214,18 @@ namespace dodo {
     const std::string yaml_sendbufsz = "send-buffer";
     /** recvbufsz YAML configuration name */
     const std::string yaml_recvbufsz = "receive-buffer";
-    /** server_idle_ttl_s YAML configuration name */
-    const std::string yaml_server_idle_ttl_s = "server-idle-ttl-s";
     /** pollbatch YAML configuration name */
     const std::string yaml_pollbatch = "poll-batch";
+    /** pop_batch YAML configuration name */
+    const std::string yaml_pop_batch = "pop-batch";
+    /** spin_max YAML configuration name */
+    const std::string yaml_spin_max = "spin-max";
     /** listener_sleep_ms YAML configuration name */
     const std::string yaml_listener_sleep_ms = "listener-sleep-ms";
-    /** throttle_sleep_us YAML configuration name */
-    const std::string yaml_throttle_sleep_us = "throttle-sleep-us";
-    /** cycle_max_throttles YAML configuration name */
-    const std::string yaml_cycle_max_throttles = "cycle-max-throttles";
+    /** admission_resume_ratio YAML configuration name */
+    const std::string yaml_admission_resume_ratio = "admission-resume-ratio";
+    /** shed_connections YAML configuration name */
+    const std::string yaml_shed_connections = "shed-connections";
     /** stat_trc_interval_s YAML configuration name */
     const std::string yaml_stat_trc_interval_s = "stat-trc-interval-s";
     /** yaml_send_timeout_seconds YAML configuration name */
@@ -133,6 +234,56 @@ namespace dodo {
     const std::string yaml_receive_timeout_seconds = "receive-timeout-seconds";
     /** yaml_tcp_keep_alive YAML configuration name */
     const std::string yaml_tcp_keep_alive = "tcp-keep-alive";
+    /** edge_triggered YAML configuration name */
+    const std::string yaml_edge_triggered = "edge-triggered";
+    /** worker_owned YAML configuration name */
+    const std::string yaml_worker_owned = "worker-owned";
+    /** worker_assignment YAML configuration name */
+    const std::string yaml_worker_assignment = "worker-assignment";
+    /** listener_shards YAML configuration name */
+    const std::string yaml_listener_shards = "listener-shards";
+    /** shard_incoming_cpu YAML configuration name */
+    const std::string yaml_shard_incoming_cpu = "shard-incoming-cpu";
+    /** io_engine YAML configuration name */
+    const std::string yaml_io_engine = "io-engine";
+    /** output_high_water YAML configuration name */
+    const std::string yaml_output_high_water = "output-high-water";
+    /** ip_connection_rate YAML configuration name */
+    const std::string yaml_ip_connection_rate = "ip-connection-rate";
+    /** ip_connection_burst YAML configuration name */
+    const std::string yaml_ip_connection_burst = "ip-connection-burst";
+    /** ip_request_rate YAML configuration name */
+    const std::string yaml_ip_request_rate = "ip-request-rate";
+    /** ip_request_burst YAML configuration name */
+    const std::string yaml_ip_request_burst = "ip-request-burst";
+    /** ip_max_connections YAML configuration name */
+    const std::string yaml_ip_max_connections = "ip-max-connections";
+    /** idle_timeout_ms YAML configuration name */
+    const std::string yaml_idle_timeout_ms = "idle-timeout-ms";
+    /** handshake_timeout_ms YAML configuration name */
+    const std::string yaml_handshake_timeout_ms = "handshake-timeout-ms";
+    /** request_timeout_ms YAML configuration name */
+    const std::string yaml_request_timeout_ms = "request-timeout-ms";
+    /** handover_path YAML configuration name */
+    const std::string yaml_handover_path = "handover-path";
+    /** handover_connections YAML configuration name */
+    const std::string yaml_handover_connections = "handover-connections";
+    /** handover_drain_s YAML configuration name */
+    const std::string yaml_handover_drain_s = "handover-drain-s";
+    /** tls YAML configuration name */
+    const std::string yaml_tls = "tls";
+    /** scale_interval_ms YAML configuration name */
+    const std::string yaml_scale_interval_ms = "scale-interval-ms";
+    /** scale_up_wait_us YAML configuration name */
+    const std::string yaml_scale_up_wait_us = "scale-up-wait-us";
+    /** scale_up_utilisation YAML configuration name */
+    const std::string yaml_scale_up_utilisation = "scale-up-utilisation";
+    /** scale_down_utilisation YAML configuration name */
+    const std::string yaml_scale_down_utilisation = "scale-down-utilisation";
+    /** scale_up_intervals YAML configuration name */
+    const std::string yaml_scale_up_intervals = "scale-up-intervals";
+    /** scale_down_intervals YAML configuration name */
+    const std::string yaml_scale_down_intervals = "scale-down-intervals";
 
 
 
@@ -143,46 +294,198 @@ namespace dodo {
       maxqdepth               = common::YAML_read_key_default<size_t>( node, yaml_maxqdepth, 256 );
       sendbufsz               = common::YAML_read_key_default<socklen_t>( node, yaml_sendbufsz, 16384 );
       recvbufsz               = common::YAML_read_key_default<socklen_t>( node, yaml_recvbufsz, 32768 );
-      server_idle_ttl_s       = common::YAML_read_key_default<double>( node, yaml_server_idle_ttl_s, 300 );
       pollbatch               = common::YAML_read_key_default<int>( node, yaml_pollbatch, 128 );
+      pop_batch               = common::YAML_read_key_default<size_t>( node, yaml_pop_batch, 8 );
+      spin_max                = common::YAML_read_key_default<size_t>( node, yaml_spin_max, 2000 );
       listener_sleep_ms       = common::YAML_read_key_default<int>( node, yaml_listener_sleep_ms, 200 );
-      throttle_sleep_us       = common::YAML_read_key_default<size_t>( node, yaml_throttle_sleep_us, 4000 );
-      cycle_max_throttles     = common::YAML_read_key_default<size_t>( node, yaml_cycle_max_throttles, 40 );
+      admission_resume_ratio  = common::YAML_read_key_default<double>( node, yaml_admission_resume_ratio, 0.5 );
+      shed_connections        = common::YAML_read_key_default<bool>( node, yaml_shed_connections, false );
+      ip_connection_rate      = common::YAML_read_key_default<double>( node, yaml_ip_connection_rate, 0 );
+      ip_connection_burst     = common::YAML_read_key_default<size_t>( node, yaml_ip_connection_burst, 20 );
+      ip_request_rate         = common::YAML_read_key_default<double>( node, yaml_ip_request_rate, 0 );
+      ip_request_burst        = common::YAML_read_key_default<size_t>( node, yaml_ip_request_burst, 100 );
+      ip_max_connections      = common::YAML_read_key_default<size_t>( node, yaml_ip_max_connections, 0 );
       stat_trc_interval_s     = common::YAML_read_key_default<time_t>( node, yaml_stat_trc_interval_s, 300 );
       send_timeout_seconds    = common::YAML_read_key_default<int>( node, yaml_send_timeout_seconds, 0 );
       receive_timeout_seconds = common::YAML_read_key_default<int>( node, yaml_receive_timeout_seconds, 0 );
       tcp_keep_alive          = common::YAML_read_key_default<bool>( node, yaml_tcp_keep_alive, true );
+      edge_triggered          = common::YAML_read_key_default<bool>( node, yaml_edge_triggered, false );
+      worker_owned            = common::YAML_read_key_default<bool>( node, yaml_worker_owned, false );
+      std::string assignment  = common::YAML_read_key_default<std::string>( node, yaml_worker_assignment, "round-robin" );
+      if ( assignment == "round-robin" ) worker_assignment = WorkerAssignment::RoundRobin;
+      else if ( assignment == "least-loaded" ) worker_assignment = WorkerAssignment::LeastLoaded;
+      else throw_Exception( "invalid " << yaml_worker_assignment << " '" << assignment <<
+                            "', expecting round-robin or least-loaded" );
+      listener_shards         = common::YAML_read_key_default<size_t>( node, yaml_listener_shards, 1 );
+      shard_incoming_cpu      = common::YAML_read_key_default<bool>( node, yaml_shard_incoming_cpu, false );
+      std::string engine      = common::YAML_read_key_default<std::string>( node, yaml_io_engine, "epoll" );
+      if ( engine == "epoll" ) io_engine = IOEngine::Epoll;
+      else if ( engine == "io_uring" ) io_engine = IOEngine::URing;
+      else throw_Exception( "invalid " << yaml_io_engine << " '" << engine << "', expecting epoll or io_uring" );
+      output_high_water       = common::YAML_read_key_default<size_t>( node, yaml_output_high_water, 262144 );
+      idle_timeout_ms         = common::YAML_read_key_default<size_t>( node, yaml_idle_timeout_ms, 0 );
+      handshake_timeout_ms    = common::YAML_read_key_default<size_t>( node, yaml_handshake_timeout_ms, 10000 );
+      request_timeout_ms      = common::YAML_read_key_default<size_t>( node, yaml_request_timeout_ms, 60000 );
+      handover_path           = common::YAML_read_key_default<std::string>( node, yaml_handover_path, "" );
+      handover_connections    = common::YAML_read_key_default<bool>( node, yaml_handover_connections, false );
+      handover_drain_s        = common::YAML_read_key_default<int>( node, yaml_handover_drain_s, 30 );
+      if ( node[yaml_tls] ) tls = std::make_shared<TLSContext>( node[yaml_tls] );
+      scale_interval_ms       = common::YAML_read_key_default<int>( node, yaml_scale_interval_ms, 500 );
+      scale_up_wait_us        = common::YAML_read_key_default<double>( node, yaml_scale_up_wait_us, 2000 );
+      scale_up_utilisation    = common::YAML_read_key_default<double>( node, yaml_scale_up_utilisation, 0.85 );
+      scale_down_utilisation  = common::YAML_read_key_default<double>( node, yaml_scale_down_utilisation, 0.4 );
+      scale_up_intervals      = common::YAML_read_key_default<size_t>( node, yaml_scale_up_intervals, 2 );
+      scale_down_intervals    = common::YAML_read_key_default<size_t>( node, yaml_scale_down_intervals, 10 );
     }
 
     TCPListener::TCPListener( const Address& address, const Params &params ) :
-      Thread() {
+      Thread(), primary_(nullptr), shard_index_(0) {
+      construct( address, params );
+      createShards();
+    }
+
+    TCPListener::TCPListener( const Address& address, const Params &params, TCPListener* primary, size_t index ) :
+      Thread(), primary_(primary), shard_index_(index) {
       construct( address, params );
     }
 
     TCPListener::~TCPListener() {
+      for ( auto shard : shards_ ) delete shard;
       if ( listen_socket_ ) delete listen_socket_;
+      if ( listen_ring_ ) delete listen_ring_;
+      if ( workload_ ) delete workload_;
+      if ( free_slots_ ) delete free_slots_;
+      if ( scaling_policy_ ) delete scaling_policy_;
+      if ( wheel_ ) delete wheel_;
+      if ( limiter_ && isPrimary() ) delete limiter_;
+      for ( auto fd : handover_fds_ ) if ( fd >= 0 ) ::close( fd );
+      if ( handover_listen_fd_ >= 0 ) ::close( handover_listen_fd_ );
+      if ( handover_in_ >= 0 ) ::close( handover_in_ );
+      if ( handover_out_ >= 0 ) ::close( handover_out_ );
     }
 
     void TCPListener::construct( const Address& address, const Params &params ) {
       listen_address_ = address;
       params_ = params;
+      if ( params_.listener_shards < 1 ) throw_Exception( yaml_listener_shards << " must be at least 1" );
+      if ( params_.listener_shards > 1 && isPrimary() ) {
+        // the limits are totals over all shards, the shards are handed the primary's already divided params_
+        auto per_shard = [&params]( size_t total ) {
+          return std::max( (size_t)1, ( total + params.listener_shards - 1 ) / params.listener_shards );
+        };
+        params_.minservers     = per_shard( params.minservers );
+        params_.maxservers     = std::max( params_.minservers, per_shard( params.maxservers ) );
+        params_.maxconnections = per_shard( params.maxconnections );
+        params_.maxqdepth      = per_shard( params.maxqdepth );
+      }
+      if ( params_.pop_batch < 1 ) throw_Exception( yaml_pop_batch << " must be at least 1" );
+      // spinning only helps if the thread pushing work runs on another cpu
+      if ( std::thread::hardware_concurrency() < 2 ) params_.spin_max = 0;
+      if ( params_.scale_interval_ms < 1 ) throw_Exception( yaml_scale_interval_ms << " must be at least 1" );
+      if ( params_.admission_resume_ratio < 0 || params_.admission_resume_ratio > 1 )
+        throw_Exception( yaml_admission_resume_ratio << " must be between 0 and 1" );
+      if ( params_.io_engine == IOEngine::URing && params_.tls ) {
+        log_Warning( "TCPListener io_uring does not support TLS, falling back to epoll" );
+        params_.io_engine = IOEngine::Epoll;
+      }
+      if ( params_.io_engine == IOEngine::URing ) {
+        if ( URing::isSupported() ) {
+          params_.worker_owned = true;
+        } else {
+          log_Warning( "TCPListener io_uring is not available, falling back to epoll" );
+          params_.io_engine = IOEngine::Epoll;
+        }
+      }
       init_server_ = nullptr;
+      scaling_policy_ = nullptr;
+      wheel_ = nullptr;
+      limiter_ = nullptr;
+      RateLimiter::Params limits;
+      limits.connection_rate = params_.ip_connection_rate;
+      limits.connection_burst = params_.ip_connection_burst;
+      limits.request_rate = params_.ip_request_rate;
+      limits.request_burst = params_.ip_request_burst;
+      limits.max_connections = params_.ip_max_connections;
+      if ( RateLimiter::isEnabled( limits ) ) {
+        // the limits are per host over all shards, the table has room for a host per connection
+        if ( isPrimary() )
+          limiter_ = new RateLimiter( limits, std::max( (size_t)1024, 2 * params.maxconnections ) );
+        else
+          limiter_ = primary_->limiter_;
+      }
+      timeout_recheck_ns_ = 0;
+      for ( size_t timeout : { params_.idle_timeout_ms, params_.handshake_timeout_ms, params_.request_timeout_ms } ) {
+        if ( timeout && ( !timeout_recheck_ns_ || timeout * 1000000 < timeout_recheck_ns_ ) )
+          timeout_recheck_ns_ = timeout * 1000000;
+      }
+      // the io_uring engine has no timeouts
+      timeouts_enabled_ = timeout_recheck_ns_ && params_.io_engine != IOEngine::URing;
+      scale_time_ns_ = 0;
+      queue_wait_ns_ = 0;
+      queue_waits_ = 0;
+      listen_ring_ = nullptr;
+      num_servers_ = 0;
+      num_parked_ = 0;
+      next_server_ = 0;
+      workload_ = new threads::MPMCQueue<SocketWork*>( std::max( params_.maxqdepth, params_.maxconnections ) );
+      clients_ = std::vector<SocketWork>( params_.maxconnections );
+      free_slots_ = new threads::MPMCQueue<uint32_t>( params_.maxconnections );
+      for ( uint32_t slot = 0; slot < params_.maxconnections; slot++ ) free_slots_->push( slot );
+      num_clients_ = 0;
       stop_server_ = false;
       work_q_sz_ = 0;
+      admission_paused_ = false;
+      resume_qdepth_ = (unsigned long long)( params_.admission_resume_ratio * (double)params_.maxqdepth );
+      paused_ns_ = 0;
+      resume_fd_ = -1;
+      resume_signalled_ = false;
+      handover_listen_fd_ = -1;
+      handover_in_ = -1;
+      handover_out_ = -1;
+      handing_over_ = false;
+      listening_ = true;
+      handover_deadline_ns_ = 0;
+      handed_over_ = false;
+      // the TCPListener, up to maxservers TCPServers and threads that are neither
+      counters_ = std::vector<Counters>( std::max( params_.minservers, params_.maxservers ) + 2 );
+      free_counters_.clear();
+      for ( size_t i = counters_.size() - 2; i > 0; i-- ) free_counters_.push_back( i );
 
-      read_event_mask_ = EPOLLIN | EPOLLPRI | EPOLLONESHOT | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLWAKEUP;
+      // EPOLLOUT only fires after a send hit a full socket buffer, so it can be registered permanently
+      if ( params_.edge_triggered )
+        read_event_mask_ = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLET | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLWAKEUP;
+      else
+        read_event_mask_ = EPOLLIN | EPOLLPRI | EPOLLONESHOT | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLWAKEUP;
       //hangup_event_mask_ = EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLWAKEUP;
       hangup_event_mask_ = 0;
       if ( !listen_address_.isValid() ) throw_Exception( "invalid address" );
-      /** @todo This could also be a TLSSocket */
-      listen_socket_ = new Socket( false,
-                                   SocketParams(
-                                   listen_address_.getAddressFamily(),
-                                   SocketParams::stSTREAM,
-                                   SocketParams::pnHOPOPT )
-      );
+      // take over the listening socket of a running instance
+      int handed_fd = -1;
+      if ( !params_.handover_path.empty() ) {
+        if ( isPrimary() ) receiveListeners();
+        std::vector<int> &fds = isPrimary() ? handover_fds_ : primary_->handover_fds_;
+        if ( shard_index_ < fds.size() ) std::swap( handed_fd, fds[shard_index_] );
+        if ( handed_fd >= 0 && Socket( handed_fd ).getAddress().asString(true) != listen_address_.asString(true) ) {
+          log_Warning( "TCPListener handed over socket does not listen on " << listen_address_.asString(true) );
+          ::close( handed_fd );
+          handed_fd = -1;
+        }
+      }
+      if ( handed_fd >= 0 ) {
+        listen_socket_ = new Socket( handed_fd );
+      } else {
+        listen_socket_ = new Socket( false,
+                                     SocketParams(
+                                     listen_address_.getAddressFamily(),
+                                     SocketParams::stSTREAM,
+                                     SocketParams::pnHOPOPT )
+        );
+      }
       listen_socket_->setReUseAddress();
       listen_socket_->setReUsePort();
+      if ( params_.listener_shards > 1 && params_.shard_incoming_cpu ) {
+        listen_socket_->setIncomingCPU( (int)( shard_index_ % std::thread::hardware_concurrency() ) );
+      }
       listen_socket_->setBlocking( false );
       listen_socket_->setSendBufSize( params_.sendbufsz );
       listen_socket_->setReceiveBufSize( params_.recvbufsz );
@@ -192,70 +495,270 @@ namespace dodo {
       if ( !common::fileReadInt( proc_somaxconn, backlog_ ) )
         throw_Exception( "failed to read int from " << proc_somaxconn );
 
-      log_Statistics( yaml_minservers << " = " << params_.minservers );
-      log_Statistics( yaml_maxservers << " = " << params_.maxservers );
-      log_Statistics( yaml_maxconnections << " = " << params_.maxconnections );
-      log_Statistics( yaml_maxqdepth << " = " << params_.maxqdepth );
-      log_Statistics( yaml_sendbufsz << " = " << params_.sendbufsz );
-      log_Statistics( yaml_recvbufsz << " = " << params_.recvbufsz );
-      log_Statistics( yaml_server_idle_ttl_s << " = " << params_.server_idle_ttl_s );
-      log_Statistics( yaml_pollbatch << " = " << params_.pollbatch );
-      log_Statistics( yaml_listener_sleep_ms << " = " << params_.listener_sleep_ms );
-      log_Statistics( yaml_throttle_sleep_us << " = " << params_.throttle_sleep_us );
-      log_Statistics( yaml_cycle_max_throttles << " = " << params_.cycle_max_throttles );
-      log_Statistics( yaml_send_timeout_seconds << " = " << params_.send_timeout_seconds );
-      log_Statistics( yaml_receive_timeout_seconds << " = " << params_.receive_timeout_seconds );
+      if ( isPrimary() ) {
+        log_Statistics( yaml_minservers << " = " << params.minservers );
+        log_Statistics( yaml_maxservers << " = " << params.maxservers );
+        log_Statistics( yaml_maxconnections << " = " << params.maxconnections );
+        log_Statistics( yaml_maxqdepth << " = " << params.maxqdepth );
+        log_Statistics( yaml_sendbufsz << " = " << params_.sendbufsz );
+        log_Statistics( yaml_recvbufsz << " = " << params_.recvbufsz );
+        log_Statistics( yaml_pollbatch << " = " << params_.pollbatch );
+        log_Statistics( yaml_pop_batch << " = " << params_.pop_batch );
+        log_Statistics( yaml_spin_max << " = " << params_.spin_max );
+        log_Statistics( yaml_listener_sleep_ms << " = " << params_.listener_sleep_ms );
+        log_Statistics( yaml_admission_resume_ratio << " = " << params_.admission_resume_ratio );
+        log_Statistics( yaml_shed_connections << " = " << params_.shed_connections );
+        log_Statistics( yaml_ip_connection_rate << " = " << params_.ip_connection_rate );
+        log_Statistics( yaml_ip_connection_burst << " = " << params_.ip_connection_burst );
+        log_Statistics( yaml_ip_request_rate << " = " << params_.ip_request_rate );
+        log_Statistics( yaml_ip_request_burst << " = " << params_.ip_request_burst );
+        log_Statistics( yaml_ip_max_connections << " = " << params_.ip_max_connections );
+        log_Statistics( yaml_send_timeout_seconds << " = " << params_.send_timeout_seconds );
+        log_Statistics( yaml_receive_timeout_seconds << " = " << params_.receive_timeout_seconds );
+        log_Statistics( yaml_edge_triggered << " = " << params_.edge_triggered );
+        log_Statistics( yaml_worker_owned << " = " << params_.worker_owned );
+        log_Statistics( yaml_worker_assignment << " = " <<
+                        ( params_.worker_assignment == WorkerAssignment::RoundRobin ? "round-robin" : "least-loaded" ) );
+        log_Statistics( yaml_listener_shards << " = " << params_.listener_shards );
+        log_Statistics( yaml_shard_incoming_cpu << " = " << params_.shard_incoming_cpu );
+        log_Statistics( yaml_io_engine << " = " << ( params_.io_engine == IOEngine::URing ? "io_uring" : "epoll" ) );
+        log_Statistics( yaml_output_high_water << " = " << params_.output_high_water );
+        log_Statistics( yaml_idle_timeout_ms << " = " << params_.idle_timeout_ms );
+        log_Statistics( yaml_handshake_timeout_ms << " = " << params_.handshake_timeout_ms );
+        log_Statistics( yaml_request_timeout_ms << " = " << params_.request_timeout_ms );
+        log_Statistics( yaml_handover_path << " = " << params_.handover_path );
+        log_Statistics( yaml_handover_connections << " = " << params_.handover_connections );
+        log_Statistics( yaml_handover_drain_s << " = " << params_.handover_drain_s );
+        log_Statistics( yaml_tls << " = " << ( params_.tls ? "enabled" : "disabled" ) );
+        log_Statistics( yaml_scale_interval_ms << " = " << params_.scale_interval_ms );
+        log_Statistics( yaml_scale_up_wait_us << " = " << params_.scale_up_wait_us );
+        log_Statistics( yaml_scale_up_utilisation << " = " << params_.scale_up_utilisation );
+        log_Statistics( yaml_scale_down_utilisation << " = " << params_.scale_down_utilisation );
+        log_Statistics( yaml_scale_up_intervals << " = " << params_.scale_up_intervals );
+        log_Statistics( yaml_scale_down_intervals << " = " << params_.scale_down_intervals );
+      }
+
+      if ( handed_fd < 0 ) {
+        common::SystemError error = listen_socket_->listen( listen_address_, backlog_ );
+        if ( error != common::SystemError::ecOK ) throw_SystemException( "listen failed", error );
+      }
 
-      common::SystemError error = listen_socket_->listen( listen_address_, backlog_ );
-      if ( error != common::SystemError::ecOK ) throw_SystemException( "listen failed", error );
+      if ( isPrimary() ) log_Statistics( "address = " << listen_address_.asString(true) );
+    }
 
-      log_Statistics( "address = " << listen_address_.asString(true) );
+    void TCPListener::createShards() {
+      for ( size_t i = 1; i < params_.listener_shards; i++ ) {
+        shards_.push_back( new TCPListener( listen_address_, params_, this, i ) );
+      }
+      // the running instance had more shards
+      for ( auto &fd : handover_fds_ ) {
+        if ( fd >= 0 ) ::close( fd );
+        fd = -1;
+      }
     }
 
-    TCPListener::TCPListener( const YAML::Node &yaml ) {
+    TCPListener::TCPListener( const YAML::Node &yaml ) : primary_(nullptr), shard_index_(0) {
       Params params( yaml );
       std::string saddr = common::YAML_read_key<std::string>( yaml, "listen-address" );
       uint16_t port = common::YAML_read_key<std::uint16_t>( yaml, "listen-port" );
       Address addr( saddr, port );
       if ( !addr.isValid() ) throw_Exception( "invalid listen address " << saddr << ":" << port );
       construct( addr, params );
+      createShards();
+    }
+
+    /**
+     * Hint the cpu that the thread is spinning.
+     */
+    static inline void cpuRelax() {
+      #if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+      #elif defined(__aarch64__)
+      asm volatile( "yield" );
+      #endif
     }
 
+    thread_local TCPListener::Counters* TCPListener::thread_counters_ = nullptr;
+
     bool TCPListener::waitForActivity( TCPServer* server ) {
-      std::unique_lock<std::mutex> lk( mt_signal_ );
-      return cv_signal_.wait_for( lk,
-                                  std::chrono::milliseconds(params_.listener_sleep_ms),
-                                  [this,server]{ return work_q_sz_ || server->getRequestStop(); } );
+      if ( server->parked_ ) {
+        server->wakeup_.wait( params_.listener_sleep_ms );
+        return server->getRequestStop();
+      }
+      for ( size_t i = 0; i < server->spin_; i++ ) {
+        if ( workload_->size() ) return true;
+        cpuRelax();
+      }
+      {
+        // registering under idle_mutex_ after checking the queue cannot miss a wakeServers() for work pushed after
+        // the check
+        threads::Mutexer lock( idle_mutex_ );
+        if ( workload_->size() || server->getRequestStop() ) return true;
+        idle_servers_.push_back( server );
+      }
+      uint64_t sleep_start = steadyNanos();
+      bool woken = server->wakeup_.wait( params_.listener_sleep_ms );
+      if ( !woken ) {
+        threads::Mutexer lock( idle_mutex_ );
+        auto i_server = std::find( idle_servers_.begin(), idle_servers_.end(), server );
+        if ( i_server != idle_servers_.end() ) idle_servers_.erase( i_server );
+        else server->wakeup_.tryWait(); // woken right after the timeout
+      }
+      // spin longer if work arrives shortly after going to sleep, shorter if it does not
+      if ( woken && steadyNanos() - sleep_start < spin_window_ns ) {
+        server->spin_ = std::min( 2 * server->spin_ + 16, params_.spin_max );
+      } else {
+        server->spin_ /= 2;
+      }
+      return ( !server->parked_ && workload_->size() ) || server->getRequestStop();
+    }
+
+    void TCPListener::wakeServers( size_t n ) {
+      if ( n == 0 ) return;
+      threads::Mutexer lock( idle_mutex_ );
+      while ( n > 0 && !idle_servers_.empty() ) {
+        TCPServer* server = idle_servers_.back();
+        idle_servers_.pop_back();
+        server->wakeup_.post();
+        n--;
+      }
+    }
+
+    void TCPListener::wakeServer( TCPServer* server ) {
+      threads::Mutexer lock( idle_mutex_ );
+      auto i_server = std::find( idle_servers_.begin(), idle_servers_.end(), server );
+      if ( i_server != idle_servers_.end() ) idle_servers_.erase( i_server );
+      server->wakeup_.post();
     }
 
     void TCPListener::start( TCPServer *server ) {
       init_server_ = server;
+      for ( auto shard : shards_ ) {
+        shard->start( server->addShardServer( *shard ) );
+      }
       Thread::start();
     }
 
+    void TCPListener::stop() {
+      stop_server_ = true;
+      for ( auto shard : shards_ ) shard->stop();
+    }
+
+    TCPListener::Stats TCPListener::getStats() {
+      Stats stats;
+      for ( const auto &c : counters_ ) c.addTo( stats );
+      return stats;
+    }
+
+    void TCPListener::Counters::addTo( Stats &stats ) const {
+      stats.connections += connections.load( std::memory_order_relaxed );
+      stats.requests += requests.load( std::memory_order_relaxed );
+      stats.admission_pauses += admission_pauses.load( std::memory_order_relaxed );
+      stats.paused_us += paused_us.load( std::memory_order_relaxed );
+      stats.shed += shed.load( std::memory_order_relaxed );
+      stats.limited_connections += limited_connections.load( std::memory_order_relaxed );
+      stats.limited_requests += limited_requests.load( std::memory_order_relaxed );
+      stats.received += received.load( std::memory_order_relaxed );
+      stats.sent += sent.load( std::memory_order_relaxed );
+      stats.epoll_ctls += epoll_ctls.load( std::memory_order_relaxed );
+      stats.uring_enters += uring_enters.load( std::memory_order_relaxed );
+      stats.scale_ups += scale_ups.load( std::memory_order_relaxed );
+      stats.scale_downs += scale_downs.load( std::memory_order_relaxed );
+      stats.timeouts += timeouts.load( std::memory_order_relaxed );
+      stats.handshake_failures += handshake_failures.load( std::memory_order_relaxed );
+    }
+
+    void TCPListener::registerServer( TCPServer* server ) {
+      if ( free_counters_.empty() ) {
+        server->counters_ = &counters_.back();
+      } else {
+        server->counters_ = &counters_[ free_counters_.back() ];
+        free_counters_.pop_back();
+      }
+    }
+
+    void TCPListener::unregisterServer( TCPServer* server ) {
+      size_t index = (size_t)( server->counters_ - counters_.data() );
+      if ( index > 0 && index < counters_.size() - 1 ) free_counters_.push_back( index );
+      server->counters_ = nullptr;
+    }
+
+    TCPListener::Latencies TCPListener::getLatencies() {
+      threads::Mutexer lock( stats_mutex_ );
+      return latencies_;
+    }
+
     void TCPListener::run() {
       struct epoll_event poll_sockets[params_.pollbatch];
       struct epoll_event set_event;
       event_maxconnections_reached_ = 0;
       try {
         int rc = 0;
+        if ( params_.listener_shards > 1 && params_.shard_incoming_cpu ) {
+          cpu_set_t cpuset;
+          CPU_ZERO( &cpuset );
+          CPU_SET( shard_index_ % std::thread::hardware_concurrency(), &cpuset );
+          rc = pthread_setaffinity_np( pthread_self(), sizeof(cpuset), &cpuset );
+          if ( rc != 0 ) log_Warning( "TCPListener::run shard " << shard_index_ << " failed to set cpu affinity" );
+        }
+        thread_counters_ = &counters_.front();
         servers_.push_back(init_server_);
+        registerServer( init_server_ );
         memset(  poll_sockets, 0, sizeof(poll_sockets) );
         epoll_fd_ = epoll_create1( 0 );
         if ( epoll_fd_ < 0 )
           throw_SystemException( "TCPListener::run: epoll_create1 failed", errno );
         set_event.events = EPOLLIN | EPOLLPRI;
-        set_event.data.fd = listen_socket_->getFD();
-        rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, listen_socket_->getFD(), &set_event );
+        set_event.data.u64 = listen_token_;
+        if ( params_.io_engine == IOEngine::URing ) {
+          // the listener thread still waits in epoll_wait, on the ring that reaps the multishot accept
+          listen_ring_ = new URing( 64 );
+          listen_ring_->prepAccept( listen_socket_->getFD(), 0 );
+          listen_ring_->enter( 0, 0 );
+          rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, listen_ring_->getFD(), &set_event );
+        } else {
+          rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, listen_socket_->getFD(), &set_event );
+        }
         if ( rc < 0 ) throw_SystemException( "TCPListener::run epoll_ctl failed", errno );
+        if ( !params_.handover_path.empty() && isPrimary() ) {
+          handover_listen_fd_ = Handover::listen( params_.handover_path );
+          set_event.events = EPOLLIN;
+          set_event.data.u64 = handover_token_;
+          rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, handover_listen_fd_, &set_event );
+          if ( rc < 0 ) throw_SystemException( "TCPListener::run epoll_ctl failed", errno );
+          if ( handover_in_ >= 0 ) {
+            if ( fcntl( handover_in_, F_SETFL, fcntl( handover_in_, F_GETFL ) | O_NONBLOCK ) < 0 )
+              throw_SystemException( "TCPListener::run fcntl failed", errno );
+            set_event.data.u64 = handover_in_token_;
+            rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, handover_in_, &set_event );
+            if ( rc < 0 ) throw_SystemException( "TCPListener::run epoll_ctl failed", errno );
+          }
+        }
+        if ( !params_.worker_owned ) {
+          resume_fd_ = eventfd( 0, EFD_NONBLOCK );
+          if ( resume_fd_ < 0 ) throw_SystemException( "TCPListener::run eventfd failed", errno );
+          set_event.events = EPOLLIN;
+          set_event.data.u64 = resume_token_;
+          rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, resume_fd_, &set_event );
+          if ( rc < 0 ) throw_SystemException( "TCPListener::run epoll_ctl failed", errno );
+        }
 
         log_Debug( "TCPListener::run starting " << params_.minservers << " servers" );
         init_server_->start();
         while ( servers_.size() < params_.minservers ) {
           TCPServer* add_server = init_server_->addServer();
           servers_.push_back(add_server);
+          registerServer( add_server );
           add_server->start();
         }
+        num_servers_ = servers_.size();
+        scaling_policy_ = init_server_->newScalingPolicy();
+        if ( timeouts_enabled_ && !params_.worker_owned )
+          wheel_ = new TimerWheel( (uint64_t)timeout_tick_ms * 1000000, steadyNanos() );
+        // the timeouts are checked at least every tick
+        int poll_timeout = timeouts_enabled_ ? std::min( params_.listener_sleep_ms, timeout_tick_ms ) :
+                                               params_.listener_sleep_ms;
+        scale_time_ns_ = steadyNanos();
 
         gettimeofday( &prev_stat_time_, NULL );
         prev_stat_time_.tv_sec -= 1;
@@ -269,91 +772,80 @@ namespace dodo {
         timer.start();
         do {
           logStats();
-          addServers();
-          throttle();
+          scaleServers();
+          if ( handing_over_ ) drainHandover();
+          admitConnections();
           // check for maxservers
           {
             threads::Mutexer lock( now_mutex_ );
-            if ( servers_.size() == params_.maxservers &&
-                 work_q_sz_ > 2 * servers_.size() &&
+            if ( num_servers_ == params_.maxservers &&
+                 work_q_sz_ > 2 * num_servers_ &&
                  now_.tv_sec > 30 + warn_queue_time_.tv_sec ) {
               log_Warning( "TCPListener::run queuing on maxservers #clients=" <<
-                clients_.size() << " #servers=" << servers_.size() << " queue=" << work_q_sz_ );
+                num_clients_ << " #servers=" << servers_.size() << " queue=" << work_q_sz_ );
               gettimeofday( &warn_queue_time_, NULL );
             }
           }
           // wait for activity
-          rc = epoll_wait( epoll_fd_, poll_sockets, params_.pollbatch, params_.listener_sleep_ms );
+          rc = epoll_wait( epoll_fd_, poll_sockets, params_.pollbatch, poll_timeout );
           if ( rc < 0 && errno != EINTR )
             throw_SystemException( "TCPListener::run: epoll_wait failed", errno );
           else if ( rc > 0 ) {
+            size_t pushed = 0;
             for ( int i = 0; i < rc; i++ ) {
               if ( poll_sockets[i].events != 0 ) {
-                if ( poll_sockets[i].data.fd == listen_socket_->getFD() ) {
-                  network::BaseSocket* client_sock;
-                  do {
-                    client_sock = listen_socket_->accept();
-                    if ( !client_sock->isValid() ) break;
-                    if ( clients_.size() >= params_.maxconnections ) {
-                       client_sock->close();
-                       delete client_sock;
-                       event_maxconnections_reached_++;
-                    } else {
-                      {
-                        threads::Mutexer lock( clientmutex_ );
-                        clients_[client_sock->getFD()].socket = client_sock;
-                        clients_[client_sock->getFD()].state = SockState::New;
-                        clients_[client_sock->getFD()].data = init_server_->newConnectionData();
-                      }
-                      pushWork( { client_sock, SockState::New } );
-                      log_Debug( "TCPListener::run new client socket " <<
-                                 client_sock->debugString() << " from " <<
-                                 client_sock->getPeerAddress().asString() );
-                      {
-                        threads::Mutexer lock( stats_mutex_ );
-                        last_stats_.connections++;
-                      }
-                      client_sock->setBlocking( false );
-                      client_sock->setTCPNoDelay( true );
-                      client_sock->setSendTimeout( params_.send_timeout_seconds );
-                      client_sock->setReceiveTimeout( params_.receive_timeout_seconds );
-                      client_sock->setTCPKeepAlive( params_.tcp_keep_alive );
-                      cv_signal_.notify_one();
-                    }
-                  } while ( client_sock->isValid() );
-                } else if ( poll_sockets[i].data.fd >= 0 ) {
+                if ( poll_sockets[i].data.u64 == listen_token_ ) {
+                  if ( listen_ring_ ) reapAccepts(); else acceptConnections();
+                } else if ( poll_sockets[i].data.u64 == resume_token_ ) {
+                  // admitConnections() at the top of the loop resumes
+                  uint64_t value = 0;
+                  if ( ::read( resume_fd_, &value, sizeof(value) ) < 0 && errno != EAGAIN )
+                    throw_SystemException( "TCPListener::run eventfd read failed", errno );
+                  resume_signalled_ = false;
+                } else if ( poll_sockets[i].data.u64 == handover_token_ ) {
+                  sendListeners();
+                } else if ( poll_sockets[i].data.u64 == handover_in_token_ ) {
+                  receiveConnections();
+                } else {
+                  uint64_t token = poll_sockets[i].data.u64;
+                  SocketWork* work = &clients_[ token & 0xFFFFFFFF ];
+                  if ( work->generation != ( token >> 32 ) ) {
+                    log_Warning( "TCPListener::run epoll event on stale connection slot " << ( token & 0xFFFFFFFF ) <<
+                                 " events=(" << poll_sockets[i].events << ")" );
+                    continue;
+                  }
                   SockState combined_state = SockState::None;
                   if ( (poll_sockets[i].events & EPOLLIN) || (poll_sockets[i].events &  EPOLLPRI) ) {
-                    log_Debug( "TCPListener::run EPOLLIN || EPOLLPRI on socket " <<
-                               poll_sockets[i].data.fd <<
+                    log_Debug( "TCPListener::run EPOLLIN || EPOLLPRI on slot " << ( token & 0xFFFFFFFF ) <<
                                " events=(" << poll_sockets[i].events << ")" );
                     combined_state |= SockState::Read;
-                    {
-                      threads::Mutexer lock( stats_mutex_ );
-                      last_stats_.requests++;
-                    }
+                    count( counters().requests, 1 );
+                    if ( !admitRequest( work ) ) combined_state = SockState::Shut;
+                  }
+                  if ( poll_sockets[i].events & EPOLLOUT ) {
+                    log_Debug( "TCPListener::run EPOLLOUT on slot " << ( token & 0xFFFFFFFF ) );
+                    combined_state |= SockState::Write;
                   }
                   if ( (poll_sockets[i].events & EPOLLRDHUP ) ||
                        (poll_sockets[i].events & EPOLLERR ) ||
                        (poll_sockets[i].events & EPOLLHUP ) ) {
                     combined_state |= SockState::Shut;
-                    log_Debug( "TCPListener::run hangup or error on socket " <<
-                               poll_sockets[i].data.fd <<
+                    log_Debug( "TCPListener::run hangup or error on slot " << ( token & 0xFFFFFFFF ) <<
                                " events=(" << poll_sockets[i].events << ")" );
                   }
                   if ( combined_state != SockState::None ) {
                     poll_sockets[i].events = 0;
-                    pushWork( poll_sockets[i].data.fd, combined_state );
-                    cv_signal_.notify_one();
+                    work->armed = false;
+                    pushWork( work, combined_state );
+                    pushed++;
                   }
-                } else {
-                    log_Warning( "TCPListener::run epoll event on invalid descriptor " <<
-                                 poll_sockets[i].data.fd <<
-                                 " events=(" << poll_sockets[i].events << ")" );
                 }
               }
             }
+            // wake no more TCPServers than there is work for
+            wakeServers( pushed );
           }
+          if ( wheel_ ) expireTimeouts();
 
           cleanStoppedServers();
         } while ( !stop_server_ );
@@ -376,104 +868,544 @@ namespace dodo {
         log_Debug( "TCPListener::run stop TCPServers " );
         for ( auto srv : servers_ ) {
           srv->requestStop();
+          wakeServer( srv );
         }
         for ( auto srv : servers_ ) {
           srv->wait();
+          retired_latencies_ += srv->latencies_;
           delete srv;
         }
         log_Debug( "TCPListener::run stopped TCPServers " );
         servers_.clear();
-        auto clients_copy = clients_;  // closeSocket modifies clients_
-        for( auto c: clients_copy ) {
-          log_Debug( "TCPListener::run close socket " << c.second.socket );
-          closeSocket( c.second.socket );
+        num_servers_ = 0;
+        for( auto &c : clients_ ) {
+          if ( c.socket ) {
+            log_Debug( "TCPListener::run close socket " << c.socket );
+            // the owning TCPServers have been deleted
+            c.owner = nullptr;
+            closeSocket( &c );
+          }
+        }
+        if ( listen_ring_ ) {
+          // the multishot accept holds a reference to the listening socket until it is cancelled
+          listen_ring_->prepCancel( 0, 1 );
+          listen_ring_->enter( 1, params_.listener_sleep_ms );
+          delete listen_ring_;
+          listen_ring_ = nullptr;
+        }
+        listen_socket_->close();
+        if ( resume_fd_ >= 0 ) ::close( resume_fd_ );
+        ::close( epoll_fd_ );
+        for ( auto shard : shards_ ) shard->wait();
+        if ( handover_out_ >= 0 ) {
+          // end of the handover, the new instance closes its channel
+          ::close( handover_out_ );
+          handover_out_ = -1;
         }
+        handed_over_ = handing_over_.load();
       }
       catch ( ... ) {
       }
     }
 
-    void TCPListener::pushWork( int fd, SockState state ) {
-      {
-        threads::Mutexer lock( clientmutex_ );
-        clients_[fd].state |= state;
-        workload_.push_back( &(clients_[fd]) );
-        work_q_sz_++;
-        if ( ! (state & SockState::New) ) pollDel( clients_[fd].socket );
+    void TCPListener::acceptConnections() {
+      while ( true ) {
+        network::BaseSocket* client_sock = listen_socket_->accept();
+        if ( !client_sock->isValid() ) {
+          delete client_sock;
+          break;
+        }
+        if ( params_.tls ) {
+          // the TLS handshake is performed by the TCPServers, the BaseSocket does not close its descriptor
+          BaseSocket* tls_sock = new TLSSocket( client_sock->getFD(), *params_.tls, X509Common::SAN() );
+          delete client_sock;
+          client_sock = tls_sock;
+        }
+        newConnection( client_sock );
       }
-      log_Debug( "TCPListener::pushWork BaseSocket* socket " <<
-                 clients_[fd].socket->debugString() << " state " << state );
     }
 
-    void TCPListener::pushWork( const SocketWork &work ) {
-      {
-        threads::Mutexer lock( clientmutex_ );
-        clients_[work.socket->getFD()].state |= work.state;
-        workload_.push_back( &(clients_[work.socket->getFD()]) );
-        work_q_sz_++;
-        if ( ! (work.state & SockState::New) ) pollDel( clients_[work.socket->getFD()].socket );
+    void TCPListener::reapAccepts() {
+      size_t enters = listen_ring_->getEnters();
+      bool rearm = false;
+      listen_ring_->forEachCQE( [this,&rearm]( const struct io_uring_cqe& cqe ) {
+        if ( cqe.res >= 0 ) {
+          newConnection( new URingSocket( cqe.res ) );
+        } else {
+          log_Warning( "TCPListener::reapAccepts accept failed : " << common::SystemError( -cqe.res ).asString() );
+        }
+        // the multishot accept terminates on errors
+        if ( !( cqe.flags & IORING_CQE_F_MORE ) ) rearm = true;
+      } );
+      if ( rearm ) listen_ring_->prepAccept( listen_socket_->getFD(), 0 );
+      listen_ring_->enter( 0, 0 );
+      count( counters().uring_enters, listen_ring_->getEnters() - enters );
+    }
+
+    void TCPListener::newConnection( BaseSocket* client_sock, bool adopted ) {
+      if ( admission_paused_ && params_.shed_connections ) {
+        client_sock->close();
+        delete client_sock;
+        count( counters().shed, 1 );
+        return;
+      }
+      uint32_t limit_slot = RateLimiter::no_slot;
+      if ( limiter_ && !limiter_->admitConnection( RateLimiter::key( client_sock->getPeerAddress() ), limit_slot ) ) {
+        client_sock->close();
+        delete client_sock;
+        count( counters().limited_connections, 1 );
+        return;
+      }
+      SocketWork* work = nullptr;
+      uint32_t slot = 0;
+      if ( free_slots_->pop( slot ) ) {
+        work = &clients_[slot];
+        work->socket = client_sock;
+        work->state = SockState::None;
+        work->data = init_server_->newConnectionData();
+        work->registered = false;
+        work->pending = 0;
+        work->busy = false;
+        work->owner = nullptr;
+        work->events = 0;
+        work->deadline = 0;
+        work->armed = false;
+        work->request_ns = 0;
+        work->limit_slot = limit_slot;
+        work->handshake_events = 0;
+        work->handshake_ns = 0;
+        num_clients_++;
+      }
+      if ( !work ) {
+         if ( limiter_ ) limiter_->releaseConnection( limit_slot );
+         client_sock->close();
+         delete client_sock;
+         event_maxconnections_reached_++;
+      } else {
+        // setup the socket before it is handed to a TCPServer, which may close it right away
+        client_sock->setBlocking( false );
+        client_sock->setTCPNoDelay( true );
+        client_sock->setSendTimeout( params_.send_timeout_seconds );
+        client_sock->setReceiveTimeout( params_.receive_timeout_seconds );
+        client_sock->setTCPKeepAlive( params_.tcp_keep_alive );
+        log_Debug( "TCPListener::newConnection new client socket " <<
+                   client_sock->debugString() << " from " <<
+                   client_sock->getPeerAddress().asString() );
+        count( counters().connections, 1 );
+        if ( params_.worker_owned ) {
+          if ( !adopted ) work->state |= SockState::New;
+          if ( !assignWork( work ) ) closeSocket( work );
+        } else {
+          // the deadline is set when the connection is first released to wait for events
+          if ( wheel_ ) wheel_->schedule( pollToken( work ), steadyNanos() + timeout_recheck_ns_ );
+          if ( adopted ) {
+            // handed over whilst waiting for a request, wait for it right away
+            if ( timeouts_enabled_ ) work->deadline = connectionDeadline( work );
+            work->registered = true;
+            pollAdd( work, read_event_mask_ | hangup_event_mask_ );
+            // events and timeouts are handled by this thread, so arming after epoll_ctl leaves no gap
+            work->armed = true;
+          } else {
+            pushWork( work, SockState::New );
+            wakeServers( 1 );
+          }
+        }
       }
-      log_Debug( "TCPListener::pushWork BaseSocket* socket " << work.socket->debugString() <<
-                 " state " << work.state );
     }
 
-    TCPListener::SocketWork* TCPListener::popWork() {
-      SocketWork* result = NULL;
-      {
-        threads::Mutexer lock( clientmutex_ );
-        if ( workload_.size() > 0 ) {
-          result = workload_.front();
-          workload_.pop_front();
+    void TCPListener::pushWork( SocketWork* work, SockState state ) {
+      if ( params_.edge_triggered ) {
+        work->pending |= static_cast<int>( state );
+        // if busy, the TCPServer owning the work requeues the pending events on releaseWork
+        if ( work->busy.exchange( true ) ) return;
+        state = static_cast<SockState>( work->pending.exchange( 0 ) );
+      }
+      // a one-shot registration is disarmed by the event, no need to remove the socket from epoll
+      work->state |= state;
+      log_Debug( "TCPListener::pushWork BaseSocket* socket " << work->socket->debugString() <<
+                 " state " << work->state );
+      work->queued_ns = steadyNanos();
+      work_q_sz_++;
+      // cannot fail as the queue capacity is at least maxconnections, but never drop work
+      while ( !workload_->push( work ) ) std::this_thread::yield();
+    }
+
+    bool TCPListener::assignWork( SocketWork* work ) {
+      TCPServer* server = nullptr;
+      if ( params_.worker_assignment == WorkerAssignment::LeastLoaded ) {
+        for ( auto srv : servers_ ) {
+          if ( srv->getRequestStop() || srv->hasStopped() ) continue;
+          if ( !server || srv->num_connections_ < server->num_connections_ ) server = srv;
+        }
+      } else {
+        for ( size_t i = 0; i < servers_.size() && !server; i++ ) {
+          auto i_server = servers_.begin();
+          std::advance( i_server, next_server_++ % servers_.size() );
+          if ( !(*i_server)->getRequestStop() && !(*i_server)->hasStopped() ) server = *i_server;
         }
       }
-      if ( result )
-        log_Debug( "TCPListener::popWork socket " << result->socket->debugString() <<
-                   " state " << result->state  << " sockmapstate=" << clients_[result->socket->getFD()].state );
-      return result;
+      if ( !server ) {
+        log_Warning( "TCPListener::assignWork no running TCPServer for socket " << work->socket->debugString() );
+        return false;
+      }
+      work->owner = server;
+      server->num_connections_++;
+      log_Debug( "TCPListener::assignWork socket " << work->socket->debugString() <<
+                 " to TCPServer " << server->getTID() );
+      server->assignWork( work );
+      return true;
     }
 
-    void TCPListener::releaseWork( const SocketWork &work ) {
-      log_Debug( "TCPListener::releaseWork socket " << work.socket->debugString() <<
-                 " state " << work.state  << " sockmapstate=" << clients_[work.socket->getFD()].state );
-      work_q_sz_--;
-      if ( work.state & TCPListener::SockState::Shut ) {
-        closeSocket( work.socket );
+    void TCPListener::releaseOwned( TCPServer* server ) {
+      if ( !params_.worker_owned || server->num_connections_ == 0 ) return;
+      for ( auto &work : clients_ ) {
+        if ( work.owner != server ) continue;
+        if ( params_.io_engine == IOEngine::URing ) {
+          closeSocket( &work );
+          continue;
+        }
+        // the epoll set of the stopped TCPServer goes with it, the new owner registers the connection in its own
+        work.owner = nullptr;
+        server->num_connections_--;
+        work.registered = false;
+        work.events = 0;
+        if ( !assignWork( &work ) ) closeSocket( &work );
+      }
+    }
+
+    size_t TCPListener::popWork( SocketWork** work, size_t n ) {
+      // only batch if there is more queued work than TCPServers, leave work for idle TCPServers otherwise
+      size_t servers = std::max( (size_t)1, num_servers_.load() );
+      n = std::min( n, std::max( (size_t)1, workload_->size() / servers ) );
+      size_t popped = workload_->pop( work, n );
+      if ( popped == 0 ) return 0;
+      uint64_t now = steadyNanos();
+      uint64_t wait = 0;
+      for ( size_t i = 0; i < popped; i++ ) {
+        wait += now - work[i]->queued_ns;
+        log_Debug( "TCPListener::popWork socket " << work[i]->socket->debugString() <<
+                   " state " << work[i]->state );
+      }
+      queue_wait_ns_ += wait;
+      queue_waits_ += popped;
+      return popped;
+    }
+
+    void TCPListener::releaseWork( SocketWork* work, SockState state ) {
+      log_Debug( "TCPListener::releaseWork socket " << work->socket->debugString() <<
+                 " state " << state  << " sockmapstate=" << work->state );
+      if ( state & TCPListener::SockState::Shut ) {
+        // in edge-triggered mode, busy remains true so that late events on the slot are ignored
+        closeSocket( work );
       } else {
-        threads::Mutexer lock( clientmutex_ );
-        pollAdd( work.socket, read_event_mask_ | hangup_event_mask_ );
-        clients_[work.socket->getFD()].state ^= work.state;
+        // update the state before re-arming, once armed the TCPListener owns the SocketWork
+        work->state ^= state;
+        if ( timeouts_enabled_ ) work->deadline = connectionDeadline( work );
+        if ( params_.edge_triggered ) {
+          work->armed = true;
+          if ( !work->registered ) {
+            work->registered = true;
+            pollAdd( work, read_event_mask_ );
+          }
+          releaseClaim( work );
+        } else {
+          uint32_t events = eventMask( work, read_event_mask_ | hangup_event_mask_ );
+          bool registered = work->registered;
+          work->registered = true;
+          // whilst rearming, the TCPListener leaves the armed connection alone. Once epoll_ctl succeeds, an event
+          // may hand the SocketWork to another TCPServer, so it is not touched after that but to end rearming.
+          work->rearming++;
+          work->armed = true;
+          if ( registered ) pollMod( work, events ); else pollAdd( work, events );
+          work->rearming--;
+        }
       }
+      work_q_sz_--;
+      signalResume();
     }
 
-    void TCPListener::closeSocket( BaseSocket *s ) {
-      int fd = -1;
-      {
-        threads::Mutexer lock( clientmutex_ );
-        fd = s->getFD();
-        if ( clients_[s->getFD()].data ) delete clients_[s->getFD()].data;
-        clients_.erase( fd );
-        s->close();
-        delete s;
+    void TCPListener::releaseClaim( SocketWork* work ) {
+      work->armed = true;
+      if ( !params_.edge_triggered ) return;
+      work->busy = false;
+      // events detected whilst busy were left pending for the holder
+      if ( work->pending && !work->busy.exchange( true ) ) {
+        work->armed = false;
+        work->state |= static_cast<SockState>( work->pending.exchange( 0 ) );
+        work->queued_ns = steadyNanos();
+        work_q_sz_++;
+        while ( !workload_->push( work ) ) std::this_thread::yield();
+        wakeServers( 1 );
       }
-      log_Debug( "TCPListener::closeSocket socket " << s << " fd=" << fd );
     }
 
-    void TCPListener::pollAdd( const BaseSocket* s, uint32_t events ) {
+    uint64_t TCPListener::connectionDeadline( SocketWork* work ) const {
+      uint64_t now = steadyNanos();
+      size_t timeout = params_.idle_timeout_ms;
+      if ( work->state & SockState::New ) {
+        timeout = params_.handshake_timeout_ms;
+      } else if ( work->data && ( work->data->getReadBuffer().getSize() || work->data->getOutputSize() ) ) {
+        // the request timeout runs from the first partial request, not from the last progress
+        if ( !work->request_ns ) work->request_ns = now;
+        if ( !params_.request_timeout_ms ) return 0;
+        return work->request_ns + params_.request_timeout_ms * 1000000;
+      }
+      work->request_ns = 0;
+      if ( !timeout ) return 0;
+      return now + timeout * 1000000;
+    }
+
+    void TCPListener::expireTimeouts() {
+      uint64_t now = steadyNanos();
+      size_t expired = 0;
+      wheel_->expire( now, [this,now,&expired]( uint64_t token ) {
+        SocketWork* work = &clients_[ token & 0xFFFFFFFF ];
+        // the connection has been closed, its entry is dropped
+        if ( work->generation != ( token >> 32 ) ) return;
+        uint64_t deadline = work->deadline;
+        if ( deadline > now ) {
+          wheel_->schedule( token, deadline );
+          return;
+        }
+        // claim the connection, if it is queued or in progress its deadline is set again by releaseWork
+        bool claimed = deadline &&
+                       ( params_.edge_triggered ? !work->busy.exchange( true ) : work->armed.exchange( false ) );
+        if ( !claimed ) {
+          wheel_->schedule( token, now + timeout_recheck_ns_ );
+          return;
+        }
+        // closed and reused between the check and the claim, the new connection has its own entry
+        if ( work->generation != ( token >> 32 ) ) {
+          releaseClaim( work );
+          return;
+        }
+        // a TCPServer still re-arming the connection in epoll has armed it, back off until it is done
+        if ( !params_.edge_triggered && work->rearming ) {
+          releaseClaim( work );
+          wheel_->schedule( token, now + timeout_recheck_ns_ );
+          return;
+        }
+        log_Debug( "TCPListener::expireTimeouts socket " << work->socket->debugString() << " timed out" );
+        work->deadline = 0;
+        if ( work->registered ) {
+          pollDel( work->socket );
+          work->registered = false;
+        }
+        count( counters().timeouts, 1 );
+        // close through the Shut path of a TCPServer, as if the peer hung up
+        work->state |= SockState::Shut;
+        work->queued_ns = steadyNanos();
+        work_q_sz_++;
+        while ( !workload_->push( work ) ) std::this_thread::yield();
+        expired++;
+      } );
+      wakeServers( expired );
+    }
+
+    void TCPListener::receiveListeners() {
+      handover_in_ = Handover::connect( params_.handover_path, handover_timeout_ms );
+      if ( handover_in_ < 0 ) return;
+      while ( true ) {
+        Handover::Tag tag;
+        int fd = -1;
+        common::SystemError error = Handover::receive( handover_in_, tag, fd );
+        if ( error != common::SystemError::ecOK ) {
+          log_Warning( "TCPListener handover from " << params_.handover_path << " failed : " << error.asString() );
+          for ( auto received : handover_fds_ ) ::close( received );
+          handover_fds_.clear();
+          ::close( handover_in_ );
+          handover_in_ = -1;
+          return;
+        }
+        if ( tag == Handover::Tag::Listen && fd >= 0 ) {
+          handover_fds_.push_back( fd );
+        } else if ( tag == Handover::Tag::Ready ) {
+          break;
+        } else if ( fd >= 0 ) {
+          ::close( fd );
+        }
+      }
+      log_Info( "TCPListener took over " << handover_fds_.size() << " listening sockets through " <<
+                params_.handover_path );
+    }
+
+    void TCPListener::sendListeners() {
+      int channel = ::accept4( handover_listen_fd_, nullptr, nullptr, SOCK_CLOEXEC );
+      if ( channel < 0 ) return;
+      if ( handing_over_ ) {
+        // handed over already
+        ::close( channel );
+        return;
+      }
+      struct timeval tv = { handover_timeout_ms / 1000, 0 };
+      setsockopt( channel, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv) );
+      common::SystemError error = Handover::send( channel, Handover::Tag::Listen, listen_socket_->getFD() );
+      for ( auto shard : shards_ ) {
+        if ( error == common::SystemError::ecOK )
+          error = Handover::send( channel, Handover::Tag::Listen, shard->listen_socket_->getFD() );
+      }
+      if ( error == common::SystemError::ecOK ) error = Handover::send( channel, Handover::Tag::Ready );
+      if ( error != common::SystemError::ecOK ) {
+        log_Warning( "TCPListener handover through " << params_.handover_path << " failed : " << error.asString() );
+        ::close( channel );
+        return;
+      }
+      log_Info( "TCPListener handed over " << shards_.size() + 1 << " listening sockets through " <<
+                params_.handover_path );
+      // connections are handed over as they become idle, a full channel must not block the TCPListener
+      if ( fcntl( channel, F_SETFL, fcntl( channel, F_GETFL ) | O_NONBLOCK ) < 0 )
+        throw_SystemException( "TCPListener::sendListeners fcntl failed", errno );
+      // the new instance listens on the path for its successor
+      epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, handover_listen_fd_, nullptr );
+      ::close( handover_listen_fd_ );
+      handover_listen_fd_ = -1;
+      handover_out_ = channel;
+      handing_over_ = true;
+      for ( auto shard : shards_ ) shard->handing_over_ = true;
+    }
+
+    void TCPListener::receiveConnections() {
+      while ( true ) {
+        Handover::Tag tag;
+        int fd = -1;
+        common::SystemError error = Handover::receive( handover_in_, tag, fd );
+        if ( error == common::SystemError::ecEAGAIN ) return;
+        if ( error != common::SystemError::ecOK ) {
+          // the previous instance has stopped
+          epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, handover_in_, nullptr );
+          ::close( handover_in_ );
+          handover_in_ = -1;
+          log_Info( "TCPListener handover through " << params_.handover_path << " completed" );
+          return;
+        }
+        if ( tag == Handover::Tag::Connection && fd >= 0 ) {
+          newConnection( new Socket( fd ), true );
+        } else if ( fd >= 0 ) {
+          ::close( fd );
+        }
+      }
+    }
+
+    common::SystemError TCPListener::sendHandover( Handover::Tag tag, int fd ) {
+      TCPListener* primary = isPrimary() ? this : primary_;
+      threads::Mutexer lock( primary->handover_mutex_ );
+      return Handover::send( primary->handover_out_, tag, fd );
+    }
+
+    void TCPListener::drainHandover() {
+      if ( listening_ ) {
+        listening_ = false;
+        if ( listen_ring_ ) {
+          epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, listen_ring_->getFD(), nullptr );
+          listen_ring_->prepCancel( 0, 1 );
+          listen_ring_->enter( 1, params_.listener_sleep_ms );
+          delete listen_ring_;
+          listen_ring_ = nullptr;
+        } else if ( !admission_paused_ || params_.shed_connections ) {
+          epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, listen_socket_->getFD(), nullptr );
+        }
+        if ( admission_paused_ ) {
+          count( counters().paused_us, ( steadyNanos() - paused_ns_ ) / 1000 );
+          admission_paused_ = false;
+        }
+        // the new instance holds the listening socket
+        listen_socket_->close();
+        handover_deadline_ns_ = steadyNanos() + (uint64_t)params_.handover_drain_s * 1000000000;
+      }
+      bool connections = params_.handover_connections && !params_.worker_owned && !params_.tls;
+      // the number of connections waiting for a next request, not handed over
+      size_t waiting = 0;
+      // worker-owned connections are never waiting in the TCPListener, they drain by closing
+      for ( auto &work : clients_ ) {
+        if ( params_.worker_owned ) break;
+        // claim the connection as expireTimeouts() does, only the claim holder may inspect its socket and data
+        if ( params_.edge_triggered ? work.busy.exchange( true ) : !work.armed.exchange( false ) ) continue;
+        if ( !work.socket ) {
+          // a free slot (edge-triggered mode only)
+          work.busy = false;
+          continue;
+        }
+        if ( ( !params_.edge_triggered && work.rearming ) || ( work.state & SockState::New ) || !work.data ||
+             work.data->getReadBuffer().getSize() || work.data->getOutputSize() ) {
+          releaseClaim( &work );
+          continue;
+        }
+        if ( !connections ) {
+          releaseClaim( &work );
+          waiting++;
+          continue;
+        }
+        common::SystemError error = sendHandover( Handover::Tag::Connection, work.socket->getFD() );
+        if ( error != common::SystemError::ecOK ) {
+          releaseClaim( &work );
+          if ( error != common::SystemError::ecEAGAIN )
+            log_Warning( "TCPListener::drainHandover failed to hand over connection : " << error.asString() );
+          break;
+        }
+        log_Debug( "TCPListener::drainHandover handed over socket " << work.socket->debugString() );
+        if ( work.registered ) {
+          pollDel( work.socket );
+          work.registered = false;
+        }
+        closeSocket( &work );
+      }
+      bool idle = waiting >= num_clients_;
+      if ( work_q_sz_ == 0 && ( num_clients_ == 0 || ( idle && !connections ) ||
+                                steadyNanos() > handover_deadline_ns_ ) ) {
+        log_Info( "TCPListener drained after handover, stopping" );
+        stop_server_ = true;
+      }
+    }
+
+    void TCPListener::closeSocket( SocketWork *work ) {
+      // stale tokens of the slot are told apart from here on
+      work->generation++;
+      log_Debug( "TCPListener::closeSocket fd=" << work->socket->getFD() );
+      TCPServer* owner = work->owner;
+      if ( owner ) owner->num_connections_--;
+      work->owner = nullptr;
+      if ( limiter_ ) limiter_->releaseConnection( work->limit_slot );
+      work->limit_slot = RateLimiter::no_slot;
+      if ( work->data ) delete work->data;
+      work->data = nullptr;
+      work->socket->close();
+      delete work->socket;
+      work->socket = nullptr;
+      num_clients_--;
+      free_slots_->push( (uint32_t)( work - clients_.data() ) );
+    }
+
+    void TCPListener::pollAdd( SocketWork* work, uint32_t events ) {
       struct epoll_event set_event;
       set_event.events = events;
-      set_event.data.fd = s->getFD();
-      int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, s->getFD(), &set_event );
-      if ( rc < 0 ) throw_SystemException( "TCPListener::pollAdd epoll_ctl failed socket " << s->debugString(), errno );
-      log_Debug( "TCPListener::pollAdd socket " << set_event.data.fd << " events=" << events );
+      set_event.data.u64 = pollToken( work );
+      // once armed, the SocketWork is owned by the TCPListener and must not be touched
+      int fd = work->socket->getFD();
+      int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &set_event );
+      count( counters().epoll_ctls, 1 );
+      if ( rc < 0 ) throw_SystemException( "TCPListener::pollAdd epoll_ctl failed socket " << fd, errno );
+      log_Debug( "TCPListener::pollAdd socket " << fd << " events=" << events );
     }
 
-    void TCPListener::pollMod( const BaseSocket* s, uint32_t events ) {
+    void TCPListener::pollMod( SocketWork* work, uint32_t events ) {
       struct epoll_event set_event;
       set_event.events = events;
-      set_event.data.fd = s->getFD();
-      int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_MOD, s->getFD(), &set_event );
-      if ( rc < 0 ) throw_SystemException( "TCPListener::pollMod epoll_ctl failed socket " << s->debugString(), errno );
-      log_Debug( "TCPListener::pollMod socket " << set_event.data.fd << " events=" << events );
+      set_event.data.u64 = pollToken( work );
+      // once armed, the SocketWork is owned by the TCPListener and must not be touched
+      int fd = work->socket->getFD();
+      int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_MOD, fd, &set_event );
+      count( counters().epoll_ctls, 1 );
+      if ( rc < 0 ) throw_SystemException( "TCPListener::pollMod epoll_ctl failed socket " << fd, errno );
+      log_Debug( "TCPListener::pollMod socket " << fd << " events=" << events );
+    }
+
+    uint32_t TCPListener::eventMask( const SocketWork* work, uint32_t base ) const {
+      if ( work->handshake_events ) return ( base & ~( EPOLLIN | EPOLLPRI | EPOLLOUT ) ) | work->handshake_events;
+      size_t queued = work->data ? work->data->getOutputSize() : 0;
+      if ( queued == 0 ) return base;
+      uint32_t events = base | EPOLLOUT;
+      if ( queued >= params_.output_high_water ) events &= ~( EPOLLIN | EPOLLPRI );
+      return events;
     }
 
     void TCPListener::pollDel( const BaseSocket* s ) {
@@ -481,33 +1413,122 @@ namespace dodo {
       set_event.events = 0;
       set_event.data.fd = s->getFD();
       int rc = epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, s->getFD(), &set_event );
+      count( counters().epoll_ctls, 1 );
       if ( rc < 0 ) throw_SystemException( "TCPListener::pollDel epoll_ctl failed socket " << s->debugString(), errno );
       log_Debug( "TCPListener::pollDel socket " << set_event.data.fd );
     }
 
-    void TCPListener::addServers() {
-      while ( work_q_sz_ > servers_.size() && servers_.size() < params_.maxservers  ) {
+    void TCPListener::scaleServers() {
+      if ( params_.worker_owned ) return;
+      uint64_t now = steadyNanos();
+      if ( now - scale_time_ns_ < (uint64_t)params_.scale_interval_ms * 1000000 ) return;
+      double interval = (double)( now - scale_time_ns_ ) / 1.0E9;
+      scale_time_ns_ = now;
+      uint64_t busy_ns = 0;
+      for ( auto srv : servers_ ) busy_ns += srv->busy_ns_.exchange( 0 );
+      uint64_t waits = queue_waits_.exchange( 0 );
+      uint64_t wait_ns = queue_wait_ns_.exchange( 0 );
+      ScalingPolicy::Sample &sample = scale_sample_;
+      sample.interval_s = interval;
+      sample.active = num_servers_;
+      sample.minservers = params_.minservers;
+      sample.maxservers = params_.maxservers;
+      sample.queued = work_q_sz_;
+      sample.queue_wait_us = waits ? (double)wait_ns / (double)waits / 1000.0 : 0;
+      sample.utilisation = std::min( 1.0, (double)busy_ns / 1.0E9 / interval / (double)std::max( (size_t)1, sample.active ) );
+      sample.throughput = (double)waits / interval;
+      size_t target = std::clamp( scaling_policy_->decide( sample ), params_.minservers, params_.maxservers );
+      if ( target == sample.active ) return;
+      std::string name = "TCPListener";
+      if ( params_.listener_shards > 1 ) name = common::Puts() << "TCPListener shard " << shard_index_;
+      log_Statistics( common::Puts::setprecision(2) << name <<
+                      " scale " << sample.active << " -> " << target << " servers (" <<
+                      scaling_policy_->getReason() << ") qwait=" << sample.queue_wait_us <<
+                      "us util=" << sample.utilisation * 100.0 << "% throughput=" << sample.throughput << "/s" );
+      count( target > sample.active ? counters().scale_ups : counters().scale_downs, 1 );
+      setActiveServers( target );
+    }
+
+    void TCPListener::setActiveServers( size_t target ) {
+      size_t active = 0;
+      for ( auto srv : servers_ ) if ( !srv->parked_ ) active++;
+      // resume the most recently parked TCPServers first, then start new ones
+      for ( auto i_server = servers_.rbegin(); i_server != servers_.rend() && active < target; ++i_server ) {
+        if ( (*i_server)->parked_ ) {
+          (*i_server)->parked_ = false;
+          wakeServer( *i_server );
+          active++;
+          log_Debug( "TCPListener::setActiveServers resumed TCPServer " << (*i_server)->getTID() );
+        }
+      }
+      while ( active < target ) {
         TCPServer* add_server = init_server_->addServer();
-        servers_.push_back(add_server);
+        servers_.push_back( add_server );
+        registerServer( add_server );
         add_server->start();
-        log_Debug( "TCPListener::addServers +1" );
+        active++;
+        log_Debug( "TCPListener::setActiveServers started TCPServer" );
+      }
+      // park the most recently started TCPServers, never the initial TCPServer
+      for ( auto i_server = servers_.rbegin(); i_server != servers_.rend() && active > target; ++i_server ) {
+        if ( *i_server != init_server_ && !(*i_server)->parked_ ) {
+          (*i_server)->parked_ = true;
+          // an idle TCPServer must not be woken for work any more
+          wakeServer( *i_server );
+          active--;
+          log_Debug( "TCPListener::setActiveServers parked TCPServer " << (*i_server)->getTID() );
+        }
       }
+      num_servers_ = active;
+      num_parked_ = servers_.size() - active;
     }
 
-    void TCPListener::throttle() {
-      if ( work_q_sz_ > params_.maxqdepth ) {
-        unsigned long last_pending =  work_q_sz_;
-        unsigned int c = 0;
-        while ( work_q_sz_ >= last_pending && c++ < params_.cycle_max_throttles ) {
-          std::this_thread::sleep_for( std::chrono::microseconds( params_.throttle_sleep_us ) );
-          {
-            threads::Mutexer lock( stats_mutex_ );
-            last_stats_.throttles++;
-          }
+    void TCPListener::admitConnections() {
+      if ( params_.worker_owned || !listening_ ) return;
+      if ( !admission_paused_ && work_q_sz_ > params_.maxqdepth ) {
+        admission_paused_ = true;
+        paused_ns_ = steadyNanos();
+        if ( !params_.shed_connections ) {
+          // leave new connections in the kernel backlog
+          if ( epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, listen_socket_->getFD(), nullptr ) < 0 )
+            throw_SystemException( "TCPListener::admitConnections epoll_ctl failed", errno );
         }
+        count( counters().admission_pauses, 1 );
+        log_Debug( "TCPListener::admitConnections paused at queue depth " << work_q_sz_ );
+      } else if ( admission_paused_ ) {
+        // account the paused time as it passes, so that it falls in the right statistics interval
+        uint64_t now = steadyNanos();
+        count( counters().paused_us, ( now - paused_ns_ ) / 1000 );
+        paused_ns_ = now;
+        if ( work_q_sz_ > resume_qdepth_ ) return;
+        if ( !params_.shed_connections ) {
+          struct epoll_event set_event;
+          set_event.events = EPOLLIN | EPOLLPRI;
+          set_event.data.u64 = listen_token_;
+          if ( epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, listen_socket_->getFD(), &set_event ) < 0 )
+            throw_SystemException( "TCPListener::admitConnections epoll_ctl failed", errno );
+        }
+        admission_paused_ = false;
+        log_Debug( "TCPListener::admitConnections resumed at queue depth " << work_q_sz_ );
       }
     }
 
+    /**
+     * Log the percentiles of a latency Histogram in microseconds.
+     * @param name The name of the latency.
+     * @param histogram The Histogram, in nanoseconds.
+     */
+    static void logLatency( const std::string &name, const common::Histogram &histogram ) {
+      uint64_t count = histogram.getCount();
+      if ( count == 0 ) return;
+      log_Statistics( common::Puts::setprecision(1) << "TCPListener latency " << name << " n=" << count <<
+                      " p50=" << (double)histogram.getPercentile( 50.0 ) / 1000.0 <<
+                      "us p90=" << (double)histogram.getPercentile( 90.0 ) / 1000.0 <<
+                      "us p99=" << (double)histogram.getPercentile( 99.0 ) / 1000.0 <<
+                      "us p999=" << (double)histogram.getPercentile( 99.9 ) / 1000.0 <<
+                      "us max=" << (double)histogram.getMax() / 1000.0 << "us" );
+    }
+
     void TCPListener::logStats() {
       struct timeval l_now;
       {
@@ -521,20 +1542,70 @@ namespace dodo {
                        " limited " << event_maxconnections_reached_ << " times since last stats" );
           event_maxconnections_reached_ = 0;
         }
-        log_Statistics( "TCPListener #clients=" <<
-                        clients_.size() << " #servers=" << servers_.size() << " #queued=" << work_q_sz_ <<
-                        " recv=" << (double)( last_stats_.received - prev_stats_.received ) /
-                          common::getSecondDiff(prev_stat_time_,stat_time_ ) / 1024.0 <<
-                        "KiB/s sent=" << (double)( last_stats_.sent - prev_stats_.sent ) /
-                          common::getSecondDiff(prev_stat_time_,stat_time_ ) / 1024.0 <<
-                        "KIB/s conn=" << (double)( last_stats_.connections - prev_stats_.connections ) /
-                          common::getSecondDiff(prev_stat_time_,stat_time_ ) <<
-                        "/s req=" << (double)( last_stats_.requests - prev_stats_.requests ) /
-                          common::getSecondDiff(prev_stat_time_,stat_time_) <<
-                        "/s throttle=" << (double)( last_stats_.throttles - prev_stats_.throttles ) /
-                          common::getSecondDiff(prev_stat_time_,stat_time_) << "/s" );
+        {
+          Latencies latencies = retired_latencies_;
+          for ( auto srv : servers_ ) latencies += srv->latencies_;
+          threads::Mutexer lock( stats_mutex_ );
+          latencies_ = latencies;
+        }
+        Stats stats;
+        if ( isPrimary() ) {
+          // aggregate over all shards, the rates are over the interval that just passed
+          double seconds = common::getSecondDiff( stat_time_, l_now );
+          stats = getStats();
+          size_t num_clients = getClientCount();
+          size_t num_servers = num_servers_;
+          size_t num_parked = num_parked_;
+          unsigned long long num_queued = work_q_sz_;
+          for ( auto shard : shards_ ) {
+            stats += shard->getStats();
+            num_clients += shard->getClientCount();
+            num_servers += shard->num_servers_;
+            num_parked += shard->num_parked_;
+            num_queued += shard->work_q_sz_;
+          }
+          log_Statistics( "TCPListener #clients=" <<
+                          num_clients << " #servers=" << num_servers << " #parked=" << num_parked <<
+                          " #queued=" << num_queued <<
+                          " recv=" << (double)( stats.received - prev_stats_.received ) / seconds / 1024.0 <<
+                          "KiB/s sent=" << (double)( stats.sent - prev_stats_.sent ) / seconds / 1024.0 <<
+                          "KIB/s conn=" << (double)( stats.connections - prev_stats_.connections ) / seconds <<
+                          "/s req=" << (double)( stats.requests - prev_stats_.requests ) / seconds <<
+                          "/s pause=" << (double)( stats.admission_pauses - prev_stats_.admission_pauses ) / seconds <<
+                          "/s paused=" << (double)( stats.paused_us - prev_stats_.paused_us ) / 1.0E4 / seconds <<
+                          "% shed=" << (double)( stats.shed - prev_stats_.shed ) / seconds <<
+                          "/s limited_conn=" <<
+                          (double)( stats.limited_connections - prev_stats_.limited_connections ) / seconds <<
+                          "/s limited_req=" <<
+                          (double)( stats.limited_requests - prev_stats_.limited_requests ) / seconds <<
+                          "/s timeout=" << (double)( stats.timeouts - prev_stats_.timeouts ) / seconds <<
+                          "/s hs_fail=" <<
+                          (double)( stats.handshake_failures - prev_stats_.handshake_failures ) / seconds <<
+                          "/s epoll_ctl=" << (double)( stats.epoll_ctls - prev_stats_.epoll_ctls ) / seconds <<
+                          "/s io_uring_enter=" << (double)( stats.uring_enters - prev_stats_.uring_enters ) / seconds <<
+                          "/s scale_up=" << stats.scale_ups - prev_stats_.scale_ups <<
+                          " scale_down=" << stats.scale_downs - prev_stats_.scale_downs );
+          Latencies latencies = getLatencies();
+          for ( auto shard : shards_ ) latencies += shard->getLatencies();
+          Latencies interval = latencies;
+          interval -= prev_latencies_;
+          prev_latencies_ = latencies;
+          logLatency( "queue-wait", interval.queue_wait );
+          logLatency( "handshake", interval.handshake );
+          logLatency( "read-socket", interval.read_socket );
+          logLatency( "total", interval.total );
+          if ( params_.tls ) {
+            TLSContext::SessionStats tls = params_.tls->getSessionStats();
+            log_Statistics( "TCPListener TLS full=" << (double)( tls.full - prev_tls_stats_.full ) / seconds <<
+                            "/s resumed=" << (double)( tls.resumed - prev_tls_stats_.resumed ) / seconds <<
+                            "/s sessions=" << tls.cached );
+            prev_tls_stats_ = tls;
+          }
+        }
+        std::string name = "TCPListener";
+        if ( params_.listener_shards > 1 ) name = common::Puts() << "TCPListener shard " << shard_index_;
         log_Statistics( common::Puts::setprecision(2) <<
-                        "TCPListener ucpu=" << getLastUserCPU() <<
+                        name << " ucpu=" << getLastUserCPU() <<
                         " scpu=" << getLastSysCPU() <<
                         " minflt=" << getLastMinFltRate() << "/s" <<
                         " majflt=" << getLastMajFltRate() << "/s" <<
@@ -542,11 +1613,13 @@ namespace dodo {
                         " bo=" << getLastBlkOutRate() << "/s" <<
                         " yield=" << getLastVCtx() << "/s" <<
                         " ctxsw=" << getLastICtx() << "/s" <<
-                        " maxrss=" << getMaxRSS() );
+                        " maxrss=" << getMaxRSS() <<
+                        " qwait=" << scale_sample_.queue_wait_us << "us" <<
+                        " util=" << scale_sample_.utilisation * 100.0 << "%" );
         for ( auto srv : servers_ ) {
          log_Statistics( common::Puts::setprecision(2) <<
                          "TCPServer id " << srv->getTID() <<
-                         (srv->isBusy()?" busy-":" idle-") << srv->getState() <<
+                         (srv->isParked()?" parked-":srv->isBusy()?" busy-":" idle-") << srv->getState() <<
                          " ucpu=" << srv->getLastUserCPU() <<
                          " scpu=" << srv->getLastSysCPU() <<
                          " minflt=" << srv->getLastMinFltRate() << "/s" <<
@@ -557,14 +1630,15 @@ namespace dodo {
                          " ctxsw=" << srv->getLastICtx() << "/s" );
         }
         prev_stat_time_ = stat_time_;
-        {
-          threads::Mutexer lock( stats_mutex_ );
-          prev_stats_ = last_stats_;
-        }
+        if ( isPrimary() ) prev_stats_ = stats;
         gettimeofday( &stat_time_, NULL );
       }
     }
 
+    size_t TCPListener::getClientCount() {
+      return num_clients_;
+    }
+
     void TCPListener::cleanStoppedServers() {
       struct timeval l_now;
       {
@@ -573,7 +1647,6 @@ namespace dodo {
       }
       if ( server_stopped_check_time_.tv_sec < l_now.tv_sec - 4 ) {
         gettimeofday( &server_stopped_check_time_, NULL );
-        size_t num_stopped = 0;
         std::list<TCPServer*>::iterator i_server = servers_.begin();
         while ( i_server != servers_.end() ) {
           if ( *i_server != init_server_ ) {
@@ -581,20 +1654,13 @@ namespace dodo {
               (*i_server)->wait();
               TCPServer* thisserver = (*i_server);
               i_server = servers_.erase(i_server);
-              delete thisserver;
               log_Debug( "TCPListener::run deleted stopped TCPServer " << common::Puts::hex() <<
-                         (*i_server)->getId() << common::Puts::dec() );
+                         thisserver->getId() << common::Puts::dec() );
+              retired_latencies_ += thisserver->latencies_;
+              releaseOwned( thisserver );
+              unregisterServer( thisserver );
+              delete thisserver;
             } else {
-              if ( num_stopped == 0 &&
-                   servers_.size() > params_.minservers &&
-                   (*i_server)->getIdleSeconds() > params_.server_idle_ttl_s &&
-                   !(*i_server)->isBusy() ) {
-                  (*i_server)->requestStop();
-                  cv_signal_.notify_all();
-                  num_stopped--;
-                  log_Debug( "TCPListener::run stop idle TCPServer " << common::Puts::hex() <<
-                             (*i_server)->getId() << common::Puts::dec() );
-              }
               ++i_server;
             }
           } else {
@@ -602,16 +1668,25 @@ namespace dodo {
               init_server_->wait();
               i_server = servers_.erase(i_server);
               TCPServer* new_server = init_server_->addServer();
+              retired_latencies_ += init_server_->latencies_;
+              registerServer( new_server );
               new_server->start();
+              servers_.push_back( new_server );
+              releaseOwned( init_server_ );
+              unregisterServer( init_server_ );
               delete init_server_;
               init_server_ = new_server;
-              servers_.push_back( init_server_ );
               log_Debug( "TCPListener::run replaced stopped initial TCPServer " << common::Puts::hex() <<
                          init_server_->getTID() << common::Puts::dec() );
+              continue;
             }
             ++i_server;
           }
         }
+        size_t active = 0;
+        for ( auto srv : servers_ ) if ( !srv->parked_ ) active++;
+        num_servers_ = active;
+        num_parked_ = servers_.size() - active;
       }
     }
 
@@ -21,12 +21,19 @@
  */
 
 #include <network/tcpserver.hpp>
+#include <network/tlssocket.hpp>
 #include <common/logger.hpp>
 #include <common/util.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
 
 
 namespace dodo {
@@ -37,13 +44,54 @@ namespace dodo {
       listener_(listener),
       request_stop_(false),
       has_stopped_(false),
-      busy_(false) {
+      busy_(false),
+      parked_(false),
+      busy_ns_(0),
+      wakeup_(0),
+      counters_(nullptr),
+      wheel_(nullptr),
+      spin_(0),
+      epoll_fd_(-1),
+      event_fd_(-1),
+      inbox_(nullptr),
+      num_connections_(0),
+      ring_(nullptr) {
       gettimeofday( &last_active_, NULL );
+      if ( listener_.params_.worker_owned ) {
+        inbox_ = new threads::MPMCQueue<TCPListener::SocketWork*>( listener_.params_.maxconnections );
+        event_fd_ = eventfd( 0, EFD_NONBLOCK );
+        if ( event_fd_ < 0 ) throw_SystemException( "TCPServer::TCPServer eventfd failed", errno );
+        // the io_uring engine polls the eventfd in the ring, created by runURing
+        if ( listener_.params_.io_engine == TCPListener::IOEngine::URing ) return;
+        epoll_fd_ = epoll_create1( 0 );
+        if ( epoll_fd_ < 0 ) throw_SystemException( "TCPServer::TCPServer epoll_create1 failed", errno );
+        struct epoll_event set_event;
+        set_event.events = EPOLLIN;
+        set_event.data.ptr = nullptr;
+        if ( epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, event_fd_, &set_event ) < 0 )
+          throw_SystemException( "TCPServer::TCPServer epoll_ctl failed", errno );
+      }
+    }
+
+    TCPServer::~TCPServer() {
+      if ( epoll_fd_ >= 0 ) close( epoll_fd_ );
+      if ( event_fd_ >= 0 ) close( event_fd_ );
+      if ( inbox_ ) delete inbox_;
+      if ( wheel_ ) delete wheel_;
     }
 
     void TCPServer::run() {
+      TCPListener::thread_counters_ = counters_;
+      if ( listener_.params_.io_engine == TCPListener::IOEngine::URing ) {
+        runURing();
+        return;
+      }
+      if ( listener_.params_.worker_owned ) {
+        runOwned();
+        return;
+      }
       has_stopped_ = false;
-      network::TCPListener::SocketWork* sockmap = 0;
+      std::vector<TCPListener::SocketWork*> work( listener_.params_.pop_batch );
       struct timeval now, last_snap;
       gettimeofday( &last_active_, NULL );
       gettimeofday( &now, NULL );
@@ -56,109 +104,26 @@ namespace dodo {
 
             busy_ = true;
             gettimeofday( &last_active_, NULL );
+            uint64_t busy_start = TCPListener::steadyNanos();
 
             state_ = ssAwoken;
 
+            size_t popped = 0;
             do {
-
-              sockmap = listener_.popWork();
-
-              if ( sockmap ) {
-
-                log_Debug( "TCPServer::run notify wakeup " <<
-                           sockmap->socket->debugString() << " state " << sockmap->state );
-
-                TCPListener::SockState completion_state = TCPListener::SockState::None;
-
-                if ( sockmap->state & TCPListener::SockState::New ) {
-                  log_Debug( "TCPServer::run ssNew " <<
-                             sockmap->socket->debugString() << " state " << sockmap->state );
-                  state_ = ssHandshake;
-                  try {
-                    bool ok = false;
-                    ssize_t received = 0;
-                    ssize_t sent = 0;
-                    ok = handShake( sockmap->socket, received, sent );
-                    listener_.addReceivedSentBytes( received, sent );
-                    state_ = ssHandshakeDone;
-                    completion_state |= TCPListener::SockState::New;
-                    if ( !ok ) {
-                      completion_state |= TCPListener::SockState::Shut;
-                      log_Error( "TCPServer::run handshake failure socket " <<
-                                sockmap->socket->debugString() );
-                    }
-                  }
-                  catch ( std::exception &e ) {
-                    log_Error( "TCPServer::run exception in handshake " << e.what()
-                              << " socket " << sockmap->socket->debugString() );
-                  }
-                  catch ( ... ) {
-                    log_Error( "TCPServer::run unhandled exception in handshake " <<
-                              sockmap->socket->debugString() );
-                  }
-                }
-
-                if ( sockmap->state & TCPListener::SockState::Read ) {
-                  log_Debug( "TCPServer::run ssRead " <<
-                             sockmap->socket->debugString() << " state " << sockmap->state );
-                  state_ = ssReadSocket;
-                  try {
-                    bool ok = false;
-                    ssize_t received = 0;
-                    ssize_t sent = 0;
-
-                    common::SystemError error = sockmap->data->readBuffer( sockmap->socket, received );
-                    ok = (error == common::SystemError::ecOK);
-                    error = readSocket( *sockmap, sent );
-                    ok = ok && ( error == common::SystemError::ecOK || error == common::SystemError::ecEAGAIN );
-                    listener_.addReceivedSentBytes( received, sent );
-                    state_ = ssReadSocketDone;
-                    completion_state |= TCPListener::SockState::Read;
-                    if ( !ok ) {
-                      completion_state |= TCPListener::SockState::Shut;
-                      if ( error != common::SystemError::ecECONNABORTED ) {
-                        log_Error( "TCPServer::run readSocket failure socket " <<
-                                   sockmap->socket->getFD() << " client " <<
-                                   sockmap->socket->getPeerAddress().asString(true) );
-                        }
-                    }
-                  }
-                  catch ( std::exception &e ) {
-                     log_Error( "TCPServer::run exception in ssReadSocket " << e.what()
-                                << " socket " << sockmap->socket->getFD() );
-                  }
-                  catch ( ... ) {
-                     log_Error( "TCPServer::run unhandled exception in ssReadSocket socket " <<
-                                sockmap->socket->getFD() );
-                  }
-                  state_ = ssReadSocketDone;
-                }
-
-                if ( sockmap->state & TCPListener::SockState::Shut ) {
-                  log_Debug( "TCPServer::run ssShut " <<
-                             sockmap->socket->debugString() << " state " << sockmap->state );
-                  state_ = ssShutdown;
-                  try {
-                    shutDown( sockmap->socket );
-                    state_ = ssShutdownDone;
-                    completion_state |= TCPListener::SockState::Shut;
-                  }
-                  catch ( std::exception &e ) {
-                     log_Error( "TCPServer::run exception in ssShutdown " << e.what()
-                                << " socket " << sockmap->socket->debugString() );
-                  }
-                  catch ( ... ) {
-                     log_Error( "TCPServer::run unhandled exception in ssShutdown " <<
-                                sockmap->socket->debugString() );
-                  }
-                }
+              popped = listener_.popWork( work.data(), work.size() );
+              uint64_t popped_ns = TCPListener::steadyNanos();
+              for ( size_t i = 0; i < popped; i++ ) {
+                uint64_t queued_ns = work[i]->queued_ns;
+                latencies_.queue_wait.record( popped_ns - queued_ns );
+                TCPListener::SockState completion_state = serviceWork( work[i] );
                 state_ = ssReleaseWork;
-                listener_.releaseWork( { sockmap->socket, completion_state } );
+                latencies_.total.record( TCPListener::steadyNanos() - queued_ns );
+                listener_.releaseWork( work[i], completion_state );
                 state_ = ssReleaseWorkDone;
               }
+            } while ( popped && !parked_ );
 
-            } while ( sockmap );
-
+            busy_ns_ += TCPListener::steadyNanos() - busy_start;
             busy_ = false;
             state_ = ssWait;
           }
@@ -180,6 +145,466 @@ namespace dodo {
       has_stopped_ = true;
     }
 
+    TCPListener::SockState TCPServer::serviceWork( TCPListener::SocketWork* sockmap, bool buffered ) {
+      log_Debug( "TCPServer::serviceWork " <<
+                 sockmap->socket->debugString() << " state " << sockmap->state );
+
+      TCPListener::SockState completion_state = TCPListener::SockState::None;
+      // true whilst the TLS handshake waits for the socket, the connection then remains SockState::New
+      bool handshaking = false;
+
+      if ( sockmap->state & TCPListener::SockState::New ) {
+        log_Debug( "TCPServer::serviceWork ssNew " <<
+                   sockmap->socket->debugString() << " state " << sockmap->state );
+        state_ = ssHandshake;
+        try {
+          bool ok = false;
+          ssize_t received = 0;
+          ssize_t sent = 0;
+          if ( !sockmap->handshake_ns ) sockmap->handshake_ns = TCPListener::steadyNanos();
+          common::SystemError error = common::SystemError::ecOK;
+          if ( listener_.params_.tls ) error = static_cast<TLSSocket*>( sockmap->socket )->acceptTLS();
+          if ( error == common::SystemError::ecSSL_ERROR_WANT_READ ||
+               error == common::SystemError::ecSSL_ERROR_WANT_WRITE ) {
+            // resumed on the next event, the Read and Write events were consumed by the handshake
+            handshaking = true;
+            sockmap->handshake_events = error == common::SystemError::ecSSL_ERROR_WANT_READ ? EPOLLIN : EPOLLOUT;
+            if ( sockmap->state & TCPListener::SockState::Read ) completion_state |= TCPListener::SockState::Read;
+            if ( sockmap->state & TCPListener::SockState::Write ) completion_state |= TCPListener::SockState::Write;
+            ok = true;
+          } else {
+            sockmap->handshake_events = 0;
+            if ( error == common::SystemError::ecOK ) ok = handShake( sockmap->socket, received, sent );
+            latencies_.handshake.record( TCPListener::steadyNanos() - sockmap->handshake_ns );
+            completion_state |= TCPListener::SockState::New;
+          }
+          listener_.addReceivedSentBytes( received, sent );
+          state_ = ssHandshakeDone;
+          if ( !ok ) {
+            completion_state |= TCPListener::SockState::Shut;
+            TCPListener::count( counters_->handshake_failures, 1 );
+            log_Error( "TCPServer::serviceWork handshake failure socket " <<
+                      sockmap->socket->debugString() );
+          }
+        }
+        catch ( std::exception &e ) {
+          log_Error( "TCPServer::serviceWork exception in handshake " << e.what()
+                    << " socket " << sockmap->socket->debugString() );
+        }
+        catch ( ... ) {
+          log_Error( "TCPServer::serviceWork unhandled exception in handshake " <<
+                    sockmap->socket->debugString() );
+        }
+      }
+
+      if ( !handshaking && ( sockmap->state & TCPListener::SockState::Write ) ) {
+        ssize_t sent = 0;
+        common::SystemError error = common::SystemError::ecOK;
+        try {
+          error = sockmap->data->flushOutput( sockmap->socket, sent );
+        }
+        catch ( std::exception &e ) {
+          log_Error( "TCPServer::serviceWork exception in flushOutput " << e.what()
+                     << " socket " << sockmap->socket->getFD() );
+          error = common::SystemError::ecEPIPE;
+        }
+        listener_.addReceivedSentBytes( 0, sent );
+        completion_state |= TCPListener::SockState::Write;
+        if ( error != common::SystemError::ecOK && error != common::SystemError::ecEAGAIN ) {
+          log_Debug( "TCPServer::serviceWork flushOutput failed socket " << sockmap->socket->getFD() <<
+                     " : " << error.asString() );
+          completion_state |= TCPListener::SockState::Shut;
+        }
+      }
+
+      // stop reading from a connection that does not drain its output (Params.output_high_water), the Read
+      // state remains set and is handled once the output has been drained below the mark
+      if ( !handshaking && ( sockmap->state & TCPListener::SockState::Read ) &&
+           !( completion_state & TCPListener::SockState::Shut ) &&
+           queuedOutput( sockmap ) < listener_.params_.output_high_water ) {
+        log_Debug( "TCPServer::serviceWork ssRead " <<
+                   sockmap->socket->debugString() << " state " << sockmap->state );
+        state_ = ssReadSocket;
+        try {
+          bool ok = false;
+          ssize_t received = 0;
+          ssize_t sent = 0;
+
+          common::SystemError error = common::SystemError::ecOK;
+          uint64_t start_ns = TCPListener::steadyNanos();
+          if ( !buffered ) error = sockmap->data->readBuffer( sockmap->socket, received );
+          ok = (error == common::SystemError::ecOK || error == common::SystemError::ecEAGAIN);
+          error = readSocket( *sockmap, sent );
+          latencies_.read_socket.record( TCPListener::steadyNanos() - start_ns );
+          ok = ok && ( error == common::SystemError::ecOK || error == common::SystemError::ecEAGAIN );
+          listener_.addReceivedSentBytes( received, sent );
+          state_ = ssReadSocketDone;
+          completion_state |= TCPListener::SockState::Read;
+          if ( !ok ) {
+            completion_state |= TCPListener::SockState::Shut;
+            if ( error != common::SystemError::ecECONNABORTED ) {
+              log_Error( "TCPServer::serviceWork readSocket failure socket " <<
+                         sockmap->socket->getFD() << " client " <<
+                         sockmap->socket->getPeerAddress().asString(true) );
+              }
+          }
+        }
+        catch ( std::exception &e ) {
+           log_Error( "TCPServer::serviceWork exception in ssReadSocket " << e.what()
+                      << " socket " << sockmap->socket->getFD() );
+        }
+        catch ( ... ) {
+           log_Error( "TCPServer::serviceWork unhandled exception in ssReadSocket socket " <<
+                      sockmap->socket->getFD() );
+        }
+        state_ = ssReadSocketDone;
+      }
+
+      if ( sockmap->state & TCPListener::SockState::Shut ) {
+        log_Debug( "TCPServer::serviceWork ssShut " <<
+                   sockmap->socket->debugString() << " state " << sockmap->state );
+        state_ = ssShutdown;
+        try {
+          shutDown( sockmap->socket );
+          state_ = ssShutdownDone;
+          completion_state |= TCPListener::SockState::Shut;
+        }
+        catch ( std::exception &e ) {
+           log_Error( "TCPServer::serviceWork exception in ssShutdown " << e.what()
+                      << " socket " << sockmap->socket->debugString() );
+        }
+        catch ( ... ) {
+           log_Error( "TCPServer::serviceWork unhandled exception in ssShutdown " <<
+                      sockmap->socket->debugString() );
+        }
+      }
+      return completion_state;
+    }
+
+    void TCPServer::runOwned() {
+      has_stopped_ = false;
+      struct epoll_event events[listener_.params_.pollbatch];
+      struct timeval now, last_snap;
+      gettimeofday( &last_active_, NULL );
+      snapRUsage();
+      gettimeofday( &last_snap, NULL );
+      state_ = ssWait;
+      int poll_timeout = listener_.params_.listener_sleep_ms;
+      if ( listener_.timeouts_enabled_ ) {
+        wheel_ = new TimerWheel( (uint64_t)TCPListener::timeout_tick_ms * 1000000, TCPListener::steadyNanos() );
+        poll_timeout = std::min( poll_timeout, TCPListener::timeout_tick_ms );
+      }
+      try {
+        do {
+          int rc = epoll_wait( epoll_fd_, events, listener_.params_.pollbatch, poll_timeout );
+          if ( rc < 0 && errno != EINTR ) throw_SystemException( "TCPServer::runOwned epoll_wait failed", errno );
+          if ( rc > 0 ) {
+            busy_ = true;
+            gettimeofday( &last_active_, NULL );
+            state_ = ssAwoken;
+            ssize_t requests = 0;
+            for ( int i = 0; i < rc; i++ ) {
+              if ( events[i].data.ptr == nullptr ) {
+                uint64_t count = 0;
+                if ( read( event_fd_, &count, sizeof(count) ) < 0 && errno != EAGAIN )
+                  throw_SystemException( "TCPServer::runOwned eventfd read failed", errno );
+                TCPListener::SocketWork* work = nullptr;
+                while ( inbox_->pop( work ) ) {
+                  if ( wheel_ ) {
+                    wheel_->schedule( listener_.pollToken( work ),
+                                      TCPListener::steadyNanos() + listener_.timeout_recheck_ns_ );
+                  }
+                  serviceOwned( work );
+                }
+              } else {
+                TCPListener::SocketWork* work = static_cast<TCPListener::SocketWork*>( events[i].data.ptr );
+                if ( events[i].events & ( EPOLLIN | EPOLLPRI ) ) {
+                  if ( listener_.admitRequest( work ) )
+                    work->state |= TCPListener::SockState::Read;
+                  else
+                    work->state |= TCPListener::SockState::Shut;
+                  requests++;
+                }
+                if ( events[i].events & EPOLLOUT ) work->state |= TCPListener::SockState::Write;
+                if ( events[i].events & ( EPOLLRDHUP | EPOLLERR | EPOLLHUP ) ) work->state |= TCPListener::SockState::Shut;
+                serviceOwned( work );
+              }
+            }
+            listener_.addRequests( requests );
+            busy_ = false;
+            state_ = ssWait;
+          }
+          if ( wheel_ ) expireOwned();
+          gettimeofday( &now, NULL );
+          if ( common::getSecondDiff( last_snap, now ) > 0.2 ) {
+            snapRUsage();
+            gettimeofday( &last_snap, NULL );
+          }
+        } while ( !request_stop_ );
+        log_Debug( "TCPServer::runOwned stopping" );
+      }
+      catch ( const std::exception &e ) {
+        log_Fatal( "TCPServer::runOwned caught unhandled exception " << e.what() );
+      }
+      catch ( ... ) {
+        log_Fatal( "TCPServer::runOwned caught std::exception " );
+      }
+      has_stopped_ = true;
+    }
+
+    void TCPServer::serviceOwned( TCPListener::SocketWork* work ) {
+      TCPListener::SockState completion_state = serviceWork( work );
+      state_ = ssReleaseWork;
+      if ( completion_state & TCPListener::SockState::Shut ) {
+        listener_.closeSocket( work );
+      } else {
+        work->state ^= completion_state;
+        // level-triggered, so EPOLLOUT is only registered whilst output is queued
+        uint32_t events = listener_.eventMask( work, EPOLLIN | EPOLLPRI | EPOLLRDHUP | EPOLLERR | EPOLLHUP );
+        if ( !work->registered || events != work->events ) {
+          struct epoll_event set_event;
+          set_event.events = events;
+          set_event.data.ptr = work;
+          if ( epoll_ctl( epoll_fd_, work->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, work->socket->getFD(), &set_event ) < 0 )
+            throw_SystemException( "TCPServer::serviceOwned epoll_ctl failed socket " << work->socket->debugString(), errno );
+          TCPListener::count( counters_->epoll_ctls, 1 );
+          work->registered = true;
+          work->events = events;
+        }
+        if ( wheel_ ) work->deadline = listener_.connectionDeadline( work );
+      }
+      state_ = ssReleaseWorkDone;
+    }
+
+    void TCPServer::expireOwned() {
+      uint64_t now = TCPListener::steadyNanos();
+      wheel_->expire( now, [this,now]( uint64_t token ) {
+        TCPListener::SocketWork* work = &listener_.clients_[ token & 0xFFFFFFFF ];
+        // the connection has been closed, its entry is dropped
+        if ( work->generation != ( token >> 32 ) || !work->socket || work->owner != this ) return;
+        uint64_t deadline = work->deadline;
+        if ( deadline > now ) {
+          wheel_->schedule( token, deadline );
+        } else if ( !deadline ) {
+          wheel_->schedule( token, now + listener_.timeout_recheck_ns_ );
+        } else {
+          log_Debug( "TCPServer::expireOwned socket " << work->socket->debugString() << " timed out" );
+          TCPListener::count( counters_->timeouts, 1 );
+          work->state |= TCPListener::SockState::Shut;
+          serviceOwned( work );
+        }
+      } );
+    }
+
+    /** io_uring user_data tag of the eventfd poll. */
+    const uint64_t uring_tag_wakeup = 0;
+    /** io_uring user_data tag of a receive. */
+    const uint64_t uring_tag_recv = 1;
+    /** io_uring user_data tag of a send. */
+    const uint64_t uring_tag_send = 2;
+    /** io_uring user_data tag of a cancel. */
+    const uint64_t uring_tag_cancel = 3;
+    /** io_uring user_data tag mask, the remaining bits are the SocketWork address. */
+    const uint64_t uring_tag_mask = 3;
+
+    void TCPServer::runURing() {
+      has_stopped_ = false;
+      struct timeval now, last_snap;
+      gettimeofday( &last_active_, NULL );
+      snapRUsage();
+      gettimeofday( &last_snap, NULL );
+      state_ = ssWait;
+      try {
+        ring_ = new URing( 256, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN );
+        ring_->setupBufferRing( 0, uring_buffer_count, uring_buffer_size );
+        ring_->prepPoll( event_fd_, POLLIN, uring_tag_wakeup );
+        do {
+          size_t enters = ring_->getEnters();
+          // submits the sends and receives queued by the previous batch of completions, and waits
+          ring_->enter( 1, listener_.params_.listener_sleep_ms );
+          ssize_t requests = 0;
+          busy_ = true;
+          state_ = ssAwoken;
+          unsigned completions = ring_->forEachCQE( [this,&requests]( const struct io_uring_cqe& cqe ) {
+            uringComplete( cqe, requests );
+          } );
+          if ( completions ) gettimeofday( &last_active_, NULL );
+          listener_.addRequests( requests );
+          TCPListener::count( counters_->uring_enters, ring_->getEnters() - enters );
+          busy_ = false;
+          state_ = ssWait;
+          gettimeofday( &now, NULL );
+          if ( common::getSecondDiff( last_snap, now ) > 0.2 ) {
+            snapRUsage();
+            gettimeofday( &last_snap, NULL );
+          }
+        } while ( !request_stop_ );
+        log_Debug( "TCPServer::runURing stopping" );
+      }
+      catch ( const std::exception &e ) {
+        log_Fatal( "TCPServer::runURing caught unhandled exception " << e.what() );
+      }
+      catch ( ... ) {
+        log_Fatal( "TCPServer::runURing caught std::exception " );
+      }
+      // closing the ring cancels the operations in flight, the TCPListener closes the connections
+      if ( ring_ ) delete ring_;
+      ring_ = nullptr;
+      has_stopped_ = true;
+    }
+
+    void TCPServer::uringComplete( const struct io_uring_cqe& cqe, ssize_t &requests ) {
+      uint64_t tag = cqe.user_data & uring_tag_mask;
+      TCPListener::SocketWork* work = reinterpret_cast<TCPListener::SocketWork*>( cqe.user_data & ~uring_tag_mask );
+      if ( tag == uring_tag_wakeup ) {
+        uint64_t count = 0;
+        if ( read( event_fd_, &count, sizeof(count) ) < 0 && errno != EAGAIN )
+          throw_SystemException( "TCPServer::uringComplete eventfd read failed", errno );
+        if ( !( cqe.flags & IORING_CQE_F_MORE ) ) ring_->prepPoll( event_fd_, POLLIN, uring_tag_wakeup );
+        while ( inbox_->pop( work ) ) {
+          URingSocket* socket = static_cast<URingSocket*>( work->socket );
+          TCPListener::SockState completion_state = serviceWork( work, true );
+          work->state ^= completion_state;
+          if ( completion_state & TCPListener::SockState::Shut ) socket->closing_ = true;
+          uringSettle( work );
+        }
+        return;
+      }
+      if ( tag == uring_tag_cancel ) return;
+      URingSocket* socket = static_cast<URingSocket*>( work->socket );
+      if ( tag == uring_tag_recv ) {
+        if ( cqe.flags & IORING_CQE_F_BUFFER ) {
+          uint16_t bid = (uint16_t)( cqe.flags >> IORING_CQE_BUFFER_SHIFT );
+          if ( cqe.res > 0 && !socket->closing_ ) work->data->appendBuffer( ring_->getBuffer( bid ), cqe.res );
+          ring_->recycleBuffer( bid );
+        }
+        if ( !( cqe.flags & IORING_CQE_F_MORE ) ) socket->receiving_ = false;
+        if ( !socket->closing_ ) {
+          if ( cqe.res > 0 ) {
+            if ( listener_.admitRequest( work ) )
+              work->state |= TCPListener::SockState::Read;
+            else
+              work->state |= TCPListener::SockState::Shut;
+            listener_.addReceivedSentBytes( cqe.res, 0 );
+            requests++;
+          } else if ( cqe.res != -ENOBUFS && cqe.res != -ECANCELED ) {
+            // end of stream or error, a receive cancelled over Params.output_high_water is armed again
+            work->state |= TCPListener::SockState::Shut;
+          }
+          if ( work->state != TCPListener::SockState::None ) {
+            TCPListener::SockState completion_state = serviceWork( work, true );
+            work->state ^= completion_state;
+            if ( completion_state & TCPListener::SockState::Shut ) socket->closing_ = true;
+          }
+        }
+      } else if ( tag == uring_tag_send ) {
+        socket->sending_ = false;
+        if ( cqe.res < 0 ) {
+          log_Debug( "TCPServer::uringComplete send failed socket " << socket->getFD() <<
+                     " : " << common::SystemError( -cqe.res ).asString() );
+          socket->output_.clear();
+          if ( !socket->closing_ ) {
+            work->state |= TCPListener::SockState::Shut;
+            work->state ^= serviceWork( work, true );
+            socket->closing_ = true;
+          }
+        } else {
+          socket->send_offset_ += cqe.res;
+          if ( socket->send_offset_ < socket->inflight_.size() ) {
+            // short send, send the remainder
+            ring_->prepSend( socket->getFD(), socket->inflight_.data() + socket->send_offset_,
+                             socket->inflight_.size() - socket->send_offset_, (uint64_t)work | uring_tag_send );
+            socket->sending_ = true;
+          }
+        }
+      }
+      uringSettle( work );
+    }
+
+    void TCPServer::uringSettle( TCPListener::SocketWork* work ) {
+      URingSocket* socket = static_cast<URingSocket*>( work->socket );
+      if ( !socket->closing_ && ( work->state & TCPListener::SockState::Read ) &&
+           queuedOutput( work ) < listener_.params_.output_high_water ) {
+        // received whilst the output was over Params.output_high_water, handled now that it has drained
+        TCPListener::SockState completion_state = serviceWork( work, true );
+        work->state ^= completion_state;
+        if ( completion_state & TCPListener::SockState::Shut ) socket->closing_ = true;
+      }
+      if ( !socket->sending_ && socket->output_.empty() && !socket->closing_ &&
+           work->data && work->data->getOutputSize() > 0 ) {
+        // the next chunk of a queued sendFile() transfer, flushOutput() appends it to the socket output
+        ssize_t sent = 0;
+        common::SystemError error = common::SystemError::ecOK;
+        try {
+          error = work->data->flushOutput( socket, sent );
+        }
+        catch ( std::exception &e ) {
+          log_Error( "TCPServer::uringSettle exception in flushOutput " << e.what() << " socket " << socket->getFD() );
+          error = common::SystemError::ecEPIPE;
+        }
+        if ( error != common::SystemError::ecOK && error != common::SystemError::ecEAGAIN ) socket->closing_ = true;
+      }
+      if ( !socket->sending_ && !socket->output_.empty() ) {
+        // the response(s) of the request(s) handled, submitted with the next enter
+        socket->inflight_.swap( socket->output_ );
+        socket->output_.clear();
+        socket->send_offset_ = 0;
+        ring_->prepSend( socket->getFD(), socket->inflight_.data(), socket->inflight_.size(),
+                         (uint64_t)work | uring_tag_send );
+        socket->sending_ = true;
+      }
+      if ( !socket->closing_ ) {
+        // as the epoll engine, stop receiving from a connection that does not drain its output
+        bool throttled = queuedOutput( work ) >= listener_.params_.output_high_water;
+        if ( throttled && socket->receiving_ && !socket->cancelled_ ) {
+          ring_->prepCancel( (uint64_t)work | uring_tag_recv, (uint64_t)work | uring_tag_cancel );
+          socket->cancelled_ = true;
+        } else if ( !throttled && !socket->receiving_ ) {
+          ring_->prepRecv( socket->getFD(), 0, (uint64_t)work | uring_tag_recv );
+          socket->receiving_ = true;
+          socket->cancelled_ = false;
+        }
+        return;
+      }
+      if ( socket->sending_ ) return;
+      if ( socket->receiving_ ) {
+        if ( !socket->cancelled_ ) {
+          ring_->prepCancel( (uint64_t)work | uring_tag_recv, (uint64_t)work | uring_tag_cancel );
+          socket->cancelled_ = true;
+        }
+        return;
+      }
+      listener_.closeSocket( work );
+    }
+
+    size_t TCPServer::queuedOutput( const TCPListener::SocketWork* work ) const {
+      size_t queued = work->data->getOutputSize();
+      if ( ring_ ) queued += static_cast<const URingSocket*>( work->socket )->getQueuedSize();
+      return queued;
+    }
+
+    void TCPServer::assignWork( TCPListener::SocketWork* work ) {
+      // cannot fail, the inbox capacity is maxconnections
+      while ( !inbox_->push( work ) ) std::this_thread::yield();
+      uint64_t one = 1;
+      if ( write( event_fd_, &one, sizeof(one) ) < 0 )
+        throw_SystemException( "TCPServer::assignWork eventfd write failed", errno );
+    }
+
+    TCPServer* TCPServer::addShardServer( TCPListener &shard ) {
+      throw_Exception( "TCPServer::addShardServer must be overridden to use listener shards" );
+    }
+
+    ScalingPolicy* TCPServer::newScalingPolicy() const {
+      LatencyScalingPolicy::Params params;
+      params.up_wait_us       = listener_.params_.scale_up_wait_us;
+      params.up_utilisation   = listener_.params_.scale_up_utilisation;
+      params.down_utilisation = listener_.params_.scale_down_utilisation;
+      params.up_intervals     = listener_.params_.scale_up_intervals;
+      params.down_intervals   = listener_.params_.scale_down_intervals;
+      return new LatencyScalingPolicy( params );
+    }
+
     double TCPServer::getIdleSeconds() {
       struct timeval tv;
       gettimeofday( &tv, 0 );
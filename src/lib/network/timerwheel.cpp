@@ -0,0 +1,50 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file timerwheel.cpp
+ * Implements the dodo::network::TimerWheel class.
+ */
+
+#include <network/timerwheel.hpp>
+
+namespace dodo::network {
+
+  TimerWheel::TimerWheel( uint64_t tick_ns, uint64_t now_ns ) :
+    tick_ns_(tick_ns), current_tick_(now_ns / tick_ns), size_(0) {
+  }
+
+  void TimerWheel::schedule( uint64_t token, uint64_t deadline_ns ) {
+    size_++;
+    place( { token, ( deadline_ns + tick_ns_ - 1 ) / tick_ns_ } );
+  }
+
+  void TimerWheel::place( const Entry &entry ) {
+    if ( entry.tick <= current_tick_ ) {
+      // due, expire on the next tick
+      level0_[ ( current_tick_ + 1 ) % wheel_size ].push_back( entry );
+    } else if ( entry.tick - current_tick_ < wheel_size ) {
+      level0_[ entry.tick % wheel_size ].push_back( entry );
+    } else if ( entry.tick / wheel_size - current_tick_ / wheel_size < wheel_size ) {
+      level1_[ ( entry.tick / wheel_size ) % wheel_size ].push_back( entry );
+    } else {
+      // beyond the wheel, rescheduled when the farthest bucket is cascaded
+      level1_[ ( current_tick_ / wheel_size + wheel_size - 1 ) % wheel_size ].push_back( entry );
+    }
+  }
+
+}
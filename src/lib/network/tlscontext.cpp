@@ -22,8 +22,15 @@
 
 #include <cstring>
 #include <iostream>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/opensslv.h>
 #include <openssl/pkcs12.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
 
@@ -70,6 +77,15 @@ namespace dodo::network {
       loadPEMIdentity( pub, priv, passphrase_ );
     } else if ( yaml["pkcs12"] ) {
     } else throw_Exception( "need either pem or pcks12 section");
+    if ( yaml["session-cache"] ) {
+      setSessionCache( common::YAML_read_key_default<size_t>( yaml["session-cache"], "size", 20480 ),
+                       common::YAML_read_key_default<time_t>( yaml["session-cache"], "ttl-s", 300 ),
+                       common::YAML_read_key_default<size_t>( yaml["session-cache"], "shards", 16 ) );
+    }
+    if ( yaml["session-tickets"] ) {
+      setSessionTickets( common::YAML_read_key_default<bool>( yaml["session-tickets"], "enabled", true ),
+                         common::YAML_read_key_default<time_t>( yaml["session-tickets"], "key-rotation-s", 3600 ) );
+    }
   }
 
   void TLSContext::construct( const PeerVerification& peerverficiation,
@@ -82,6 +98,9 @@ namespace dodo::network {
     allow_san_wildcards_ = allowSANWildcards;
     passphrase_ = "";
     tlsctx_ = nullptr;
+    resumed_ = 0;
+    full_ = 0;
+    ticket_rotation_ns_ = 0;
     long rc = 0;
     tlsctx_ = SSL_CTX_new( TLS_method() );
     if ( !tlsctx_ ) throw_ExceptionObject( "SSL_CTX_new failed"
@@ -103,8 +122,14 @@ namespace dodo::network {
     if ( rc == 0 ) throw_ExceptionObject( "SSL_CTX_set_min_proto_version failed"
                                           << common::Puts::endl() << common::getSSLErrors( '\n' ), this  );
 
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // peers closing without close_notify read as the end of the stream instead of a protocol error
+    SSL_CTX_set_options( tlsctx_, SSL_OP_IGNORE_UNEXPECTED_EOF );
+#endif
+
     SSL_CTX_set_default_passwd_cb( tlsctx_, pem_passwd_cb );
     SSL_CTX_set_default_passwd_cb_userdata( tlsctx_, this );
+    SSL_CTX_set_app_data( tlsctx_, this );
 
     if ( peerverficiation == PeerVerification::pvVerifyNone ) {
       SSL_CTX_set_verify( tlsctx_, SSL_VERIFY_NONE, nullptr );
@@ -234,6 +259,146 @@ namespace dodo::network {
                              << common::Puts::endl() << common::getSSLErrors( '\n' ), this  );
   }
 
+  void TLSContext::setSessionCache( size_t size, time_t ttl_s, size_t shards ) {
+    if ( size == 0 ) {
+      SSL_CTX_set_session_cache_mode( tlsctx_, SSL_SESS_CACHE_OFF );
+      server_sessions_.reset();
+      client_sessions_.reset();
+      return;
+    }
+    server_sessions_ = std::make_unique<TLSSessionCache>( size, ttl_s, shards );
+    client_sessions_ = std::make_unique<TLSSessionCache>( size, ttl_s, shards );
+    SSL_CTX_set_session_cache_mode( tlsctx_, SSL_SESS_CACHE_BOTH | SSL_SESS_CACHE_NO_INTERNAL );
+    SSL_CTX_set_timeout( tlsctx_, ttl_s );
+    // required to resume sessions of verified clients
+    const unsigned char sid_ctx[] = "dodo";
+    SSL_CTX_set_session_id_context( tlsctx_, sid_ctx, sizeof(sid_ctx) - 1 );
+    SSL_CTX_sess_set_new_cb( tlsctx_, new_session_cb );
+    SSL_CTX_sess_set_get_cb( tlsctx_, get_session_cb );
+    SSL_CTX_sess_set_remove_cb( tlsctx_, remove_session_cb );
+  }
+
+  void TLSContext::setSessionTickets( bool enabled, time_t key_rotation_s ) {
+    if ( !enabled ) {
+      SSL_CTX_set_options( tlsctx_, SSL_OP_NO_TICKET );
+      return;
+    }
+    SSL_CTX_clear_options( tlsctx_, SSL_OP_NO_TICKET );
+    ticket_rotation_ns_ = (uint64_t)std::max( (time_t)1, key_rotation_s ) * 1000000000;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb( tlsctx_, ticket_key_cb );
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb( tlsctx_, ticket_key_cb );
+#endif
+  }
+
+  TLSContext::SessionStats TLSContext::getSessionStats() const {
+    SessionStats stats;
+    stats.resumed = resumed_.load( std::memory_order_relaxed );
+    stats.full = full_.load( std::memory_order_relaxed );
+    if ( server_sessions_ ) stats.cached += server_sessions_->size();
+    if ( client_sessions_ ) stats.cached += client_sessions_->size();
+    return stats;
+  }
+
+  SSL_SESSION* TLSContext::getClientSession( const std::string &peer ) {
+    if ( !client_sessions_ ) return nullptr;
+    SSL_SESSION* session = client_sessions_->get( peer );
+    // TLS 1.3 tickets are for single use, the server sends a new one on each connection
+    if ( session && SSL_SESSION_get_protocol_version( session ) >= TLS1_3_VERSION ) client_sessions_->remove( peer );
+    return session;
+  }
+
+  int TLSContext::new_session_cb( SSL* ssl, SSL_SESSION* session ) {
+    TLSContext* tlsctx = fromSSL( ssl );
+    if ( SSL_is_server( ssl ) ) {
+      if ( !tlsctx->server_sessions_ ) return 0;
+      unsigned int length = 0;
+      const unsigned char* id = SSL_SESSION_get_id( session, &length );
+      tlsctx->server_sessions_->add( std::string( (const char*)id, length ), session );
+    } else {
+      // the TLSSocket sets the peer as application data in connect()
+      const std::string* peer = static_cast<const std::string*>( SSL_get_app_data( ssl ) );
+      if ( !tlsctx->client_sessions_ || !peer || peer->empty() ) return 0;
+      tlsctx->client_sessions_->add( *peer, session );
+    }
+    return 1;
+  }
+
+  SSL_SESSION* TLSContext::get_session_cb( SSL* ssl, const unsigned char* id, int length, int* copy ) {
+    TLSContext* tlsctx = fromSSL( ssl );
+    *copy = 0;
+    if ( !tlsctx->server_sessions_ ) return nullptr;
+    return tlsctx->server_sessions_->get( std::string( (const char*)id, length ) );
+  }
+
+  void TLSContext::remove_session_cb( SSL_CTX* ctx, SSL_SESSION* session ) {
+    TLSContext* tlsctx = static_cast<TLSContext*>( SSL_CTX_get_app_data( ctx ) );
+    if ( !tlsctx->server_sessions_ ) return;
+    unsigned int length = 0;
+    const unsigned char* id = SSL_SESSION_get_id( session, &length );
+    tlsctx->server_sessions_->remove( std::string( (const char*)id, length ) );
+  }
+
+  int TLSContext::ticketKey( unsigned char* name, int enc, TicketKey &key ) {
+    uint64_t now = common::steadyNanos();
+    threads::Mutexer lock( ticket_mutex_ );
+    if ( ticket_keys_.empty() || ticket_keys_.front().created_ns + ticket_rotation_ns_ <= now ) {
+      TicketKey fresh;
+      if ( RAND_bytes( fresh.name, sizeof(fresh.name) ) != 1 ||
+           RAND_bytes( fresh.aes, sizeof(fresh.aes) ) != 1 ||
+           RAND_bytes( fresh.hmac, sizeof(fresh.hmac) ) != 1 ) return -1;
+      fresh.created_ns = now;
+      ticket_keys_.push_front( fresh );
+    }
+    // a key replaced more than a rotation interval ago no longer decrypts tickets
+    while ( ticket_keys_.size() > 1 && ticket_keys_.back().created_ns + 2 * ticket_rotation_ns_ <= now )
+      ticket_keys_.pop_back();
+    if ( enc ) {
+      key = ticket_keys_.front();
+      memcpy( name, key.name, sizeof(key.name) );
+      return 1;
+    }
+    for ( size_t i = 0; i < ticket_keys_.size(); i++ ) {
+      if ( memcmp( name, ticket_keys_[i].name, sizeof(key.name) ) == 0 ) {
+        key = ticket_keys_[i];
+        return i == 0 ? 1 : 2;
+      }
+    }
+    return 0;
+  }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  int TLSContext::ticket_key_cb( SSL* ssl, unsigned char* name, unsigned char* iv,
+                                 EVP_CIPHER_CTX* ctx, EVP_MAC_CTX* hctx, int enc ) {
+#else
+  int TLSContext::ticket_key_cb( SSL* ssl, unsigned char* name, unsigned char* iv,
+                                 EVP_CIPHER_CTX* ctx, HMAC_CTX* hctx, int enc ) {
+#endif
+    TicketKey key;
+    int rc = fromSSL( ssl )->ticketKey( name, enc, key );
+    if ( rc <= 0 ) return rc;
+    if ( enc ) {
+      if ( RAND_bytes( iv, EVP_CIPHER_iv_length( EVP_aes_256_cbc() ) ) != 1 ) return -1;
+      if ( EVP_EncryptInit_ex( ctx, EVP_aes_256_cbc(), nullptr, key.aes, iv ) != 1 ) return -1;
+    } else {
+      if ( EVP_DecryptInit_ex( ctx, EVP_aes_256_cbc(), nullptr, key.aes, iv ) != 1 ) return -1;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_octet_string( OSSL_MAC_PARAM_KEY, key.hmac, sizeof(key.hmac) ),
+      OSSL_PARAM_construct_utf8_string( OSSL_MAC_PARAM_DIGEST, const_cast<char*>( "SHA256" ), 0 ),
+      OSSL_PARAM_construct_end()
+    };
+    if ( EVP_MAC_CTX_set_params( hctx, params ) != 1 ) return -1;
+#else
+    if ( HMAC_Init_ex( hctx, key.hmac, sizeof(key.hmac), EVP_sha256(), nullptr ) != 1 ) return -1;
+#endif
+    // the client uses a TLS 1.3 ticket once, so a resumed session always needs a new ticket
+    if ( !enc && SSL_version( ssl ) >= TLS1_3_VERSION ) return 2;
+    return rc;
+  }
+
   TLSContext::TLSVersion TLSContext::tlsVersionFromString( const std::string &src ) {
     if ( src == "1.1" ) return TLSVersion::tls1_1;
     else if ( src == "1.2" ) return TLSVersion::tls1_2;
@@ -0,0 +1,102 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file tlssessioncache.cpp
+ * Implements the dodo::network::TLSSessionCache class.
+ */
+
+#include <common/util.hpp>
+#include <network/tlssessioncache.hpp>
+
+#include <algorithm>
+
+namespace dodo::network {
+
+  TLSSessionCache::TLSSessionCache( size_t size, time_t ttl_s, size_t shards ) :
+    shards_( std::max( (size_t)1, shards ) ) {
+    shard_capacity_ = std::max( (size_t)1, size / shards_.size() );
+    ttl_ns_ = (uint64_t)std::max( (time_t)1, ttl_s ) * 1000000000;
+  }
+
+  TLSSessionCache::~TLSSessionCache() {
+    for ( auto &shard : shards_ ) {
+      for ( auto &entry : shard.sessions ) SSL_SESSION_free( entry.second.session );
+    }
+  }
+
+  void TLSSessionCache::add( const std::string &key, SSL_SESSION* session ) {
+    Shard &s = shard( key );
+    uint64_t now = common::steadyNanos();
+    threads::Mutexer lock( s.mutex );
+    auto i = s.sessions.find( key );
+    if ( i != s.sessions.end() ) {
+      SSL_SESSION_free( i->second.session );
+      s.sessions.erase( i );
+    }
+    uint64_t sequence = s.sequence++;
+    s.sessions[key] = { session, now + ttl_ns_, sequence };
+    s.order.push_back( { key, sequence } );
+    evict( s, now );
+  }
+
+  SSL_SESSION* TLSSessionCache::get( const std::string &key ) {
+    Shard &s = shard( key );
+    uint64_t now = common::steadyNanos();
+    threads::Mutexer lock( s.mutex );
+    auto i = s.sessions.find( key );
+    if ( i == s.sessions.end() || i->second.expires_ns <= now ) return nullptr;
+    // the session may be evicted as soon as the lock is released
+    SSL_SESSION_up_ref( i->second.session );
+    return i->second.session;
+  }
+
+  void TLSSessionCache::remove( const std::string &key ) {
+    Shard &s = shard( key );
+    threads::Mutexer lock( s.mutex );
+    auto i = s.sessions.find( key );
+    if ( i == s.sessions.end() ) return;
+    SSL_SESSION_free( i->second.session );
+    s.sessions.erase( i );
+  }
+
+  size_t TLSSessionCache::size() {
+    size_t count = 0;
+    for ( auto &shard : shards_ ) {
+      threads::Mutexer lock( shard.mutex );
+      count += shard.sessions.size();
+    }
+    return count;
+  }
+
+  void TLSSessionCache::evict( Shard &s, uint64_t now_ns ) {
+    while ( !s.order.empty() ) {
+      auto &front = s.order.front();
+      auto i = s.sessions.find( front.first );
+      // the key was removed, or removed and added again later
+      if ( i == s.sessions.end() || i->second.sequence != front.second ) {
+        s.order.pop_front();
+        continue;
+      }
+      if ( i->second.expires_ns > now_ns && s.sessions.size() <= shard_capacity_ ) break;
+      SSL_SESSION_free( i->second.session );
+      s.sessions.erase( i );
+      s.order.pop_front();
+    }
+  }
+
+}
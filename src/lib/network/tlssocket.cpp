@@ -21,6 +21,7 @@
  */
 
 #include <cstring>
+#include <vector>
 
 #include "common/logger.hpp"
 #include "common/util.hpp"
@@ -54,6 +55,14 @@ namespace dodo::network {
     if (ssl_ ) SSL_free( ssl_ );
   }
 
+  void TLSSocket::close() {
+    if ( ssl_ && socket_ != -1 && SSL_is_init_finished( ssl_ ) ) {
+      // send close_notify without waiting for the peer's, a session is only resumable after a clean shutdown
+      if ( SSL_shutdown( ssl_ ) < 0 ) ERR_clear_error();
+    }
+    BaseSocket::close();
+  }
+
   common::SystemError TLSSocket::connect( const Address &address ) {
     common::SystemError error = BaseSocket::connect( address );
     if ( error == common::SystemError::ecOK ) {
@@ -62,6 +71,16 @@ namespace dodo::network {
         auto ssl_error_code = SSL_get_error( ssl_, rc );
         throw_Exception( ssl_error_code << " " << common::getSSLErrors( '\n' )  );
       }
+      if ( tlscontext_.hasSessionCache() ) {
+        // new sessions are cached under session_key_ by the TLSContext
+        session_key_ = address.asString( true ) + "/" + peer_name_.san_name;
+        SSL_set_app_data( ssl_, &session_key_ );
+        SSL_SESSION* session = tlscontext_.getClientSession( session_key_ );
+        if ( session ) {
+          SSL_set_session( ssl_, session );
+          SSL_SESSION_free( session );
+        }
+      }
       rc = SSL_connect( ssl_ );
       if ( rc != 1 ) {
         auto ssl_error_code = SSL_get_error( ssl_, rc );
@@ -77,6 +96,7 @@ namespace dodo::network {
           default: throw_Exception( ssl_error_code << " " << common::getSSLErrors( '\n' )  );
         }
       }
+      tlscontext_.countHandshake( SSL_session_reused( ssl_ ) );
       if ( tlscontext_.getPeerVerification() == TLSContext::PeerVerification::pvVerifyFQDN )  {
         if ( X509Certificate::verifySAN( getPeerCertificate(), { network::X509Common::SANType::stDNS, peer_name_.san_name }, tlscontext_.isAllowSANWildcards() ) ) {
           return common::SystemError::ecOK;
@@ -98,6 +118,28 @@ namespace dodo::network {
     return nullptr;
   }
 
+  common::SystemError TLSSocket::acceptTLS() {
+    if ( !ssl_ ) {
+      ssl_ = SSL_new( tlscontext_.getContext() );
+      if ( !ssl_ ) throw_Exception( common::getSSLErrors( '\n' )  );
+      SSL_set_fd( ssl_, socket_ );
+      SSL_set_accept_state( ssl_ );
+    }
+    auto rc = SSL_accept( ssl_ );
+    if ( rc == 1 ) {
+      tlscontext_.countHandshake( SSL_session_reused( ssl_ ) );
+      return common::SystemError::ecOK;
+    }
+    switch ( SSL_get_error( ssl_, rc ) ) {
+      case SSL_ERROR_WANT_READ :        return common::SystemError::ecSSL_ERROR_WANT_READ;
+      case SSL_ERROR_WANT_WRITE :       return common::SystemError::ecSSL_ERROR_WANT_WRITE;
+      default:
+        // a client failing the handshake is not an error of the server
+        log_Debug( "TLSSocket::acceptTLS socket " << socket_ << " failed " << common::getSSLErrors( '\n' ) );
+        return common::SystemError::ecECONNABORTED;
+    }
+  }
+
   X509* TLSSocket::getPeerCertificate() const {
     return SSL_get_peer_certificate(ssl_);
   }
@@ -120,6 +162,41 @@ namespace dodo::network {
     return common::SystemError::ecOK;
   }
 
+  common::SystemError TLSSocket::sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more ) {
+    SSL_set_mode( ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER );
+    const char* cp = (const char*)buf;
+    sent = 0;
+    while ( sent < len ) {
+      auto rc = SSL_write( ssl_, cp + sent, (int)( len - sent ) );
+      if ( rc <= 0 ) {
+        switch ( SSL_get_error( ssl_, rc ) ) {
+          case SSL_ERROR_WANT_READ :
+          case SSL_ERROR_WANT_WRITE :       return common::SystemError::ecEAGAIN;
+          case SSL_ERROR_ZERO_RETURN :      return common::SystemError::ecSSL_ERROR_ZERO_RETURN;
+          case SSL_ERROR_SYSCALL :          return common::SystemError::ecSSL_ERROR_SYSCALL;
+          case SSL_ERROR_SSL :
+          default: throw_Exception( common::getSSLErrors( '\n' )  );
+        }
+      }
+      sent += rc;
+    }
+    return common::SystemError::ecOK;
+  }
+
+  common::SystemError TLSSocket::sendv( const ConstBuffer* buffers, size_t count, bool more ) {
+    if ( count == 1 ) return send( buffers[0].data, buffers[0].size, more );
+    size_t total = 0;
+    for ( size_t i = 0; i < count; i++ ) total += buffers[i].size;
+    if ( total == 0 ) return common::SystemError::ecOK;
+    std::vector<char> coalesced;
+    coalesced.reserve( total );
+    for ( size_t i = 0; i < count; i++ ) {
+      const char* cp = static_cast<const char*>( buffers[i].data );
+      coalesced.insert( coalesced.end(), cp, cp + buffers[i].size );
+    }
+    return send( coalesced.data(), total, more );
+  }
+
   common::SystemError TLSSocket::receive( void* buf, ssize_t request, ssize_t &received ) {
     received = 0;
     auto rc = SSL_read( ssl_, buf, (int)request );
@@ -141,4 +218,29 @@ namespace dodo::network {
     return common::SystemError::ecOK;
   }
 
+  common::SystemError TLSSocket::receivev( const MutableBuffer* buffers, size_t count, ssize_t &received ) {
+    received = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+      // SSL_read returns at most one record
+      size_t filled = 0;
+      while ( filled < buffers[i].size ) {
+        ssize_t got = 0;
+        common::SystemError error = receive( static_cast<char*>( buffers[i].data ) + filled,
+                                             buffers[i].size - filled, got );
+        if ( error != common::SystemError::ecOK ) {
+          // the peer's close_notify reads as the end of the stream, like a plain socket
+          if ( received > 0 || error == common::SystemError::ecSSL_ERROR_ZERO_RETURN ) return common::SystemError::ecOK;
+          if ( error == common::SystemError::ecSSL_ERROR_WANT_READ ||
+               error == common::SystemError::ecSSL_ERROR_WANT_WRITE ) return common::SystemError::ecEAGAIN;
+          return error;
+        }
+        filled += got;
+        received += got;
+        // like readv, return what has been received rather than wait for the next record
+        if ( SSL_pending( ssl_ ) == 0 ) return common::SystemError::ecOK;
+      }
+    }
+    return common::SystemError::ecOK;
+  }
+
 }
@@ -0,0 +1,262 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file uring.cpp
+ * Implements the dodo::network::URing and dodo::network::URingSocket classes.
+ */
+
+#include <network/uring.hpp>
+#include <common/exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dodo::network {
+
+  URing::URing( unsigned entries, unsigned flags ) :
+    fd_(-1), flags_(flags), sq_ring_(MAP_FAILED), sq_ring_sz_(0), cq_ring_(MAP_FAILED), cq_ring_sz_(0),
+    sqes_(nullptr), sq_entries_(0), sqe_tail_(0), buf_ring_(nullptr), buf_ring_sz_(0), buf_tail_(0), buf_count_(0),
+    buf_size_(0), buffers_(nullptr), enters_(0) {
+    struct io_uring_params params;
+    memset( &params, 0, sizeof(params) );
+    params.flags = flags | IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+    fd_ = (int)syscall( __NR_io_uring_setup, entries, &params );
+    if ( fd_ < 0 && errno == EINVAL && flags ) {
+      // older kernels do not know all flags
+      flags_ = 0;
+      memset( &params, 0, sizeof(params) );
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = entries * 4;
+      fd_ = (int)syscall( __NR_io_uring_setup, entries, &params );
+    }
+    if ( fd_ < 0 ) throw_SystemException( "URing::URing io_uring_setup failed", errno );
+
+    sq_ring_sz_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_sz_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if ( single_mmap ) sq_ring_sz_ = cq_ring_sz_ = std::max( sq_ring_sz_, cq_ring_sz_ );
+    sq_ring_ = mmap( nullptr, sq_ring_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING );
+    if ( sq_ring_ == MAP_FAILED ) {
+      int err = errno;
+      release();
+      throw_SystemException( "URing::URing mmap of the SQ ring failed", err );
+    }
+    if ( single_mmap ) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap( nullptr, cq_ring_sz_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING );
+      if ( cq_ring_ == MAP_FAILED ) {
+        int err = errno;
+        release();
+        throw_SystemException( "URing::URing mmap of the CQ ring failed", err );
+      }
+    }
+    void* sqes = mmap( nullptr, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES );
+    if ( sqes == MAP_FAILED ) {
+      int err = errno;
+      release();
+      throw_SystemException( "URing::URing mmap of the SQEs failed", err );
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>( sqes );
+    sq_entries_ = params.sq_entries;
+
+    char* sq = static_cast<char*>( sq_ring_ );
+    sq_head_ = reinterpret_cast<unsigned*>( sq + params.sq_off.head );
+    sq_tail_ = reinterpret_cast<unsigned*>( sq + params.sq_off.tail );
+    sq_mask_ = *reinterpret_cast<unsigned*>( sq + params.sq_off.ring_mask );
+    unsigned* sq_array = reinterpret_cast<unsigned*>( sq + params.sq_off.array );
+    for ( unsigned i = 0; i < sq_entries_; i++ ) sq_array[i] = i;
+    sqe_tail_ = *sq_tail_;
+
+    char* cq = static_cast<char*>( cq_ring_ );
+    cq_head_ = reinterpret_cast<unsigned*>( cq + params.cq_off.head );
+    cq_tail_ = reinterpret_cast<unsigned*>( cq + params.cq_off.tail );
+    cq_mask_ = *reinterpret_cast<unsigned*>( cq + params.cq_off.ring_mask );
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>( cq + params.cq_off.cqes );
+  }
+
+  URing::~URing() {
+    release();
+  }
+
+  void URing::release() {
+    // close the ring before releasing the provided buffers the kernel may still refer to
+    if ( fd_ >= 0 ) ::close( fd_ );
+    fd_ = -1;
+    if ( sqes_ ) munmap( sqes_, sq_entries_ * sizeof(struct io_uring_sqe) );
+    sqes_ = nullptr;
+    if ( cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_ ) munmap( cq_ring_, cq_ring_sz_ );
+    cq_ring_ = MAP_FAILED;
+    if ( sq_ring_ != MAP_FAILED ) munmap( sq_ring_, sq_ring_sz_ );
+    sq_ring_ = MAP_FAILED;
+    if ( buf_ring_ ) munmap( buf_ring_, buf_ring_sz_ );
+    buf_ring_ = nullptr;
+    if ( buffers_ ) delete[] buffers_;
+    buffers_ = nullptr;
+  }
+
+  bool URing::isSupported() {
+    try {
+      URing ring( 4 );
+      ring.setupBufferRing( 0, 1, 64 );
+      return true;
+    }
+    catch ( ... ) {
+      return false;
+    }
+  }
+
+  void URing::setupBufferRing( uint16_t group, uint16_t count, uint32_t size ) {
+    buf_ring_sz_ = count * sizeof(struct io_uring_buf);
+    void* ring = mmap( nullptr, buf_ring_sz_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+    if ( ring == MAP_FAILED ) throw_SystemException( "URing::setupBufferRing mmap failed", errno );
+    buf_ring_ = static_cast<struct io_uring_buf_ring*>( ring );
+    buf_count_ = count;
+    buf_size_ = size;
+    buf_tail_ = 0;
+    struct io_uring_buf_reg reg;
+    memset( &reg, 0, sizeof(reg) );
+    reg.ring_addr = (uint64_t)buf_ring_;
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if ( syscall( __NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1 ) < 0 )
+      throw_SystemException( "URing::setupBufferRing io_uring_register failed", errno );
+    buffers_ = new common::Octet[ (size_t)count * size ];
+    for ( uint16_t bid = 0; bid < count; bid++ ) recycleBuffer( bid );
+  }
+
+  void URing::recycleBuffer( uint16_t bid ) {
+    // not buf_ring_->bufs, in C++ __DECLARE_FLEX_ARRAY offsets bufs by the size of an empty struct
+    struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>( buf_ring_ ) + ( buf_tail_ & ( buf_count_ - 1 ) );
+    buf->addr = (uint64_t)( buffers_ + (size_t)bid * buf_size_ );
+    buf->len = buf_size_;
+    buf->bid = bid;
+    buf_tail_++;
+    __atomic_store_n( &buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE );
+  }
+
+  struct io_uring_sqe* URing::getSQE() {
+    if ( sqe_tail_ - __atomic_load_n( sq_head_, __ATOMIC_ACQUIRE ) >= sq_entries_ ) enter( 0, 0 );
+    struct io_uring_sqe* sqe = &sqes_[ sqe_tail_ & sq_mask_ ];
+    memset( sqe, 0, sizeof(struct io_uring_sqe) );
+    sqe_tail_++;
+    return sqe;
+  }
+
+  void URing::prepAccept( int fd, uint64_t user_data ) {
+    struct io_uring_sqe* sqe = getSQE();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = user_data;
+  }
+
+  void URing::prepRecv( int fd, uint16_t group, uint64_t user_data ) {
+    struct io_uring_sqe* sqe = getSQE();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = group;
+    sqe->user_data = user_data;
+  }
+
+  void URing::prepSend( int fd, const void* buf, size_t len, uint64_t user_data ) {
+    struct io_uring_sqe* sqe = getSQE();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data;
+  }
+
+  void URing::prepPoll( int fd, uint32_t events, uint64_t user_data ) {
+    struct io_uring_sqe* sqe = getSQE();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data;
+  }
+
+  void URing::prepCancel( uint64_t target, uint64_t user_data ) {
+    struct io_uring_sqe* sqe = getSQE();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+  }
+
+  void URing::enter( unsigned wait_nr, int timeout_ms ) {
+    __atomic_store_n( sq_tail_, sqe_tail_, __ATOMIC_RELEASE );
+    unsigned to_submit = sqe_tail_ - __atomic_load_n( sq_head_, __ATOMIC_ACQUIRE );
+    bool cqes_pending = *cq_head_ != __atomic_load_n( cq_tail_, __ATOMIC_ACQUIRE );
+    if ( cqes_pending ) wait_nr = 0;
+    // with IORING_SETUP_DEFER_TASKRUN, completions are only posted when entering with IORING_ENTER_GETEVENTS
+    bool defer_taskrun = flags_ & IORING_SETUP_DEFER_TASKRUN;
+    if ( to_submit == 0 && wait_nr == 0 && ( cqes_pending || !defer_taskrun ) ) return;
+    unsigned flags = 0;
+    if ( wait_nr || defer_taskrun ) flags |= IORING_ENTER_GETEVENTS;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset( &arg, 0, sizeof(arg) );
+    void* argp = nullptr;
+    size_t argsz = _NSIG / 8;
+    if ( wait_nr && timeout_ms >= 0 ) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = ( timeout_ms % 1000 ) * 1000000L;
+      arg.ts = (uint64_t)&ts;
+      argp = &arg;
+      argsz = sizeof(arg);
+      flags |= IORING_ENTER_EXT_ARG;
+    }
+    enters_++;
+    if ( syscall( __NR_io_uring_enter, fd_, to_submit, wait_nr, flags, argp, argsz ) < 0 ) {
+      if ( errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY )
+        throw_SystemException( "URing::enter io_uring_enter failed", errno );
+    }
+  }
+
+  common::SystemError URingSocket::send( const void* buf, ssize_t len, bool more ) {
+    const common::Octet* octets = static_cast<const common::Octet*>( buf );
+    output_.insert( output_.end(), octets, octets + len );
+    return common::SystemError::ecOK;
+  }
+
+  common::SystemError URingSocket::sendPartial( const void* buf, ssize_t len, ssize_t &sent, bool more ) {
+    sent = len;
+    return send( buf, len, more );
+  }
+
+  common::SystemError URingSocket::sendv( const ConstBuffer* buffers, size_t count, bool more ) {
+    for ( size_t i = 0; i < count; i++ ) {
+      const common::Octet* octets = static_cast<const common::Octet*>( buffers[i].data );
+      output_.insert( output_.end(), octets, octets + buffers[i].size );
+    }
+    return common::SystemError::ecOK;
+  }
+
+}
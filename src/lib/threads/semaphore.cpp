@@ -0,0 +1,89 @@
+/*
+ * This file is part of the dodo library (https://github.com/jmspit/dodo).
+ * Copyright (c) 2019 Jan-Marten Spit.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file semaphore.cpp
+ * Implements the dodo::threads::Semaphore class.
+ */
+
+#include <threads/semaphore.hpp>
+
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dodo::threads {
+
+  /**
+   * Issue a private futex operation on a Semaphore count.
+   */
+  static long futex( std::atomic<int32_t> *word, int op, int32_t val, const struct timespec *timeout ) {
+    static_assert( sizeof(std::atomic<int32_t>) == sizeof(int32_t) );
+    return syscall( SYS_futex, reinterpret_cast<int32_t*>( word ), op | FUTEX_PRIVATE_FLAG, val, timeout, nullptr, 0 );
+  }
+
+  void Semaphore::post() {
+    count_.fetch_add( 1, std::memory_order_seq_cst );
+    if ( waiters_.load( std::memory_order_seq_cst ) > 0 ) futex( &count_, FUTEX_WAKE, 1, nullptr );
+  }
+
+  bool Semaphore::tryWait() {
+    int32_t count = count_.load( std::memory_order_relaxed );
+    while ( count > 0 ) {
+      if ( count_.compare_exchange_weak( count, count - 1, std::memory_order_acquire ) ) return true;
+    }
+    return false;
+  }
+
+  bool Semaphore::wait( int timeout_ms ) {
+    if ( tryWait() ) return true;
+    struct timespec deadline;
+    if ( timeout_ms >= 0 ) {
+      clock_gettime( CLOCK_MONOTONIC, &deadline );
+      deadline.tv_sec += timeout_ms / 1000;
+      deadline.tv_nsec += ( timeout_ms % 1000 ) * 1000000L;
+      if ( deadline.tv_nsec >= 1000000000L ) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+    }
+    while ( true ) {
+      struct timespec remain;
+      if ( timeout_ms >= 0 ) {
+        struct timespec now;
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        remain.tv_sec = deadline.tv_sec - now.tv_sec;
+        remain.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+        if ( remain.tv_nsec < 0 ) {
+          remain.tv_sec--;
+          remain.tv_nsec += 1000000000L;
+        }
+        if ( remain.tv_sec < 0 ) return tryWait();
+      }
+      waiters_.fetch_add( 1, std::memory_order_seq_cst );
+      // sleeps only if the count is still 0, a post() in between makes the futex return EAGAIN
+      long rc = futex( &count_, FUTEX_WAIT, 0, timeout_ms >= 0 ? &remain : nullptr );
+      int err = errno;
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+      if ( tryWait() ) return true;
+      if ( rc < 0 && err == ETIMEDOUT ) return false;
+    }
+  }
+
+}
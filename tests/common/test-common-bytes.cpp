@@ -1,3 +1,4 @@
+#include <cstring>
 #include <iostream>
 #include <dodo.hpp>
 #include <common/unittest.hpp>
@@ -18,6 +19,7 @@ class BytesTest : public common::UnitTest {
     bool test4();
     bool test5();
     bool test6();
+    bool test7();
 
     bool verifyBase64( const std::string &test, const std::string &base64 );
 };
@@ -29,6 +31,7 @@ void BytesTest::doRun() {
   test4();
   test5();
   test6();
+  test7();
 }
 
 
@@ -118,6 +121,24 @@ bool BytesTest::test6() {
   return ( mt == common::Bytes::MatchType::Full && octets == o2.getSize() );
 }
 
+bool BytesTest::test7() {
+  common::Bytes o1;
+  o1.ensureCapacity( 100 );
+  bool ok = o1.getSize() == 0 && o1.getCapacity() >= 100 && o1.getSpare() == o1.getCapacity();
+  memcpy( o1.getTail(), "CONNECTED", 9 );
+  o1.extend( 9 );
+  ok = ok && o1.getSize() == 9 && o1.asString() == "CONNECTED";
+  size_t capacity = o1.getCapacity();
+  o1.clear();
+  ok = ok && o1.getSize() == 0 && o1.getCapacity() == capacity;
+  o1.append( { "CONN" } );
+  ok = ok && o1.getCapacity() == capacity && o1.asString() == "CONN";
+  o1.ensureCapacity( capacity + 1 );
+  ok = ok && o1.getCapacity() >= 2 * capacity && o1.asString() == "CONN";
+  return writeSubTestResult( "test capacity",
+                             "test common::Bytes ensureCapacity, extend and clear",
+                             ok );
+}
 
 int main() {
   int error = 0;
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+bool test1() {
+  // bucket bounds are contiguous and hold their values
+  for ( size_t i = 1; i < common::Histogram::num_buckets; i++ ) {
+    if ( common::Histogram::bucketLow( i ) != common::Histogram::bucketHigh( i - 1 ) + 1 ) {
+      std::cout << "bucket " << i << " not contiguous" << std::endl;
+      return false;
+    }
+  }
+  if ( common::Histogram::bucketHigh( common::Histogram::num_buckets - 1 ) != UINT64_MAX ) return false;
+  for ( uint64_t v : { 0ULL, 1ULL, 31ULL, 32ULL, 33ULL, 1000ULL, 123456789ULL, 0xFFFFFFFFFFFFFFFFULL } ) {
+    size_t i = common::Histogram::bucketIndex( v );
+    if ( v < common::Histogram::bucketLow( i ) || v > common::Histogram::bucketHigh( i ) ) {
+      std::cout << "value " << v << " not in bucket " << i << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool test2() {
+  // percentiles within the relative error of 1 / sub_buckets
+  common::Histogram h;
+  for ( uint64_t v = 1; v <= 100000; v++ ) h.record( v );
+  std::cout << "p50=" << h.getPercentile( 50.0 ) << " p99=" << h.getPercentile( 99.0 ) <<
+               " max=" << h.getMax() << std::endl;
+  if ( h.getCount() != 100000 ) return false;
+  auto near = []( uint64_t value, double expected ) {
+    return (double)value >= expected && (double)value <= expected * ( 1.0 + 1.0 / common::Histogram::sub_buckets );
+  };
+  return near( h.getPercentile( 50.0 ), 50000 ) &&
+         near( h.getPercentile( 99.0 ), 99000 ) &&
+         near( h.getPercentile( 99.9 ), 99900 ) &&
+         near( h.getMax(), 100000 );
+}
+
+bool test3() {
+  // interval by subtraction, merge by addition
+  common::Histogram a, b, previous;
+  for ( int i = 0; i < 100; i++ ) a.record( 10 );
+  previous = a;
+  for ( int i = 0; i < 100; i++ ) a.record( 1000 );
+  common::Histogram interval = a;
+  interval -= previous;
+  if ( interval.getCount() != 100 || interval.getPercentile( 1.0 ) < 1000 ) return false;
+  b.record( 5 );
+  b += interval;
+  if ( b.getCount() != 101 || b.getPercentile( 0.0 ) != 5 ) return false;
+  common::Histogram empty;
+  return empty.getCount() == 0 && empty.getPercentile( 99.0 ) == 0 && empty.getMax() == 0;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/**
+ * Line echo TCPServer that prefixes each line with the id of its instance.
+ */
+class EchoServer : public network::TCPServer {
+  public:
+    EchoServer( network::TCPListener &listener, char id ) : network::TCPServer( listener ), id_( id ) {}
+
+    virtual network::TCPServer* addServer() { return new EchoServer( listener_, id_ ); }
+
+    virtual network::TCPServer* addShardServer( network::TCPListener &shard ) { return new EchoServer( shard, id_ ); }
+
+    virtual bool handShake( network::BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      const common::Bytes &buf = work.data->getReadBuffer();
+      if ( buf.getSize() > 0 && buf.getOctet( buf.getSize() - 1 ) == '\n' ) {
+        std::string reply = id_ + std::string( reinterpret_cast<const char*>( buf.getArray() ), buf.getSize() );
+        common::SystemError error = work.data->send( work.socket, reply.c_str(), reply.size() );
+        sent = reply.size();
+        work.data->clearBuffer();
+        return error;
+      }
+      return common::SystemError::ecEAGAIN;
+    }
+
+    virtual void shutDown( network::BaseSocket *socket ) {}
+
+  private:
+    char id_;
+};
+
+/**
+ * Return the number of open file descriptors of the process.
+ */
+size_t openFDs() {
+  size_t count = 0;
+  DIR* dir = opendir( "/proc/self/fd" );
+  if ( !dir ) return 0;
+  while ( readdir( dir ) ) count++;
+  closedir( dir );
+  return count;
+}
+
+/**
+ * Send a message carrying fds.size() descriptors, which Handover::send cannot.
+ */
+bool sendFDs( int channel, const std::vector<int> &fds ) {
+  char data = static_cast<char>( network::Handover::Tag::Connection );
+  struct iovec iov = { &data, sizeof(data) };
+  std::vector<char> control( CMSG_SPACE( sizeof(int) * fds.size() ), 0 );
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN( sizeof(int) * fds.size() );
+  memcpy( CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size() );
+  return ::sendmsg( channel, &msg, MSG_NOSIGNAL ) == 1;
+}
+
+bool test1() {
+  std::cout << "Handover send and receive a descriptor ... ";
+  int channel[2];
+  int pipe_fds[2];
+  if ( socketpair( AF_UNIX, SOCK_STREAM, 0, channel ) < 0 || pipe( pipe_fds ) < 0 ) return false;
+  bool ok = true;
+  network::Handover::Tag tag;
+  int fd = -1;
+  ok = ok && network::Handover::send( channel[0], network::Handover::Tag::Listen, pipe_fds[1] ) ==
+             common::SystemError::ecOK;
+  ok = ok && network::Handover::receive( channel[1], tag, fd ) == common::SystemError::ecOK;
+  ok = ok && tag == network::Handover::Tag::Listen && fd >= 0 && fd != pipe_fds[1];
+  // the received descriptor refers to the same pipe
+  ok = ok && ::write( fd, "x", 1 ) == 1;
+  char c = 0;
+  ok = ok && ::read( pipe_fds[0], &c, 1 ) == 1 && c == 'x';
+  if ( fd >= 0 ) ::close( fd );
+  ok = ok && network::Handover::send( channel[0], network::Handover::Tag::Ready ) == common::SystemError::ecOK;
+  ok = ok && network::Handover::receive( channel[1], tag, fd ) == common::SystemError::ecOK;
+  ok = ok && tag == network::Handover::Tag::Ready && fd == -1;
+  ::close( channel[0] );
+  ok = ok && network::Handover::receive( channel[1], tag, fd ) == common::SystemError::ecECONNABORTED;
+  ::close( channel[1] );
+  ::close( pipe_fds[0] );
+  ::close( pipe_fds[1] );
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED" << std::endl;
+  return ok;
+}
+
+bool test2() {
+  std::cout << "Handover rejects messages with more descriptors without leaking them ... ";
+  int channel[2];
+  int pipe_fds[2];
+  if ( socketpair( AF_UNIX, SOCK_STREAM, 0, channel ) < 0 || pipe( pipe_fds ) < 0 ) return false;
+  bool ok = true;
+  size_t before = openFDs();
+  network::Handover::Tag tag;
+  int fd = -1;
+  // two descriptors fit the control buffer
+  ok = ok && sendFDs( channel[0], { pipe_fds[0], pipe_fds[1] } );
+  ok = ok && network::Handover::receive( channel[1], tag, fd ) == common::SystemError::ecEMSGSIZE && fd == -1;
+  // three do not, the message is truncated
+  ok = ok && sendFDs( channel[0], { pipe_fds[0], pipe_fds[1], pipe_fds[0] } );
+  ok = ok && network::Handover::receive( channel[1], tag, fd ) == common::SystemError::ecEMSGSIZE && fd == -1;
+  ok = ok && openFDs() == before;
+  ::close( channel[0] );
+  ::close( channel[1] );
+  ::close( pipe_fds[0] );
+  ::close( pipe_fds[1] );
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED" << std::endl;
+  return ok;
+}
+
+/**
+ * Send a line and receive the reply.
+ */
+bool echo( network::Socket &socket, const std::string &line, std::string &reply ) {
+  std::string request = line + "\n";
+  return socket.send( request.c_str(), request.size() ) == common::SystemError::ecOK &&
+         socket.receiveLine( reply ) == common::SystemError::ecOK;
+}
+
+bool test3() {
+  std::cout << "TCPListener hands its listening socket and idle connections over ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19690;
+  yaml["min-servers"] = 1;
+  yaml["max-servers"] = 2;
+  yaml["max-connections"] = 16;
+  yaml["listener-sleep-ms"] = 50;
+  yaml["stat-trc-interval-s"] = 300;
+  yaml["handover-path"] = "/tmp/test-network-handover.sock";
+  yaml["handover-connections"] = true;
+  yaml["handover-drain-s"] = 10;
+  network::Address address( "127.0.0.1", 19690 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  bool ok = true;
+  std::string reply;
+
+  network::TCPListener old_listener( yaml );
+  old_listener.start( new EchoServer( old_listener, 'A' ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+  network::Socket client( true, params );
+  ok = ok && client.connect( address ) == common::SystemError::ecOK;
+  ok = ok && echo( client, "one", reply ) && reply == "Aone";
+
+  network::TCPListener new_listener( yaml );
+  new_listener.start( new EchoServer( new_listener, 'B' ) );
+  for ( int i = 0; i < 100 && !old_listener.hasHandedOver(); i++ )
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+  ok = ok && old_listener.hasHandedOver();
+  old_listener.wait();
+
+  // the established connection is served by the new instance
+  ok = ok && echo( client, "two", reply ) && reply == "Btwo";
+  // as are new connections on the listening socket taken over
+  network::Socket second( true, params );
+  ok = ok && second.connect( address ) == common::SystemError::ecOK;
+  ok = ok && echo( second, "three", reply ) && reply == "Bthree";
+  client.close();
+  second.close();
+  new_listener.stop();
+  new_listener.wait();
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED" << std::endl;
+  return ok;
+}
+
+int main() {
+  const std::string config = "/tmp/test-network-handover.yaml";
+  std::ofstream( config ) << "dodo:\n  common:\n    application:\n      name: test-network-handover\n"
+                             "    logger:\n      console:\n        level: warning\n";
+  dodo::initLibrary();
+  common::Config* cfg = common::Config::initialize( config );
+  common::Logger::initialize( *cfg );
+  bool ok = true;
+
+  ok = ok && test1();
+  ok = ok && test2();
+  ok = ok && test3();
+
+  dodo::closeLibrary();
+  ::unlink( config.c_str() );
+  return !ok;
+}
@@ -1,4 +1,6 @@
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <dodo.hpp>
 
 using namespace dodo;
@@ -209,6 +211,310 @@ bool test7() {
   return true;
 }
 
+/**
+ * Read a file into a string.
+ */
+std::string readFile( const std::string &filename ) {
+  std::ifstream file( filename, std::ios::binary );
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+bool test8() {
+  std::cout << "incremental parse HTTPRequest, split at every byte ... " << std::endl;
+  std::string data = readFile( BuildEnv::getSourceDirectory() + "/../tests/network/http/get-body-chunked.http" );
+  for ( size_t split = 0; split <= data.size(); split++ ) {
+    network::protocol::http::HTTPRequestParser parser;
+    size_t consumed = 0;
+    network::protocol::http::HTTPFragment::ParseResult result = parser.parse( data.c_str(), split, consumed );
+    if ( consumed != split || ( split < data.size() && !result.incomplete() ) ) {
+      std::cout << "split " << split << " first part " << result.asString() << " consumed " << consumed << std::endl;
+      return false;
+    }
+    if ( split < data.size() ) result = parser.parse( data.c_str() + split, data.size() - split, consumed );
+    if ( !result.ok() || parser.getConsumed() != data.size() ) {
+      std::cout << "split " << split << " parse failed " << result.asString() << std::endl;
+      return false;
+    }
+    if ( parser.getRequest().getRequestLine().getRequestURI() != "/index.html" ||
+         !parser.getRequest().hasHeader( "user-agent" ) ||
+         parser.getRequest().getBody().asString() != "aaaabbbbbbbbcccccccccc" ) {
+      std::cout << "split " << split << " request mismatch (" << parser.getRequest().getBody().asString() << ")"
+                << std::endl;
+      return false;
+    }
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test9() {
+  std::cout << "incremental parse HTTPRequest, byte by byte from a growing buffer ... " << std::endl;
+  std::string data = readFile( BuildEnv::getSourceDirectory() + "/../tests/network/http/get-body.http" );
+  network::protocol::http::HTTPRequestParser parser;
+  common::Bytes buffer;
+  network::protocol::http::HTTPFragment::ParseResult result;
+  for ( size_t i = 0; i < data.size(); i++ ) {
+    buffer.append( static_cast<common::Octet>( data[i] ) );
+    result = parser.parse( buffer );
+    if ( i + 1 < data.size() && !result.incomplete() ) {
+      std::cout << "byte " << i << " unexpected " << result.asString() << std::endl;
+      return false;
+    }
+  }
+  if ( !result.ok() || parser.getRequest().getBody().asString() != "0123456789" ) {
+    std::cout << "parse failed " << result.asString() << std::endl;
+    return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test10() {
+  std::cout << "incremental parse pipelined HTTPRequests ... " << std::endl;
+  std::string data = "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+                     "POST /b HTTP/1.1\r\nContent-Length: 3\r\nX-Folded: one\r\n  two\r\n\r\nabc"
+                     "GET /c HTTP/1.0\r\n\r\n";
+  network::protocol::http::HTTPRequestParser parser;
+  size_t offset = 0;
+  std::vector<std::string> uris;
+  while ( offset < data.size() ) {
+    size_t consumed = 0;
+    network::protocol::http::HTTPFragment::ParseResult result = parser.parse( data.c_str() + offset,
+                                                                              data.size() - offset, consumed );
+    if ( !result.ok() ) {
+      std::cout << "parse failed " << result.asString() << std::endl;
+      return false;
+    }
+    uris.push_back( parser.getRequest().getRequestLine().getRequestURI() );
+    if ( uris.back() == "/b" ) {
+      std::string folded;
+      if ( parser.getRequest().getBody().asString() != "abc" ||
+           !parser.getRequest().getHeaderValue( "x-folded", folded ) || folded != "one two" ) {
+        std::cout << "second request mismatch (" << folded << ")" << std::endl;
+        return false;
+      }
+    }
+    offset += consumed;
+    parser.reset();
+  }
+  if ( uris.size() != 3 || uris[0] != "/a" || uris[1] != "/b" || uris[2] != "/c" ) {
+    std::cout << "pipelined requests mismatch" << std::endl;
+    return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test11() {
+  std::cout << "incremental parse invalid HTTPRequests ... " << std::endl;
+  struct {
+    std::string data;
+    network::protocol::http::HTTPFragment::ParseError error;
+  } cases[] = {
+    { "FETCH / HTTP/1.1\r\n\r\n", network::protocol::http::HTTPFragment::peInvalidMethod },
+    { "GET / HTTP/x.1\r\n\r\n", network::protocol::http::HTTPFragment::peInvalidHTTPVersion },
+    { "GET / HTTP/1.1\r\nHost x\r\n\r\n", network::protocol::http::HTTPFragment::peExpectingHeaderColon },
+    { "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", network::protocol::http::HTTPFragment::peInvalidContentLength },
+    { "GET / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", network::protocol::http::HTTPFragment::peInvalidTransferEncoding },
+    { "GET / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nz\r\n", network::protocol::http::HTTPFragment::peInvalidChunkHex },
+    { "GET / HTTP/1.1\r\nX: " + std::string( 200, 'x' ) + "\r\n\r\n", network::protocol::http::HTTPFragment::peHeaderTooLarge },
+  };
+  for ( auto &c : cases ) {
+    network::protocol::http::HTTPRequestParser parser( 128 );
+    size_t consumed = 0;
+    network::protocol::http::HTTPFragment::ParseResult result = parser.parse( c.data.c_str(), c.data.size(), consumed );
+    if ( result.asString() != network::protocol::http::HTTPFragment::ParseResult( c.error, common::SystemError::ecOK ).asString() ) {
+      std::cout << "unexpected " << result.asString() << " for " << c.data << std::endl;
+      return false;
+    }
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test12() {
+  std::cout << "parse HTTPRequest with bodies across buffer underflows ... " << std::endl;
+  for ( size_t bufsize = 1; bufsize <= 16; bufsize++ ) {
+    network::protocol::http::HTTPRequest request;
+    network::FileReadBuffer sbuf( BuildEnv::getSourceDirectory() + "/../tests/network/http/get-body-chunked.http", bufsize );
+    network::protocol::http::HTTPFragment::ParseResult result = request.parse( sbuf );
+    if ( !result.ok() || request.getBody().asString() != "aaaabbbbbbbbcccccccccc" ) {
+      std::cout << "bufsize " << bufsize << " chunked body parse failure " << result.asString() << std::endl;
+      return false;
+    }
+    network::protocol::http::HTTPRequest request2;
+    network::FileReadBuffer sbuf2( BuildEnv::getSourceDirectory() + "/../tests/network/http/get-body.http", bufsize );
+    result = request2.parse( sbuf2 );
+    std::string host;
+    if ( !result.ok() || request2.getBody().asString() != "0123456789" ||
+         !request2.getHeaderValue( "host", host ) || host != "www.knmi.nl" ) {
+      std::cout << "bufsize " << bufsize << " body parse failure " << result.asString() << std::endl;
+      return false;
+    }
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test13() {
+  std::cout << "HTTPScan implementations agree with the scalar scan ... " << std::endl;
+  typedef network::protocol::http::HTTPScan HTTPScan;
+  // random data biased towards token chars, so that spans cross the 16 and 32 byte blocks
+  std::string data( 4096, ' ' );
+  unsigned int seed = 42;
+  for ( auto &c : data ) {
+    seed = seed * 1103515245 + 12345;
+    unsigned int r = ( seed >> 16 ) & 0x7fff;
+    c = static_cast<char>( r % 8 == 0 ? r % 256 : 'a' + r % 26 );
+  }
+  HTTPScan::Implementation best = HTTPScan::getBestImplementation();
+  std::cout << "best implementation " << HTTPScan::implementationAsString( best ) << std::endl;
+  for ( int im = HTTPScan::imScalar; im <= best; im++ ) {
+    HTTPScan::setImplementation( static_cast<HTTPScan::Implementation>( im ) );
+    for ( size_t offset = 0; offset < 512; offset++ ) {
+      for ( size_t size : { size_t(0), size_t(1), size_t(15), size_t(16), size_t(31), size_t(33), size_t(100),
+                            data.size() - offset } ) {
+        const char* p = data.data() + offset;
+        size_t token = 0, value = 0, line = 0;
+        while ( token < size && HTTPScan::isTokenChar( p[token] ) ) token++;
+        while ( value < size && p[value] != '\r' && p[value] != ' ' && p[value] != '\t' ) value++;
+        while ( line < size && p[line] != '\r' && p[line] != '\n' ) line++;
+        if ( HTTPScan::tokenSpan( p, size ) != token || HTTPScan::fieldValueSpan( p, size ) != value ||
+             HTTPScan::lineSpan( p, size ) != line ) {
+          std::cout << HTTPScan::implementationAsString( HTTPScan::getImplementation() ) << " mismatch at offset " <<
+                       offset << " size " << size << std::endl;
+          HTTPScan::setImplementation( best );
+          return false;
+        }
+      }
+    }
+  }
+  HTTPScan::setImplementation( best );
+  for ( int c = 0; c < 256; c++ ) {
+    char ch = static_cast<char>( c );
+    bool token = c > 32 && c < 127 && std::string( "()<>@,;:\\\"/[]?={}" ).find( ch ) == std::string::npos;
+    if ( HTTPScan::isTokenChar( ch ) != token ) {
+      std::cout << "token char mismatch for " << c << std::endl;
+      return false;
+    }
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test14() {
+  std::cout << "incremental parse HTTPRequest headers into a HTTPHeaderView ... " << std::endl;
+  std::string data = "GET / HTTP/1.1\r\nHost:  www.knmi.nl \r\nX-Folded: one\r\n\t two  three\r\n";
+  for ( size_t i = 0; i < 20; i++ ) data += "X-Header-" + std::to_string( i ) + ": value " + std::to_string( i ) + "\r\n";
+  data += "\r\n";
+  network::protocol::http::HTTPRequestParser parser;
+  common::Bytes buffer;
+  network::protocol::http::HTTPFragment::ParseResult result;
+  // grow the buffer in small parts, so that it moves while the view refers to it
+  for ( size_t i = 0; i < data.size(); i += 7 ) {
+    buffer.append( reinterpret_cast<const common::Octet*>( data.data() + i ), std::min( size_t(7), data.size() - i ) );
+    result = parser.parse( buffer );
+  }
+  const network::protocol::http::HTTPHeaderView &headers = parser.getHeaders();
+  std::string_view value;
+  if ( !result.ok() || headers.size() != 22 || !headers.getValue( "HOST", value ) || value != "www.knmi.nl" ||
+       headers.getName( 21 ) != "X-Header-19" || !headers.getValue( "x-header-17", value ) || value != "value 17" ||
+       headers.find( "x-header-20" ) != network::protocol::http::HTTPHeaderView::npos ) {
+    std::cout << "header view mismatch " << result.asString() << std::endl;
+    return false;
+  }
+  std::string folded;
+  if ( headers.materialize( 1 ) != "one two three" || !parser.getRequest().getHeaderValue( "x-folded", folded ) ||
+       folded != "one two three" || !parser.getRequest().hasHeader( "x-header-19" ) ) {
+    std::cout << "materialized header mismatch (" << folded << ")" << std::endl;
+    return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test15() {
+  std::cout << "HTTPHeader perfect hash and typed header accessors ... " << std::endl;
+  typedef network::protocol::http::HTTPHeader HTTPHeader;
+  for ( int id = HTTPHeader::hiUnknown + 1; id < HTTPHeader::hiCount; id++ ) {
+    std::string name( HTTPHeader::getName( static_cast<HTTPHeader::Id>( id ) ) );
+    std::string upper = name;
+    for ( auto &c : upper ) c = static_cast<char>( std::toupper( c ) );
+    if ( HTTPHeader::lookup( name ) != id || HTTPHeader::lookup( upper ) != id ||
+         HTTPHeader::lookup( name + "x" ) != HTTPHeader::hiUnknown ) {
+      std::cout << "lookup mismatch for " << name << std::endl;
+      return false;
+    }
+  }
+  if ( HTTPHeader::lookup( "x-custom" ) != HTTPHeader::hiUnknown || HTTPHeader::lookup( "" ) != HTTPHeader::hiUnknown ) {
+    std::cout << "unknown header lookup mismatch" << std::endl;
+    return false;
+  }
+  network::protocol::http::HTTPRequest parsed;
+  network::FileReadBuffer sbuf( BuildEnv::getSourceDirectory() + "/../tests/network/http/get-body.http" );
+  network::protocol::http::HTTPFragment::ParseResult result = parsed.parse( sbuf );
+  // a copy must not refer to the headers of the original
+  network::protocol::http::HTTPRequest request = parsed;
+  parsed.clearHeaders();
+  std::string host;
+  unsigned long length = 0;
+  if ( !result.ok() || !request.getHost( host ) || host != "www.knmi.nl" || !request.getContentLength( length ) ||
+       length != 10 || request.hasHeader( HTTPHeader::hiTransferEncoding ) ||
+       !request.getHeader( HTTPHeader::hiUserAgent ) || *request.getHeader( HTTPHeader::hiUserAgent ) != "curl/7.74.0" ) {
+    std::cout << "typed accessor mismatch " << result.asString() << std::endl;
+    return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test16() {
+  std::cout << "incremental parse HTTPRequests with a maximum body size ... " << std::endl;
+  typedef network::protocol::http::HTTPFragment HTTPFragment;
+  struct {
+    std::string data;
+    HTTPFragment::ParseError error;
+  } cases[] = {
+    { "POST / HTTP/1.1\r\nContent-Length: 16\r\n\r\n" + std::string( 16, 'x' ), HTTPFragment::peOk },
+    { "POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n", HTTPFragment::peBodyTooLarge },
+    { "POST / HTTP/1.1\r\nContent-Length: 999999999999999999\r\n\r\n", HTTPFragment::peBodyTooLarge },
+    { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n8\r\naaaaaaaa\r\n8\r\nbbbbbbbb\r\n0\r\n\r\n",
+      HTTPFragment::peOk },
+    { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n8\r\naaaaaaaa\r\n9\r\n", HTTPFragment::peBodyTooLarge },
+    { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nfffffffffffffff", HTTPFragment::peBodyTooLarge },
+  };
+  for ( auto &c : cases ) {
+    network::protocol::http::HTTPRequestParser parser( 128, 16 );
+    size_t consumed = 0;
+    HTTPFragment::ParseResult result = parser.parse( c.data.c_str(), c.data.size(), consumed );
+    if ( result.asString() != HTTPFragment::ParseResult( c.error, common::SystemError::ecOK ).asString() ||
+         ( result.ok() && parser.getRequest().getBody().getSize() != 16 ) ) {
+      std::cout << "unexpected " << result.asString() << " for " << c.data << std::endl;
+      return false;
+    }
+  }
+  // the size of a chunk is checked before its data arrives
+  std::string data = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10\r\n" + std::string( 16, 'x' ) +
+                     "\r\n1\r\n";
+  network::protocol::http::HTTPRequestParser parser( 128, 16 );
+  size_t consumed = 0;
+  HTTPFragment::ParseResult result = parser.parse( data.c_str(), data.size() - 3, consumed );
+  if ( !result.incomplete() || parser.getRequest().getBody().getSize() != 16 ) {
+    std::cout << "unexpected " << result.asString() << " before the second chunk" << std::endl;
+    return false;
+  }
+  result = parser.parse( data.c_str() + consumed, 3, consumed );
+  HTTPFragment::ParseResult expected( HTTPFragment::peBodyTooLarge, common::SystemError::ecOK );
+  if ( result.asString() != expected.asString() ) {
+    std::cout << "unexpected " << result.asString() << " for the second chunk" << std::endl;
+    return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
 int main() {
   int error = 0;
   try {
@@ -229,6 +535,24 @@ int main() {
 
     ok = ok && test7();
 
+    ok = ok && test8();
+
+    ok = ok && test9();
+
+    ok = ok && test10();
+
+    ok = ok && test11();
+
+    ok = ok && test12();
+
+    ok = ok && test13();
+
+    ok = ok && test14();
+
+    ok = ok && test15();
+
+    ok = ok && test16();
+
     error = ( ok != true );
   }
   catch ( const std::exception& e ) {
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+bool test1() {
+  // the key identifies the host, not the port
+  std::cout << "RateLimiter key ... ";
+  uint64_t a1 = network::RateLimiter::key( network::Address( "127.0.0.1", 80 ) );
+  uint64_t a2 = network::RateLimiter::key( network::Address( "127.0.0.1", 443 ) );
+  uint64_t b = network::RateLimiter::key( network::Address( "127.0.0.2", 80 ) );
+  uint64_t c = network::RateLimiter::key( network::Address( "::1", 80 ) );
+  if ( a1 != a2 || a1 == b || a1 == c || !a1 || !b || !c ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // a full bucket admits connection_burst connections at once, then one per 1 / connection_rate
+  std::cout << "RateLimiter connection burst and rate ... ";
+  network::RateLimiter::Params params;
+  params.connection_rate = 100;
+  params.connection_burst = 5;
+  network::RateLimiter limiter( params, 64 );
+  uint32_t slot = network::RateLimiter::no_slot;
+  size_t admitted = 0;
+  common::StopWatch sw;
+  while ( limiter.admitConnection( 1, slot ) ) admitted++;
+  if ( slot == network::RateLimiter::no_slot ) return false;
+  if ( admitted < 5 || (double)admitted > 5 + sw.getElapsedSeconds() * params.connection_rate + 1 ) return false;
+  // the bucket refills at the rate, up to the burst
+  std::this_thread::sleep_for( std::chrono::milliseconds( 30 ) );
+  double refill_s = sw.getElapsedSeconds();
+  while ( limiter.admitConnection( 1, slot ) ) admitted++;
+  double total_s = sw.getElapsedSeconds();
+  std::cout << "(" << admitted << " in " << total_s << "s) ";
+  double low = std::min( 5 + std::floor( refill_s * params.connection_rate ), 10.0 ) - 1;
+  if ( (double)admitted < low || (double)admitted > 5 + total_s * params.connection_rate + 1 ) return false;
+  // other hosts have their own bucket
+  uint32_t other = network::RateLimiter::no_slot;
+  if ( !limiter.admitConnection( 2, other ) || other == slot ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // requests are limited per host on the slot of the connection
+  std::cout << "RateLimiter request burst and rate ... ";
+  network::RateLimiter::Params params;
+  params.request_rate = 1;
+  params.request_burst = 10;
+  network::RateLimiter limiter( params, 64 );
+  uint32_t slot = network::RateLimiter::no_slot;
+  if ( !limiter.admitConnection( 1, slot ) ) return false;
+  size_t admitted = 0;
+  while ( admitted < 100 && limiter.admitRequest( slot ) ) admitted++;
+  if ( admitted != 10 ) return false;
+  // untracked connections are not limited
+  for ( int i = 0; i < 100; i++ ) {
+    if ( !limiter.admitRequest( network::RateLimiter::no_slot ) ) return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // at most max_connections per host, a released connection makes room
+  std::cout << "RateLimiter max connections ... ";
+  network::RateLimiter::Params params;
+  params.max_connections = 2;
+  network::RateLimiter limiter( params, 64 );
+  uint32_t s1, s2, s3, s4;
+  if ( !limiter.admitConnection( 7, s1 ) || !limiter.admitConnection( 7, s2 ) ) return false;
+  if ( s1 != s2 || limiter.admitConnection( 7, s3 ) ) return false;
+  if ( !limiter.admitConnection( 8, s4 ) || s4 == s1 ) return false;
+  limiter.releaseConnection( s1 );
+  if ( !limiter.admitConnection( 7, s3 ) || s3 != s1 || limiter.admitConnection( 7, s3 ) ) return false;
+  // releasing more than admitted does not wrap the count
+  limiter.releaseConnection( s4 );
+  limiter.releaseConnection( s4 );
+  if ( !limiter.admitConnection( 8, s4 ) || !limiter.admitConnection( 8, s4 ) || limiter.admitConnection( 8, s4 ) )
+    return false;
+  limiter.releaseConnection( network::RateLimiter::no_slot );
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test5() {
+  // a slot is pinned whilst its host has connections and reused once it has none
+  std::cout << "RateLimiter slot reuse ... ";
+  network::RateLimiter::Params params;
+  params.max_connections = 1;
+  // 8 slots, so keys that differ by a multiple of 8 share the probe sequence
+  network::RateLimiter limiter( params, 8 );
+  uint32_t slots[network::RateLimiter::max_probes];
+  for ( uint64_t host = 0; host < network::RateLimiter::max_probes; host++ ) {
+    if ( !limiter.admitConnection( 8 * host + 8, slots[host] ) ) return false;
+    if ( slots[host] == network::RateLimiter::no_slot ) return false;
+  }
+  // the probe sequence is full, a further host is admitted but not tracked
+  uint32_t untracked = 0;
+  if ( !limiter.admitConnection( 1000, untracked ) || untracked != network::RateLimiter::no_slot ) return false;
+  // the tracked hosts are still limited
+  uint32_t slot = 0;
+  if ( limiter.admitConnection( 16, slot ) ) return false;
+  // a host without connections gives up its slot to a new host
+  limiter.releaseConnection( slots[3] );
+  if ( !limiter.admitConnection( 2000, slot ) || slot != slots[3] ) return false;
+  if ( limiter.admitConnection( 2000, slot ) ) return false;
+  // and the previous host then finds no slot, it is not tracked
+  if ( !limiter.admitConnection( 32, slot ) || slot != network::RateLimiter::no_slot ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  ok = ok && test5();
+  if ( !ok ) return 1;
+
+  return 0;
+}
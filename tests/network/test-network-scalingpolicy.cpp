@@ -0,0 +1,138 @@
+#include <iostream>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/**
+ * Return a Sample.
+ */
+network::ScalingPolicy::Sample sample( size_t active, double queue_wait_us, double utilisation,
+                                       double throughput = 1000 ) {
+  network::ScalingPolicy::Sample s;
+  s.interval_s = 1;
+  s.active = active;
+  s.minservers = 2;
+  s.maxservers = 16;
+  s.queue_wait_us = queue_wait_us;
+  s.utilisation = utilisation;
+  s.throughput = throughput;
+  return s;
+}
+
+bool test1() {
+  // scale up only after up_intervals consecutive intervals under pressure
+  std::cout << "LatencyScalingPolicy scale up ... ";
+  network::LatencyScalingPolicy::Params params;
+  network::LatencyScalingPolicy policy( params );
+  if ( policy.decide( sample( 4, 5000, 0.5 ) ) != 4 ) return false;
+  if ( policy.decide( sample( 4, 5000, 0.5 ) ) != 5 || policy.getReason() != "queue-wait" ) return false;
+  // pressure has to persist for another up_intervals before the next scale up
+  if ( policy.decide( sample( 5, 5000, 0.5, 2000 ) ) != 5 ) return false;
+  // proportional to the utilisation, but at most doubling the pool
+  size_t target = policy.decide( sample( 5, 0, 1.0, 4000 ) );
+  if ( target != 8 || policy.getReason() != "utilisation" ) return false;
+  network::LatencyScalingPolicy::Params low = params;
+  low.up_utilisation = 0.5;
+  low.down_utilisation = 0.1;
+  network::LatencyScalingPolicy doubling( low );
+  doubling.decide( sample( 2, 0, 1.0 ) );
+  if ( doubling.decide( sample( 2, 0, 1.0 ) ) != 4 ) return false;
+  // not beyond maxservers
+  network::LatencyScalingPolicy full( params );
+  for ( int i = 0; i < 5; i++ ) {
+    if ( full.decide( sample( 16, 5000, 1.0 ) ) != 16 ) return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // a single interval under pressure or a load between the thresholds does not scale
+  std::cout << "LatencyScalingPolicy hysteresis ... ";
+  network::LatencyScalingPolicy::Params params;
+  network::LatencyScalingPolicy policy( params );
+  for ( int i = 0; i < 10; i++ ) {
+    if ( policy.decide( sample( 4, 5000, 0.5 ) ) != 4 ) return false;
+    if ( policy.decide( sample( 4, 100, 0.6 ) ) != 4 ) return false;
+  }
+  // idle intervals interrupted by a moderate load restart the count
+  for ( size_t i = 0; i < params.down_intervals - 1; i++ ) {
+    if ( policy.decide( sample( 4, 0, 0.1 ) ) != 4 ) return false;
+  }
+  if ( policy.decide( sample( 4, 0, 0.6 ) ) != 4 ) return false;
+  for ( size_t i = 0; i < params.down_intervals - 1; i++ ) {
+    if ( policy.decide( sample( 4, 0, 0.1 ) ) != 4 ) return false;
+  }
+  if ( policy.decide( sample( 4, 0, 0.1 ) ) != 3 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // idle pools shrink (park TCPServers) one at a time, down to minservers
+  std::cout << "LatencyScalingPolicy scale down ... ";
+  network::LatencyScalingPolicy::Params params;
+  network::LatencyScalingPolicy policy( params );
+  size_t active = 4;
+  for ( size_t interval = 0; interval < 5 * params.down_intervals; interval++ ) {
+    size_t target = policy.decide( sample( active, 0, 0.05 ) );
+    if ( target != active ) {
+      if ( target != active - 1 || policy.getReason() != "idle" ) return false;
+      if ( ( interval + 1 ) % params.down_intervals != 0 ) return false;
+      active = target;
+    }
+  }
+  if ( active != 2 ) return false;
+  // a queue wait above up_wait_us / 4 is not idle
+  network::LatencyScalingPolicy waiting( params );
+  for ( size_t interval = 0; interval < 2 * params.down_intervals; interval++ ) {
+    if ( waiting.decide( sample( 4, params.up_wait_us / 2, 0.05 ) ) != 4 ) return false;
+  }
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // a scale up that did not raise the throughput stops further scale ups whilst the pressure persists
+  std::cout << "LatencyScalingPolicy saturation ... ";
+  network::LatencyScalingPolicy::Params params;
+  network::LatencyScalingPolicy policy( params );
+  policy.decide( sample( 4, 5000, 0.5, 1000 ) );
+  if ( policy.decide( sample( 4, 5000, 0.5, 1000 ) ) != 5 ) return false;
+  policy.decide( sample( 5, 5000, 0.5, 1010 ) );
+  if ( policy.decide( sample( 5, 5000, 0.5, 1010 ) ) != 5 || policy.getReason() != "saturated" ) return false;
+  // still saturated
+  policy.decide( sample( 5, 5000, 0.5, 1020 ) );
+  if ( policy.decide( sample( 5, 5000, 0.5, 1020 ) ) != 5 || policy.getReason() != "saturated" ) return false;
+  // once the pressure has gone, the next pressure scales up again
+  policy.decide( sample( 5, 100, 0.5, 1000 ) );
+  policy.decide( sample( 5, 5000, 0.5, 1000 ) );
+  if ( policy.decide( sample( 5, 5000, 0.5, 1000 ) ) != 6 ) return false;
+  // a scale up that raised the throughput is followed by another
+  network::LatencyScalingPolicy scaling( params );
+  scaling.decide( sample( 4, 5000, 0.5, 1000 ) );
+  if ( scaling.decide( sample( 4, 5000, 0.5, 1000 ) ) != 5 ) return false;
+  scaling.decide( sample( 5, 5000, 0.5, 1200 ) );
+  if ( scaling.decide( sample( 5, 5000, 0.5, 1200 ) ) != 6 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  return 0;
+}
@@ -1,4 +1,13 @@
 #include <iostream>
+#include <fcntl.h>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <dodo.hpp>
 
 using namespace dodo;
@@ -59,6 +68,239 @@ bool test2() {
          sock.getBlocking();
 }
 
+/**
+ * Return the test byte at position i, which does not repeat every 256 bytes.
+ */
+char pattern( size_t i ) {
+  return static_cast<char>( ( i * 7 + i / 251 ) & 0xff );
+}
+
+/**
+ * Return length test bytes from position offset.
+ */
+std::string patternBytes( size_t offset, size_t length ) {
+  std::string bytes( length, 0 );
+  for ( size_t i = 0; i < length; i++ ) bytes[i] = pattern( offset + i );
+  return bytes;
+}
+
+/**
+ * Connect a socketpair, the sender non-blocking with a small send buffer so that it fills whilst the receiver does
+ * not read.
+ */
+bool socketPair( network::Socket &sender, network::Socket &receiver ) {
+  int fds[2];
+  if ( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) != 0 ) return false;
+  sender = fds[0];
+  receiver = fds[1];
+  sender.setSendBufSize( 4096 );
+  sender.setBlocking( false );
+  return true;
+}
+
+/**
+ * Send length bytes with send( done, sent ), which sends from position done and sets the number of bytes sent. The
+ * first call must make partial progress as the receiver does not read yet, the remainder is sent whilst a slow
+ * reader receives.
+ * @param received The bytes received.
+ * @return True if the first call was partial and all bytes were sent and received.
+ */
+bool sendSlowly( network::Socket &sender, network::Socket &receiver, size_t length,
+                 const std::function<common::SystemError( size_t, size_t& )> &send, std::string &received ) {
+  size_t done = 0;
+  size_t sent = 0;
+  common::SystemError error = send( done, sent );
+  if ( error != common::SystemError::ecEAGAIN || sent == 0 || sent >= length ) {
+    std::cout << "first send " << error.asString() << " sent " << sent << " ";
+    return false;
+  }
+  done = sent;
+  std::thread reader( [&] {
+    char buf[4096];
+    while ( received.size() < length ) {
+      ssize_t count = 0;
+      if ( receiver.receive( buf, sizeof(buf), count ) != common::SystemError::ecOK || count <= 0 ) return;
+      received.append( buf, count );
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+    }
+  } );
+  while ( done < length ) {
+    error = send( done, sent );
+    done += sent;
+    if ( error == common::SystemError::ecEAGAIN ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    else if ( error != common::SystemError::ecOK ) break;
+  }
+  // ends the reader if not all bytes were sent
+  ::shutdown( sender.getFD(), SHUT_WR );
+  reader.join();
+  if ( done != length || received.size() != length ) {
+    std::cout << "sent " << done << " received " << received.size() << " of " << length << " ";
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Write length test bytes to file.
+ */
+void writeFile( const std::string &file, size_t length ) {
+  std::ofstream( file, std::ios::binary ) << patternBytes( 0, length );
+}
+
+bool test3() {
+  // a regular file is sent with sendfile from the offset, with partial progress on a full socket
+  std::cout << "Socket::sendFile regular file ... ";
+  const std::string file = "/tmp/test-network-socket-sendfile.data";
+  writeFile( file, 262144 );
+  int fd = ::open( file.c_str(), O_RDONLY | O_CLOEXEC );
+  network::Socket sender, receiver;
+  bool ok = fd >= 0 && socketPair( sender, receiver );
+  const size_t offset = 1000;
+  const size_t length = 200000;
+  std::string received;
+  ok = ok && sendSlowly( sender, receiver, length, [&]( size_t done, size_t &sent ) {
+    return sender.sendFile( fd, offset + done, length - done, sent );
+  }, received );
+  ok = ok && received == patternBytes( offset, length );
+  sender.close();
+  receiver.close();
+  // the file ends before length bytes
+  ok = ok && socketPair( sender, receiver );
+  size_t sent = 0;
+  ok = ok && sender.sendFile( fd, 262144 - 10, 100, sent ) == common::SystemError::ecENODATA && sent == 10;
+  sender.close();
+  receiver.close();
+  if ( fd >= 0 ) ::close( fd );
+  ::unlink( file.c_str() );
+  if ( ok ) std::cout << "OK" << std::endl;
+  return ok;
+}
+
+bool test4() {
+  // a FIFO is spliced to the socket, only the bytes the socket accepted are consumed from it, and an empty
+  // blocking FIFO does not block
+  std::cout << "Socket::sendFile FIFO ... ";
+  const std::string file = "/tmp/test-network-socket-sendfile.fifo";
+  ::unlink( file.c_str() );
+  bool ok = mkfifo( file.c_str(), 0600 ) == 0;
+  int rfd = ok ? ::open( file.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC ) : -1;
+  int wfd = rfd >= 0 ? ::open( file.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC ) : -1;
+  // larger than the socket buffer takes
+  const size_t length = 1000000;
+  ok = ok && rfd >= 0 && wfd >= 0 && fcntl( rfd, F_SETFL, 0 ) == 0 && fcntl( wfd, F_SETPIPE_SZ, length ) >= 0;
+  network::Socket sender, receiver;
+  ok = ok && socketPair( sender, receiver );
+  size_t sent = 1;
+  ok = ok && sender.sendFile( rfd, 0, 100, sent ) == common::SystemError::ecEAGAIN && sent == 0;
+  std::string bytes = patternBytes( 0, length );
+  ok = ok && ::write( wfd, bytes.data(), length ) == (ssize_t)length;
+  std::string received;
+  ok = ok && sendSlowly( sender, receiver, length, [&]( size_t done, size_t &sent ) {
+    return sender.sendFile( rfd, 0, length - done, sent );
+  }, received );
+  ok = ok && received == bytes;
+  // the FIFO is drained and closed by the writer
+  if ( wfd >= 0 ) ::close( wfd );
+  ok = ok && sender.sendFile( rfd, 0, 100, sent ) == common::SystemError::ecENODATA && sent == 0;
+  sender.close();
+  receiver.close();
+  if ( rfd >= 0 ) ::close( rfd );
+  ::unlink( file.c_str() );
+  if ( ok ) std::cout << "OK" << std::endl;
+  return ok;
+}
+
+bool test5() {
+  // the pread fallback of BaseSocket::sendFile, also used for other file types such as character devices
+  std::cout << "BaseSocket::sendFile pread fallback ... ";
+  const std::string file = "/tmp/test-network-socket-pread.data";
+  writeFile( file, 131072 );
+  int fd = ::open( file.c_str(), O_RDONLY | O_CLOEXEC );
+  network::Socket sender, receiver;
+  bool ok = fd >= 0 && socketPair( sender, receiver );
+  const size_t offset = 333;
+  const size_t length = 100000;
+  std::string received;
+  ok = ok && sendSlowly( sender, receiver, length, [&]( size_t done, size_t &sent ) {
+    return sender.network::BaseSocket::sendFile( fd, offset + done, length - done, sent );
+  }, received );
+  ok = ok && received == patternBytes( offset, length );
+  sender.close();
+  receiver.close();
+  if ( fd >= 0 ) ::close( fd );
+  ::unlink( file.c_str() );
+  fd = ::open( "/dev/zero", O_RDONLY | O_CLOEXEC );
+  ok = ok && fd >= 0 && socketPair( sender, receiver );
+  size_t sent = 0;
+  ok = ok && sender.sendFile( fd, 0, 1000, sent ) == common::SystemError::ecOK && sent == 1000;
+  char buf[1000];
+  ssize_t count = 0;
+  ok = ok && receiver.receive( buf, sizeof(buf), count ) == common::SystemError::ecOK && count == 1000 &&
+       std::string( buf, count ) == std::string( 1000, 0 );
+  sender.close();
+  receiver.close();
+  if ( fd >= 0 ) ::close( fd );
+  if ( ok ) std::cout << "OK" << std::endl;
+  return ok;
+}
+
+bool test6() {
+  // sendv resumes partial writes in the middle of an iovec and across batches of sendv_max_iov buffers, receivev
+  // fills its buffers in order
+  std::cout << "Socket::sendv partial writes and receivev ... ";
+  network::Socket sender, receiver;
+  bool ok = socketPair( sender, receiver );
+  sender.setBlocking( true );
+  // a signal interrupts the blocked sendmsg, which returns what it sent so far
+  struct sigaction action, previous;
+  memset( &action, 0, sizeof(action) );
+  action.sa_handler = []( int ) {};
+  sigaction( SIGUSR1, &action, &previous );
+  std::string bytes;
+  std::vector<size_t> sizes;
+  for ( size_t i = 0; i < 200; i++ ) sizes.push_back( i % 10 == 0 ? 0 : ( i * 7919 ) % 20000 + 1 );
+  for ( auto size : sizes ) bytes += patternBytes( bytes.size(), size );
+  std::vector<network::ConstBuffer> buffers;
+  size_t offset = 0;
+  for ( auto size : sizes ) {
+    buffers.push_back( network::ConstBuffer( bytes.data() + offset, size ) );
+    offset += size;
+  }
+  pthread_t sending = pthread_self();
+  std::string received;
+  std::thread reader( [&] {
+    char first[1000], second[1], third[3000];
+    network::MutableBuffer parts[3] = { { first, sizeof(first) }, { second, sizeof(second) },
+                                        { third, sizeof(third) } };
+    while ( received.size() < bytes.size() ) {
+      ssize_t count = 0;
+      if ( receiver.receivev( parts, 3, count ) != common::SystemError::ecOK || count <= 0 ) return;
+      size_t left = count;
+      for ( const auto &part : parts ) {
+        size_t take = std::min( left, part.size );
+        received.append( static_cast<const char*>( part.data ), take );
+        left -= take;
+      }
+      // interrupt the sender whilst it waits for the reader
+      if ( ( received.size() - count ) / 65536 != received.size() / 65536 ) {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        pthread_kill( sending, SIGUSR1 );
+      }
+    }
+  } );
+  common::SystemError error = sender.sendv( buffers.data(), buffers.size() );
+  // ends the reader if not all bytes were sent
+  ::shutdown( sender.getFD(), SHUT_WR );
+  reader.join();
+  sigaction( SIGUSR1, &previous, nullptr );
+  sender.close();
+  receiver.close();
+  ok = ok && error == common::SystemError::ecOK && received == bytes;
+  if ( ok ) std::cout << "OK" << std::endl;
+  else std::cout << "FAILED (" << error.asString() << " received " << received.size() << " of " << bytes.size() <<
+                    ")" << std::endl;
+  return ok;
+}
 
 int main() {
   std::cout << BuildEnv::getDescription();
@@ -70,5 +312,17 @@ int main() {
   ok = ok && test2();
   if ( !ok ) return 1;
 
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  ok = ok && test5();
+  if ( !ok ) return 1;
+
+  ok = ok && test6();
+  if ( !ok ) return 1;
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,611 @@
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/** The self-signed certificate and key of the TLS listener. */
+const std::string cert_file = "/tmp/test-network-tcplistener.cert.pem";
+const std::string key_file = "/tmp/test-network-tcplistener.key.pem";
+
+/**
+ * Write a self-signed certificate and its key to cert_file and key_file.
+ */
+bool writeIdentity() {
+  EVP_PKEY* pkey = nullptr;
+  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, nullptr );
+  bool ok = pctx && EVP_PKEY_keygen_init( pctx ) == 1 &&
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pctx, NID_X9_62_prime256v1 ) == 1 &&
+            EVP_PKEY_keygen( pctx, &pkey ) == 1;
+  EVP_PKEY_CTX_free( pctx );
+  X509* cert = X509_new();
+  if ( ok ) {
+    X509_set_version( cert, 2 );
+    ASN1_INTEGER_set( X509_get_serialNumber( cert ), 1 );
+    X509_gmtime_adj( X509_getm_notBefore( cert ), 0 );
+    X509_gmtime_adj( X509_getm_notAfter( cert ), 3600 );
+    X509_set_pubkey( cert, pkey );
+    X509_NAME* name = X509_get_subject_name( cert );
+    X509_NAME_add_entry_by_txt( name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0 );
+    X509_set_issuer_name( cert, name );
+    ok = X509_sign( cert, pkey, EVP_sha256() ) > 0;
+  }
+  FILE* f = ok ? fopen( cert_file.c_str(), "w" ) : nullptr;
+  ok = f && PEM_write_X509( f, cert ) == 1;
+  if ( f ) fclose( f );
+  f = ok ? fopen( key_file.c_str(), "w" ) : nullptr;
+  ok = f && PEM_write_PrivateKey( f, pkey, nullptr, nullptr, 0, nullptr, nullptr ) == 1;
+  if ( f ) fclose( f );
+  X509_free( cert );
+  EVP_PKEY_free( pkey );
+  return ok;
+}
+
+/**
+ * Send the pending TLS output of a client to the socket a few bytes at a time, so that the server receives
+ * partial records.
+ */
+bool trickle( BIO* output, network::Socket &socket ) {
+  char buf[7];
+  int count = 0;
+  while ( ( count = BIO_read( output, buf, sizeof( buf ) ) ) > 0 ) {
+    if ( socket.send( buf, count ) != common::SystemError::ecOK ) return false;
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+  return true;
+}
+
+/**
+ * Receive from the socket and pass the data to the TLS input of a client, false on error or end of stream.
+ */
+bool feed( network::Socket &socket, BIO* input ) {
+  char buf[4096];
+  ssize_t count = 0;
+  if ( socket.receive( buf, sizeof( buf ), count ) != common::SystemError::ecOK || count <= 0 ) return false;
+  return BIO_write( input, buf, static_cast<int>( count ) ) == count;
+}
+
+/**
+ * Line echo TCPServer that prefixes each line with the address of the TCPServer that handled it.
+ */
+class EchoServer : public network::TCPServer {
+  public:
+    explicit EchoServer( network::TCPListener &listener ) : network::TCPServer( listener ) {}
+
+    virtual network::TCPServer* addServer() { return new EchoServer( listener_ ); }
+
+    virtual network::TCPServer* addShardServer( network::TCPListener &shard ) { return new EchoServer( shard ); }
+
+    virtual bool handShake( network::BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      const common::Bytes &buf = work.data->getReadBuffer();
+      if ( buf.getSize() > 0 && buf.getOctet( buf.getSize() - 1 ) == '\n' ) {
+        std::string reply = common::Puts() << common::Puts::hex() << reinterpret_cast<uintptr_t>( this ) << " " <<
+                            std::string( reinterpret_cast<const char*>( buf.getArray() ), buf.getSize() );
+        common::SystemError error = work.data->send( work.socket, reply.c_str(), reply.size() );
+        sent = reply.size();
+        work.data->clearBuffer();
+        return error;
+      }
+      return common::SystemError::ecEAGAIN;
+    }
+
+    virtual void shutDown( network::BaseSocket *socket ) {}
+};
+
+/**
+ * EchoServer that takes a millisecond for each read, slower than a client sending requests back to back.
+ */
+class SlowEchoServer : public EchoServer {
+  public:
+    explicit SlowEchoServer( network::TCPListener &listener ) : EchoServer( listener ) {}
+
+    virtual network::TCPServer* addServer() { return new SlowEchoServer( listener_ ); }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      return EchoServer::readSocket( work, sent );
+    }
+};
+
+/**
+ * TCPServer that answers each line with the address of the TCPListener shard it works for.
+ */
+class ShardServer : public network::TCPServer {
+  public:
+    explicit ShardServer( network::TCPListener &listener ) : network::TCPServer( listener ) {}
+
+    virtual network::TCPServer* addServer() { return new ShardServer( listener_ ); }
+
+    virtual network::TCPServer* addShardServer( network::TCPListener &shard ) { return new ShardServer( shard ); }
+
+    virtual bool handShake( network::BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      const common::Bytes &buf = work.data->getReadBuffer();
+      if ( buf.getSize() > 0 && buf.getOctet( buf.getSize() - 1 ) == '\n' ) {
+        std::string reply = common::Puts() << common::Puts::hex() << reinterpret_cast<uintptr_t>( &listener_ ) <<
+                            "\n";
+        common::SystemError error = work.data->send( work.socket, reply.c_str(), reply.size() );
+        sent = reply.size();
+        work.data->clearBuffer();
+        return error;
+      }
+      return common::SystemError::ecEAGAIN;
+    }
+
+    virtual void shutDown( network::BaseSocket *socket ) {}
+};
+
+/** Whilst false, GateServers do not return from readSocket. */
+std::atomic<bool> gate_open = true;
+
+/**
+ * EchoServer that holds the TCPServer in readSocket until gate_open, so that work queues up.
+ */
+class GateServer : public EchoServer {
+  public:
+    explicit GateServer( network::TCPListener &listener ) : EchoServer( listener ) {}
+
+    virtual network::TCPServer* addServer() { return new GateServer( listener_ ); }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      while ( !gate_open ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      return EchoServer::readSocket( work, sent );
+    }
+};
+
+/**
+ * TCPServer that echoes the received bytes as they arrive.
+ */
+class StreamServer : public network::TCPServer {
+  public:
+    explicit StreamServer( network::TCPListener &listener ) : network::TCPServer( listener ) {}
+
+    virtual network::TCPServer* addServer() { return new StreamServer( listener_ ); }
+
+    virtual bool handShake( network::BaseSocket *socket, ssize_t &received, ssize_t &sent ) { return true; }
+
+    virtual common::SystemError readSocket( network::TCPListener::SocketWork &work, ssize_t &sent ) {
+      const common::Bytes &buf = work.data->getReadBuffer();
+      common::SystemError error = work.data->send( work.socket, buf.getArray(), buf.getSize() );
+      sent = buf.getSize();
+      work.data->clearBuffer();
+      return error;
+    }
+
+    virtual void shutDown( network::BaseSocket *socket ) {}
+};
+
+bool test1() {
+  // with all TCPServers idle, work goes to the most recently idle one, which is the one that handled the previous
+  // request
+  std::cout << "TCPListener wakes the most recently idle TCPServer ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19691;
+  yaml["min-servers"] = 4;
+  yaml["max-servers"] = 4;
+  yaml["max-connections"] = 16;
+  // no TCPServer times out of its wait and re-registers as idle during the test
+  yaml["listener-sleep-ms"] = 2000;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", 19691 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new EchoServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  network::Socket client( true, params );
+  bool ok = client.connect( address ) == common::SystemError::ecOK;
+  std::set<std::string> servers;
+  for ( int i = 0; ok && i < 10; i++ ) {
+    std::string request = "request\n";
+    std::string reply;
+    ok = client.send( request.c_str(), request.size() ) == common::SystemError::ecOK &&
+         client.receiveLine( reply ) == common::SystemError::ecOK;
+    // the connection is established by the first request, count the TCPServers from the second
+    if ( i > 0 ) servers.insert( reply.substr( 0, reply.find( ' ' ) ) );
+    // leave the TCPServer time to go idle
+    std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+  }
+  client.close();
+  listener.stop();
+  listener.wait();
+  ok = ok && servers.size() == 1;
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED (" << servers.size() << " servers)" << std::endl;
+  return ok;
+}
+
+bool test2( const std::string &engine, uint16_t port ) {
+  // a client that does not read its replies is no longer read from once output-high-water is queued, and is
+  // serviced again once it has read them
+  std::cout << "TCPListener output-high-water " << engine << " ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = port;
+  yaml["min-servers"] = 1;
+  yaml["max-servers"] = 1;
+  yaml["max-connections"] = 16;
+  yaml["io-engine"] = engine;
+  yaml["output-high-water"] = 65536;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", port );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new StreamServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  network::Socket client( true, params );
+  bool ok = client.connect( address ) == common::SystemError::ecOK;
+  // far more than the socket buffers hold
+  const size_t total = 16 * 1024 * 1024;
+  std::atomic<size_t> sent = 0;
+  std::thread sender( [&] {
+    std::vector<char> chunk( 65536, 'x' );
+    while ( sent < total ) {
+      if ( client.send( chunk.data(), chunk.size() ) != common::SystemError::ecOK ) return;
+      sent += chunk.size();
+    }
+  } );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 1000 ) );
+  size_t stalled = sent;
+  size_t received = 0;
+  std::vector<char> buf( 65536 );
+  while ( ok && received < total ) {
+    ssize_t count = 0;
+    ok = client.receive( buf.data(), buf.size(), count ) == common::SystemError::ecOK && count > 0;
+    received += count;
+  }
+  // closes the connection, so that the sender does not block if the replies stopped
+  listener.stop();
+  listener.wait();
+  sender.join();
+  client.close();
+  ok = ok && stalled < total && received == total;
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED (" << stalled << " sent unread)" << std::endl;
+  return ok;
+}
+
+bool test3() {
+  // a TLS handshake that arrives a few bytes at a time is resumed on each read event, after which requests and
+  // replies are exchanged and closing the connection sends close_notify
+  std::cout << "TCPListener TLS handshake and round trip ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19694;
+  yaml["min-servers"] = 1;
+  yaml["max-servers"] = 2;
+  yaml["max-connections"] = 16;
+  yaml["stat-trc-interval-s"] = 300;
+  network::TCPListener::Params listener_params( yaml );
+  listener_params.tls = std::make_shared<network::TLSContext>( network::TLSContext::PeerVerification::pvVerifyNone,
+                                                               network::TLSContext::TLSVersion::tls1_2, false,
+                                                               false );
+  listener_params.tls->loadPEMIdentity( cert_file, key_file, "" );
+  network::Address address( "127.0.0.1", 19694 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( address, listener_params );
+  listener.start( new EchoServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  // the client runs TLS over memory BIOs and forwards the records over a plain socket
+  SSL_CTX* client_ctx = SSL_CTX_new( TLS_client_method() );
+  SSL* client = SSL_new( client_ctx );
+  BIO* input = BIO_new( BIO_s_mem() );
+  BIO* output = BIO_new( BIO_s_mem() );
+  SSL_set_bio( client, input, output );
+  SSL_set_connect_state( client );
+  network::Socket socket( true, params );
+  bool ok = socket.connect( address ) == common::SystemError::ecOK;
+  if ( ok ) socket.setTCPNoDelay( true );
+  bool connected = false;
+  while ( ok && !connected ) {
+    int rc = SSL_do_handshake( client );
+    ok = trickle( output, socket );
+    if ( rc == 1 ) connected = true;
+    else ok = ok && SSL_get_error( client, rc ) == SSL_ERROR_WANT_READ && feed( socket, input );
+  }
+  std::string request = "request\n";
+  ok = ok && SSL_write( client, request.c_str(), static_cast<int>( request.size() ) ) > 0 && trickle( output, socket );
+  std::string reply;
+  char buf[256];
+  while ( ok && ( reply.empty() || reply.back() != '\n' ) ) {
+    int count = SSL_read( client, buf, sizeof( buf ) );
+    if ( count > 0 ) reply.append( buf, count );
+    else ok = SSL_get_error( client, count ) == SSL_ERROR_WANT_READ && feed( socket, input );
+  }
+  ok = ok && reply.size() > request.size() && reply.substr( reply.size() - request.size() ) == request;
+  // the client sends close_notify and half-closes, the server closes the connection with its own close_notify
+  ok = ok && SSL_shutdown( client ) == 0 && trickle( output, socket ) && ::shutdown( socket.getFD(), SHUT_WR ) == 0;
+  while ( ok && feed( socket, input ) );
+  bool notified = ok && SSL_read( client, buf, sizeof( buf ) ) <= 0 &&
+                  ( SSL_get_shutdown( client ) & SSL_RECEIVED_SHUTDOWN );
+  socket.close();
+  SSL_free( client );
+  SSL_CTX_free( client_ctx );
+  network::TCPListener::Stats stats = listener.getStats();
+  listener.stop();
+  listener.wait();
+  ok = ok && notified && stats.handshake_failures == 0;
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED" << std::endl;
+  return ok;
+}
+
+bool test4() {
+  // in edge-triggered mode, requests arriving whilst a TCPServer handles the connection are left pending and
+  // requeued when it releases the connection, so pipelined requests do not stall
+  std::cout << "TCPListener edge-triggered pipelining ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19695;
+  yaml["min-servers"] = 2;
+  yaml["max-servers"] = 2;
+  yaml["max-connections"] = 16;
+  yaml["edge-triggered"] = true;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", 19695 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new SlowEchoServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  const size_t clients = 4;
+  const size_t requests = 200;
+  std::vector<size_t> replies( clients, 0 );
+  std::vector<std::thread> threads;
+  for ( size_t c = 0; c < clients; c++ ) {
+    threads.push_back( std::thread( [&, c] {
+      network::Socket client( true, params );
+      if ( client.connect( address ) != common::SystemError::ecOK ) return;
+      // a stalled connection times out instead of blocking the test
+      client.setReceiveTimeout( 5 );
+      std::string request = "request\n";
+      for ( size_t i = 0; i < requests; i++ ) {
+        if ( client.send( request.c_str(), request.size() ) != common::SystemError::ecOK ) return;
+        std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      }
+      // a reply holds all requests that were read together, one line each
+      char buf[4096];
+      while ( replies[c] < requests ) {
+        ssize_t count = 0;
+        if ( client.receive( buf, sizeof( buf ), count ) != common::SystemError::ecOK || count <= 0 ) break;
+        replies[c] += std::count( buf, buf + count, '\n' );
+      }
+      client.close();
+    } ) );
+  }
+  for ( auto &thread : threads ) thread.join();
+  listener.stop();
+  listener.wait();
+  bool ok = true;
+  for ( auto count : replies ) ok = ok && count == requests;
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED" << std::endl;
+  return ok;
+}
+
+bool test5() {
+  // in worker-owned mode, connections are assigned to the TCPServers, which poll and expire them on their own
+  std::cout << "TCPListener worker-owned connections and idle timeout ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19696;
+  yaml["min-servers"] = 2;
+  yaml["max-servers"] = 2;
+  yaml["max-connections"] = 16;
+  yaml["worker-owned"] = true;
+  yaml["idle-timeout-ms"] = 500;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", 19696 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new EchoServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  // the idle connection is answered once, then closed by the TCPServer owning it after the idle timeout
+  network::Socket idle( true, params );
+  bool ok = idle.connect( address ) == common::SystemError::ecOK;
+  std::string request = "request\n";
+  std::string reply;
+  ok = ok && idle.send( request.c_str(), request.size() ) == common::SystemError::ecOK &&
+       idle.receiveLine( reply ) == common::SystemError::ecOK;
+  uint64_t idle_ns = common::steadyNanos();
+  const size_t clients = 4;
+  std::vector<bool> done( clients, false );
+  std::vector<std::set<std::string>> servers( clients );
+  std::vector<std::thread> threads;
+  for ( size_t c = 0; c < clients; c++ ) {
+    threads.push_back( std::thread( [&, c] {
+      network::Socket client( true, params );
+      if ( client.connect( address ) != common::SystemError::ecOK ) return;
+      client.setReceiveTimeout( 5 );
+      for ( int i = 0; i < 50; i++ ) {
+        std::string reply;
+        if ( client.send( request.c_str(), request.size() ) != common::SystemError::ecOK ||
+             client.receiveLine( reply ) != common::SystemError::ecOK ) return;
+        servers[c].insert( reply.substr( 0, reply.find( ' ' ) ) );
+      }
+      client.close();
+      done[c] = true;
+    } ) );
+  }
+  for ( auto &thread : threads ) thread.join();
+  std::set<std::string> owners;
+  for ( size_t c = 0; c < clients; c++ ) {
+    // a connection is serviced by the TCPServer that owns it
+    ok = ok && done[c] && servers[c].size() == 1;
+    owners.insert( servers[c].begin(), servers[c].end() );
+  }
+  idle.setReceiveTimeout( 5 );
+  char buf[16];
+  ssize_t count = -1;
+  ok = ok && idle.receive( buf, sizeof( buf ), count ) == common::SystemError::ecOK && count == 0;
+  double idle_s = (double)( common::steadyNanos() - idle_ns ) / 1.0E9;
+  idle.close();
+  network::TCPListener::Stats stats = listener.getStats();
+  listener.stop();
+  listener.wait();
+  ok = ok && owners.size() == 2 && idle_s >= 0.4 && idle_s < 3 && stats.timeouts == 1;
+  if ( ok ) std::cout << "OK" << std::endl;
+  else std::cout << "FAILED (" << owners.size() << " owners, idle closed after " << idle_s << "s)" << std::endl;
+  return ok;
+}
+
+bool test6( bool shed, uint16_t port ) {
+  // once the work queue exceeds max-queue-depth, new connections are left in the backlog or shed, until the
+  // TCPServers drain the queue and the TCPListener is woken to resume accepting
+  std::cout << "TCPListener admission pause " << ( shed ? "shedding" : "backlog" ) << " ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = port;
+  yaml["min-servers"] = 1;
+  yaml["max-servers"] = 1;
+  yaml["max-connections"] = 16;
+  yaml["max-queue-depth"] = 2;
+  yaml["shed-connections"] = shed;
+  // longer than the receive timeouts and without timeouts to check, so that only the resume eventfd wakes the
+  // TCPListener in time
+  yaml["listener-sleep-ms"] = 10000;
+  yaml["handshake-timeout-ms"] = 0;
+  yaml["request-timeout-ms"] = 0;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", port );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new GateServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  gate_open = false;
+  std::string request = "request\n";
+  std::vector<network::Socket> clients;
+  bool ok = true;
+  // the first request holds the only TCPServer, the others queue up until the third exceeds the queue depth
+  for ( size_t c = 0; ok && c < 3; c++ ) {
+    clients.push_back( network::Socket( true, params ) );
+    ok = clients.back().connect( address ) == common::SystemError::ecOK &&
+         clients.back().send( request.c_str(), request.size() ) == common::SystemError::ecOK;
+    std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+  }
+  // the excess connection is closed right away, or completes in the kernel backlog but is not answered
+  network::Socket excess( true, params );
+  ok = ok && excess.connect( address ) == common::SystemError::ecOK &&
+       excess.send( request.c_str(), request.size() ) == common::SystemError::ecOK;
+  excess.setReceiveTimeout( 0.5 );
+  char buf[256];
+  ssize_t count = -1;
+  common::SystemError error = common::SystemError::ecOK;
+  bool refused = false;
+  try {
+    if ( ok ) error = excess.receive( buf, sizeof( buf ), count );
+    refused = error == common::SystemError::ecOK && count == 0;
+  }
+  catch ( common::Exception &e ) {
+    // reset as the request was not read
+    refused = true;
+  }
+  ok = ok && ( shed ? refused : error == common::SystemError::ecEAGAIN );
+  gate_open = true;
+  std::string reply;
+  // the clients stay connected, their close would wake the TCPListener
+  for ( auto &client : clients ) {
+    client.setReceiveTimeout( 5 );
+    ok = ok && client.receiveLine( reply ) == common::SystemError::ecOK;
+  }
+  // once resumed, the waiting connection is accepted and answered, or a new connection is
+  excess.setReceiveTimeout( 5 );
+  if ( shed ) {
+    excess.close();
+    // leave the TCPListener time to be woken
+    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+    excess = network::Socket( true, params );
+    ok = ok && excess.connect( address ) == common::SystemError::ecOK &&
+         excess.send( request.c_str(), request.size() ) == common::SystemError::ecOK;
+    excess.setReceiveTimeout( 5 );
+  }
+  ok = ok && excess.receiveLine( reply ) == common::SystemError::ecOK;
+  excess.close();
+  for ( auto &client : clients ) client.close();
+  network::TCPListener::Stats stats = listener.getStats();
+  listener.stop();
+  listener.wait();
+  ok = ok && stats.admission_pauses >= 1 && ( shed ? stats.shed == 1 : stats.shed == 0 );
+  if ( ok ) std::cout << "OK" << std::endl;
+  else std::cout << "FAILED (" << error.asString() << " pauses " << stats.admission_pauses << " shed " <<
+                    stats.shed << ")" << std::endl;
+  return ok;
+}
+
+bool test7() {
+  // with two listener shards, the kernel spreads the connections over both SO_REUSEPORT sockets and each shard
+  // services its connections with its own TCPServers
+  std::cout << "TCPListener listener shards ... ";
+  YAML::Node yaml;
+  yaml["listen-address"] = "127.0.0.1";
+  yaml["listen-port"] = 19699;
+  yaml["min-servers"] = 2;
+  yaml["max-servers"] = 2;
+  yaml["max-connections"] = 16;
+  yaml["listener-shards"] = 2;
+  yaml["stat-trc-interval-s"] = 300;
+  network::Address address( "127.0.0.1", 19699 );
+  network::SocketParams params( address.getAddressFamily(), network::SocketParams::stSTREAM,
+                                network::SocketParams::pnHOPOPT );
+  network::TCPListener listener( yaml );
+  listener.start( new ShardServer( listener ) );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+  std::set<std::string> shards;
+  bool ok = true;
+  // the connections hash to a shard by their source port, all on one shard is unlikely beyond a few
+  for ( int i = 0; ok && i < 32; i++ ) {
+    network::Socket client( true, params );
+    std::string request = "request\n";
+    std::string reply;
+    ok = client.connect( address ) == common::SystemError::ecOK &&
+         client.send( request.c_str(), request.size() ) == common::SystemError::ecOK &&
+         client.receiveLine( reply ) == common::SystemError::ecOK;
+    shards.insert( reply );
+    client.close();
+  }
+  network::TCPListener::Stats stats = listener.getStats();
+  listener.stop();
+  listener.wait();
+  // the Stats exclude those of the other shard
+  ok = ok && shards.size() == 2 && stats.connections > 0 && stats.connections < 32;
+  if ( ok ) std::cout << "OK" << std::endl; else std::cout << "FAILED (" << shards.size() << " shards)" << std::endl;
+  return ok;
+}
+
+int main() {
+  const std::string config = "/tmp/test-network-tcplistener.yaml";
+  std::ofstream( config ) << "dodo:\n  common:\n    application:\n      name: test-network-tcplistener\n"
+                             "    logger:\n      console:\n        level: warning\n";
+  dodo::initLibrary();
+  common::Config* cfg = common::Config::initialize( config );
+  common::Logger::initialize( *cfg );
+  bool ok = writeIdentity();
+
+  ok = ok && test1();
+  ok = ok && test2( "epoll", 19692 );
+  ok = ok && test2( "io_uring", 19693 );
+  ok = ok && test3();
+  ok = ok && test4();
+  ok = ok && test5();
+  ok = ok && test6( false, 19697 );
+  ok = ok && test6( true, 19698 );
+  ok = ok && test7();
+
+  dodo::closeLibrary();
+  ::unlink( config.c_str() );
+  ::unlink( cert_file.c_str() );
+  ::unlink( key_file.c_str() );
+  return !ok;
+}
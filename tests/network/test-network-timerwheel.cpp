@@ -0,0 +1,154 @@
+#include <iostream>
+#include <map>
+#include <random>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/** The tick in nanoseconds. */
+const uint64_t tick = 1000000;
+
+/** The ticks covered by the two levels. */
+const uint64_t span = network::TimerWheel::wheel_size * network::TimerWheel::wheel_size;
+
+/**
+ * Advance the TimerWheel one tick at a time up to ticks, recording the tick at which each token expired. Fails if
+ * a token expires twice.
+ */
+bool step( network::TimerWheel &wheel, uint64_t from, uint64_t ticks, std::map<uint64_t,uint64_t> &expired ) {
+  bool ok = true;
+  for ( uint64_t t = from + 1; t <= ticks; t++ ) {
+    wheel.expire( t * tick, [&]( uint64_t token ) {
+      if ( !expired.insert( { token, t } ).second ) ok = false;
+    } );
+  }
+  return ok;
+}
+
+bool test1() {
+  // a token expires on the tick of its deadline, rounded up, and not before
+  std::cout << "TimerWheel schedule and expire ... ";
+  network::TimerWheel wheel( tick, 100 * tick );
+  std::map<uint64_t,uint64_t> expired;
+  wheel.schedule( 1, 105 * tick );
+  wheel.schedule( 2, 105 * tick + 1 );
+  wheel.schedule( 3, 110 * tick - 1 );
+  // a deadline that has passed expires on the next tick
+  wheel.schedule( 4, 50 * tick );
+  if ( wheel.size() != 4 ) return false;
+  if ( !step( wheel, 100, 120, expired ) ) return false;
+  if ( expired[1] != 105 || expired[2] != 106 || expired[3] != 110 || expired[4] != 101 ) return false;
+  if ( wheel.size() != 0 ) return false;
+  // expiring without advancing does nothing
+  size_t calls = 0;
+  wheel.schedule( 5, 130 * tick );
+  wheel.expire( 120 * tick, [&]( uint64_t ) { calls++; } );
+  wheel.expire( 125 * tick, [&]( uint64_t ) { calls++; } );
+  if ( calls != 0 || wheel.size() != 1 ) return false;
+  // a jump expires all that are due
+  wheel.expire( 1000 * tick, [&]( uint64_t token ) { calls += token; } );
+  if ( calls != 5 || wheel.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // the owner cancels or moves deadlines lazily, ignoring or rescheduling tokens expire() hands back
+  std::cout << "TimerWheel cancel and reschedule ... ";
+  network::TimerWheel wheel( tick, 0 );
+  std::map<uint64_t,uint64_t> deadlines;
+  std::map<uint64_t,uint64_t> fired;
+  for ( uint64_t token = 1; token <= 30; token++ ) {
+    deadlines[token] = token * 10 * tick;
+    wheel.schedule( token, deadlines[token] );
+  }
+  // cancel the even tokens, move the multiples of 3 later by 1000 ticks
+  for ( uint64_t token = 1; token <= 30; token++ ) {
+    if ( token % 2 == 0 ) deadlines[token] = 0;
+    else if ( token % 3 == 0 ) deadlines[token] += 1000 * tick;
+  }
+  for ( uint64_t t = 1; t <= 2000; t++ ) {
+    wheel.expire( t * tick, [&]( uint64_t token ) {
+      uint64_t deadline = deadlines[token];
+      if ( !deadline ) return;
+      if ( deadline > t * tick ) {
+        wheel.schedule( token, deadline );
+        return;
+      }
+      fired[token] = t;
+    } );
+  }
+  for ( uint64_t token = 1; token <= 30; token++ ) {
+    if ( token % 2 == 0 ) {
+      if ( fired.count( token ) ) return false;
+    } else if ( fired[token] * tick != deadlines[token] ) {
+      return false;
+    }
+  }
+  if ( wheel.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // deadlines on the second level are cascaded to the first and expire on their tick
+  std::cout << "TimerWheel cascade ... ";
+  uint64_t start = 12345;
+  network::TimerWheel wheel( tick, start * tick );
+  std::mt19937_64 random( 42 );
+  std::map<uint64_t,uint64_t> due;
+  for ( uint64_t token = 0; token < 5000; token++ ) {
+    uint64_t ticks = 1 + random() % ( span - 1 );
+    // include the level and bucket boundaries
+    if ( token < 8 ) ticks = network::TimerWheel::wheel_size * ( token + 1 ) + token % 2 - 1;
+    due[token] = start + ticks;
+    wheel.schedule( token, due[token] * tick );
+  }
+  std::map<uint64_t,uint64_t> expired;
+  if ( !step( wheel, start, start + span + 1, expired ) ) return false;
+  if ( expired != due || wheel.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // deadlines beyond the span of the two levels are parked and rescheduled, never expire early
+  std::cout << "TimerWheel beyond the wheel span ... ";
+  network::TimerWheel wheel( tick, 0 );
+  std::map<uint64_t,uint64_t> due = { { 1, span }, { 2, span + 1 }, { 3, 2 * span + 17 }, { 4, 5 * span - 3 } };
+  for ( const auto &d : due ) wheel.schedule( d.first, d.second * tick );
+  std::map<uint64_t,uint64_t> expired;
+  if ( !step( wheel, 0, 5 * span, expired ) ) return false;
+  if ( expired != due || wheel.size() != 0 ) return false;
+  // in jumps, a token expires at the first expire() at or after its deadline
+  network::TimerWheel jumps( tick, 0 );
+  jumps.schedule( 1, 3 * span * tick );
+  size_t calls = 0;
+  for ( uint64_t t = span / 2; t < 3 * span; t += span / 2 ) {
+    jumps.expire( t * tick, [&]( uint64_t ) { calls++; } );
+  }
+  if ( calls != 0 ) return false;
+  jumps.expire( 3 * span * tick, [&]( uint64_t ) { calls++; } );
+  if ( calls != 1 || jumps.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include <iostream>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/** The self-signed certificate and key of the server. */
+const std::string cert_file = "/tmp/test-network-tlssessioncache.cert.pem";
+const std::string key_file = "/tmp/test-network-tlssessioncache.key.pem";
+
+/**
+ * Return a key of the shard, with shards shards.
+ */
+std::string shardKey( size_t shard, size_t shards, size_t &counter ) {
+  while ( true ) {
+    std::string key = "key-" + std::to_string( counter++ );
+    if ( std::hash<std::string>()( key ) % shards == shard ) return key;
+  }
+}
+
+/**
+ * Return true if the cache has a session for the key.
+ */
+bool cached( network::TLSSessionCache &cache, const std::string &key ) {
+  SSL_SESSION* session = cache.get( key );
+  if ( !session ) return false;
+  SSL_SESSION_free( session );
+  return true;
+}
+
+/**
+ * Write a self-signed certificate and its key to cert_file and key_file.
+ */
+bool writeIdentity() {
+  EVP_PKEY* pkey = nullptr;
+  EVP_PKEY_CTX* pctx = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, nullptr );
+  bool ok = pctx && EVP_PKEY_keygen_init( pctx ) == 1 &&
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid( pctx, NID_X9_62_prime256v1 ) == 1 &&
+            EVP_PKEY_keygen( pctx, &pkey ) == 1;
+  EVP_PKEY_CTX_free( pctx );
+  X509* cert = X509_new();
+  if ( ok ) {
+    X509_set_version( cert, 2 );
+    ASN1_INTEGER_set( X509_get_serialNumber( cert ), 1 );
+    X509_gmtime_adj( X509_getm_notBefore( cert ), 0 );
+    X509_gmtime_adj( X509_getm_notAfter( cert ), 3600 );
+    X509_set_pubkey( cert, pkey );
+    X509_NAME* name = X509_get_subject_name( cert );
+    X509_NAME_add_entry_by_txt( name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0 );
+    X509_set_issuer_name( cert, name );
+    ok = X509_sign( cert, pkey, EVP_sha256() ) > 0;
+  }
+  FILE* f = ok ? fopen( cert_file.c_str(), "w" ) : nullptr;
+  ok = f && PEM_write_X509( f, cert ) == 1;
+  if ( f ) fclose( f );
+  f = ok ? fopen( key_file.c_str(), "w" ) : nullptr;
+  ok = f && PEM_write_PrivateKey( f, pkey, nullptr, nullptr, 0, nullptr, nullptr ) == 1;
+  if ( f ) fclose( f );
+  X509_free( cert );
+  EVP_PKEY_free( pkey );
+  return ok;
+}
+
+/**
+ * Complete a TLS 1.2 handshake between a client SSL_CTX and the server TLSContext over memory BIOs, offering the
+ * session if not nullptr.
+ * @param resumed Set to true if the handshake resumed the session.
+ * @return The client session, with a reference for the caller, or nullptr if the handshake failed.
+ */
+SSL_SESSION* handShake( SSL_CTX* client_ctx, network::TLSContext &server_ctx, SSL_SESSION* session,
+                        bool &resumed ) {
+  SSL* client = SSL_new( client_ctx );
+  SSL* server = SSL_new( server_ctx.getContext() );
+  BIO* client_bio = nullptr;
+  BIO* server_bio = nullptr;
+  BIO_new_bio_pair( &client_bio, 0, &server_bio, 0 );
+  SSL_set_bio( client, client_bio, client_bio );
+  SSL_set_bio( server, server_bio, server_bio );
+  if ( session ) SSL_set_session( client, session );
+  SSL_set_connect_state( client );
+  SSL_set_accept_state( server );
+  bool client_done = false;
+  bool server_done = false;
+  for ( int i = 0; i < 100 && !( client_done && server_done ); i++ ) {
+    if ( !client_done ) {
+      int rc = SSL_do_handshake( client );
+      if ( rc == 1 ) client_done = true;
+      else if ( SSL_get_error( client, rc ) != SSL_ERROR_WANT_READ ) break;
+    }
+    if ( !server_done ) {
+      int rc = SSL_do_handshake( server );
+      if ( rc == 1 ) server_done = true;
+      else if ( SSL_get_error( server, rc ) != SSL_ERROR_WANT_READ ) break;
+    }
+  }
+  SSL_SESSION* result = nullptr;
+  if ( client_done && server_done ) {
+    resumed = SSL_session_reused( client ) == 1;
+    result = SSL_get1_session( client );
+    // an SSL freed without shutdown removes its session from the cache
+    SSL_shutdown( client );
+    SSL_shutdown( server );
+  }
+  SSL_free( client );
+  SSL_free( server );
+  return result;
+}
+
+bool test1() {
+  // a session is found until its time to live has passed
+  std::cout << "TLSSessionCache ttl expiry ... ";
+  network::TLSSessionCache cache( 16, 1, 4 );
+  cache.add( "a", SSL_SESSION_new() );
+  cache.add( "b", SSL_SESSION_new() );
+  if ( !cached( cache, "a" ) || !cached( cache, "b" ) || cached( cache, "c" ) ) return false;
+  std::this_thread::sleep_for( std::chrono::milliseconds( 600 ) );
+  // replacing a session restarts its time to live
+  cache.add( "b", SSL_SESSION_new() );
+  if ( cache.size() != 2 ) return false;
+  std::this_thread::sleep_for( std::chrono::milliseconds( 600 ) );
+  if ( cached( cache, "a" ) || !cached( cache, "b" ) ) return false;
+  std::this_thread::sleep_for( std::chrono::milliseconds( 600 ) );
+  if ( cached( cache, "b" ) ) return false;
+  // expired sessions are evicted on the next add to their shard
+  size_t counter = 0;
+  for ( size_t shard = 0; shard < 4; shard++ ) cache.add( shardKey( shard, 4, counter ), SSL_SESSION_new() );
+  if ( cache.size() != 4 ) return false;
+  cache.remove( "none" );
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // each shard holds size / shards sessions and evicts the oldest first, without affecting the other shards
+  std::cout << "TLSSessionCache capacity eviction per shard ... ";
+  const size_t shards = 4;
+  network::TLSSessionCache cache( 3 * shards, 300, shards );
+  size_t counter = 0;
+  std::vector<std::string> other;
+  for ( size_t shard = 1; shard < shards; shard++ ) {
+    other.push_back( shardKey( shard, shards, counter ) );
+    cache.add( other.back(), SSL_SESSION_new() );
+  }
+  std::vector<std::string> keys;
+  for ( size_t i = 0; i < 5; i++ ) {
+    keys.push_back( shardKey( 0, shards, counter ) );
+    cache.add( keys.back(), SSL_SESSION_new() );
+  }
+  if ( cache.size() != 3 + other.size() ) return false;
+  if ( cached( cache, keys[0] ) || cached( cache, keys[1] ) ) return false;
+  for ( size_t i = 2; i < 5; i++ ) if ( !cached( cache, keys[i] ) ) return false;
+  for ( const auto &key : other ) if ( !cached( cache, key ) ) return false;
+  // replacing a session moves it to the back of the order, so the next add evicts the one after it
+  cache.add( keys[2], SSL_SESSION_new() );
+  keys.push_back( shardKey( 0, shards, counter ) );
+  cache.add( keys.back(), SSL_SESSION_new() );
+  if ( !cached( cache, keys[2] ) || cached( cache, keys[3] ) || !cached( cache, keys[4] ) ) return false;
+  // a removed session makes room
+  cache.remove( keys[4] );
+  keys.push_back( shardKey( 0, shards, counter ) );
+  cache.add( keys.back(), SSL_SESSION_new() );
+  if ( !cached( cache, keys[2] ) || !cached( cache, keys[5] ) || !cached( cache, keys[6] ) ) return false;
+  if ( cache.size() != 3 + other.size() ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // the TLSContext resumes sessions by id from its TLSSessionCache
+  std::cout << "TLSContext resumes from the session cache ... ";
+  network::TLSContext server( network::TLSContext::PeerVerification::pvVerifyNone,
+                              network::TLSContext::TLSVersion::tls1_2, false, false );
+  server.loadPEMIdentity( cert_file, key_file, "" );
+  server.setSessionCache( 16, 300, 4 );
+  server.setSessionTickets( false );
+  SSL_CTX* client = SSL_CTX_new( TLS_client_method() );
+  SSL_CTX_set_max_proto_version( client, TLS1_2_VERSION );
+  SSL_CTX_set_options( client, SSL_OP_NO_TICKET );
+  bool resumed = true;
+  SSL_SESSION* session = handShake( client, server, nullptr, resumed );
+  bool ok = session && !resumed && server.getSessionStats().cached == 1;
+  SSL_SESSION* again = ok ? handShake( client, server, session, resumed ) : nullptr;
+  ok = ok && again && resumed;
+  SSL_SESSION_free( again );
+  SSL_SESSION_free( session );
+  SSL_CTX_free( client );
+  if ( !ok ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // a ticket is resumed after its key has been rotated, until the key is dropped a rotation interval later
+  std::cout << "TLSContext resumes after ticket key rotation ... ";
+  network::TLSContext server( network::TLSContext::PeerVerification::pvVerifyNone,
+                              network::TLSContext::TLSVersion::tls1_2, false, false );
+  server.loadPEMIdentity( cert_file, key_file, "" );
+  server.setSessionTickets( true, 1 );
+  SSL_CTX* client = SSL_CTX_new( TLS_client_method() );
+  SSL_CTX_set_max_proto_version( client, TLS1_2_VERSION );
+  bool resumed = true;
+  SSL_SESSION* session = handShake( client, server, nullptr, resumed );
+  bool ok = session && !resumed;
+  // the first key is replaced but still decrypts
+  std::this_thread::sleep_for( std::chrono::milliseconds( 1200 ) );
+  SSL_SESSION* renewed = ok ? handShake( client, server, session, resumed ) : nullptr;
+  ok = ok && renewed && resumed;
+  // the first key is dropped, the ticket renewed with the second key is resumed
+  std::this_thread::sleep_for( std::chrono::milliseconds( 1200 ) );
+  SSL_SESSION* again = ok ? handShake( client, server, renewed, resumed ) : nullptr;
+  ok = ok && again && resumed;
+  SSL_SESSION_free( again );
+  again = ok ? handShake( client, server, session, resumed ) : nullptr;
+  ok = ok && again && !resumed;
+  SSL_SESSION_free( again );
+  SSL_SESSION_free( renewed );
+  SSL_SESSION_free( session );
+  SSL_CTX_free( client );
+  if ( !ok ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  dodo::initLibrary();
+  bool ok = writeIdentity();
+
+  ok = ok && test1();
+  ok = ok && test2();
+  ok = ok && test3();
+  ok = ok && test4();
+
+  dodo::closeLibrary();
+  ::unlink( cert_file.c_str() );
+  ::unlink( key_file.c_str() );
+  return !ok;
+}
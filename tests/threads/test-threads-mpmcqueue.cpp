@@ -0,0 +1,145 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+bool test1() {
+  // push and pop in FIFO order, capacity rounded up to a power of 2
+  std::cout << "MPMCQueue push and pop ... ";
+  threads::MPMCQueue<int> queue( 5 );
+  if ( queue.capacity() != 8 ) return false;
+  int item = 0;
+  if ( queue.pop( item ) || queue.size() != 0 ) return false;
+  for ( int i = 0; i < 5; i++ ) if ( !queue.push( i ) ) return false;
+  if ( queue.size() != 5 ) return false;
+  for ( int i = 0; i < 5; i++ ) {
+    if ( !queue.pop( item ) || item != i ) return false;
+  }
+  if ( queue.pop( item ) || queue.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // push fails when full, and succeeds again after a pop
+  std::cout << "MPMCQueue full and empty ... ";
+  threads::MPMCQueue<int> queue( 4 );
+  for ( int i = 0; i < 4; i++ ) if ( !queue.push( i ) ) return false;
+  if ( queue.push( 4 ) || queue.size() != 4 ) return false;
+  int item = 0;
+  if ( !queue.pop( item ) || item != 0 ) return false;
+  if ( !queue.push( 4 ) || queue.push( 5 ) ) return false;
+  int items[8];
+  if ( queue.pop( items, 8 ) != 4 || items[0] != 1 || items[3] != 4 ) return false;
+  if ( queue.pop( items, 8 ) != 0 || queue.pop( items, 0 ) != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // batch pop claims up to n ready items, in order
+  std::cout << "MPMCQueue batch pop ... ";
+  threads::MPMCQueue<int> queue( 16 );
+  for ( int i = 0; i < 10; i++ ) if ( !queue.push( i ) ) return false;
+  int items[16];
+  if ( queue.pop( items, 4 ) != 4 ) return false;
+  for ( int i = 0; i < 4; i++ ) if ( items[i] != i ) return false;
+  if ( queue.pop( items, 16 ) != 6 ) return false;
+  for ( int i = 0; i < 6; i++ ) if ( items[i] != i + 4 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // the positions wrap around the cell array many times over
+  std::cout << "MPMCQueue index wraparound ... ";
+  threads::MPMCQueue<uint64_t> queue( 4 );
+  uint64_t next_push = 0;
+  uint64_t next_pop = 0;
+  uint64_t items[3];
+  for ( int lap = 0; lap < 10000; lap++ ) {
+    while ( queue.push( next_push ) ) next_push++;
+    size_t n = queue.pop( items, 1 + lap % 3 );
+    for ( size_t i = 0; i < n; i++ ) {
+      if ( items[i] != next_pop++ ) return false;
+    }
+  }
+  uint64_t item = 0;
+  while ( queue.pop( item ) ) {
+    if ( item != next_pop++ ) return false;
+  }
+  if ( next_pop != next_push || next_push < 10000 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test5() {
+  // every item pushed by the producers is popped exactly once by the consumers
+  std::cout << "MPMCQueue multi-producer multi-consumer ... ";
+  const size_t producers = 4;
+  const size_t consumers = 4;
+  const uint32_t per_producer = 100000;
+  threads::MPMCQueue<uint64_t> queue( 64 );
+  std::vector<std::atomic<uint8_t>> seen( producers * per_producer );
+  std::atomic<size_t> popped = 0;
+  std::atomic<bool> ordered = true;
+  std::vector<std::thread> threads;
+  for ( size_t p = 0; p < producers; p++ ) {
+    threads.emplace_back( [&,p] {
+      for ( uint32_t i = 0; i < per_producer; i++ ) {
+        while ( !queue.push( ( (uint64_t)p << 32 ) | i ) ) std::this_thread::yield();
+      }
+    } );
+  }
+  for ( size_t c = 0; c < consumers; c++ ) {
+    threads.emplace_back( [&,c] {
+      uint64_t items[8];
+      // items of one producer are popped by a consumer in the order pushed
+      std::vector<int64_t> last( producers, -1 );
+      while ( popped < producers * per_producer ) {
+        size_t n = queue.pop( items, 1 + c % 8 );
+        if ( n == 0 ) {
+          std::this_thread::yield();
+          continue;
+        }
+        for ( size_t i = 0; i < n; i++ ) {
+          size_t p = items[i] >> 32;
+          uint32_t index = items[i] & 0xFFFFFFFF;
+          if ( (int64_t)index <= last[p] ) ordered = false;
+          last[p] = index;
+          seen[p * per_producer + index]++;
+        }
+        popped += n;
+      }
+    } );
+  }
+  for ( auto &t : threads ) t.join();
+  for ( auto &s : seen ) if ( s != 1 ) return false;
+  if ( !ordered || queue.size() != 0 ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  ok = ok && test5();
+  if ( !ok ) return 1;
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <dodo.hpp>
+
+using namespace dodo;
+
+/**
+ * Return the milliseconds since start.
+ */
+double elapsedMs( std::chrono::steady_clock::time_point start ) {
+  return std::chrono::duration<double,std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
+
+bool test1() {
+  // posts are counted, a positive count does not wait
+  std::cout << "Semaphore post and wait ... ";
+  threads::Semaphore sem( 2 );
+  if ( !sem.tryWait() || !sem.wait( 0 ) || sem.tryWait() ) return false;
+  sem.post();
+  sem.post();
+  sem.post();
+  for ( int i = 0; i < 3; i++ ) if ( !sem.wait( 1000 ) ) return false;
+  if ( sem.tryWait() ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test2() {
+  // a timed wait without a post expires after its timeout
+  std::cout << "Semaphore timed wait expiry ... ";
+  threads::Semaphore sem;
+  auto start = std::chrono::steady_clock::now();
+  if ( sem.wait( 50 ) ) return false;
+  double ms = elapsedMs( start );
+  if ( ms < 50.0 || ms > 5000.0 ) return false;
+  start = std::chrono::steady_clock::now();
+  if ( sem.wait( 0 ) || elapsedMs( start ) > 1000.0 ) return false;
+  // a post after the expiry is kept for the next wait
+  sem.post();
+  if ( !sem.wait( 0 ) ) return false;
+  std::cout << "OK (" << ms << "ms)" << std::endl;
+  return true;
+}
+
+bool test3() {
+  // a post wakes a thread waiting without timeout, and one with a timeout before it expires
+  std::cout << "Semaphore post wakes a waiting thread ... ";
+  threads::Semaphore sem;
+  std::atomic<int> woken = 0;
+  std::thread forever( [&] { if ( sem.wait() ) woken++; } );
+  std::thread timed( [&] { if ( sem.wait( 10000 ) ) woken++; } );
+  std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+  if ( woken != 0 ) return false;
+  auto start = std::chrono::steady_clock::now();
+  sem.post();
+  sem.post();
+  forever.join();
+  timed.join();
+  if ( woken != 2 || elapsedMs( start ) > 5000.0 || sem.tryWait() ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+bool test4() {
+  // each post is consumed by exactly one of many waiters
+  std::cout << "Semaphore many waiters ... ";
+  const int waiters = 8;
+  const int rounds = 2000;
+  threads::Semaphore sem;
+  std::atomic<int> consumed = 0;
+  std::vector<std::thread> threads;
+  for ( int t = 0; t < waiters; t++ ) {
+    threads.emplace_back( [&] {
+      while ( sem.wait( 5000 ) ) {
+        if ( ++consumed > waiters * rounds ) return;
+      }
+    } );
+  }
+  for ( int i = 0; i < waiters * rounds; i++ ) sem.post();
+  while ( consumed < waiters * rounds ) std::this_thread::yield();
+  // one more post per waiter to let them exit
+  for ( int t = 0; t < waiters; t++ ) sem.post();
+  for ( auto &t : threads ) t.join();
+  if ( consumed != waiters * rounds + waiters || sem.tryWait() ) return false;
+  std::cout << "OK" << std::endl;
+  return true;
+}
+
+int main() {
+  std::cout << dodo::BuildEnv::getDescription();
+  bool ok = true;
+
+  ok = ok && test1();
+  if ( !ok ) return 1;
+
+  ok = ok && test2();
+  if ( !ok ) return 1;
+
+  ok = ok && test3();
+  if ( !ok ) return 1;
+
+  ok = ok && test4();
+  if ( !ok ) return 1;
+
+  return 0;
+}